@@ -118,10 +118,11 @@ int main(void)
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
-  HAL_Delay(20000);  
+  ME3616_Delay(&ME3616_Instance, 20000);  
   DBG_Print("Demo End.",DBG_DIR_APP);  
   while (1)
   {
+	ME3616_Poll(&ME3616_Instance);
 	
 	
 
@@ -265,7 +265,15 @@ void USART1_IRQHandler(void)
   /* USER CODE END USART1_IRQn 0 */
   HAL_UART_IRQHandler(&huart1);
   /* USER CODE BEGIN USART1_IRQn 1 */
+#ifdef ME3616_RX_IDLE_MODE
+  if(__HAL_UART_GET_FLAG(&huart1, UART_FLAG_IDLE) == true )
+  {
+    __HAL_UART_CLEAR_IDLEFLAG(&huart1);
+    UART_AT_Rx_Event(&ME3616_Instance);
+  }
+#else
   if(__HAL_UART_GET_FLAG(&huart1, UART_FLAG_CMF) == true ) UART_AT_Receive(&ME3616_Instance);
+#endif
   
   /* USER CODE END USART1_IRQn 1 */
 }
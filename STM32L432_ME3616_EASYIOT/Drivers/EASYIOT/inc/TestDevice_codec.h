@@ -0,0 +1,155 @@
+/*
+ * Generated from TestDevice.h by Host/Tools/easyiot_gen, do not edit, regenerate
+ * when the product definition changes:
+ * easyiot_gen TestDevice.h msg_1=Sensor_1,Sensor_2,Led_Green CMD_1=Led_Green:result,Led_Green
+ */
+
+#ifndef _GUARD_H_TestDevice_codec
+#define _GUARD_H_TestDevice_codec
+
+#include <stdint.h>
+#include <string.h>
+
+#include "easyiot.h"
+#include "easyiot_endian.h"
+#include "TestDevice.h"
+
+// Offsets and checksum were computed with these
+#if EASYIOT_UP_HEADER_SIZE != 49 || EASYIOT_RSP_HEADER_SIZE != 6
+#error "EasyIoT header size changed, regenerate"
+#endif
+#if MSG_1_MSGID != 1
+#error "MSG_1_MSGID changed, regenerate"
+#endif
+#if CMD_1_CMDID != 2
+#error "CMD_1_CMDID changed, regenerate"
+#endif
+#if SENSOR_1_TLV_PARAMID != 1
+#error "SENSOR_1_TLV_PARAMID changed, regenerate"
+#endif
+#if SENSOR_2_TLV_PARAMID != 2
+#error "SENSOR_2_TLV_PARAMID changed, regenerate"
+#endif
+#if LED_GREEN_TLV_PARAMID != 3
+#error "LED_GREEN_TLV_PARAMID changed, regenerate"
+#endif
+#if RESULT_TLV_PARAMID != 0
+#error "RESULT_TLV_PARAMID changed, regenerate"
+#endif
+
+// Sum of the 4 bytes, for the checksum
+static inline uint32_t testdevice_sum32(uint32_t v)
+{
+	v = (v & 0x00FF00FFu) + ((v >> 8) & 0x00FF00FFu);
+	return (v & 0xFFFFu) + (v >> 16);
+}
+
+// Message msg_1, uplink
+#define MSG_1_LENGTH 68
+
+static inline int msg_1_encode(uint8_t* buf, uint16_t inMaxLength, uint16_t dtag_mid, int8_t sensor_1, int32_t sensor_2, int8_t led_green)
+{
+	struct MessageWriter w;
+	uint32_t sum;
+	uint32_t u32;
+
+	if (inMaxLength < MSG_1_LENGTH) {
+		return -1;
+	}
+	if (BeginMessage(&w, buf, inMaxLength, CMT_USER_UP, MSG_1_MSGID, dtag_mid) < 0) {
+		return -1;
+	}
+	sum = w.sum + 0x5Bu;
+	nb_store_be16(buf + 2, 64);
+	nb_store_be16(buf + 50, 15);
+
+	buf[52] = SENSOR_1_TLV_PARAMID;
+	buf[53] = 0;
+	buf[54] = 1;
+	buf[55] = (uint8_t)sensor_1;
+	sum += buf[55];
+
+	buf[56] = SENSOR_2_TLV_PARAMID;
+	buf[57] = 0;
+	buf[58] = 4;
+	u32 = (uint32_t)sensor_2;
+	nb_store_be32(buf + 59, u32);
+	sum += testdevice_sum32(u32);
+
+	buf[63] = LED_GREEN_TLV_PARAMID;
+	buf[64] = 0;
+	buf[65] = 1;
+	buf[66] = (uint8_t)led_green;
+	sum += buf[66];
+
+	buf[67] = (uint8_t)sum;
+	if (MSG_1_LENGTH < inMaxLength) {
+		buf[MSG_1_LENGTH] = '\0';
+	}
+	return MSG_1_LENGTH;
+}
+
+// Command CMD_1, request
+struct cmd_1_request {
+	int8_t led_green;
+};
+
+static inline int cmd_1_decode(const struct MessageReader* r, struct cmd_1_request* request)
+{
+	const uint8_t* p = r->buf + r->body;
+
+	if (r->msgType != CMT_USER_CMD_REQ || r->msgid != CMD_1_CMDID) {
+		return -1;
+	}
+
+	if (r->body == 9 && r->end - r->body == 4
+		&& p[0] == LED_GREEN_TLV_PARAMID && p[1] == 0 && p[2] == 1) {
+		request->led_green = (int8_t)p[3];
+		return 0;
+	}
+
+	// Other order or more TLVs
+	if (ReadInt8(r, LED_GREEN_TLV_PARAMID, &request->led_green) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+// Command CMD_1, response
+#define CMD_1_RSP_LENGTH 18
+
+static inline int cmd_1_respond(uint8_t* buf, uint16_t inMaxLength, uint16_t dtag_mid, int8_t result, int8_t led_green)
+{
+	struct MessageWriter w;
+	uint32_t sum;
+
+	if (inMaxLength < CMD_1_RSP_LENGTH) {
+		return -1;
+	}
+	if (BeginMessage(&w, buf, inMaxLength, CMT_USER_CMD_RSP, CMD_1_CMDID, dtag_mid) < 0) {
+		return -1;
+	}
+	sum = w.sum + 0x1Bu;
+	nb_store_be16(buf + 2, 14);
+	nb_store_be16(buf + 7, 8);
+
+	buf[9] = RESULT_TLV_PARAMID;
+	buf[10] = 0;
+	buf[11] = 1;
+	buf[12] = (uint8_t)result;
+	sum += buf[12];
+
+	buf[13] = LED_GREEN_TLV_PARAMID;
+	buf[14] = 0;
+	buf[15] = 1;
+	buf[16] = (uint8_t)led_green;
+	sum += buf[16];
+
+	buf[17] = (uint8_t)sum;
+	if (CMD_1_RSP_LENGTH < inMaxLength) {
+		buf[CMD_1_RSP_LENGTH] = '\0';
+	}
+	return CMD_1_RSP_LENGTH;
+}
+
+#endif
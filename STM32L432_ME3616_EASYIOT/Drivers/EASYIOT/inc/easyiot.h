@@ -10,6 +10,7 @@
 #define _GUARD_H_EASYIOT_H_
 
 #include <stdint.h>
+#include <stdarg.h>
 
 #define EASY_IOT_VERSION "0.0.1"
 
@@ -53,6 +54,33 @@ struct TLV {
 * Messages 5 TLV
 */
 #define MESSAGE_MAX_TLV 5
+
+/*
+* ڴأNewMessage  Messages  TLV ӹ̶СĿз䣬ʹ malloc
+* 1EASYIOT_MESSAGE_POOL_SIZEMessages ͬʱڵ NewMessage 
+* 2EASYIOT_TLV_POOL_SIZETLV ÿ麬 struct TLV  EASYIOT_TLV_VALUE_SIZE ֽڵ value
+* 3value  EASYIOT_TLV_VALUE_SIZE ʱNewMessageStatic Ϣ buffer з䣬NewMessage Ϣʧܡ
+* ͷžΪ O(1)жеá
+*/
+#ifndef EASYIOT_MESSAGE_POOL_SIZE
+#define EASYIOT_MESSAGE_POOL_SIZE 2
+#endif
+#ifndef EASYIOT_TLV_POOL_SIZE
+#define EASYIOT_TLV_POOL_SIZE (MESSAGE_MAX_TLV * 3)
+#endif
+#ifndef EASYIOT_TLV_VALUE_SIZE
+#define EASYIOT_TLV_VALUE_SIZE 16
+#endif
+
+/*
+* ָ handler  cmdidе msgid0~255ֱַΪ O(1)
+* 1256 ֽڵ¼ÿ cmdid ڵıֻΪע cmdid 䣻
+* 2EASYIOT_CMD_MAX_HANDLERע cmdid  255
+* 3ͬһ cmdid  handlerreader  context һظ滻
+*/
+#ifndef EASYIOT_CMD_MAX_HANDLER
+#define EASYIOT_CMD_MAX_HANDLER 16
+#endif
 struct Messages {
     
     /* ̬ڴ MessageMallocУʵһ򵥵ľ̬ڴƣֻ䣬ͷš */
@@ -85,6 +113,83 @@ struct Messages {
 	struct TLV* tlvs[MESSAGE_MAX_TLV];
 };
 
+/*
+* MessageWriterбĵĵι TLV 飬Ҳû TLV 
+* 1BeginMessage ֱ buffer д뱨ͷֶռλ
+* 2Put* ֽд TLVͬʱۼ checksum
+* 3EndMessage ܳ data ȣд checksum
+*/
+// data msgid֮ǰıͷȣɵı뺯Host/Tools/easyiot_gen˼̶ƫ
+// CMT_USER_UPver 1, type 1, length 2, dtag 2, battery 1, signal 4, imei 15, imsi 15, timestamp 8
+#define EASYIOT_UP_HEADER_SIZE 49
+// CMT_USER_CMD_RSPver 1, type 1, length 2, mid 2
+#define EASYIOT_RSP_HEADER_SIZE 6
+struct MessageWriter {
+	//  buffer 󳤶
+	uint8_t * buf;
+	uint16_t maxlength;
+
+	// һдλ
+	uint16_t pos;
+
+	// data msgidƫƣEndMessage ʱ䳤
+	uint16_t body;
+
+	// дֽڵۼӺͣռλĳֶδʱΪ 0
+	uint32_t sum;
+
+	// дʧܺλ֮ Put*  EndMessage  -1
+	uint8_t error;
+};
+
+/*
+* TLVViewбһ TLV ͼvalue ֱָ bufferûп
+* value δض룬Ҳֽ Read* ȡֵ
+*/
+struct TLVView {
+	const uint8_t * value;
+	uint16_t length;
+	uint8_t type;
+};
+
+/*
+* MessageReaderбĵԭؽ MessageWriter 
+* 1OpenMessage У汾ܳȡchecksumһ TLV ÿ length֮ĶȡԽ磻
+* 2NextTLV ˳ȡ TLVViewRead*  type ҲתΪֽ
+* 3 buffer ɵṩhandler غ󼴲ЧҪֵп
+*/
+struct MessageReader {
+	//  buffer 䳤ȣ checksum
+	const uint8_t * buf;
+	uint16_t length;
+
+	// һ TLV ƫƣ TLV Ľƫƣ checksum λã
+	uint16_t body;
+	uint16_t end;
+
+	// NextTLV ĵǰλ
+	uint16_t pos;
+
+	//  struct Messages еֶͬκͬ
+	uint16_t dtag_mid;
+	uint8_t msgid;
+	uint8_t msgType;
+	uint8_t tlv_count;
+};
+
+/*
+* ڴͳƣ GetMessagePoolStats  GetTLVPoolStats
+*/
+struct PoolStats {
+	uint16_t block_size;
+	uint16_t block_count;
+	// ǰռõĿʷֵ
+	uint16_t used;
+	uint16_t high_water;
+	// þʧܵĴ
+	uint32_t failed;
+};
+
 enum LoggingLevel {
 	LOG_TRACE,
 	LOG_DEBUG,
@@ -105,6 +210,9 @@ struct Messages* NewMessageStatic(uint8_t* buf, uint16_t inMaxLength);
 struct TLV* NewTLVStatic(struct Messages* msg, uint8_t type);
 
 void FreeMessage(struct Messages* msg);
+// ڴͳƣȷ EASYIOT_*_POOL_SIZE
+void GetMessagePoolStats(struct PoolStats* stats);
+void GetTLVPoolStats(struct PoolStats* stats);
 void setMessages(struct Messages* msg, enum CoapMessageType type, uint8_t msgid);
 
 // л뷴л
@@ -116,11 +224,48 @@ int CoapInput(struct Messages* msg, uint8_t *data, uint16_t inLength);
 int CoapHexInput(const char* data);
 int CoapHexInputStatic(const char* data, uint8_t* inBuf, uint16_t inMaxLength);
 /*
+* ԭشݣپ Messages 侲̬ڴhandler õ MessageReader
+* CoapHexInputInPlace  HEX ַ͵תΪƣд data ǰ벿֣data ᱻд
+*/
+int CoapInputInPlace(const uint8_t* data, uint16_t inLength);
+int CoapHexInputInPlace(char* data, uint16_t inLength);
+/*
 * ͺEasyIoT ƽ̨ Messages
 * ڲ CoapOutput ָӲ
 */
 int pushMessages(struct Messages *msg);
 
+/* ιбģtype ֧ CMT_USER_UP  CMT_USER_CMD_RSP */
+int BeginMessage(struct MessageWriter* w, uint8_t* buf, uint16_t inMaxLength, enum CoapMessageType type, uint8_t msgid, uint16_t dtag_mid);
+int PutInt8(struct MessageWriter* w, uint8_t type, int8_t v);
+int PutInt16(struct MessageWriter* w, uint8_t type, int16_t v);
+int PutInt32(struct MessageWriter* w, uint8_t type, int32_t v);
+int PutInt64(struct MessageWriter* w, uint8_t type, int64_t v);
+int PutFloat(struct MessageWriter* w, uint8_t type, float v);
+int PutDouble(struct MessageWriter* w, uint8_t type, double v);
+int PutString(struct MessageWriter* w, uint8_t type, const char* v);
+int PutBinary(struct MessageWriter* w, uint8_t type, const char* v, uint16_t length);
+// رĳȣʧܷ-1
+int EndMessage(struct MessageWriter* w);
+// EndMessage ֱ CoapOutput
+int pushMessageWriter(struct MessageWriter* w);
+
+/* ԭؽбģbuf ڶȡڼ䱣Ч TLV ʧܷ-1 */
+int OpenMessage(struct MessageReader* r, const uint8_t* buf, uint16_t inLength);
+// ȡһ TLV1ѵĩβ0
+int NextTLV(struct MessageReader* r, struct TLVView* tlv);
+//  type  TLVҵ1򷵻0
+int FindTLV(const struct MessageReader* r, uint8_t type, struct TLVView* tlv);
+//  Get* ֵͬȣʧܷ-1ReadString  ReadBinary ָڲstring  '\0' β
+int ReadInt8(const struct MessageReader* r, uint8_t type, int8_t* v);
+int ReadInt16(const struct MessageReader* r, uint8_t type, int16_t* v);
+int ReadInt32(const struct MessageReader* r, uint8_t type, int32_t* v);
+int ReadLong64(const struct MessageReader* r, uint8_t type, int64_t* v);
+int ReadFloat(const struct MessageReader* r, uint8_t type, float* v);
+int ReadDouble(const struct MessageReader* r, uint8_t type, double* v);
+int ReadString(const struct MessageReader* r, uint8_t type, const char** v);
+int ReadBinary(const struct MessageReader* r, uint8_t type, const uint8_t** v);
+
 /* ݼmessageṹ */
 int AddInt8(struct Messages* msg, uint8_t type, int8_t v);
 int AddInt16(struct Messages* msg, uint8_t type, int16_t v);
@@ -152,14 +297,26 @@ typedef uint8_t(*BatteryCbFuncPtr)(void);
 typedef int32_t(*SignalCbFuncPtr)(void);
 typedef void(*OutputFuncPtr)(const uint8_t* buf, uint16_t length);
 typedef void(*CmdHandlerFuncPtr)(struct Messages* req);
+typedef void(*CmdReaderFuncPtr)(const struct MessageReader* req);
+//  context  handlercontext Ϊעʱָ
+typedef void(*CmdContextFuncPtr)(struct Messages* req, void* context);
+typedef void(*CmdReaderContextFuncPtr)(const struct MessageReader* req, void* context);
+typedef void(*LogFormatFuncPtr)(enum LoggingLevel level, const char* fmt, va_list args);
 
 void setsTimestampCb(TimestampCbFuncPtr func);
 void setSignalCb(SignalCbFuncPtr func);
 void setBatteryCb(BatteryCbFuncPtr func);
 void setNbSerialOutputCb(OutputFuncPtr func);
 void setLogSerialOutputCb(OutputFuncPtr func);
+void setLogFormatOutputCb(LogFormatFuncPtr func);
 void setAckHandler(CmdHandlerFuncPtr func);
 int setCmdHandler(int cmdid, CmdHandlerFuncPtr func);
+// CoapInputInPlace ʹõ handlerͬʱãӰ
+void setAckReader(CmdReaderFuncPtr func);
+int setCmdReader(int cmdid, CmdReaderFuncPtr func);
+// ͬ setCmdHandler / setCmdReaderصʱ context벻 context İ汾滻
+int setCmdHandlerContext(int cmdid, CmdContextFuncPtr func, void* context);
+int setCmdReaderContext(int cmdid, CmdReaderContextFuncPtr func, void* context);
 
 
 /* ײӿ CoAP ͬģ飬ҪʹòͬPORTING */
@@ -168,4 +325,76 @@ int CoapOutput(uint8_t *inBuf, uint16_t inLength);
 void SetLogLevel(enum LoggingLevel level);
 int Logging(enum LoggingLevel level, const char* fmt, ...);
 
+/*
+ * ־ǰ˺ LOG_T / LOG_D / LOG_I / LOG_W / LOG_E / LOG_FӦ LOG_TRACE ... LOG_FATAL
+ * 1ڱڵȼ EASYIOT_LOG_MIN_LEVEL ĵòᱻ룬Ҳᱻֵ
+ * 2ȱȽڵȼSetLogLevelͨŽ Logging()
+ * 3Դļڰļǰ EASYIOT_LOG_MODULE_LEVELɵǱڵȼ
+ */
+#define EASYIOT_LEVEL_TRACE   0
+#define EASYIOT_LEVEL_DEBUG   1
+#define EASYIOT_LEVEL_INFO    2
+#define EASYIOT_LEVEL_WARNING 3
+#define EASYIOT_LEVEL_ERROR   4
+#define EASYIOT_LEVEL_FATAL   5
+#define EASYIOT_LEVEL_NONE    6
+
+// ڵȼʱڱѡжΪ EASYIOT_LEVEL_TRACE
+#ifndef EASYIOT_LOG_MIN_LEVEL
+#define EASYIOT_LOG_MIN_LEVEL EASYIOT_LEVEL_INFO
+#endif
+
+// ڵȼĳֵ
+#ifndef EASYIOT_LOG_DEFAULT_LEVEL
+#define EASYIOT_LOG_DEFAULT_LEVEL LOG_INFO
+#endif
+
+#ifdef EASYIOT_LOG_MODULE_LEVEL
+#define EASYIOT_LOG_FLOOR EASYIOT_LOG_MODULE_LEVEL
+#else
+#define EASYIOT_LOG_FLOOR EASYIOT_LOG_MIN_LEVEL
+#endif
+
+// ڵȼֻʹ SetLogLevel ޸
+extern enum LoggingLevel gl_loglevel;
+
+#define EASYIOT_LOG(level, ...) do { if ((level) >= gl_loglevel) Logging((level), __VA_ARGS__); } while (0)
+#define EASYIOT_LOG_NONE(...)   do { } while (0)
+
+#if EASYIOT_LOG_FLOOR <= EASYIOT_LEVEL_TRACE
+#define LOG_T(...) EASYIOT_LOG(LOG_TRACE, __VA_ARGS__)
+#else
+#define LOG_T(...) EASYIOT_LOG_NONE(__VA_ARGS__)
+#endif
+
+#if EASYIOT_LOG_FLOOR <= EASYIOT_LEVEL_DEBUG
+#define LOG_D(...) EASYIOT_LOG(LOG_DEBUG, __VA_ARGS__)
+#else
+#define LOG_D(...) EASYIOT_LOG_NONE(__VA_ARGS__)
+#endif
+
+#if EASYIOT_LOG_FLOOR <= EASYIOT_LEVEL_INFO
+#define LOG_I(...) EASYIOT_LOG(LOG_INFO, __VA_ARGS__)
+#else
+#define LOG_I(...) EASYIOT_LOG_NONE(__VA_ARGS__)
+#endif
+
+#if EASYIOT_LOG_FLOOR <= EASYIOT_LEVEL_WARNING
+#define LOG_W(...) EASYIOT_LOG(LOG_WARNING, __VA_ARGS__)
+#else
+#define LOG_W(...) EASYIOT_LOG_NONE(__VA_ARGS__)
+#endif
+
+#if EASYIOT_LOG_FLOOR <= EASYIOT_LEVEL_ERROR
+#define LOG_E(...) EASYIOT_LOG(LOG_ERROR, __VA_ARGS__)
+#else
+#define LOG_E(...) EASYIOT_LOG_NONE(__VA_ARGS__)
+#endif
+
+#if EASYIOT_LOG_FLOOR <= EASYIOT_LEVEL_FATAL
+#define LOG_F(...) EASYIOT_LOG(LOG_FATAL, __VA_ARGS__)
+#else
+#define LOG_F(...) EASYIOT_LOG_NONE(__VA_ARGS__)
+#endif
+
 #endif /* _GUARD_H_EASYIOT_H_ */
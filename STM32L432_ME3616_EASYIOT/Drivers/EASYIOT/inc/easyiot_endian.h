@@ -0,0 +1,137 @@
+/*************************************************************************
+    > File Name:    easyiot_endian.h
+    > Author:       Guangdong Research Institute of China Telecom Corporation Ltd.
+	> See More:     https://www.easy-iot.cn/
+	> Description:  EasyIoT SDK ֽǶ
+    > Created Time: 2018/01/01
+ ************************************************************************/
+
+#ifndef _GUARD_H_EASYIOT_ENDIAN_H_
+#define _GUARD_H_EASYIOT_ENDIAN_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+* ͳһʹֽ򣨴ˣ
+* 1жϱֽ򣬴ƽ̨תΪղ
+* 2Сƽ̨ʹñڽֽڽCortex-M4 ϼΪһ REV / REV16 ָ
+* 3nb_load_* / nb_store_* д̶ַȵ memcpy ᱻΪ LDR / STR
+*    Cortex-M4 ַ֧Ƕ LDR / STR64 λΪҪ LDRD / STRD
+*/
+
+// ڱѡж EASYIOT_BIG_ENDIAN Ϊ 0  1Զж
+#ifndef EASYIOT_BIG_ENDIAN
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define EASYIOT_BIG_ENDIAN 1
+#elif defined(__BIG_ENDIAN__) || defined(__ARMEB__) || defined(__ARM_BIG_ENDIAN)
+#define EASYIOT_BIG_ENDIAN 1
+#else
+#define EASYIOT_BIG_ENDIAN 0
+#endif
+#endif
+
+// ֽڽGCC  ARM Compiler 6armclangʹ __builtin_bswap*IAR ʹ __REV / __REV16
+#if defined(__GNUC__) || defined(__clang__)
+#define nb_bswap16(_n) __builtin_bswap16((uint16_t)(_n))
+#define nb_bswap32(_n) __builtin_bswap32((uint32_t)(_n))
+#define nb_bswap64(_n) __builtin_bswap64((uint64_t)(_n))
+#elif defined(__ICCARM__)
+#include <intrinsics.h>
+#define nb_bswap16(_n) ((uint16_t)__REV16((uint32_t)(_n)))
+#define nb_bswap32(_n) ((uint32_t)__REV((uint32_t)(_n)))
+#define nb_bswap64(_n) ((((uint64_t)__REV((uint32_t)(_n))) << 32) | __REV((uint32_t)((uint64_t)(_n) >> 32)))
+#elif defined(__CC_ARM)
+#define nb_bswap16(_n) ((uint16_t)(__rev((uint32_t)(_n)) >> 16))
+#define nb_bswap32(_n) ((uint32_t)__rev((uint32_t)(_n)))
+#define nb_bswap64(_n) ((((uint64_t)__rev((uint32_t)(_n))) << 32) | __rev((uint32_t)((uint64_t)(_n) >> 32)))
+#else
+#define nb_bswap16(_n) ((uint16_t)((((_n) & 0xff) << 8) | (((_n) >> 8) & 0xff)))
+#define nb_bswap32(_n) ((uint32_t)( (((_n) & 0xff) << 24) | (((_n) & 0xff00) << 8) | (((_n) >> 8)  & 0xff00) | (((_n) >> 24) & 0xff) ))
+#define nb_bswap64(_n) ((((uint64_t)nb_bswap32((uint32_t)(_n))) << 32) | nb_bswap32((uint32_t)((uint64_t)(_n) >> 32)))
+#endif
+
+#if EASYIOT_BIG_ENDIAN
+#define nb_htons(_n)  ((uint16_t)(_n))
+#define nb_htonl(_n)  ((uint32_t)(_n))
+#define nb_htonll(_n) ((uint64_t)(_n))
+#else
+#define nb_htons(_n)  nb_bswap16(_n)
+#define nb_htonl(_n)  nb_bswap32(_n)
+#define nb_htonll(_n) nb_bswap64(_n)
+#endif
+#define nb_ntohs(_n)  nb_htons(_n)
+#define nb_ntohl(_n)  nb_htonl(_n)
+#define nb_ntohll(_n) nb_htonll(_n)
+
+
+// ַдֽ
+static inline uint16_t nb_load_u16(const void* p)
+{
+	uint16_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t nb_load_u32(const void* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t nb_load_u64(const void* p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void nb_store_u16(void* p, uint16_t v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void nb_store_u32(void* p, uint32_t v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline void nb_store_u64(void* p, uint64_t v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+
+// ַдֽ
+static inline uint16_t nb_load_be16(const void* p)
+{
+	return nb_ntohs(nb_load_u16(p));
+}
+
+static inline uint32_t nb_load_be32(const void* p)
+{
+	return nb_ntohl(nb_load_u32(p));
+}
+
+static inline uint64_t nb_load_be64(const void* p)
+{
+	return nb_ntohll(nb_load_u64(p));
+}
+
+static inline void nb_store_be16(void* p, uint16_t v)
+{
+	nb_store_u16(p, nb_htons(v));
+}
+
+static inline void nb_store_be32(void* p, uint32_t v)
+{
+	nb_store_u32(p, nb_htonl(v));
+}
+
+static inline void nb_store_be64(void* p, uint64_t v)
+{
+	nb_store_u64(p, nb_htonll(v));
+}
+
+#endif /* _GUARD_H_EASYIOT_ENDIAN_H_ */
@@ -13,11 +13,13 @@
 #include <stdarg.h>
 
 #include "easyiot.h"
+#include "easyiot_endian.h"
+#include "me3616_hex.h"
+#include "me3616_pool.h"
 
 static char gl_imei[20];
 static char gl_imsi[20];
 
-#define COMMAND_MAX_HANDLER 8
 #define STANDARD_IMEI_LENGTH 15
 #define STANDARD_IMSI_LENGTH 15
 #define EASYIOT_COAP_VERSION 0x01
@@ -27,24 +29,38 @@ static TimestampCbFuncPtr gl_timestampcb;
 static SignalCbFuncPtr gl_signalcb;
 static BatteryCbFuncPtr gl_batterycb;
 static CmdHandlerFuncPtr gl_ackhandler;
+static CmdReaderFuncPtr gl_ackreader;
 static OutputFuncPtr gl_nb_out;
 static OutputFuncPtr gl_log_out;
-static int cmd_handler_count;
-static enum LoggingLevel gl_loglevel;
+static LogFormatFuncPtr gl_log_format;
+static uint8_t cmd_handler_count;
+enum LoggingLevel gl_loglevel = EASYIOT_LOG_DEFAULT_LEVEL;
 
 
 typedef struct {
 	int CmdID;
 	CmdHandlerFuncPtr ptr;
+	// CoapInputInPlace ʹ
+	CmdReaderFuncPtr reader;
+	//  context İ汾
+	CmdContextFuncPtr ctx_ptr;
+	CmdReaderContextFuncPtr ctx_reader;
+	void* context;
 } cmd_handler_t;
-static cmd_handler_t gl_cmd_handlers[COMMAND_MAX_HANDLER];
+static cmd_handler_t gl_cmd_handlers[EASYIOT_CMD_MAX_HANDLER];
+//  cmdid ֵΪ gl_cmd_handlers ± + 10 ʾδע
+static uint8_t gl_cmd_index[256];
+
+// TLV 飬value  EASYIOT_TLV_VALUE_SIZE ʱֱӷڿڣһηһͷ
+struct TLVBlock {
+	struct TLV tlv;
+	uint8_t value[EASYIOT_TLV_VALUE_SIZE];
+};
 
-// ǰ
+POOL_DEFINE(gl_message_pool, sizeof(struct Messages), EASYIOT_MESSAGE_POOL_SIZE);
+POOL_DEFINE(gl_tlv_pool, sizeof(struct TLVBlock), EASYIOT_TLV_POOL_SIZE);
 
-#define nb_htons(_n)  ((uint16_t)((((_n) & 0xff) << 8) | (((_n) >> 8) & 0xff)))
-#define nb_ntohs(_n)  ((uint16_t)((((_n) & 0xff) << 8) | (((_n) >> 8) & 0xff)))
-#define nb_htonl(_n)  ((uint32_t)( (((_n) & 0xff) << 24) | (((_n) & 0xff00) << 8) | (((_n) >> 8)  & 0xff00) | (((_n) >> 24) & 0xff) ))
-#define nb_ntohl(_n)  ((uint32_t)( (((_n) & 0xff) << 24) | (((_n) & 0xff00) << 8) | (((_n) >> 8)  & 0xff00) | (((_n) >> 24) & 0xff) ))
+// ǰ
 
 float host2NetFloat(float value);
 double host2NetDouble(double value);
@@ -65,7 +81,7 @@ int AddBuffer(struct Messages* msg, uint8_t type, uint8_t* v, uint16_t length, u
 // ʼʹIMEIIMSIʼȫֱÿ
 void EasyIotInit(const char* imei, const char* imsi)
 {
-	Logging(LOG_TRACE, "EasyIoT version %s\n", EASY_IOT_VERSION);
+	LOG_T("EasyIoT version %s\n", EASY_IOT_VERSION);
 	
 	memset(gl_imei, 0, sizeof(gl_imei));
 	memset(gl_imsi, 0, sizeof(gl_imsi));
@@ -74,30 +90,31 @@ void EasyIotInit(const char* imei, const char* imsi)
 	gl_signalcb = NULL;
 	gl_batterycb = NULL;
 	gl_ackhandler = NULL;
+	gl_ackreader = NULL;
 	memset(gl_cmd_handlers, 0, sizeof(gl_cmd_handlers));
+	memset(gl_cmd_index, 0, sizeof(gl_cmd_index));
 	cmd_handler_count = 0;
-	gl_loglevel = LOG_TRACE;
 	
 	if (strlen(imei) != STANDARD_IMEI_LENGTH) {
-		Logging(LOG_WARNING, "IMEI %s length not equal %d\n", imei, STANDARD_IMEI_LENGTH);
+		LOG_W("IMEI %s length not equal %d\n", imei, STANDARD_IMEI_LENGTH);
 	} else {
 		strcpy(gl_imei, imei);
 	}
 
 	if (strlen(imsi) != STANDARD_IMSI_LENGTH) {
-		Logging(LOG_WARNING, "IMSI %s length not equal %d\n", imsi, STANDARD_IMSI_LENGTH);
+		LOG_W("IMSI %s length not equal %d\n", imsi, STANDARD_IMSI_LENGTH);
 	} else {
 		strcpy(gl_imsi, imsi);
 	}
 
-	Logging(LOG_TRACE, "EasyIoT Initialize finished.\n");
+	LOG_T("EasyIoT Initialize finished.\n");
 }
 
 
 //  TIMESTAMP ص
 void setsTimestampCb(TimestampCbFuncPtr func)
 {
-	Logging(LOG_TRACE, "set timestamp callback to 0x%p\n", func);
+	LOG_T("set timestamp callback to 0x%p\n", func);
 	gl_timestampcb = func;
 }
 
@@ -105,7 +122,7 @@ void setsTimestampCb(TimestampCbFuncPtr func)
 //  źǿ ص
 void setSignalCb(SignalCbFuncPtr func)
 {
-	Logging(LOG_TRACE, "set signal callback to 0x%p\n", func);
+	LOG_T("set signal callback to 0x%p\n", func);
 	gl_signalcb = func;
 }
 
@@ -113,25 +130,114 @@ void setSignalCb(SignalCbFuncPtr func)
 //  ص ص
 void setBatteryCb(BatteryCbFuncPtr func)
 {
-	Logging(LOG_TRACE, "set battery callback to 0x%p\n", func);
+	LOG_T("set battery callback to 0x%p\n", func);
 	gl_batterycb = func;
 }
 
 
+//  cmdid ȡδע cmdid  NULL
+static cmd_handler_t* cmd_handler_find(uint8_t cmdid)
+{
+	uint8_t index = gl_cmd_index[cmdid];
+
+	return index ? &gl_cmd_handlers[index - 1] : NULL;
+}
+
+
+// ȡ cmdid ıͬһָĸ handler һδעһ
+static cmd_handler_t* cmd_handler_slot(int cmdid)
+{
+	cmd_handler_t* slot;
+
+	if (cmdid < 0 || cmdid > 0xFF) {
+		LOG_E("cmdid %d out of range 0~255\n", cmdid);
+		return NULL;
+	}
+
+	slot = cmd_handler_find((uint8_t)cmdid);
+	if (slot) {
+		return slot;
+	}
+
+	if (cmd_handler_count >= EASYIOT_CMD_MAX_HANDLER) {
+		LOG_E("EASYIOT_CMD_MAX_HANDLER count %d\n", EASYIOT_CMD_MAX_HANDLER);
+		return NULL;
+	}
+	slot = &gl_cmd_handlers[cmd_handler_count++];
+	slot->CmdID = cmdid;
+	gl_cmd_index[cmdid] = cmd_handler_count;
+	return slot;
+}
+
+
 // ָصָIDEasyIoTƽ̨Ԥ
 int setCmdHandler(int cmdid, CmdHandlerFuncPtr func)
 {
-	Logging(LOG_TRACE, "add cmd %d handler callback to 0x%p\n", cmdid, func);
-	if (cmd_handler_count >= COMMAND_MAX_HANDLER) {
-		Logging(LOG_ERROR, "COMMAND_MAX_HANDLER count %d\n", COMMAND_MAX_HANDLER);
+	cmd_handler_t* slot;
+
+	LOG_T("add cmd %d handler callback to 0x%p\n", cmdid, func);
+	slot = cmd_handler_slot(cmdid);
+	if (!slot) {
 		return -1;
 	}
 	
-	gl_cmd_handlers[cmd_handler_count].CmdID = cmdid;
-	gl_cmd_handlers[cmd_handler_count].ptr = func;
-	cmd_handler_count += 1;
-	Logging(LOG_TRACE, "add command %d processer 0x%p, current handler count %d.\r\n", cmdid, func, cmd_handler_count);
+	slot->ptr = func;
+	slot->ctx_ptr = NULL;
+	LOG_T("add command %d processer 0x%p, current handler count %d.\r\n", cmdid, func, cmd_handler_count);
+
+	return 0;
+}
 
+
+//  CoapInputInPlace ָص
+int setCmdReader(int cmdid, CmdReaderFuncPtr func)
+{
+	cmd_handler_t* slot;
+
+	LOG_T("add cmd %d reader callback to 0x%p\n", cmdid, func);
+	slot = cmd_handler_slot(cmdid);
+	if (!slot) {
+		return -1;
+	}
+
+	slot->reader = func;
+	slot->ctx_reader = NULL;
+	return 0;
+}
+
+
+// ô context ָصͬһ cmdid  handler  reader һ context
+int setCmdHandlerContext(int cmdid, CmdContextFuncPtr func, void* context)
+{
+	cmd_handler_t* slot;
+
+	LOG_T("add cmd %d handler callback to 0x%p, context 0x%p\n", cmdid, func, context);
+	slot = cmd_handler_slot(cmdid);
+	if (!slot) {
+		return -1;
+	}
+
+	slot->ctx_ptr = func;
+	slot->ptr = NULL;
+	slot->context = context;
+	return 0;
+}
+
+
+// ô context  CoapInputInPlace ָص
+int setCmdReaderContext(int cmdid, CmdReaderContextFuncPtr func, void* context)
+{
+	cmd_handler_t* slot;
+
+	LOG_T("add cmd %d reader callback to 0x%p, context 0x%p\n", cmdid, func, context);
+	slot = cmd_handler_slot(cmdid);
+	if (!slot) {
+		return -1;
+	}
+
+	slot->ctx_reader = func;
+	slot->reader = NULL;
+	slot->context = context;
 	return 0;
 }
 
@@ -139,15 +245,23 @@ int setCmdHandler(int cmdid, CmdHandlerFuncPtr func)
 //  ACK صɹݺACKȷ֪ͨ
 void setAckHandler(CmdHandlerFuncPtr func)
 {
-	Logging(LOG_TRACE, "set ack handler to 0x%p\n", func);
+	LOG_T("set ack handler to 0x%p\n", func);
 	gl_ackhandler = func;
 }
 
 
+//  CoapInputInPlace ACK ص
+void setAckReader(CmdReaderFuncPtr func)
+{
+	LOG_T("set ack reader to 0x%p\n", func);
+	gl_ackreader = func;
+}
+
+
 // NBģͨѶĻص
 void setNbSerialOutputCb(OutputFuncPtr func)
 {
-	Logging(LOG_TRACE, "set nb serial output function to 0x%p\n", func);
+	LOG_T("set nb serial output function to 0x%p\n", func);
 	gl_nb_out = func;
 }
 
@@ -155,21 +269,29 @@ void setNbSerialOutputCb(OutputFuncPtr func)
 // ־Ļصýκ־־ʹsetLogLevelȼ
 void setLogSerialOutputCb(OutputFuncPtr func)
 {
-	Logging(LOG_TRACE, "set logging serial output function to 0x%p\n", func);
+	LOG_T("set logging serial output function to 0x%p\n", func);
 	gl_log_out = func;
 }
 
 
-// Message ṹʼʹ malloc ̬ڴ
+// ־ʽĻصú־ĸʽԭپ vsprintf  setLogSerialOutputCb ĺ
+void setLogFormatOutputCb(LogFormatFuncPtr func)
+{
+	LOG_T("set logging format output function to 0x%p\n", func);
+	gl_log_format = func;
+}
+
+
+// Message ṹʼ Messages ڴз
 struct Messages* NewMessage(void)
 {
-	struct Messages* msg = malloc(sizeof(struct Messages));
+	struct Messages* msg = Pool_Alloc(&gl_message_pool);
 	if (!msg) {
-		Logging(LOG_WARNING, "new messages, malloc failed.\n");
+		LOG_W("new messages, pool exhausted.\n");
 		return NULL;
 	}
 	memset(msg, 0, sizeof(struct Messages));
-	Logging(LOG_TRACE, "new message from malloc at 0x%p.\r\n", msg);
+	LOG_T("new message from pool at 0x%p.\r\n", msg);
 
 	return msg;
 }
@@ -178,24 +300,25 @@ struct Messages* NewMessage(void)
 // Messages Ϣ msgid
 void setMessages(struct Messages* msg, enum CoapMessageType type, uint8_t msgid)
 {
-	Logging(LOG_TRACE, "set msg 0x%p msgid: %d, type: %d.\r\n", msg, msgid, type);
+	LOG_T("set msg 0x%p msgid: %d, type: %d.\r\n", msg, msgid, type);
 
 	msg->msgType = type;
 	msg->msgid = msgid;
 }
 
 
-// ̬ʼ Message ṹ壬ʹô˺ Message  addtlvУ಻ᶯ̬ڴ
+// ̬ʼ Message ṹ壬Message  buf УTLV Դڴط
+// buf ʣռڷó EASYIOT_TLV_VALUE_SIZE  valueԼ pushMessages ʱл
 struct Messages* NewMessageStatic(uint8_t * buf, uint16_t inMaxLength)
 {
 	__attribute__((aligned(4))) struct Messages * msg;
 
 	if (!buf) {
-		Logging(LOG_WARNING, "new message from static, but buffer is null.\n");
+		LOG_W("new message from static, but buffer is null.\n");
 		return NULL;
 	}
 	if (inMaxLength < sizeof(struct Messages)) {
-		Logging(LOG_WARNING, "new message from static, but buffer too small.\n");
+		LOG_W("new message from static, but buffer too small.\n");
 		return NULL;
 	}
 
@@ -206,13 +329,13 @@ struct Messages* NewMessageStatic(uint8_t * buf, uint16_t inMaxLength)
 	msg->sbuf = buf;
 	msg->sbuf_offset = sizeof(struct Messages);
 	msg->sbuf_maxlength = inMaxLength;
-	Logging(LOG_TRACE, "new message from static buffer at 0x%p.\r\n", msg);
+	LOG_T("new message from static buffer at 0x%p.\r\n", msg);
 
 	return msg;
 }
 
 
-// MessageڴռڣһָС n ڴռ
+// MessageڴռڣһָС n ڴռ䣬ֻ䲻ͷţ NewMessageStatic 
 // ĿռΪ 4 ֽѶ
 void* MessagesStaticMalloc(struct Messages* msg, uint16_t n)
 {
@@ -222,7 +345,7 @@ void* MessagesStaticMalloc(struct Messages* msg, uint16_t n)
 	align_n = n;
 	align_n += n % 4 ? 4 - n % 4 : 0;
 	if (msg->sbuf_offset + align_n > msg->sbuf_maxlength) {
-		Logging(LOG_WARNING, "message static malloc, buffer overloaded, malloc failed.\n");
+		LOG_W("message static malloc, buffer overloaded, malloc failed.\n");
 		return NULL;
 	}
 
@@ -232,255 +355,166 @@ void* MessagesStaticMalloc(struct Messages* msg, uint16_t n)
 }
 
 
-// ͷ Message ڴռ䣬ʹ NewMessageStatic 䣬ָڴ
+// ͷ Message ڴռ䣬TLV 黹ڴ
+// ʹ NewMessageStatic 䣬Message ԭ buffer в TLV buffer
 void FreeMessage(struct Messages* msg)
 {
 	int i;
 
-	// ʹþ̬ڴ汾free
-	if (msg->sbuf_use) {
-		memset(msg->sbuf, 0, msg->sbuf_maxlength);
-		return;
-	}
-
 	if (msg == NULL) {
-		Logging(LOG_FATAL, "free messages == NULL, aborted.\n");
+		LOG_F("free messages == NULL, aborted.\n");
 		return;
 	}
 
 	for (i = 0; i != msg->tlv_count; ++i) {
 		if (msg->tlvs[i]) {
 			FreeTLV(msg->tlvs[i]);
+			msg->tlvs[i] = NULL;
 		} else {
-			Logging(LOG_WARNING, "tlv ptr == NULL.\n");
+			LOG_W("tlv ptr == NULL.\n");
 		}
 	}
-	free(msg);
+	msg->tlv_count = 0;
+
+	if (msg->sbuf_use) {
+		msg->sbuf_offset = sizeof(struct Messages);
+		return;
+	}
+
+	if (!Pool_Free(&gl_message_pool, msg)) {
+		LOG_E("free messages 0x%p, not from pool.\n", msg);
+	}
+}
+
+
+// ڴͳ
+static void pool_stats(const Pool_t* pool, struct PoolStats* stats)
+{
+	stats->block_size = pool->BlockSize;
+	stats->block_count = pool->BlockCount;
+	stats->used = (uint16_t)pool->Used;
+	stats->high_water = (uint16_t)pool->HighWater;
+	stats->failed = pool->Failed;
 }
 
 
-//  Float
-typedef union FLOAT_CONV
+// Messages ڴͳ
+void GetMessagePoolStats(struct PoolStats* stats)
 {
-	float f;
-	char c[4];
-}floatConv;
+	pool_stats(&gl_message_pool, stats);
+}
 
 
-//  Double
-typedef union DOUBLE_CONV
+// TLV ڴͳ
+void GetTLVPoolStats(struct PoolStats* stats)
 {
-	double d;
-	char c[8];
-}doubleConv;
+	pool_stats(&gl_tlv_pool, stats);
+}
 
 
-// ֽתֽ float 汾
+// ֽתֽ򣬶ת easyiot_endian.hƽ̨ԭ
+// float / double λת
 float host2NetFloat(float value)
 {
-	floatConv f1, f2;
-	int size = sizeof(float);
-	int i = 0;
-	if (4 == size)
-	{
-		f1.f = value;
-		f2.c[0] = f1.c[3];
-		f2.c[1] = f1.c[2];
-		f2.c[2] = f1.c[1];
-		f2.c[3] = f1.c[0];
-	}
-	else {
-		f1.f = value;
-		for (; i < size; i++) {
-			f2.c[size - 1 - i] = f1.c[i];
-		}
-	}
-	return f2.f;
+	uint32_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	bits = nb_htonl(bits);
+	memcpy(&value, &bits, sizeof(value));
+	return value;
 }
 
 
-// ֽתֽ double 汾
 double host2NetDouble(double value)
 {
-	doubleConv d1, d2;
-	int size = sizeof(double);
-	int i = 0;
-	d1.d = value;
-	for (; i < size; i++) {
-		d2.c[size - 1 - i] = d1.c[i];
-	}
-	return d2.d;
+	uint64_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	bits = nb_htonll(bits);
+	memcpy(&value, &bits, sizeof(value));
+	return value;
 }
 
 
-// ֽתֽ int8 汾ᴦ/
 int8_t host2NetInt8(int8_t value)
 {
-	if (value >= 0 || 1)
-	{
-		return value;
-	}
-	else
-	{
-		value = ((~value + 1)) | 0x80;
-		return value;
-	}
+	return value;
 }
 
 
-
-// ֽתֽ int16 汾ᴦ/
 int16_t host2NetInt16(int16_t value)
 {
-	if (value >= 0 || 1)
-	{
-		return ((uint16_t)((((value) & 0xff) << 8) | (((value) >> 8) & 0xff)));
-	}
-	else
-	{
-		value = (((~value + 1)) | 0x8000);
-		return ((uint16_t)((((value) & 0xff) << 8) | (((value) >> 8) & 0xff)));
-	}
+	return (int16_t)nb_htons((uint16_t)value);
 }
 
 
-// ֽתֽ int32 汾ᴦ/
 int32_t host2NetInt32(int32_t value)
 {
-	if (value >= 0 || 1)
-	{
-		return ((uint32_t)((((value) & 0xff) << 24) | (((value) & 0xff00) << 8) | (((value) >> 8) & 0xff00) | (((value) >> 24) & 0xff)));
-	}
-	else
-	{
-		value = (((~value + 1)) | 0x80000000);
-		return ((uint32_t)((((value) & 0xff) << 24) | (((value) & 0xff00) << 8) | (((value) >> 8) & 0xff00) | (((value) >> 24) & 0xff)));
-	}
+	return (int32_t)nb_htonl((uint32_t)value);
 }
 
 
-// ֽתֽ int64 汾ᴦ/
 int64_t  host2NetInt64(int64_t value)
 {
-	if (value >= 0 || 1)
-	{
-		return (value & 0x00000000000000FF) << 56 | (value & 0x000000000000FF00) << 40 |
-			(value & 0x0000000000FF0000) << 24 | (value & 0x00000000FF000000) << 8 |
-			(value & 0x000000FF00000000) >> 8 | (value & 0x0000FF0000000000) >> 24 |
-			(value & 0x00FF000000000000) >> 40 | (value & 0xFF00000000000000) >> 56;
-	}
-	else
-	{
-		value = (((~value + 1)) | 0x8000000000000000);
-		return  (value & 0x00000000000000FF) << 56 | (value & 0x000000000000FF00) << 40 |
-			(value & 0x0000000000FF0000) << 24 | (value & 0x00000000FF000000) << 8 |
-			(value & 0x000000FF00000000) >> 8 | (value & 0x0000FF0000000000) >> 24 |
-			(value & 0x00FF000000000000) >> 40 | (value & 0xFF00000000000000) >> 56;
-	}
+	return (int64_t)nb_htonll((uint64_t)value);
 }
 
 
-// ֽתֽ float 汾
+// ֽתֽ host2Net* ͬ
 float net2HostFloat(float value)
 {
-	floatConv f1, f2;
-	int size = sizeof(float);
-	int i = 0;
-	if (4 == size)
-	{
-		f1.f = value;
-		f2.c[0] = f1.c[3];
-		f2.c[1] = f1.c[2];
-		f2.c[2] = f1.c[1];
-		f2.c[3] = f1.c[0];
-	}
-	else {
-		f1.f = value;
-		for (; i < size; i++) {
-			f2.c[size - 1 - i] = f1.c[i];
-		}
-	}
-	return f2.f;
+	return host2NetFloat(value);
 }
 
 
-// ֽתֽ double 汾
 double net2HostDouble(double value)
 {
-	doubleConv d1, d2;
-	int size = sizeof(double);
-	int i = 0;
-	d1.d = value;
-	for (; i < size; i++) {
-		d2.c[size - 1 - i] = d1.c[i];
-	}
-	return d2.d;
+	return host2NetDouble(value);
 }
 
 
-// ֽתֽ int8 汾й
 int8_t net2HostInt8(int8_t value)
 {
-	if (value >= 0 || 1)
-	{
-		return value;
-	}
-	else
-	{
-		value = ((~value + 1)) | 0x80;
-		return value;
-	}
+	return value;
 }
 
 
-// ֽתֽ Int6 汾й
 int16_t net2HostInt16(int16_t value)
 {
-	if (value >= 0 || 1)
-	{
-		return ((uint16_t)((((value) & 0xff) << 8) | (((value) >> 8) & 0xff)));
-	}
-	else
-	{
-		value = (((~value + 1)) | 0x8000);
-		return ((uint16_t)((((value) & 0xff) << 8) | (((value) >> 8) & 0xff)));
-	}
+	return host2NetInt16(value);
 }
 
 
-// ֽתֽ int32 汾й
 int32_t net2HostInt32(int32_t value)
 {
-	if (value >= 0 || 1)
-	{
-		return ((uint32_t)((((value) & 0xff) << 24) | (((value) & 0xff00) << 8) | (((value) >> 8) & 0xff00) | (((value) >> 24) & 0xff)));
-	}
-	else
-	{
-		value = (((~value + 1)) | 0x80000000);
-		return ((uint32_t)((((value) & 0xff) << 24) | (((value) & 0xff00) << 8) | (((value) >> 8) & 0xff00) | (((value) >> 24) & 0xff)));
-	}
+	return host2NetInt32(value);
 }
 
 
-// ֽתֽ int64 汾й
 int64_t   net2HostInt64(int64_t value)
 {
-	if (value >= 0 || 1)
-	{
-		return (value & 0x00000000000000FF) << 56 | (value & 0x000000000000FF00) << 40 |
-			(value & 0x0000000000FF0000) << 24 | (value & 0x00000000FF000000) << 8 |
-			(value & 0x000000FF00000000) >> 8 | (value & 0x0000FF0000000000) >> 24 |
-			(value & 0x00FF000000000000) >> 40 | (value & 0xFF00000000000000) >> 56;
-	}
-	else
-	{
-		value = (((~value + 1)) | 0x8000000000000000);
-		return  (value & 0x00000000000000FF) << 56 | (value & 0x000000000000FF00) << 40 |
-			(value & 0x0000000000FF0000) << 24 | (value & 0x00000000FF000000) << 8 |
-			(value & 0x000000FF00000000) >> 8 | (value & 0x0000FF0000000000) >> 24 |
-			(value & 0x00FF000000000000) >> 40 | (value & 0xFF00000000000000) >> 56;
-	}
+	return host2NetInt64(value);
+}
+
+
+// ӱַȡֽ float / double
+static float load_be_float(const void* p)
+{
+	uint32_t bits = nb_load_be32(p);
+	float v;
+
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+
+static double load_be_double(const void* p)
+{
+	uint64_t bits = nb_load_be64(p);
+	double v;
+
+	memcpy(&v, &bits, sizeof(v));
+	return v;
 }
 
 
@@ -491,28 +525,25 @@ int AddBuffer(struct Messages* msg, uint8_t type, uint8_t* v, uint16_t length, u
 {
 	struct TLV* tlv = NULL;
 	if (msg->tlv_count >= MESSAGE_MAX_TLV) {
-		Logging(LOG_WARNING, "tlv count max %d\n", MESSAGE_MAX_TLV);
+		LOG_W("tlv count max %d\n", MESSAGE_MAX_TLV);
 		return -1;
 	}
 
-	if (msg->sbuf_use) {
-		tlv = NewTLVStatic(msg, type);
-	} else {
-		tlv = NewTLV(type);
-	}
+	tlv = NewTLV(type);
 	if (!tlv) {
-		Logging(LOG_WARNING, "new tlv, malloc failed.\n");
+		LOG_W("new tlv, malloc failed.\n");
 		return -1;
 	}
 
-	if (msg->sbuf_use) {
+	// value  TLV ڣŲµֻо̬汾Դ buffer з
+	if (length <= EASYIOT_TLV_VALUE_SIZE) {
+		tlv->value = ((struct TLVBlock*)tlv)->value;
+	} else if (msg->sbuf_use) {
 		tlv->value = (uint8_t*)MessagesStaticMalloc(msg, length);
 	}
-	else {
-		tlv->value = (uint8_t*)malloc(length);
-	}
 	if (!tlv->value) {
-		Logging(LOG_WARNING, "add buffer, new tlv, malloc failed.\n");
+		LOG_W("add buffer, value %d exceeds EASYIOT_TLV_VALUE_SIZE.\n", length);
+		FreeTLV(tlv);
 		return -1;
 	}
 	tlv->vformat = vformat;
@@ -599,13 +630,13 @@ const struct TLV* get_tlv_from_msg(const struct Messages* msg, uint8_t type, uin
 			// ignore length judge.
 		} else {
 			if (tlv->length != length) {
-				Logging(LOG_WARNING, "Get tlv %d, length %d not match %d.\n", type, tlv->length, length);
+				LOG_W("Get tlv %d, length %d not match %d.\n", type, tlv->length, length);
 				return NULL;
 			}
 		}
 
 		if (tlv->vformat != TLV_TYPE_UNKNOWN && tlv->vformat != vformat) {
-			Logging(LOG_WARNING, "Get tlv %d, vformat %d not match %d.\n", type, tlv->vformat, vformat);
+			LOG_W("Get tlv %d, vformat %d not match %d.\n", type, tlv->vformat, vformat);
 			return NULL;
 		}
 
@@ -623,12 +654,12 @@ int GetInt8(const struct Messages* msg, uint8_t type, int8_t* v)
 
 	tlv = get_tlv_from_msg(msg, type, sizeof(uint8_t), TLV_TYPE_BYTE);
 	if (!tlv) {
-		Logging(LOG_WARNING, "cannot found valid tlv %d from msg 0x%p\n", type, msg);
+		LOG_W("cannot found valid tlv %d from msg 0x%p\n", type, msg);
 		return -1;
 	}
 
 	if (tlv->vformat == TLV_TYPE_UNKNOWN) {
-		*v = net2HostInt8(*(int8_t*)tlv->value);
+		*v = *(const int8_t*)tlv->value;
 	} else {
 		*v = *(int8_t*)tlv->value;
 	}
@@ -644,15 +675,15 @@ int GetInt16(const struct Messages* msg, uint8_t type, int16_t* v)
 
 	tlv = get_tlv_from_msg(msg, type, sizeof(int16_t), TLV_TYPE_SHORT);
 	if (!tlv) {
-		Logging(LOG_WARNING, "cannot found valid tlv %d from msg 0x%p\n", type, msg);
+		LOG_W("cannot found valid tlv %d from msg 0x%p\n", type, msg);
 		return -1;
 	}
 
 	if (tlv->vformat == TLV_TYPE_UNKNOWN) {
-		*v = net2HostInt16(*(int16_t*)tlv->value);
+		*v = (int16_t)nb_load_be16(tlv->value);
 	}
 	else {
-		*v = *(int16_t*)tlv->value;
+		*v = (int16_t)nb_load_u16(tlv->value);
 	}
 
 	return sizeof(int16_t);
@@ -666,15 +697,15 @@ int GetInt32(const struct Messages* msg, uint8_t type, int32_t* v)
 
 	tlv = get_tlv_from_msg(msg, type, sizeof(int32_t), TLV_TYPE_INT32);
 	if (!tlv) {
-		Logging(LOG_WARNING, "cannot found valid tlv %d from msg 0x%p\n", type, msg);
+		LOG_W("cannot found valid tlv %d from msg 0x%p\n", type, msg);
 		return -1;
 	}
 
 	if (tlv->vformat == TLV_TYPE_UNKNOWN) {
-		*v = net2HostInt32(*(int32_t*)tlv->value);
+		*v = (int32_t)nb_load_be32(tlv->value);
 	}
 	else {
-		*v = *(int32_t*)tlv->value;
+		*v = (int32_t)nb_load_u32(tlv->value);
 	}
 
 	return sizeof(int32_t);
@@ -688,15 +719,15 @@ int GetLong64(const struct Messages* msg, uint8_t type, int64_t* v)
 
 	tlv = get_tlv_from_msg(msg, type, sizeof(int64_t), TLV_TYPE_LONG64);
 	if (!tlv) {
-		Logging(LOG_WARNING, "cannot found valid tlv %d from msg 0x%p\n", type, msg);
+		LOG_W("cannot found valid tlv %d from msg 0x%p\n", type, msg);
 		return -1;
 	}
 
 	if (tlv->vformat == TLV_TYPE_UNKNOWN) {
-		*v = net2HostInt64(*(int64_t*)tlv->value);
+		*v = (int64_t)nb_load_be64(tlv->value);
 	}
 	else {
-		*v = *(int64_t*)tlv->value;
+		*v = (int64_t)nb_load_u64(tlv->value);
 	}
 
 	return sizeof(int64_t);
@@ -710,15 +741,15 @@ int GetFloat(const struct Messages* msg, uint8_t type, float* v)
 
 	tlv = get_tlv_from_msg(msg, type, sizeof(float), TLV_TYPE_FLOAT);
 	if (!tlv) {
-		Logging(LOG_WARNING, "cannot found valid tlv %d from msg 0x%p\n", type, msg);
+		LOG_W("cannot found valid tlv %d from msg 0x%p\n", type, msg);
 		return -1;
 	}
 
 	if (tlv->vformat == TLV_TYPE_UNKNOWN) {
-		*v = net2HostFloat(*(float*)tlv->value);
+		*v = load_be_float(tlv->value);
 	}
 	else {
-		*v = *(float*)tlv->value;
+		memcpy(v, tlv->value, sizeof(float));
 	}
 
 	return sizeof(float);
@@ -732,15 +763,15 @@ int GetDouble(const struct Messages* msg, uint8_t type, double* v)
 
 	tlv = get_tlv_from_msg(msg, type, sizeof(double), TLV_TYPE_DOUBLE);
 	if (!tlv) {
-		Logging(LOG_WARNING, "cannot found valid tlv %d from msg 0x%p\n", type, msg);
+		LOG_W("cannot found valid tlv %d from msg 0x%p\n", type, msg);
 		return -1;
 	}
 
 	if (tlv->vformat == TLV_TYPE_UNKNOWN) {
-		*v = net2HostDouble(*(double*)tlv->value);
+		*v = load_be_double(tlv->value);
 	}
 	else {
-		*v = *(double*)tlv->value;
+		memcpy(v, tlv->value, sizeof(double));
 	}
 
 	return sizeof(double);
@@ -754,7 +785,7 @@ int GetString(const struct Messages* msg, uint8_t type, char** v)
 
 	tlv = get_tlv_from_msg(msg, type, 0, TLV_TYPE_STRING_ISO_8859);
 	if (!tlv) {
-		Logging(LOG_WARNING, "cannot found valid tlv %d from msg 0x%p\n", type, msg);
+		LOG_W("cannot found valid tlv %d from msg 0x%p\n", type, msg);
 		return -1;
 	}
 
@@ -770,7 +801,7 @@ int GetBinary(const struct Messages* msg, uint8_t type, uint8_t** v)
 
 	tlv = get_tlv_from_msg(msg, type, 0, TLV_TYPE_STRING_HEX);
 	if (!tlv) {
-		Logging(LOG_WARNING, "cannot found valid tlv %d from msg 0x%p\n", type, msg);
+		LOG_W("cannot found valid tlv %d from msg 0x%p\n", type, msg);
 		return -1;
 	}
 
@@ -779,179 +810,83 @@ int GetBinary(const struct Messages* msg, uint8_t type, uint8_t** v)
 }
 
 
-// malloc µTLVռ䣬TLVṹ type ֵ
+//  TLV ڴطһ TLV 飬TLVṹ type ֵ
+// ڴ EASYIOT_TLV_VALUE_SIZE ֽڵ value ռ䣬 AddBuffer
 struct TLV* NewTLV(uint8_t type)
 {
-	struct TLV* tlv = malloc(sizeof(struct TLV));
+	struct TLV* tlv = Pool_Alloc(&gl_tlv_pool);
 	if (!tlv) {
-		Logging(LOG_WARNING, "new tlv, malloc failed.\n");
+		LOG_W("new tlv, pool exhausted.\n");
 		return NULL;
 	}
 	tlv->length = 0;
 	tlv->type = type;
+	tlv->vformat = TLV_TYPE_UNKNOWN;
+	tlv->value = NULL;
 
 	return tlv;
 }
 
 
-//  Message ʣռУΪ TLV ڴռ䣬ʹmalloc
+//  NewTLV ͬTLV ռ Message ʣռ䣬˽ӿԼ
 struct TLV* NewTLVStatic(struct Messages* msg, uint8_t type)
 {
-	struct TLV* tlv = MessagesStaticMalloc(msg, sizeof(struct TLV));
-	if (!tlv) {
-		Logging(LOG_WARNING, "new tlv static, malloc failed.\n");
-		return NULL;
-	}
-	tlv->type = type;
-	tlv->length = 0;
-	tlv->value = NULL;
-
-	return tlv;
+	(void)msg;
+	return NewTLV(type);
 }
 
 
-// ͷTLVڴռ
+// ͷTLVڴռ䣬TLV 黹ڴأ value  Message  buffer һʧЧ
 void FreeTLV(struct TLV* tlv)
 {
 	if (!tlv) {
-		Logging(LOG_WARNING, "free null tlv?\n");
+		LOG_W("free null tlv?\n");
 		return;
 	} 
 
-	if (tlv->value) {
-		free(tlv->value);
+	if (!Pool_Free(&gl_tlv_pool, tlv)) {
+		LOG_E("free tlv 0x%p, not from pool.\n", tlv);
 	}
-	free(tlv);
-}
-
-
-// ڴд uint16
-union u16_setter {
-	uint16_t val;
-	char buf[2];
-};
-
-
-// ʹ union ʽڴķʽд uint16 ݵ buffer
-void alignment_u16_w(char* buf, uint16_t val)
-{
-	union u16_setter setter;
-	setter.val = val;
-	memcpy(buf, setter.buf, sizeof(setter));
-}
-
-
-// ڴд uint32
-union u32_setter {
-	uint32_t val;
-	char buf[4];
-};
-
-
-// ʹ union ʽڴķʽд uint32 ݵ buffer
-void alignment_u32_w(char* buf, uint32_t val)
-{
-	union u32_setter setter;
-	setter.val = val;
-	memcpy(buf, setter.buf, sizeof(setter));
-}
-
-
-// ڴд uint64
-union u64_setter {
-	uint64_t val;
-	char buf[8];
-};
-
-
-// ʹ union ʽڴķʽд uint64 ݵ buffer
-void alignment_u64_w(char* buf, uint64_t val)
-{
-	union u64_setter setter;
-	setter.val = val;
-	memcpy(buf, setter.buf, sizeof(setter));
-}
-
-
-// ʹ union ʽڴķʽȡ uint16 
-uint16_t alignment_u16_r(const char* buf)
-{
-	union u16_setter reader;
-	memcpy(reader.buf, buf, sizeof(reader));
-	return reader.val;
-}
-
-
-// ֵл int8
-void int8_serialize(int8_t v, char* inBuf)
-{
-	memcpy(inBuf, &v, sizeof(v));
 }
 
 
-// ֵл int16
-void int16_serialize(int16_t v, char* inBuf)
-{
-	memcpy(inBuf, &v, sizeof(v));
-}
-
-
-// ֵл int32
-void int32_serialize(int32_t v, char* inBuf)
-{
-	memcpy(inBuf, &v, sizeof(v));
-}
-
-
-// ֵл int64
-void int64_serialize(int64_t v, char* inBuf)
-{
-	memcpy(inBuf, &v, sizeof(v));
-}
-
-
-// ֵл float
-void float_serialize(float v, char* inBuf)
-{
-	memcpy(inBuf, &v, sizeof(v));
-}
-
-
-// ֵл double
-void double_serialize(double v, char* inBuf)
-{
-	memcpy(inBuf, &v, sizeof(v));
-}
-
-
-// ֵл tlv->vformat ѡͬл
-void value_serialize(struct TLV* tlv, char* inBuf, uint16_t inMaxLength)
+// ֵл tlv->vformat תinBuf Ҫ
+// ֵ length ͳȲʱԭд length ֮
+void value_serialize(const struct TLV* tlv, char* inBuf)
 {
 	switch (tlv->vformat) {
 	case TLV_TYPE_BYTE:
 	case TLV_TYPE_ENUM:
 	case TLV_TYPE_BOOL:
-		int8_serialize(host2NetInt8(*(int8_t*)tlv->value), inBuf);
+		if (tlv->length == sizeof(uint8_t)) {
+			inBuf[0] = (char)tlv->value[0];
+			return;
+		}
 		break;
 	case TLV_TYPE_SHORT:
-		int16_serialize(host2NetInt16(*(int16_t*)tlv->value), inBuf);
+		if (tlv->length == sizeof(uint16_t)) {
+			nb_store_be16(inBuf, nb_load_u16(tlv->value));
+			return;
+		}
 		break;
 	case TLV_TYPE_INT32:
-		int32_serialize(host2NetInt32(*(int32_t*)tlv->value), inBuf);
-		break;
-	case TLV_TYPE_LONG64:
-		int64_serialize(host2NetInt64(*(int64_t*)tlv->value), inBuf);
-		break;
 	case TLV_TYPE_FLOAT:
-		float_serialize(host2NetFloat(*(float*)tlv->value), inBuf);
+		if (tlv->length == sizeof(uint32_t)) {
+			nb_store_be32(inBuf, nb_load_u32(tlv->value));
+			return;
+		}
 		break;
+	case TLV_TYPE_LONG64:
 	case TLV_TYPE_DOUBLE:
-		double_serialize(host2NetDouble(*(double*)tlv->value), inBuf);
+		if (tlv->length == sizeof(uint64_t)) {
+			nb_store_be64(inBuf, nb_load_u64(tlv->value));
+			return;
+		}
 		break;
 	default:
-		memcpy(inBuf, tlv->value, tlv->length);
 		break;
 	}
+	memcpy(inBuf, tlv->value, tlv->length);
 }
 
 
@@ -959,50 +894,27 @@ void value_serialize(struct TLV* tlv, char* inBuf, uint16_t inMaxLength)
 int TLVSerialize(struct TLV* tlv, char* inBuf, uint16_t inMaxLength)
 {
 	if (tlv == NULL) {
-		Logging(LOG_WARNING, "tlv serialize failed, tlv == NULL.\n");
+		LOG_W("tlv serialize failed, tlv == NULL.\n");
 		return -1;
 	}
 
 	if (inBuf == NULL) {
-		Logging(LOG_WARNING, "tlv serialize failed, inBuf == NULL.\n");
+		LOG_W("tlv serialize failed, inBuf == NULL.\n");
 		return -1;
 	}
 	if (inMaxLength < tlv->length + 3) {
-		Logging(LOG_TRACE, "tlv serialize buffer is too small, aborted.\n");
+		LOG_T("tlv serialize buffer is too small, aborted.\n");
 		return -1;
 	}
 	inBuf[0] = tlv->type;
-	alignment_u16_w(inBuf + 1, nb_htons(tlv->length));
+	nb_store_be16(inBuf + 1, tlv->length);
 
-	value_serialize(tlv, inBuf + 3, inMaxLength - 3);
+	value_serialize(tlv, inBuf + 3);
 
 	return tlv->length + 3;
 }
 
 
-// л Message  data 
-int SerializeBody(const struct Messages* msg, char* inBuf, uint16_t inMaxLength)
-{
-	int i, ret, pos, length;
-	inBuf[0] = msg->msgid;
-
-	length = 0;
-	pos = 3;
-	for (i = 0; i != msg->tlv_count; ++i) {
-		length += msg->tlvs[i]->length + 3;
-		ret = TLVSerialize(msg->tlvs[i], inBuf + pos, inMaxLength - pos);
-		if (ret < 0) {
-			Logging(LOG_WARNING, "serialize tlv failed. \n");
-			return -1;
-		}
-		pos += ret;
-	}
-
-	alignment_u16_w(inBuf + 1, nb_htons(length));
-	return 3 + length;
-}
-
-
 // checksum 㣬ۼӺ
 uint8_t CalcCheckSum(const char* buf, uint16_t length)
 {
@@ -1016,172 +928,262 @@ uint8_t CalcCheckSum(const char* buf, uint16_t length)
 }
 
 
-/*
-ûָӦл
-1ܳ
-2лtlv
-*/
-int UserCmdRspMsgSerialize(const struct Messages* msg, char* inBuf, uint16_t inMaxLength)
+//  MessageWriter Ԥ length ֽڣĩβʼ checksum  1 ֽڣռ䲻㷵NULL
+static uint8_t* writer_reserve(struct MessageWriter* w, uint16_t length)
 {
-	int i, pos, packet_length;
-
-	// ж
-	if (msg == NULL) {
-		Logging(LOG_WARNING, "tlv messages msg == NULL.\n");
-		return -1;
-	}
-	if (inBuf == NULL) {
-		Logging(LOG_WARNING, "serialize buffer == NULL.\n");
-		return -1;
-	}
-
-	// ȥdataĳ
-	// 1	1	2	2	1 == 7
-	packet_length = 7;
-	for (i = 0; i != msg->tlv_count; ++i) {
-		// ÿ TLV ͷ3ֽ
-		packet_length += msg->tlvs[i]->length + 3;
+	if (w->error) {
+		return NULL;
 	}
-	// data Ҳһܴtlvt + l Ϊ3
-	packet_length += 3;
-	if (inMaxLength < packet_length) {
-		Logging(LOG_WARNING, "Messages serialize buffer too small.\n");
-		return -1;
+	if (w->pos + length + 1 > w->maxlength) {
+		LOG_W("Messages serialize buffer too small.\n");
+		w->error = 1;
+		return NULL;
 	}
-	// ʼлǹ
-	inBuf[0] = EASYIOT_COAP_VERSION;
-	inBuf[1] = CMT_USER_CMD_RSP;
-	pos = 2;
+	return w->buf + w->pos;
+}
 
-	// λֶ 4 ~ 11Ϊܳ - 4
-	alignment_u16_w(inBuf + pos, nb_htons(packet_length - 4));
-	pos += 2;
 
-	// mid
-	alignment_u16_w(inBuf + pos, msg->dtag_mid);
-	pos += 2;
+// Ԥд󣬼 checksum ǰдλ
+static void writer_commit(struct MessageWriter* w, uint16_t length)
+{
+	const uint8_t* p = w->buf + w->pos;
+	uint32_t sum = 0;
+	uint16_t i;
 
-	// Ȼл data 
-	i = SerializeBody(msg, inBuf + pos, inMaxLength - pos);
-	if (i < 0) {
-		Logging(LOG_WARNING, "messages body serialize failed.\n");
-		return -1;
+	for (i = 0; i != length; ++i) {
+		sum += p[i];
 	}
-	pos += i;
+	w->sum += sum;
+	w->pos += length;
+}
 
-	// check sum.
-	inBuf[pos] = CalcCheckSum(inBuf, pos);
 
-	return pos + 1;
+//  offset  uint16 ֶΣֽ򣩣 checksum
+static void writer_patch_u16(struct MessageWriter* w, uint16_t offset, uint16_t val)
+{
+	nb_store_be16(w->buf + offset, val);
+	w->sum += w->buf[offset] + w->buf[offset + 1];
 }
 
 
 /*
-ûϱݱл
-1ܳ
-2лtlv
+ʼһбģֱд buf
+1ֶΡdata ֶд 0EndMessage ʱ
+2CMT_USER_UP ڴʱȡ صźǿʱ
 */
-int UserUpMsgSerialize(const struct Messages* msg, char* inBuf, uint16_t inMaxLength)
+int BeginMessage(struct MessageWriter* w, uint8_t* buf, uint16_t inMaxLength, enum CoapMessageType type, uint8_t msgid, uint16_t dtag_mid)
 {
-	int i, pos, packet_length;
+	char* p;
+	int pos, length;
 	uint8_t battery;
 	int32_t signal;
 	uint64_t timestamp;
 
-	// ж
-	if (msg == NULL) {
-		Logging(LOG_WARNING, "tlv messages msg == NULL.\n");
-		return -1;
-	}
-	if (inBuf == NULL) {
-		Logging(LOG_WARNING, "serialize buffer == NULL.\n");
-		return -1;
-	}
+	w->buf = buf;
+	w->maxlength = inMaxLength;
+	w->pos = 0;
+	w->body = 0;
+	w->sum = 0;
+	w->error = 0;
 
-	// ȥdataĳ
-	// 1	1	2	2	1	4	15	15	8	1 == 50
-	packet_length = 50;
-	for (i = 0; i != msg->tlv_count; ++i) {
-		// ÿ TLV ͷ3ֽ
-		packet_length += msg->tlvs[i]->length + 3;
-	}
-	// data Ҳһܴtlvt + l Ϊ3
-	packet_length += 3;
-	if (inMaxLength < packet_length) {
-		Logging(LOG_WARNING, "Messages serialize buffer too small.\n");
+	if (buf == NULL) {
+		LOG_W("serialize buffer == NULL.\n");
+		w->error = 1;
 		return -1;
 	}
 
-	//  ص źǿȣʱ
-	if (gl_timestampcb) {
-		timestamp = gl_timestampcb();
+	// data ǰĳȣdata  t + l һд
+	// 1	1	2	2	(1	4	15	15	8)	3
+	if (type == CMT_USER_UP) {
+		length = EASYIOT_UP_HEADER_SIZE + 3;
+	} else if (type == CMT_USER_CMD_RSP) {
+		length = EASYIOT_RSP_HEADER_SIZE + 3;
 	} else {
-		Logging(LOG_WARNING, "timestamp callback empty, ignore and set to 0.\n");
-		timestamp = 0;
+		LOG_W("unknown message type.\n");
+		w->error = 1;
+		return -1;
 	}
-	if (gl_signalcb) {
-		signal = gl_signalcb();
-	} else {
-		Logging(LOG_WARNING, "signal strength callback empty, ignore and set to 0.\n");
-		signal = 0;
+	p = (char*)writer_reserve(w, length);
+	if (!p) {
+		return -1;
 	}
-	if (gl_batterycb) {
-		battery = gl_batterycb();
-	} else {
-		Logging(LOG_WARNING, "battery status callback empty, ignore and set to 0.\n");
-		battery = 0;
+
+	// ʼлǹ֣λΪܳ - 4ռλ
+	p[0] = EASYIOT_COAP_VERSION;
+	p[1] = type;
+	p[2] = 0;
+	p[3] = 0;
+	pos = 4;
+
+	// dtag / mid ҪдСת
+	nb_store_u16(p + pos, dtag_mid);
+	pos += sizeof(uint16_t);
+
+	if (type == CMT_USER_UP) {
+		//  ص źǿȣʱ
+		if (gl_timestampcb) {
+			timestamp = gl_timestampcb();
+		} else {
+			LOG_W("timestamp callback empty, ignore and set to 0.\n");
+			timestamp = 0;
+		}
+		if (gl_signalcb) {
+			signal = gl_signalcb();
+		} else {
+			LOG_W("signal strength callback empty, ignore and set to 0.\n");
+			signal = 0;
+		}
+		if (gl_batterycb) {
+			battery = gl_batterycb();
+		} else {
+			LOG_W("battery status callback empty, ignore and set to 0.\n");
+			battery = 0;
+		}
+		if (battery > 100) {
+			LOG_W("battery level lager than 100, set to 100.\n");
+			battery = 100;
+		}
+
+		// battery.
+		p[pos] = battery;
+		pos += sizeof(uint8_t);
+
+		// signal strength
+		nb_store_be32(p + pos, (uint32_t)signal);
+		pos += sizeof(uint32_t);
+
+		// imei && imsi;
+		memcpy(p + pos, gl_imei, STANDARD_IMEI_LENGTH);
+		pos += STANDARD_IMEI_LENGTH;
+		memcpy(p + pos, gl_imsi, STANDARD_IMSI_LENGTH);
+		pos += STANDARD_IMSI_LENGTH;
+
+		// timestamp
+		nb_store_be64(p + pos, timestamp);
+		pos += sizeof(uint64_t);
 	}
-	if (battery > 100) {
-		Logging(LOG_WARNING, "battery level lager than 100, set to 100.\n");
-		battery = 100;
+
+	// data Ҳһܴtlvmsgid ֮ĳλռλ
+	w->body = pos;
+	p[pos] = msgid;
+	p[pos + 1] = 0;
+	p[pos + 2] = 0;
+
+	writer_commit(w, length);
+	return length;
+}
+
+
+//  MessageWriter дһ TLVvformat  value Ķת
+int PutBuffer(struct MessageWriter* w, uint8_t type, const uint8_t* v, uint16_t length, uint8_t vformat)
+{
+	struct TLV tlv;
+	char* p;
+
+	p = (char*)writer_reserve(w, length + 3);
+	if (!p) {
+		return -1;
 	}
 
-	// ʼлǹ
-	inBuf[0] = EASYIOT_COAP_VERSION;
-	inBuf[1] = CMT_USER_UP;
-	pos = 2;
+	p[0] = type;
+	nb_store_be16(p + 1, length);
 
-	// λֶ 4 ~ 11Ϊܳ - 4
-	alignment_u16_w(inBuf + pos, nb_htons(packet_length - 4));
-	pos += sizeof(uint16_t);
+	// ֱֵֽд룬ַԭд
+	tlv.length = length;
+	tlv.type = type;
+	tlv.vformat = vformat;
+	tlv.value = (uint8_t*)v;
+	value_serialize(&tlv, p + 3);
+
+	writer_commit(w, length + 3);
+	return length + 3;
+}
+
+
+//  MessageWriter дһ int8 ʽ TLV
+int PutInt8(struct MessageWriter* w, uint8_t type, int8_t v)
+{
+	return PutBuffer(w, type, (uint8_t*)&v, sizeof(int8_t), TLV_TYPE_BYTE);
+}
+
+
+//  MessageWriter дһ int16 ʽ TLV
+int PutInt16(struct MessageWriter* w, uint8_t type, int16_t v)
+{
+	return PutBuffer(w, type, (uint8_t*)&v, sizeof(v), TLV_TYPE_SHORT);
+}
+
+
+//  MessageWriter дһ int32 ʽ TLV
+int PutInt32(struct MessageWriter* w, uint8_t type, int32_t v)
+{
+	return PutBuffer(w, type, (uint8_t*)&v, sizeof(v), TLV_TYPE_INT32);
+}
+
+
+//  MessageWriter дһ int64 ʽ TLV
+int PutInt64(struct MessageWriter* w, uint8_t type, int64_t v)
+{
+	return PutBuffer(w, type, (uint8_t*)&v, sizeof(v), TLV_TYPE_LONG64);
+}
+
+
+//  MessageWriter дһ float ʽ TLV
+int PutFloat(struct MessageWriter* w, uint8_t type, float v)
+{
+	return PutBuffer(w, type, (uint8_t*)&v, sizeof(v), TLV_TYPE_FLOAT);
+}
 
-	// dtag.
-	alignment_u16_w(inBuf + pos, msg->dtag_mid);
-	pos += sizeof(uint16_t);
 
-	// battery.
-	inBuf[pos] = battery;
-	pos += sizeof(uint8_t);
+//  MessageWriter дһ double ʽ TLV
+int PutDouble(struct MessageWriter* w, uint8_t type, double v)
+{
+	return PutBuffer(w, type, (uint8_t*)&v, sizeof(v), TLV_TYPE_DOUBLE);
+}
 
-	// signal strength
-	alignment_u32_w(inBuf + pos, host2NetInt32(signal));
-	pos += sizeof(uint32_t);
 
-	// imei && imsi;
-	memcpy(inBuf + pos, gl_imei, 15);
-	pos += 15;
-	memcpy(inBuf + pos, gl_imsi, 15);
-	pos += 15;
+//  MessageWriter дһ string ʽ TLV
+int PutString(struct MessageWriter* w, uint8_t type, const char* v)
+{
+	return PutBuffer(w, type, (const uint8_t*)v, (uint16_t)strlen(v), TLV_TYPE_STRING_ISO_8859);
+}
 
-	// timestamp
-	alignment_u64_w(inBuf + pos, host2NetInt64(timestamp));
-	pos += sizeof(uint64_t);
 
-	// Ȼл data 
-	i = SerializeBody(msg, inBuf + pos, inMaxLength - pos);
-	if (i < 0) {
-		Logging(LOG_WARNING, "messages body serialize failed.\n");
+//  MessageWriter дһ Ƹʽڴ TLV
+int PutBinary(struct MessageWriter* w, uint8_t type, const char* v, uint16_t length)
+{
+	return PutBuffer(w, type, (const uint8_t*)v, length, TLV_TYPE_STRING_HEX);
+}
+
+
+/*
+
+1ܳ data 򳤶ȣдǰΪ 0ֱӲۼӺͣ
+2д checksumпռ䣬 '\0' β
+ɹرĳȣ checksumʧܷ-1
+*/
+int EndMessage(struct MessageWriter* w)
+{
+	uint16_t packet_length;
+
+	if (w->error) {
+		LOG_W("messages body serialize failed.\n");
 		return -1;
 	}
-	pos += i;
 
-	// check sum.
-	inBuf[pos] = CalcCheckSum(inBuf, pos);
+	// checksum ռ 1 ֽڣwriter_reserve Ϊռ
+	packet_length = w->pos + 1;
+	writer_patch_u16(w, 2, packet_length - 4);
+	writer_patch_u16(w, w->body + 1, w->pos - w->body - 3);
+
+	w->buf[w->pos] = w->sum % 256;
 
 	//ȷַ0β
-	inBuf[pos + 1] = '\0';
-	
-	return pos + 1;
+	if (packet_length < w->maxlength) {
+		w->buf[packet_length] = '\0';
+	}
+
+	return packet_length;
 }
 
 
@@ -1197,18 +1199,22 @@ int MessageDeserializeBodyData(const char* inBuf, uint16_t inLength, struct Mess
 	uint16_t length;
 
 	if (inLength < 3) {
-		Logging(LOG_WARNING, "message deserialize body data failed, too small.\n");
+		LOG_W("message deserialize body data failed, too small.\n");
 		return -1;
 	}
 
 	type = inBuf[0];
-	length = nb_htons(alignment_u16_r(inBuf + 1));
+	length = nb_load_be16(inBuf + 1);
 	if (length + 3 > inLength) {
-		Logging(LOG_WARNING, "message deserialize body data failed, length not match.\n");
+		LOG_W("message deserialize body data failed, length not match.\n");
 		return -1;
 	}
 
-	AddBuffer(out, type, (uint8_t*)(inBuf + 3), length, TLV_TYPE_UNKNOWN);
+	// TLV  value ʱϢлʧ
+	if (AddBuffer(out, type, (uint8_t*)(inBuf + 3), length, TLV_TYPE_UNKNOWN) < 0) {
+		LOG_W("message deserialize body data failed, add buffer failed.\n");
+		return -1;
+	}
 
 	// õ˶ֽ
 	return length + 3;
@@ -1228,7 +1234,7 @@ int UserCmdReqMsgDeserialize(const char* inBuf, uint16_t inLength, struct Messag
 	int rsp, pos, left;
 	uint16_t length;
 	// dtag / mid ҪдСת
-	out->dtag_mid = alignment_u16_r(inBuf + 4);
+	out->dtag_mid = nb_load_u16(inBuf + 4);
 
 	/*
 	2 data tlv  length Ƿȷ
@@ -1236,10 +1242,10 @@ int UserCmdReqMsgDeserialize(const char* inBuf, uint16_t inLength, struct Messag
 	*/
 	out->msgid = inBuf[6];
 	// lengthǷȷ, 7  ָbodylengthƫƣĵ
-	length = nb_htons(alignment_u16_r(inBuf + 7));
+	length = nb_load_be16(inBuf + 7);
 	// 10  Уȥָtlv⣬޹ֽ
 	if (length != inLength - 10) {
-		Logging(LOG_WARNING, "tlv body deserialize failed, length not match.\n");
+		LOG_W("tlv body deserialize failed, length not match.\n");
 		return -1;
 	}
 
@@ -1249,7 +1255,7 @@ int UserCmdReqMsgDeserialize(const char* inBuf, uint16_t inLength, struct Messag
 		// left == inLength - pos - 1, -1 ΪҪȥ checksum
 		rsp = MessageDeserializeBodyData(inBuf + pos, inLength - pos - 1, out);
 		if (rsp < 0) {
-			Logging(LOG_WARNING, "message deserialize body data failed, left %d\n", rsp);
+			LOG_W("message deserialize body data failed, left %d\n", rsp);
 			return -1;
 		}
 		pos += rsp;
@@ -1274,24 +1280,24 @@ int MessagesDeserialize(const char* inBuf, uint16_t inLength, struct Messages* o
 	int rsp;
 
 	rsp = -1;
-	Logging(LOG_TRACE, "prepare deserialize buffer 0x%p, length: %d\n", inBuf, inLength);
+	LOG_T("prepare deserialize buffer 0x%p, length: %d\n", inBuf, inLength);
 
 	version = inBuf[0];
 	if (version != EASYIOT_COAP_VERSION) {
-		Logging(LOG_WARNING, "message deserialize failed, version not match.");
+		LOG_W("message deserialize failed, version not match.");
 		return -1;
 	}
 
 	checksum = CalcCheckSum(inBuf, inLength - 1);
 	rchecksum = inBuf[inLength - 1];
 	if (checksum != rchecksum) {
-		Logging(LOG_WARNING, "message checksum failed, expected [%d], but get [%d].\n", checksum, inBuf[inLength - 1]);
+		LOG_W("message checksum failed, expected [%d], but get [%d].\n", checksum, inBuf[inLength - 1]);
 		return -1;
 	}
 
-	packet_length = nb_htons(alignment_u16_r(inBuf + 2));
+	packet_length = nb_load_be16(inBuf + 2);
 	if (packet_length + 4 != inLength) {
-		Logging(LOG_WARNING, "packet length not match.\n");
+		LOG_W("packet length not match.\n");
 		return -1;
 	}
 
@@ -1315,28 +1321,262 @@ int MessagesDeserialize(const char* inBuf, uint16_t inLength, struct Messages* o
 }
 
 
-// Message л
-int MessagesSerialize(const struct Messages* msg, char* inBuf, uint16_t inMaxLength)
+/*
+ԭشбģκ
+1汾šУܳ͡ȣͬ MessagesDeserialize
+2ָټ data ȣһ TLV һ TLV Խ checksum ʧܣ
+ɹ TLV ʧܷ-1
+*/
+int OpenMessage(struct MessageReader* r, const uint8_t* buf, uint16_t inLength)
 {
-	int rsp;
+	uint8_t checksum;
+	uint16_t pos, length;
 
-	rsp = -1;
-	Logging(LOG_TRACE, "prepare serialize message 0x%p, sensor count: %d\n", msg, msg->tlv_count);
-	switch (msg->msgType) {
-	case CMT_USER_UP:
-		Logging(LOG_TRACE, "message type is CMT_USER_UP.\r\n");
-		rsp = UserUpMsgSerialize(msg, inBuf, inMaxLength);
+	memset(r, 0, sizeof(struct MessageReader));
+	// 汾ܳ͡ȡchecksum  5 ֽ
+	if (inLength < 5) {
+		LOG_W("message open failed, too small.\n");
+		return -1;
+	}
+
+	if (buf[0] != EASYIOT_COAP_VERSION) {
+		LOG_W("message open failed, version not match.\n");
+		return -1;
+	}
+
+	checksum = CalcCheckSum((const char*)buf, inLength - 1);
+	if (checksum != buf[inLength - 1]) {
+		LOG_W("message checksum failed, expected [%d], but get [%d].\n", checksum, buf[inLength - 1]);
+		return -1;
+	}
+
+	if (nb_load_be16(buf + 2) + 4 != inLength) {
+		LOG_W("packet length not match.\n");
+		return -1;
+	}
+
+	r->buf = buf;
+	r->length = inLength;
+	r->msgType = buf[1];
+	r->end = inLength - 1;
+	r->body = r->end;
+
+	switch (r->msgType) {
+	case CMT_USER_CMD_REQ:
+		// 10  Уȥָtlv⣬޹ֽ UserCmdReqMsgDeserialize
+		if (inLength < 10) {
+			LOG_W("message open failed, too small.\n");
+			return -1;
+		}
+		// dtag / mid ҪдСת
+		r->dtag_mid = nb_load_u16(buf + 4);
+		r->msgid = buf[6];
+		length = nb_load_be16(buf + 7);
+		if (length != inLength - 10) {
+			LOG_W("tlv body open failed, length not match.\n");
+			return -1;
+		}
+
+		r->body = 9;
+		for (pos = r->body; pos != r->end; pos += length + 3) {
+			if (r->end - pos < 3) {
+				LOG_W("message open body data failed, too small.\n");
+				return -1;
+			}
+			length = nb_load_be16(buf + pos + 1);
+			if (length > r->end - pos - 3) {
+				LOG_W("message open body data failed, length not match.\n");
+				return -1;
+			}
+			r->tlv_count++;
+		}
 		break;
-	case CMT_USER_CMD_RSP:
-		Logging(LOG_TRACE, "message type is CMT_USER_CMD_RSP.\r\n");
-		rsp = UserCmdRspMsgSerialize(msg, inBuf, inMaxLength);
+	case CMT_USER_UP_ACK:
+		// ACK ݣͬ UserUpAckMsgDeserialize
 		break;
 	default:
-		Logging(LOG_WARNING, "unknown message type.\n");
-		break;
+		LOG_W("message type 0x%x not supported.\n", r->msgType);
+		return -1;
 	}
 
-	return rsp;
+	r->pos = r->body;
+	return r->tlv_count;
+}
+
+
+// ˳ȡһ TLVOpenMessage Ѽȣ˴ټ
+int NextTLV(struct MessageReader* r, struct TLVView* tlv)
+{
+	if (r->pos >= r->end) {
+		return 0;
+	}
+
+	tlv->type = r->buf[r->pos];
+	tlv->length = nb_load_be16(r->buf + r->pos + 1);
+	tlv->value = r->buf + r->pos + 3;
+	r->pos += tlv->length + 3;
+	return 1;
+}
+
+
+// ͷָ type ĵһ TLVӰ NextTLV λ
+int FindTLV(const struct MessageReader* r, uint8_t type, struct TLVView* tlv)
+{
+	struct MessageReader it = *r;
+
+	it.pos = it.body;
+	while (NextTLV(&it, tlv)) {
+		if (tlv->type == type) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+// Ҷ TLVȲΪЧͬ get_tlv_from_msg
+static const uint8_t* reader_value(const struct MessageReader* r, uint8_t type, uint16_t length)
+{
+	struct TLVView tlv;
+
+	if (!FindTLV(r, type, &tlv)) {
+		LOG_W("cannot found valid tlv %d from msg 0x%p\n", type, r);
+		return NULL;
+	}
+	if (length && tlv.length != length) {
+		LOG_W("Read tlv %d, length %d not match %d.\n", type, tlv.length, length);
+		return NULL;
+	}
+	return tlv.value;
+}
+
+
+// ȡ Int8 TLVvalue һ룬ֽԷǶȡת
+int ReadInt8(const struct MessageReader* r, uint8_t type, int8_t* v)
+{
+	const uint8_t* value = reader_value(r, type, sizeof(int8_t));
+
+	if (!value) {
+		return -1;
+	}
+	*v = (int8_t)value[0];
+	return sizeof(int8_t);
+}
+
+
+// ȡ Int16 TLV
+int ReadInt16(const struct MessageReader* r, uint8_t type, int16_t* v)
+{
+	const uint8_t* value = reader_value(r, type, sizeof(int16_t));
+
+	if (!value) {
+		return -1;
+	}
+	*v = (int16_t)nb_load_be16(value);
+	return sizeof(int16_t);
+}
+
+
+// ȡ Int32 TLV
+int ReadInt32(const struct MessageReader* r, uint8_t type, int32_t* v)
+{
+	const uint8_t* value = reader_value(r, type, sizeof(int32_t));
+
+	if (!value) {
+		return -1;
+	}
+	*v = (int32_t)nb_load_be32(value);
+	return sizeof(int32_t);
+}
+
+
+// ȡ Int64 TLV
+int ReadLong64(const struct MessageReader* r, uint8_t type, int64_t* v)
+{
+	const uint8_t* value = reader_value(r, type, sizeof(int64_t));
+
+	if (!value) {
+		return -1;
+	}
+	*v = (int64_t)nb_load_be64(value);
+	return sizeof(int64_t);
+}
+
+
+// ȡ float TLV
+int ReadFloat(const struct MessageReader* r, uint8_t type, float* v)
+{
+	const uint8_t* value = reader_value(r, type, sizeof(float));
+
+	if (!value) {
+		return -1;
+	}
+	*v = load_be_float(value);
+	return sizeof(float);
+}
+
+
+// ȡ double TLV
+int ReadDouble(const struct MessageReader* r, uint8_t type, double* v)
+{
+	const uint8_t* value = reader_value(r, type, sizeof(double));
+
+	if (!value) {
+		return -1;
+	}
+	*v = load_be_double(value);
+	return sizeof(double);
+}
+
+
+// ȡ string TLVָڲ '\0' βس
+int ReadString(const struct MessageReader* r, uint8_t type, const char** v)
+{
+	struct TLVView tlv;
+
+	if (!FindTLV(r, type, &tlv)) {
+		LOG_W("cannot found valid tlv %d from msg 0x%p\n", type, r);
+		return -1;
+	}
+	*v = (const char*)tlv.value;
+	return tlv.length;
+}
+
+
+// ȡ binary ڴ TLVָڲس
+int ReadBinary(const struct MessageReader* r, uint8_t type, const uint8_t** v)
+{
+	struct TLVView tlv;
+
+	if (!FindTLV(r, type, &tlv)) {
+		LOG_W("cannot found valid tlv %d from msg 0x%p\n", type, r);
+		return -1;
+	}
+	*v = tlv.value;
+	return tlv.length;
+}
+
+
+// Message л TLV д MessageWriterԤȼ㳤
+int MessagesSerialize(const struct Messages* msg, char* inBuf, uint16_t inMaxLength)
+{
+	int i;
+	struct MessageWriter w;
+
+	if (msg == NULL) {
+		LOG_W("tlv messages msg == NULL.\n");
+		return -1;
+	}
+
+	LOG_T("prepare serialize message 0x%p, sensor count: %d\n", msg, msg->tlv_count);
+	if (BeginMessage(&w, (uint8_t*)inBuf, inMaxLength, (enum CoapMessageType)msg->msgType, msg->msgid, msg->dtag_mid) < 0) {
+		return -1;
+	}
+	for (i = 0; i != msg->tlv_count; ++i) {
+		PutBuffer(&w, msg->tlvs[i]->type, msg->tlvs[i]->value, msg->tlvs[i]->length, msg->tlvs[i]->vformat);
+	}
+
+	return EndMessage(&w);
 }
 
 
@@ -1349,14 +1589,14 @@ int pushMessageStackedBuffer(struct Messages* msg)
 
 	length = MessagesSerialize(msg, buf, sizeof(buf));
 	if (length < 0) {
-		Logging(LOG_WARNING, "message serialize failed.\n");
+		LOG_W("message serialize failed.\n");
 		return -1;
 	}
 
 	// ͳȥ
 	rsp = CoapOutput((uint8_t*)buf, length);
 	if (rsp < 0) {
-		Logging(LOG_WARNING, "coap output failed.\n");
+		LOG_W("coap output failed.\n");
 		return -1;
 	}
 	return -1;
@@ -1364,7 +1604,7 @@ int pushMessageStackedBuffer(struct Messages* msg)
 
 
 // ʹMessageڵʣڴռ䣬лCoAP ݷ
-// ɺ󷵻ⲿڴռ䣬 msg->sbuf_offset 
+// ɺ󷵻ⲿڴռ䣬 msg->sbuf_offset Ҳ㣻
 int pushMessageStatic(struct Messages* msg)
 {
 	int rsp, length, left;
@@ -1374,27 +1614,47 @@ int pushMessageStatic(struct Messages* msg)
 	left = msg->sbuf_maxlength - msg->sbuf_offset;
 	length = MessagesSerialize(msg, buf, left);
 	if (length < 0) {
-		Logging(LOG_WARNING, "message serialize failed.\n");
+		LOG_W("message serialize failed.\n");
 		return -1;
 	}
 
 	// ͳȥ
 	rsp = CoapOutput((uint8_t*)buf, length);
 	if (rsp < 0) {
-		Logging(LOG_WARNING, "coap output failed.\n");
+		LOG_W("coap output failed.\n");
 		return -1;
 	}
 
-	memset(buf, 0, left);
 	return -1;
 }
 
 
+//  MessageWriter Ĺ죬͵EasyIoTƽ̨
+int pushMessageWriter(struct MessageWriter* w)
+{
+	int rsp, length;
+
+	length = EndMessage(w);
+	if (length < 0) {
+		LOG_W("message serialize failed.\n");
+		return -1;
+	}
+
+	// ͳȥ
+	rsp = CoapOutput(w->buf, length);
+	if (rsp < 0) {
+		LOG_W("coap output failed.\n");
+		return -1;
+	}
+	return length;
+}
+
+
 // Message͵EasyIoTƽ̨
 int pushMessages(struct Messages *msg)
 {
 	if (msg->sbuf_use) {
-		Logging(LOG_TRACE, "message using static buffer, using static push messages.\r\n");
+		LOG_T("message using static buffer, using static push messages.\r\n");
 		return pushMessageStatic(msg);
 	} else {
 		return pushMessageStackedBuffer(msg);
@@ -1409,46 +1669,43 @@ int pushMessages(struct Messages *msg)
 */
 int CoapInput(struct Messages* msg, uint8_t *data, uint16_t inLength)
 {
-	int ret, i, found;
-	CmdHandlerFuncPtr ptr;
+	int ret;
+	const cmd_handler_t* slot;
 	
 	ret = MessagesDeserialize((const char*)data, inLength, msg);
 	if (ret < 0) {
-		Logging(LOG_WARNING, "message deserialize failed.\n");
+		LOG_W("message deserialize failed.\n");
+		// ѷл TLV 黹ڴ
+		FreeMessage(msg);
 		return -1;
 	}
-	Logging(LOG_INFO, "message deserialize succ, tlv count: %d\n", msg->tlv_count);
+	LOG_I("message deserialize succ, tlv count: %d\n", msg->tlv_count);
 
 	switch (msg->msgType) {
 	case CMT_USER_UP_ACK: {
-		Logging(LOG_INFO, "recv ack.\n");
+		LOG_I("recv ack.\n");
 		if (!gl_ackhandler) {
-			Logging(LOG_INFO, "ack handler == null, ignore ack.\r\n");
+			LOG_I("ack handler == null, ignore ack.\r\n");
 		} else {
-			Logging(LOG_INFO, "found ack handler at 0x%p, process it.\r\n", gl_ackhandler);
+			LOG_I("found ack handler at 0x%p, process it.\r\n", gl_ackhandler);
 			gl_ackhandler(msg);
 		}
 		break;
 	}
 	case CMT_USER_CMD_REQ: {
-		Logging(LOG_INFO, "recv cmd.\n");
-		// cmdidзַhandler
-		found = 0;
-		for (i = 0; i != cmd_handler_count; ++i){
-			if (msg->msgid == gl_cmd_handlers[i].CmdID) {
-				found = 1;
-				ptr = gl_cmd_handlers[i].ptr;
-				if (!ptr) {
-					Logging(LOG_WARNING, "msg %d cmd handler is null.\n", msg->msgid);
-				} else {
-					Logging(LOG_INFO, "found cmdid %d handler at 0x%p, process it.\r\n", msg->msgid, ptr);
-					ptr(msg);
-					break;
-				}
-			}
-		}
-		if (!found) {
-			Logging(LOG_WARNING, "cannot found cmdhandler for %d \n", msg->msgid);
+		LOG_I("recv cmd.\n");
+		// cmdidֱhandler
+		slot = cmd_handler_find(msg->msgid);
+		if (!slot) {
+			LOG_W("cannot found cmdhandler for %d \n", msg->msgid);
+		} else if (slot->ctx_ptr) {
+			LOG_I("found cmdid %d handler at 0x%p, process it.\r\n", msg->msgid, slot->ctx_ptr);
+			slot->ctx_ptr(msg, slot->context);
+		} else if (slot->ptr) {
+			LOG_I("found cmdid %d handler at 0x%p, process it.\r\n", msg->msgid, slot->ptr);
+			slot->ptr(msg);
+		} else {
+			LOG_W("msg %d cmd handler is null.\n", msg->msgid);
 		}
 		break;
 	}
@@ -1461,6 +1718,57 @@ int CoapInput(struct Messages* msg, uint8_t *data, uint16_t inLength)
 }
 
 
+/*
+   CoAPԭ룬ͬ CoapInput Messages
+1OpenMessage ԭؽ
+2inputͣӦ reader صصе TLVView ָ data
+*/
+int CoapInputInPlace(const uint8_t* data, uint16_t inLength)
+{
+	int ret;
+	struct MessageReader r;
+	const cmd_handler_t* slot;
+
+	ret = OpenMessage(&r, data, inLength);
+	if (ret < 0) {
+		LOG_W("message open failed.\n");
+		return -1;
+	}
+	LOG_I("message open succ, tlv count: %d\n", r.tlv_count);
+
+	switch (r.msgType) {
+	case CMT_USER_UP_ACK: {
+		LOG_I("recv ack.\n");
+		if (!gl_ackreader) {
+			LOG_I("ack reader == null, ignore ack.\r\n");
+		} else {
+			gl_ackreader(&r);
+		}
+		break;
+	}
+	case CMT_USER_CMD_REQ: {
+		LOG_I("recv cmd.\n");
+		// cmdidֱreader
+		slot = cmd_handler_find(r.msgid);
+		if (slot && slot->ctx_reader) {
+			LOG_I("found cmdid %d reader, process it.\r\n", r.msgid);
+			slot->ctx_reader(&r, slot->context);
+		} else if (slot && slot->reader) {
+			LOG_I("found cmdid %d reader, process it.\r\n", r.msgid);
+			slot->reader(&r);
+		} else {
+			LOG_W("cannot found cmd reader for %d \n", r.msgid);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	return ret;
+}
+
+
 // CoAP ˴ʵΪ BC95 ģҪATָӦ޸
 int CoapOutput(uint8_t *inBuf, uint16_t inLength)
 {
@@ -1468,7 +1776,7 @@ int CoapOutput(uint8_t *inBuf, uint16_t inLength)
 //	char headbuf[16];
 
 	if (!gl_nb_out) {
-		Logging(LOG_WARNING, "nb serial output cb is null, pls use setNbSerialOutputCb set it.\r\n");
+		LOG_W("nb serial output cb is null, pls use setNbSerialOutputCb set it.\r\n");
 		return -1;
 	}
 
@@ -1500,13 +1808,17 @@ void SetLogLevel(enum LoggingLevel level)
 // ־Ҫʹ stdarg еĺҪȥ
 int Logging(enum LoggingLevel level, const char* fmt, ...)
 {
-	int ret;
+	int ret = 0;
 	char buf[128];
 
 	va_list arg_ptr;
 	va_start(arg_ptr, fmt);
 	if (level >= gl_loglevel) {
-		ret = vsprintf(buf, fmt, arg_ptr);
+		if (gl_log_format) {
+			gl_log_format(level, fmt, arg_ptr);
+		} else {
+			ret = vsprintf(buf, fmt, arg_ptr);
+		}
 	}
 	va_end(arg_ptr);
 
@@ -1520,21 +1832,21 @@ int Logging(enum LoggingLevel level, const char* fmt, ...)
 // ascii2binaryÿֽASCIIʾHEXݣת1ֽڵĶڴbyteݣ2ֽڵַ"AA"ת1ֽڵbyte 0xAA
 int a2b_hex(const char* s, char* out, int inMaxLength)
 {
-	int i, pos;
 	int length = strlen(s);
 
 	if (length % 2) {
-		Logging(LOG_WARNING, "input hex data must be even\n");
+		LOG_W("input hex data must be even\n");
 		return -1;
 	}
 	if (inMaxLength < length / 2) {
-		Logging(LOG_WARNING, "input buffer too small.\n");
+		LOG_W("input buffer too small.\n");
 		return -1;
 	}
 
-	pos = 0;
-	for (i = 0; i < length - 1; i += 2) {
-		out[pos++] = (s[i] >= 'A' ? s[i] - 'A' + 10 : s[i] - '0') * 16 + (s[i + 1] >= 'A' ? s[i + 1] - 'A' + 10 : s[i + 1] - '0');
+	// СдɣHEXַʧ
+	if (Hex_Decode((uint8_t*)out, length / 2, s, length) != length / 2) {
+		LOG_W("input hex data invalid.\n");
+		return -1;
 	}
 
 	return length / 2;
@@ -1550,18 +1862,21 @@ int CoapHexInput(const char* data)
 
 	ret = a2b_hex(data, cmdbuf, sizeof(cmdbuf));
 	if (ret < 0) {
-		Logging(LOG_WARNING, "ascii to binary hex failed.\n");
+		LOG_W("ascii to binary hex failed.\n");
 		return -1;
 	}
-	Logging(LOG_TRACE, "coap hex static input %d, to binary %d.\r\n", strlen(data), ret);
+	LOG_T("coap hex static input %d, to binary %d.\r\n", strlen(data), ret);
 
 	msg = NewMessage();
+	if (!msg) {
+		return -1;
+	}
 	ret = CoapInput(msg, (uint8_t*)cmdbuf, ret);
 	if (ret < 0) {
-		Logging(LOG_WARNING, "coap input process failed.\n");
+		LOG_W("coap input process failed.\n");
 		return -1;
 	}
-	Logging(LOG_TRACE, "coap input static process finished, ret %d.\r\n", ret);
+	LOG_T("coap input static process finished, ret %d.\r\n", ret);
 
 	return ret;
 }
@@ -1578,10 +1893,10 @@ int CoapHexInputStatic(const char* data, uint8_t* inBuf, uint16_t inMaxLength)
 
 	ret = a2b_hex(data, (char*)inBuf, inMaxLength);
 	if (ret < 0) {
-		Logging(LOG_WARNING, "ascii to binary hex failed.\n");
+		LOG_W("ascii to binary hex failed.\n");
 		return -1;
 	}
-	Logging(LOG_TRACE, "coap hex input %d, to binary %d.\r\n", strlen(data), ret);
+	LOG_T("coap hex input %d, to binary %d.\r\n", strlen(data), ret);
 
     //make ret_copy aligned(4) to message
     ret_copy = ret;
@@ -1590,10 +1905,46 @@ int CoapHexInputStatic(const char* data, uint8_t* inBuf, uint16_t inMaxLength)
 	msg = NewMessageStatic(inBuf + ret_copy, inMaxLength - ret_copy);
 	ret = CoapInput(msg, inBuf, ret);
 	if (ret < 0) {
-		Logging(LOG_WARNING, "coap input process failed.\n");
+		LOG_W("coap input process failed.\n");
 		return -1;
 	}
-	Logging(LOG_TRACE, "coap input process finished, ret %d.\r\n", ret);
+	LOG_T("coap input process finished, ret %d.\r\n", ret);
 
 	return ret;
 }
+
+
+/*
+ASCII HEXʽCoAPԭ봦HEX ͵תΪƺֱ CoapInputInPlace
+1ֻת 4 ֽڱͷܳ HEX Ȳģಿֲת
+2 n ֽ data[2n]data[2n+1] תд data[n]дλδȡַ֮ǰԭؽУ
+ҪĽ bufferбĳֻ data ڵĽ buffer 
+*/
+int CoapHexInputInPlace(char* data, uint16_t inLength)
+{
+	uint8_t* buf = (uint8_t*)data;
+	uint16_t length;
+
+	if (inLength % 2) {
+		LOG_W("input hex data must be even\n");
+		return -1;
+	}
+	length = inLength / 2;
+
+	if (length < 5 || Hex_Decode(buf, 4, data, 8) != 4) {
+		LOG_W("input hex data invalid.\n");
+		return -1;
+	}
+	if (nb_load_be16(data + 2) + 4 != length) {
+		LOG_W("packet length not match.\n");
+		return -1;
+	}
+
+	if (Hex_Decode(buf + 4, length - 4, data + 8, inLength - 8) != length - 4) {
+		LOG_W("input hex data invalid.\n");
+		return -1;
+	}
+	LOG_T("coap hex in place input %d, to binary %d.\r\n", inLength, length);
+
+	return CoapInputInPlace(buf, length);
+}
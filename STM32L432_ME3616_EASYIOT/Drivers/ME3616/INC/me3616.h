@@ -45,16 +45,27 @@
      
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <ctype.h>
 
 #include "main.h"
 #include "stm32l4xx_hal.h"
+#include "me3616_hex.h"
 
 
 //use DBG_Print() to foward Tx and Rx and print inner debug message, using DBG_UART.
 #define DEBUG_ME3616
+
+//Send DBG_Print() / DBG_Printf() records to DBG_UART as binary frames, formatted on PC
+//by Host/Tools/dbg_decode from the ELF file. Comment it out for plain text.
+//#define ME3616_DBG_BINARY
+
+//Receive by UART IDLE line and DMA half / full transfer, the IRQ only publishes the DMA
+//write position, strings are parsed in thread context by ME3616_Rx_Process().
+//Comment it out to parse strings in USART IRQ on character match of '\n'.
+#define ME3616_RX_IDLE_MODE
    
 
 #define ME3616_UART                     huart1 
@@ -81,8 +92,19 @@ extern UART_HandleTypeDef				DBG_UART;
 //A Buffer for DBG, From PC to MCU
 #define ME3616_DBG_RX_BUFFER_SIZE 		200
 
-//Wait ME3616 boot up
-#define ME3616_BOOT_TIMOUT              40000
+//Ring of DBG_Print() records waiting for DBG_UART, bytes, power of 2. Records not fit are dropped and counted.
+#define ME3616_DBG_LOG_SIZE             2048
+
+//Boot stages of ME3616_Init(), pulse length or deadline of each stage, see Boot_Stage_t
+#define ME3616_BOOT_POWER_PULSE         1000
+#define ME3616_BOOT_RESET_PULSE         1000
+#define ME3616_BOOT_MATREADY_TIMOUT     15000
+#define ME3616_BOOT_CPIN_TIMOUT         5000
+#define ME3616_BOOT_CFUN_TIMOUT         10000
+#define ME3616_BOOT_IP_TIMOUT           30000
+//After IPv4 assigned, wait IPv6 no longer than this. Some SIM Card does not support IPv6.
+#define ME3616_BOOT_IPV6_WAIT           3000
+#define ME3616_BOOT_AT_TIMOUT           5000
 
 //Wait until AT_State ready to Send
 #define ME3616_SEND_TIMOUT              5000
@@ -90,6 +112,19 @@ extern UART_HandleTypeDef				DBG_UART;
 //Wait ME3616 response OK / ERROR
 #define ME3616_RECEIVE_TIMOUT           10000
 
+//Depth of the asynchronous AT request queue, see ME3616_Queue_AT_Command()
+#define ME3616_AT_QUEUE_SIZE            8
+
+//Fields and bytes of strings / hex blobs kept from a command response, see AT_Response_t
+#define ME3616_RESPONSE_FIELD_MAX       6
+#define ME3616_RESPONSE_DATA_SIZE       64
+
+//Slots of the Active Report (URC) handler table, power of 2, see ME3616_Register_URC()
+#define ME3616_URC_TABLE_SIZE           32
+
+//Reports and responses carrying raw bytes after a length field, see ME3616_Register_Counted()
+#define ME3616_COUNTED_TABLE_SIZE       8
+
 //Buffer size to store IP address
 #define ME3616_IPV4_SIZE                18
 #define ME3616_IPV6_SIZE                42
@@ -298,8 +333,121 @@ typedef struct {
     AT_CMD_t            LastCMDBase;
     AT_Action_t         LastCMDAction; 
     AT_State_t          At_State;   
+    uint32_t            Timeout;                //response timeout of the command in flight, in ticks
 }AT_Cmd_Info_t;
 
+typedef enum {
+    AT_FIELD_INT = 0,                       //decimal, may be signed
+    AT_FIELD_STRING,                        //quoted or bare, kept '\0' ended
+    AT_FIELD_HEX,                           //quoted or bare hex string, kept as bytes
+    AT_FIELD_COUNTED,                       //bytes, as many as the AT_FIELD_INT before it. Raw on a
+                                            //counted line, see ME3616_Register_Counted(), hex otherwise
+    AT_FIELD_OPTIONAL = 0x80                //OR with a type, field may be empty or missing
+}AT_Field_Type_t;
+
+//Response line of a command, "<Prefix>: <Field>,<Field>,...". Prefix "" for a bare line.
+typedef struct {
+    AT_CMD_t                CMDBase;
+    const char            * Prefix;
+    uint8_t                 PrefixLen;
+    uint8_t                 FieldCount;
+    uint8_t                 Field[ME3616_RESPONSE_FIELD_MAX];    //AT_Field_Type_t
+}AT_Response_Spec_t;
+
+typedef struct {
+    int32_t                 Int;
+    uint16_t                Offset;             //of string / hex in AT_Response_t.Data
+    uint16_t                Len;
+}AT_Field_t;
+
+//Typed response of the last command, filled by Check_Response(), read by AT_Response_Get_xxx().
+typedef struct {
+    const AT_Response_Spec_t  * Spec;           //NULL for a command without spec
+    bool                    Parsed;             //response line found
+    uint8_t                 FieldCount;         //fields parsed, stops at a malformed one
+    uint8_t                 Present;            //bit n set for field n not empty
+    AT_Field_t              Field[ME3616_RESPONSE_FIELD_MAX];
+    uint16_t                DataLen;
+    uint8_t                 Data[ME3616_RESPONSE_DATA_SIZE];
+}AT_Response_t;
+
+struct __Me3616_DeviceType;
+struct __AT_Request;
+
+//Called by ME3616_Poll() once a queued command gets OK, ERROR or times out.
+typedef void (* AT_Complete_Callback_t)(struct __Me3616_DeviceType * Me3616, struct __AT_Request * request, AT_State_t result,
+                                        const AT_Response_t * response);
+
+//Called by Active_Report() with the whole Active Report string.
+typedef void (* AT_Report_Callback_t)(struct __Me3616_DeviceType * Me3616, char * pch, uint16_t len);
+
+typedef struct {
+    const char            * Name;               //part before ':' or '=', such as "+CFUN"
+    uint16_t                Len;
+    AT_Report_Callback_t    Callback;           //NULL for unregistered
+    bool                    Interleave;         //a report even while its own command waits OK, see ME3616_Set_URC_Interleave()
+}AT_Report_Handler_t;
+
+typedef enum {
+    AT_STREAM_HEAD = 0,                         //pch is the line up to the length field, '\0' ended
+    AT_STREAM_DATA,                             //pch is raw bytes as DMA wrote them, any number of calls
+    AT_STREAM_END,                              //CR LF after the raw bytes
+    AT_STREAM_ABORT                             //Rx overrun broke the line, no END comes
+}AT_Stream_Event_t;
+
+//Called by the framer with a streamed counted line, piece by piece, see ME3616_Register_Stream().
+typedef void (* AT_Stream_Callback_t)(struct __Me3616_DeviceType * Me3616, AT_Stream_Event_t event, const char * pch, uint16_t len);
+
+//A line "<Name>=<f0>,...,<fN>,<raw bytes>..." where field N is the count of raw bytes.
+typedef struct {
+    const char            * Name;               //part before ':' or '=', such as "+ESONMI"
+    uint8_t                 Len;
+    uint8_t                 Field;              //index of the length field
+    AT_Stream_Callback_t    Stream;             //NULL for a line handled whole
+}AT_Counted_t;
+
+//One step of a batch, see ME3616_Batch_Start().
+typedef struct {
+    AT_CMD_t                CMDBase;
+    AT_Action_t             CMDAction;
+    const char            * Param;              //for AT_SET
+    bool                    Combine;            //send in one line with the step before, "AT<a>;<b>"
+}AT_Step_t;
+
+typedef struct __AT_Request {
+    AT_CMD_t                CMDBase;
+    AT_Action_t             CMDAction;
+    const char            * Param;              //for AT_SET, MUST stay valid until the callback
+    uint32_t                Timeout;            //ticks, 0 for ME3616_RECEIVE_TIMOUT
+    AT_Complete_Callback_t  Callback;           //may be NULL
+    void                  * Context;            //passed back untouched
+    const AT_Step_t       * Append;             //steps appended to the same command line
+    uint8_t                 AppendCount;
+}AT_Request_t;
+
+struct __AT_Batch;
+
+//Called by ME3616_Poll() once every step of a batch is completed.
+typedef void (* AT_Batch_Callback_t)(struct __Me3616_DeviceType * Me3616, struct __AT_Batch * batch, AT_State_t result);
+
+typedef struct __AT_Batch {
+    const AT_Step_t       * Steps;              //MUST stay valid until the callback, static const is best
+    uint8_t                 StepCount;
+    uint8_t                 Queued;             //steps queued
+    uint8_t                 Done;               //steps completed
+    uint8_t                 Failed;             //steps completed without OK
+    uint8_t                 FirstFailed;        //index of the first failed step
+    AT_State_t              Result;             //AT_STATE_ATOK, or result of the first failed step
+    AT_Batch_Callback_t     Callback;           //may be NULL
+    void                  * Context;            //passed back untouched
+}AT_Batch_t;
+
+//A received line, pointing into RxBuffer. Seg[1] is NULL unless the line wraps the buffer end.
+typedef struct {
+    char                  * Seg[2];
+    uint16_t                Len[2];
+}AT_Line_t;
+
 typedef enum {
     SYS_STATE_POWERON =                 0x00000001,
     SYS_STATE_READY =                   0x00000002,
@@ -325,9 +473,23 @@ typedef enum {
 	
 }SYS_State_t;
 
+typedef enum {
+    BOOT_STAGE_POWER = 0,                   //power key pulse
+    BOOT_STAGE_RESET,                       //reset pulse
+    BOOT_STAGE_MATREADY,                    //wait *MATREADY: 1
+    BOOT_STAGE_CPIN,                        //wait +CPIN: READY
+    BOOT_STAGE_CFUN,                        //wait +CFUN: 1
+    BOOT_STAGE_IP,                          //wait +IP, IPv4 or IPv6
+    BOOT_STAGE_IPV6,                        //IPv4 got, wait IPv6 a while
+    BOOT_STAGE_AT,                          //wait AT answered OK
+    BOOT_STAGE_DONE,
+    BOOT_STAGE_FAIL
+}Boot_Stage_t;
+
 typedef struct __Me3616_DeviceType
 {
 	AT_Cmd_Info_t       AT_Info;                          		
+	AT_Response_t       Response;
     SYS_State_t        	Sys_State;
 
 	UART_HandleTypeDef  * UartDevice;
@@ -348,9 +510,34 @@ typedef struct __Me3616_DeviceType
     uint16_t            RxStringLen;
     uint8_t             RxVaildString[ME3616_RX_BUFFER_SIZE +1];
  	uint8_t 	    	RxBuffer[ME3616_RX_BUFFER_SIZE +1];
+
+	volatile uint16_t   RxWriteIndex;							//DMA write position, published by IRQ
+	volatile uint32_t   RxReceived;								//bytes received in total, published by IRQ
+	uint32_t            RxProcessed;							//bytes framed in total, by ME3616_Rx_Process()
+	volatile bool       RxProcessing;
+	uint16_t            RxHighWater;							//most bytes waiting to be framed, seen by ME3616_Rx_Process()
+	uint32_t            RxOverruns;								//times DMA lapped the parser
+	bool                RxResync;								//drop the broken line after an overrun
+
+	uint8_t             RxCounted;								//line in framing: AT_Counted_t index + 1, 0 not known yet, 0xFF none
+	uint8_t             RxCountedFields;						//fields of it passed
+	uint16_t            RxCountedField;							//index in RxBuffer of the field in framing
+	uint16_t            RxCountedLeft;							//raw bytes of the line not framed yet
+	bool                RxCountedDrop;							//raw bytes do not fit RxBuffer, the line is dropped
+	bool                RxLineCounted;							//line being handled carries raw bytes
+	AT_Stream_Callback_t RxStream;							//callback of the streamed line in framing, NULL for none
        
 	uint8_t		    	IPv4[ME3616_IPV4_SIZE];
 	uint8_t		    	IPv6[ME3616_IPV6_SIZE];
+
+	Boot_Stage_t        Boot_Stage;
+	uint32_t            Boot_StageStart;						//SysTick time
+	uint32_t            Boot_StageTime[BOOT_STAGE_DONE];		//ticks spent in each stage of last boot
+	AT_State_t          Boot_AT_Result;
+
+	AT_Request_t        AT_Queue[ME3616_AT_QUEUE_SIZE];			//asynchronous AT requests, ring buffer
+	uint8_t             AT_QueueHead;							//index of the request in flight or next to send
+	uint8_t             AT_QueueCount;
     
 }Me3616_DeviceType;
 
@@ -382,24 +569,82 @@ void ME3616_PowerOn(Me3616_DeviceType * Me3616, uint32_t delay_ticks);
 
 void ME3616_Reset(Me3616_DeviceType * Me3616, uint32_t	delay_ticks);
 
+void ME3616_Power_Key(Me3616_DeviceType * Me3616, bool press);
+
+void ME3616_Reset_Key(Me3616_DeviceType * Me3616, bool press);
+
 bool ME3616_Init(Me3616_DeviceType * Me3616, UART_HandleTypeDef * AT_huart, DMA_HandleTypeDef * DmaTx, DMA_HandleTypeDef * DmaRx);
 
 bool ME3616_Send_AT_Command(Me3616_DeviceType * Me3616,  AT_CMD_t at_cmd, AT_Action_t at_action, bool override, char * pch);
 
+bool ME3616_Send_AT_Hex(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, const uint8_t * data, uint16_t len);
+
+bool ME3616_Send_AT_Hex_Param(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, const char * pch, const uint8_t * data, uint16_t len);
+
+bool ME3616_Send_AT_Raw(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, const char * pch, const uint8_t * data, uint16_t len);
+
+bool ME3616_Queue_AT_Command(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Action_t at_action, const char * pch,
+                             uint32_t timeout, AT_Complete_Callback_t callback, void * context);
+
+bool ME3616_Poll(Me3616_DeviceType * Me3616);
+
+bool ME3616_AT_Queue_Idle(Me3616_DeviceType * Me3616);
+
+bool ME3616_Exec_AT_Command(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, char * pch);
+
+bool ME3616_Exec_AT_Hex(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, const char * pch, const uint8_t * data, uint16_t len);
+
+bool ME3616_Exec_AT_Raw(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, const char * pch, const uint8_t * data, uint16_t len);
+
+bool ME3616_Batch_Start(Me3616_DeviceType * Me3616, AT_Batch_t * batch, const AT_Step_t * steps, uint8_t count,
+                        AT_Batch_Callback_t callback, void * context);
+
+bool ME3616_Run_Batch(Me3616_DeviceType * Me3616, const AT_Step_t * steps, uint8_t count);
+
+bool ME3616_Rx_Process(Me3616_DeviceType * Me3616);
+
+void ME3616_Delay(Me3616_DeviceType * Me3616, uint32_t delay_ticks);
+
 void AT_ResultReport(Me3616_DeviceType * Me3616, bool result);
 
 void Active_Report(Me3616_DeviceType * Me3616, char *pch, uint16_t len);
 
+bool ME3616_Register_URC(const char * name, AT_Report_Callback_t callback);
+
+bool ME3616_Unregister_URC(const char * name);
+
+bool ME3616_Set_URC_Interleave(const char * name, bool interleave);
+
+const char * ME3616_Report_Fields(const char * pch, uint16_t len);
+
+bool ME3616_Parse_Int(const char ** p, const char * end, int32_t * value);
+
+bool ME3616_Register_Counted(const char * name, uint8_t field);
+
+bool ME3616_Unregister_Counted(const char * name);
+
+bool ME3616_Register_Stream(const char * name, uint8_t field, AT_Stream_Callback_t callback);
+
 bool Wait_AT_SendReady(Me3616_DeviceType * Me3616);
 
 bool Wait_AT_Response(Me3616_DeviceType * Me3616);
 
 void RxHandler(Me3616_DeviceType * Me3616, char *p_Buff, uint16_t len);
 
+void RxLineHandler(Me3616_DeviceType * Me3616, AT_Line_t * line);
+
 void ME3616_String_Receive(Me3616_DeviceType * Me3616);
 
 bool Check_Response(Me3616_DeviceType * Me3616, char *pch, uint16_t len);
 
+const AT_Response_t * ME3616_Get_Response(Me3616_DeviceType * Me3616);
+
+bool AT_Response_Get_Int(const AT_Response_t * response, uint8_t index, int32_t * value);
+
+const char * AT_Response_Get_String(const AT_Response_t * response, uint8_t index);
+
+uint16_t AT_Response_Get_Hex(const AT_Response_t * response, uint8_t index, const uint8_t ** data);
+
 void Hex2Str(char *sDest, const char *sSrc, int nSrcLen);
 
 bool HexStrToByte(unsigned char* dest, const char* source, int sourceLen);
@@ -426,6 +671,12 @@ void EMQPUB_Callback( Me3616_DeviceType * Me3616, char * pch, uint16_t len);
 
 void ECOAPNMI_Callback( Me3616_DeviceType * Me3616, char * pch, uint16_t len);
 
+void EHTTPNMIH_Callback( Me3616_DeviceType * Me3616, char * pch, uint16_t len);
+
+void EHTTPNMIC_Callback( Me3616_DeviceType * Me3616, char * pch, uint16_t len);
+
+void EHTTPERR_Callback( Me3616_DeviceType * Me3616, char * pch, uint16_t len);
+
 void M2MCLI_Callback( Me3616_DeviceType * Me3616, char * pch, uint16_t len);
 
 void M2MCLIRECV_Callback( Me3616_DeviceType * Me3616, char * pch, uint16_t len);
@@ -454,10 +705,22 @@ void ME3616_IF_ErrorHandler(char *file, int line, char * pch);
 
 void Init_UART_CM(UART_HandleTypeDef * huart);
 
+void Init_UART_Idle(UART_HandleTypeDef * huart);
+
 bool UART_AT_Send(Me3616_DeviceType * Me3616);
 
+bool UART_AT_Tx_Ready(Me3616_DeviceType * Me3616);
+
+bool UART_AT_Send_Async(Me3616_DeviceType * Me3616);
+
+bool UART_AT_Send_Data(Me3616_DeviceType * Me3616, const uint8_t * data, uint16_t len);
+
 void UART_AT_Receive(Me3616_DeviceType * Me3616);
 
+uint16_t UART_AT_Rx_WriteIndex(Me3616_DeviceType * Me3616);
+
+void UART_AT_Rx_Event(Me3616_DeviceType * Me3616);
+
 void DBG_Forward(Me3616_DeviceType * Me3616);
 
 
@@ -477,10 +740,16 @@ typedef enum {
 }DBG_DIR_t;		
 	
 void DBG_Print(const char * ch, DBG_DIR_t direction);
+void DBG_Printf(DBG_DIR_t direction, const char * fmt, ...);
+void DBG_Vprintf(DBG_DIR_t direction, const char * fmt, va_list args);
+bool DBG_Log_Drain(void);
 void State_Hex2Str(char *sDest, uint32_t uSrc);
 
 #else
 #define DBG_Print(...)    UNUSED(0)
+#define DBG_Printf(...)   UNUSED(0)
+#define DBG_Vprintf(...)  UNUSED(0)
+#define DBG_Log_Drain()   false
 #endif
 
 
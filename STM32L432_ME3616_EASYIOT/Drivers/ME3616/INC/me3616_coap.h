@@ -0,0 +1,225 @@
+/**
+  ******************************************************************************
+  * @file    me3616_coap.h
+  * @author  Simon Luk (simonluk@unidevelop.net)
+  * @brief   CoAP client of ME3616, over AT+ECOAPNEW / AT+ECOAPSEND, PDUs built here,
+  *          confirmable requests tracked and block-wise transfer
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2018 Simon Luk </center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of Simon Luk nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+
+#ifndef __ME3616_COAP_H__
+#define __ME3616_COAP_H__
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "me3616.h"
+
+//Requests outstanding at a time, power of 2. Token and Message ID tell the slot.
+#define ME3616_COAP_CON_MAX             4
+
+//Bytes of a PDU, AT+ECOAPSEND=<id>,<len>,<hex> of it fits TxBuffer. A longer payload goes by Block1.
+#define ME3616_COAP_PDU_SIZE            ((ME3616_TX_BUFFER_SIZE - 1 - (sizeof("AT+ECOAPSEND=00,000,\r\n") - 1)) / 2)
+
+//Block2 size asked of the server, 16 << SZX bytes. +ECOAPNMI of one block must fit RxBuffer.
+#define ME3616_COAP_BLOCK2_SZX          2
+
+//Slot index, then a count of requests
+#define ME3616_COAP_TOKEN_LEN           3
+
+//RFC 7252 ACK_TIMEOUT in ticks, and MAX_RETRANSMIT
+#define ME3616_COAP_ACK_TIMEOUT         2000
+#define ME3616_COAP_MAX_RETRANSMIT      4
+
+//Wait of a separate response after the empty ACK, in ticks
+#define ME3616_COAP_RESPONSE_TIMEOUT    30000
+
+typedef enum {
+    ME_COAP_CON = 0,
+    ME_COAP_NON,
+    ME_COAP_ACK,
+    ME_COAP_RST
+}ME_COAP_Type_t;
+
+//Code, class.detail
+#define ME_COAP_CODE(c, dd)             ((uint8_t)(((c) << 5) | (dd)))
+#define ME_COAP_EMPTY                   ME_COAP_CODE(0, 0)
+#define ME_COAP_GET                     ME_COAP_CODE(0, 1)
+#define ME_COAP_POST                    ME_COAP_CODE(0, 2)
+#define ME_COAP_PUT                     ME_COAP_CODE(0, 3)
+#define ME_COAP_DELETE                  ME_COAP_CODE(0, 4)
+#define ME_COAP_CREATED                 ME_COAP_CODE(2, 1)
+#define ME_COAP_CHANGED                 ME_COAP_CODE(2, 4)
+#define ME_COAP_CONTENT                 ME_COAP_CODE(2, 5)
+#define ME_COAP_CONTINUE                ME_COAP_CODE(2, 31)
+
+//Option numbers
+#define ME_COAP_OPTION_URI_HOST         3
+#define ME_COAP_OPTION_ETAG             4
+#define ME_COAP_OPTION_OBSERVE          6
+#define ME_COAP_OPTION_URI_PORT         7
+#define ME_COAP_OPTION_URI_PATH         11
+#define ME_COAP_OPTION_CONTENT_FORMAT   12
+#define ME_COAP_OPTION_MAX_AGE          14
+#define ME_COAP_OPTION_URI_QUERY        15
+#define ME_COAP_OPTION_ACCEPT           17
+#define ME_COAP_OPTION_BLOCK2           23
+#define ME_COAP_OPTION_BLOCK1           27
+#define ME_COAP_OPTION_SIZE2            28
+#define ME_COAP_OPTION_SIZE1            60
+
+//PDU being built, options MUST go in order of their numbers
+typedef struct {
+    uint8_t               * Buf;
+    uint16_t                Size;
+    uint16_t                Len;
+    uint16_t                Option;             //number of the last option
+    bool                    Overflow;           //did not fit Size or out of order, PDU is no good
+}ME_COAP_PDU_t;
+
+//Parsed PDU, pointers into the bytes parsed
+typedef struct {
+    uint8_t                 Type;               //ME_COAP_Type_t
+    uint8_t                 Code;
+    uint16_t                MessageId;
+    uint8_t                 TokenLen;
+    const uint8_t         * Token;
+    const uint8_t         * Options;            //up to the payload marker
+    uint16_t                OptionsLen;
+    const uint8_t         * Payload;            //NULL for none
+    uint16_t                PayloadLen;
+}ME_COAP_Message_t;
+
+//Response of a request, pointers into RxBuffer valid until the handler returns.
+//Block2 responses come one block at a time, offset of its payload, more until the last.
+//NULL response: no answer after every retransmission, reset by the server, or client closed.
+typedef void (* ME_COAP_Handler_t)(void * context, const ME_COAP_Message_t * response, uint32_t offset, bool more);
+
+//Strings and Payload MUST stay valid until the handler got the last response.
+typedef struct {
+    uint8_t                 Method;             //ME_COAP_GET to ME_COAP_DELETE
+    const char            * Path;               //"a/b", NULL for none
+    const char            * Query;              //"k=v&n=1", NULL for none
+    int32_t                 Format;             //Content-Format of Payload, -1 for none
+    const uint8_t         * Payload;            //Block1 blocks if it does not fit one PDU
+    uint16_t                Len;
+    ME_COAP_Handler_t       Handler;            //NULL for none
+    void                  * Context;
+}ME_COAP_Request_t;
+
+typedef enum {
+    ME_COAP_FREE = 0,
+    ME_COAP_SEND,                               //PDU built, goes out by ME_COAP_Poll()
+    ME_COAP_NEXT,                               //next block, built and sent by ME_COAP_Poll()
+    ME_COAP_WAIT_ACK,                           //sent, retransmitted until ACK or response
+    ME_COAP_WAIT_RESPONSE                       //empty ACK came, separate response to come
+}ME_COAP_State_t;
+
+typedef struct {
+    ME_COAP_State_t         State;
+    ME_COAP_Request_t       Request;
+    uint8_t                 Token[ME3616_COAP_TOKEN_LEN];
+    uint16_t                MessageId;          //of the PDU in flight
+    uint8_t                 Retries;
+    uint32_t                SentTime;
+    uint32_t                Timeout;            //ticks from SentTime to the next retransmission
+    uint16_t                Sent;               //Payload bytes the server has taken
+    uint16_t                BlockLen;           //Payload bytes of the PDU in flight
+    uint8_t                 Szx1;               //Block1 size, 0xFF for none
+    uint8_t                 Szx2;               //Block2 size
+    uint32_t                Num2;               //Block2 number asked
+    uint16_t                PduLen;
+    uint8_t                 Pdu[ME3616_COAP_PDU_SIZE];
+}ME_COAP_Exchange_t;
+
+//Empty ACK or RST of a CON message of the server
+typedef struct {
+    uint8_t                 Type;
+    uint16_t                MessageId;
+}ME_COAP_Control_t;
+
+typedef struct {
+    Me3616_DeviceType     * Me3616;
+    int32_t                 Id;                 //coap id of ME3616 by +ECOAPNEW, -1 for closed
+    uint16_t                MessageId;          //next Message ID, low bits are the slot
+    uint16_t                Count;              //requests made, in the token
+    bool                    Acked;              //AckedId is of the last CON response
+    uint16_t                AckedId;
+
+    uint32_t                Requests;
+    uint32_t                Retransmits;
+    uint32_t                Timeouts;           //requests of no answer
+    uint32_t                Resets;             //requests reset by the server
+    uint32_t                Blocks;             //Block1 and Block2 blocks besides the last
+    uint32_t                Duplicates;         //ACK or response of one already taken
+    uint32_t                Unmatched;          //PDU of no request
+
+    ME_COAP_Exchange_t      Exchange[ME3616_COAP_CON_MAX];
+    ME_COAP_Control_t       Control[ME3616_COAP_CON_MAX];
+    uint8_t                 ControlCount;
+}ME_COAP_t;
+
+
+void ME_COAP_PDU_Begin(ME_COAP_PDU_t * pdu, uint8_t * buf, uint16_t size, uint8_t type, uint8_t code,
+                       uint16_t message_id, const uint8_t * token, uint8_t token_len);
+
+bool ME_COAP_PDU_Option(ME_COAP_PDU_t * pdu, uint16_t number, const void * value, uint16_t len);
+
+bool ME_COAP_PDU_Option_Uint(ME_COAP_PDU_t * pdu, uint16_t number, uint32_t value);
+
+bool ME_COAP_PDU_Payload(ME_COAP_PDU_t * pdu, const void * data, uint16_t len);
+
+bool ME_COAP_Parse(ME_COAP_Message_t * message, const uint8_t * data, uint16_t len);
+
+bool ME_COAP_Get_Option(const ME_COAP_Message_t * message, uint16_t number, const uint8_t ** value, uint16_t * len);
+
+bool ME_COAP_Get_Option_Uint(const ME_COAP_Message_t * message, uint16_t number, uint32_t * value);
+
+bool me_coap_open(Me3616_DeviceType * Me3616, const char * server, uint16_t port);
+
+bool me_coap_close(void);
+
+int me_coap_request(const ME_COAP_Request_t * request);
+
+const ME_COAP_t * ME_COAP_Get(void);
+
+bool ME_COAP_Poll(Me3616_DeviceType * Me3616);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __ME3616_COAP_H__ */
@@ -0,0 +1,146 @@
+/**
+  ******************************************************************************
+  * @file    me3616_http.h
+  * @author  Simon Luk (simonluk@unidevelop.net)
+  * @brief   HTTP client of ME3616, over AT+EHTTPCREATE / AT+EHTTPSEND, request
+  *          bodies sent piece by piece and responses streamed to a sink
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2018 Simon Luk </center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of Simon Luk nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __ME3616_HTTP_H__
+#define __ME3616_HTTP_H__
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "me3616.h"
+
+//Data string of AT+EHTTPSEND before the body: id, method, path, header lines and content type
+#define ME3616_HTTP_HEAD_SIZE           160
+
+//Bytes of the data string in one AT+EHTTPSEND. The command is echoed, it must fit RxBuffer
+//with room for "OK" after it while the framer catches up.
+#define ME3616_HTTP_PIECE_SIZE          128
+
+//Ticks of no response bytes before a sent request fails
+#define ME3616_HTTP_TIMEOUT             30000
+
+typedef enum {
+    ME_HTTP_GET = 0,
+    ME_HTTP_POST,
+    ME_HTTP_PUT,
+    ME_HTTP_DELETE
+}ME_HTTP_Method_t;
+
+typedef enum {
+    ME_HTTP_HEADER = 0,                     //bytes of the response header lines
+    ME_HTTP_CONTENT,                        //bytes of the content
+    ME_HTTP_DONE,                           //last content came, offset is its length
+    ME_HTTP_FAILED                          //+EHTTPERR, timeout, broken stream or closed client
+}ME_HTTP_Event_t;
+
+//Response of a request, in fragments as ME3616 reports it, nothing of it is kept. data is
+//NULL for DONE / FAILED, else valid until the sink returns, offset is where it goes in the
+//header or the content. Status of ME_HTTP_Get() is the response code from the first
+//ME_HTTP_HEADER on. Called where Active Reports are handled, MUST NOT send AT commands.
+typedef void (* ME_HTTP_Sink_t)(void * context, ME_HTTP_Event_t event, const uint8_t * data, uint16_t len,
+                                uint32_t offset);
+
+//Body of a request, asked in order from thread context: up to size bytes from offset into
+//buf. Returns bytes written, 0 only past the end of the body.
+typedef uint16_t (* ME_HTTP_Source_t)(void * context, uint32_t offset, uint8_t * buf, uint16_t size);
+
+//Strings MUST stay valid until the request is over, string literals are best. All of them and
+//the body go in one quoted AT+EHTTPSEND string, no CR, LF or '"' in any of them.
+typedef struct {
+    ME_HTTP_Method_t        Method;
+    const char            * Path;               //such as "/config"
+    const char            * Header;             //"<name>: <value>" line, NULL for none
+    const char            * ContentType;        //NULL for none
+    const void            * Body;               //whole body, NULL to ask Source for it
+    uint32_t                BodyLen;            //text, no '\0', CR, LF or '"' in it
+    ME_HTTP_Source_t        Source;
+    ME_HTTP_Sink_t          Sink;               //may be NULL
+    void                  * Context;            //passed back untouched
+}ME_HTTP_Request_t;
+
+typedef enum {
+    ME_HTTP_IDLE = 0,
+    ME_HTTP_SEND,                           //pieces of AT+EHTTPSEND to go
+    ME_HTTP_WAIT                            //every piece sent, response to come
+}ME_HTTP_State_t;
+
+typedef struct {
+    Me3616_DeviceType     * Me3616;
+    int32_t                 Id;                 //httpclient id of ME3616 by +EHTTPCREATE, -1 for none
+    ME_HTTP_State_t         State;
+    ME_HTTP_Request_t       Request;
+    uint16_t                HeadLen;            //bytes of Head
+    uint16_t                Total;              //bytes of the data string, Head and body
+    uint16_t                Sent;               //bytes of the data string sent
+    uint32_t                LastTime;           //tick of the last piece sent or bytes received
+    int32_t                 Status;             //response code of +EHTTPNMIH, -1 before it
+    int32_t                 Error;              //<err> of the last +EHTTPERR
+    uint8_t                 Stream;             //ME_HTTP_HEADER / ME_HTTP_CONTENT of the line in framing, 0xFF none
+    bool                    Last;               //the +EHTTPNMIC in framing is the last one
+    uint32_t                HeaderOffset;       //header bytes received
+    uint32_t                ContentOffset;      //content bytes received
+    uint32_t                ContentLength;      //<content_len> of +EHTTPNMIC, 0 for not known
+
+    uint32_t                Requests;
+    uint32_t                Responses;          //requests ended by the last content
+    uint32_t                Failures;
+    uint32_t                Pieces;             //AT+EHTTPSEND commands
+    uint32_t                Fragments;          //pieces of header and content given to sinks
+
+    char                    Head[ME3616_HTTP_HEAD_SIZE];
+}ME_HTTP_t;
+
+
+bool me_http_open(Me3616_DeviceType * Me3616, const char * host);
+
+bool me_http_close(void);
+
+bool me_http_request(const ME_HTTP_Request_t * request);
+
+const ME_HTTP_t * ME_HTTP_Get(void);
+
+bool ME_HTTP_Poll(Me3616_DeviceType * Me3616);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __ME3616_HTTP_H__ */
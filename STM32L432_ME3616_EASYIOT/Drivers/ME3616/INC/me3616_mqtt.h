@@ -0,0 +1,151 @@
+/**
+  ******************************************************************************
+  * @file    me3616_mqtt.h
+  * @author  Simon Luk (simonluk@unidevelop.net)
+  * @brief   MQTT client of ME3616, over AT+EMQNEW / AT+EMQCON / AT+EMQPUB, with
+  *          topic subscriptions, reconnect and a publish queue
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2018 Simon Luk </center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of Simon Luk nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __ME3616_MQTT_H__
+#define __ME3616_MQTT_H__
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "me3616.h"
+
+//Topic filters subscribed at a time
+#define ME3616_MQTT_SUB_MAX             8
+
+//Messages kept while disconnected, one per topic, the oldest goes when full
+#define ME3616_MQTT_QUEUE_SIZE          4
+
+//Topic and payload of a message, bytes. AT+EMQPUB of both at their longest fills TxBuffer.
+#define ME3616_MQTT_TOPIC_SIZE          32
+#define ME3616_MQTT_PAYLOAD_SIZE        70
+
+//Reconnect wait after a lost connection, doubled by every failed try, in ticks
+#define ME3616_MQTT_BACKOFF_MIN         1000
+#define ME3616_MQTT_BACKOFF_MAX         64000
+
+//AT+EMQNEW <command_timeout_ms> and <bufsize>
+#define ME3616_MQTT_COMMAND_TIMEOUT     12000
+#define ME3616_MQTT_BUFFER_SIZE         512
+
+typedef enum {
+    ME_MQTT_CLOSED = 0,
+    ME_MQTT_CONNECTED,                      //AT+EMQCON answered OK
+    ME_MQTT_LOST                            //+EMQDISCON or a failed command, reconnect after Wait
+}ME_MQTT_State_t;
+
+//Message of a subscribed topic. topic is not '\0' ended, payload is decoded in place in
+//RxBuffer, both valid until the handler returns.
+typedef void (* ME_MQTT_Handler_t)(void * context, const char * topic, uint16_t topic_len,
+                                   const uint8_t * payload, uint16_t len);
+
+//Strings MUST stay valid while the client is open, string literals are best.
+typedef struct {
+    const char            * Server;
+    uint16_t                Port;
+    const char            * ClientId;
+    const char            * User;               //NULL for none
+    const char            * Password;
+    uint16_t                KeepAlive;          //seconds
+    bool                    CleanSession;
+}ME_MQTT_Config_t;
+
+typedef struct {
+    const char            * Filter;             //NULL for a free slot
+    uint8_t                 Len;
+    uint8_t                 QoS;
+    bool                    Subscribed;         //AT+EMQSUB answered OK since the last connect
+    ME_MQTT_Handler_t       Handler;
+    void                  * Context;
+}ME_MQTT_Sub_t;
+
+typedef struct {
+    uint8_t                 QoS;
+    bool                    Retain;
+    uint16_t                Len;
+    char                    Topic[ME3616_MQTT_TOPIC_SIZE];
+    uint8_t                 Payload[ME3616_MQTT_PAYLOAD_SIZE];
+}ME_MQTT_Message_t;
+
+typedef struct {
+    Me3616_DeviceType     * Me3616;
+    ME_MQTT_Config_t        Config;
+    ME_MQTT_State_t         State;
+    int32_t                 Id;                 //mqtt id of ME3616 by +EMQNEW, -1 for none
+    int32_t                 Error;              //error code of the last +EMQDISCON
+    uint32_t                LostTime;           //tick the connection was lost or the last try failed
+    uint32_t                Wait;               //ticks from LostTime to the next try
+    uint32_t                Backoff;            //Wait after the next failed try
+
+    uint32_t                Connects;           //successful connects, reconnects included
+    uint32_t                Received;           //+EMQPUB messages
+    uint32_t                Unmatched;          //+EMQPUB messages no subscription took
+    uint32_t                Published;
+    uint32_t                Coalesced;          //queued messages replaced by a newer one of the topic
+    uint32_t                Dropped;            //queued messages lost to a full queue
+
+    ME_MQTT_Sub_t           Sub[ME3616_MQTT_SUB_MAX];
+    ME_MQTT_Message_t       Queue[ME3616_MQTT_QUEUE_SIZE];
+    uint8_t                 QueueHead;
+    uint8_t                 QueueCount;
+}ME_MQTT_t;
+
+
+bool me_mqtt_open(Me3616_DeviceType * Me3616, const ME_MQTT_Config_t * config);
+
+bool me_mqtt_close(void);
+
+bool me_mqtt_subscribe(const char * filter, uint8_t qos, ME_MQTT_Handler_t handler, void * context);
+
+bool me_mqtt_unsubscribe(const char * filter);
+
+bool me_mqtt_publish(const char * topic, const void * data, uint16_t len, uint8_t qos, bool retain);
+
+bool ME_MQTT_Topic_Match(const char * filter, uint16_t filter_len, const char * topic, uint16_t topic_len);
+
+const ME_MQTT_t * ME_MQTT_Get(void);
+
+bool ME_MQTT_Poll(Me3616_DeviceType * Me3616);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __ME3616_MQTT_H__ */
@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file    me3616_pool.h
+  * @author  Simon Luk (simonluk@unidevelop.net)
+  * @brief   Fixed block memory pools, O(1) and safe from IRQ, for the EasyIoT
+  *          SDK messages in place of malloc
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2018 Simon Luk </center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of Simon Luk nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __ME3616_POOL_H__
+#define __ME3616_POOL_H__
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//Blocks are aligned for any scalar, double and 64 bit integers included
+#define POOL_ALIGN                      8
+#define POOL_BLOCK_SIZE(size)           ((((size) + POOL_ALIGN - 1) / POOL_ALIGN) * POOL_ALIGN)
+
+//A pool of count blocks of size bytes, in static storage. Ready to use, no Pool_Init() needed.
+#define POOL_DEFINE(name, size, count)                                                          \
+    static uint64_t name##_Storage[POOL_BLOCK_SIZE(size) * (count) / sizeof(uint64_t)];         \
+    static Pool_t name = { (uint8_t *)name##_Storage, POOL_BLOCK_SIZE(size), (count), 0, 0, 0, 0, 0 }
+
+//Free blocks are linked through their first word. Blocks never handed out are not
+//linked at all, they are taken in order after Fresh, so a zeroed pool is a full pool.
+typedef struct {
+    uint8_t               * Storage;
+    uint16_t                BlockSize;          //multiple of POOL_ALIGN
+    uint16_t                BlockCount;
+    volatile uint32_t       Free;               //index + 1 of the first freed block, 0 for none
+    volatile uint32_t       Fresh;              //blocks ever handed out, the rest are untouched
+    volatile uint32_t       Used;               //blocks out now
+    volatile uint32_t       HighWater;          //most blocks ever out at once
+    volatile uint32_t       Failed;             //Pool_Alloc() found no block
+}Pool_t;
+
+bool Pool_Init(Pool_t * pool, void * storage, uint16_t block_size, uint16_t block_count);
+
+void * Pool_Alloc(Pool_t * pool);
+
+bool Pool_Free(Pool_t * pool, void * block);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __ME3616_POOL_H__ */
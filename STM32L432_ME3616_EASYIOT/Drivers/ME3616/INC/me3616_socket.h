@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file    me3616_socket.h
+  * @author  Simon Luk (simonluk@unidevelop.net)
+  * @brief   TCP / UDP sockets of ME3616, over AT+ESOC / AT+ESOCON / AT+ESOSENDRAW,
+  *          with a receive ring for each socket
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2018 Simon Luk </center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of Simon Luk nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+#ifndef __ME3616_SOCKET_H__
+#define __ME3616_SOCKET_H__
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "me3616.h"
+
+//Socket data as raw bytes, AT+ESOSENDRAW out and binary +ESONMI / +ESOREAD in, by
+//AT+ESOSETRPT. Define ME3616_SOCKET_HEX for AT+ESOSEND and hex reports.
+#ifndef ME3616_SOCKET_HEX
+#define ME3616_SOCKET_RAW
+#endif
+
+//Sockets open at a time
+#define ME3616_SOCKET_MAX               4
+
+//Payload bytes of one AT+ESOSENDRAW, a UDP datagram must fit one
+#define ME3616_SOCKET_SEND_MAX          1024
+
+//Receive ring of each socket, bytes, power of 2
+#define ME3616_SOCKET_RX_SIZE           512
+
+//Bytes asked by one AT+ESOREAD, they are kept in AT_Response_t
+#define ME3616_SOCKET_READ_CHUNK        ME3616_RESPONSE_DATA_SIZE
+
+//Room left in a ring that makes ME3616 hold received data, AT+ESOREADEN=1. It must
+//take a whole +ESONMI already on the way, which is bounded by ME3616_RX_BUFFER_SIZE.
+#define ME3616_SOCKET_RX_LOW_ROOM       (ME3616_RX_BUFFER_SIZE / 2)
+
+//Error of a TCP socket whose ring could not take a segment, the stream has a gap.
+//Not an +ESOERR code, those are not negative.
+#define ME_SOCKET_ERR_RX_OVERFLOW       (-1)
+
+typedef enum {
+    ME_SOCK_STREAM = 1,                     //TCP
+    ME_SOCK_DGRAM = 2                       //UDP
+}ME_Socket_Type_t;
+
+typedef enum {
+    ME_SOCKET_CLOSED = 0,
+    ME_SOCKET_CREATED,                      //+ESOC got a socket id
+    ME_SOCKET_CONNECTED,                    //AT+ESOCON answered OK
+    ME_SOCKET_ERROR                         //+ESOERR reported or TCP data lost, only me_close() is left
+}ME_Socket_State_t;
+
+typedef struct {
+    Me3616_DeviceType     * Me3616;
+    ME_Socket_State_t       State;
+    ME_Socket_Type_t        Type;
+    int32_t                 Id;                 //socket id of ME3616
+    int32_t                 Error;              //error code of +ESOERR, or ME_SOCKET_ERR_RX_OVERFLOW
+
+    uint32_t                RxHead;             //bytes ever written into Rx, by +ESONMI / +ESOREAD
+    uint32_t                RxTail;             //bytes ever taken by me_recv()
+    uint32_t                Pending;            //bytes ME3616 holds for AT+ESOREAD, by +ESODATA
+    uint32_t                RxDropped;          //bytes of +ESONMI lost, ring full or line broken
+    uint32_t                TxBytes;
+    uint8_t                 Rx[ME3616_SOCKET_RX_SIZE];
+}ME_Socket_t;
+
+
+int me_socket(Me3616_DeviceType * Me3616, ME_Socket_Type_t type);
+
+int me_connect(int fd, const char * address, uint16_t port);
+
+int me_send(int fd, const void * data, uint16_t len);
+
+int me_recv(int fd, void * buf, uint16_t size);
+
+int me_close(int fd);
+
+uint16_t me_available(int fd);
+
+const ME_Socket_t * ME_Socket_Get(int fd);
+
+bool ME_Socket_Poll(Me3616_DeviceType * Me3616);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __ME3616_SOCKET_H__ */
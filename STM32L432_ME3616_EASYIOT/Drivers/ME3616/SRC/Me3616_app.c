@@ -38,13 +38,17 @@
 #include <stdlib.h>
 
 #include "me3616.h"
+#include "me3616_socket.h"
+#include "me3616_mqtt.h"
+#include "me3616_coap.h"
+#include "me3616_http.h"
 #include "easyiot.h"
 #include "TestDevice.h"
+#include "TestDevice_codec.h"
 
 #define EASYIOT_MSG_BUFF_MAX_SIZE			200
-#define EASYIOT_RECEIVE_MAX_SIZE			250
 #define EASYIOT_CMD_BUFF_ACK_MAX_SIZE		200
-#define EASYIOT_CONVERT_AT_BUFF_MAX_SIZE	200
+#define ME3616_APP_LWM_WAIT_TIMEOUT			60000	//ȴƽ̨/ظʱ(ms)
 
 
 char * client_imei = "86966203070xxxx";
@@ -57,9 +61,7 @@ uint16_t last_dtag_mid = 0;	//
 
 
 uint8_t msg_buff[EASYIOT_MSG_BUFF_MAX_SIZE] = {0};				//Ϣbuff
-uint8_t receive_buff[EASYIOT_RECEIVE_MAX_SIZE] = {0x5a};		//buff
 uint8_t cmd_ack_buff[EASYIOT_CMD_BUFF_ACK_MAX_SIZE] = {0};		//ack buff ack
-uint8_t convert_buff[EASYIOT_CONVERT_AT_BUFF_MAX_SIZE] = {0};
 
 
 void ME3616_APP_ErrorHandler(char *file, int line, char * pch)
@@ -72,68 +74,38 @@ void ME3616_APP_ErrorHandler(char *file, int line, char * pch)
 	while(1);
 }
 
-void Command_Response(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
-{
-	DBG_Print(pch, DBG_DIR_RX);
-
-	char tmp_string[5] = {0};
-	
-	//´ʾλһATָĻظ
-	//ME3616ĬϴԣһλյصжATͷԸַ
-	//ڴʹʱ
-	if((Get_Last_AT_CMD(Me3616) == AT_CMD_MODULE_CIMI) &&
-		(strstr(pch, "AT") == NULL))
-	{
-		HAL_GPIO_WritePin (LD3_GPIO_Port, LD3_Pin, GPIO_PIN_SET);
-		DBG_Print("( APP-Demo ) I light up a LED for you  :)", DBG_DIR_APP);
-        
-        //remember, set last cmd none to prevent execute more than once.
-		Set_Last_AT_CMD_None(Me3616);
-	}
-
-    //źǿ
-	if((Get_Last_AT_CMD(Me3616) == AT_CMD_NETWORK_CESQ) &&
-			(strstr(pch, "AT") == NULL))
-	{
-		memset(tmp_string, 0, 5);
-		strncpy(tmp_string, pch + 7, 2);
-		if(tmp_string[1] == ',') tmp_string[1] = '\0';
-		Signal_val = atoi (tmp_string);
-		Signal_val += -110;
-		
-		//remember, set last cmd none to prevent execute more than once.
-		Set_Last_AT_CMD_None(Me3616);
-	}
-			
-	//ģͨADCõص
-	if((Get_Last_AT_CMD(Me3616) == AT_CMD_HARDWARE_ZADC) &&
-			(strstr(pch, "AT") == NULL))
-	{
-		memset(tmp_string, 0, 5);
-		strcpy(tmp_string, pch + 6);
-		
-		Battery_val = atoi (tmp_string);
- 		Battery_val = Battery_val * 100 / 255;  //תΪٷֱ
-		
-		//remember, set last cmd none to prevent execute more than once.
-		Set_Last_AT_CMD_None(Me3616);
-	}
-		
-}
-
-
 //ƽ̨صݴeasy iot sdk
 void M2MCLIRECV_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 {
+	uint16_t pos = sizeof("+M2MCLIRECV:") - 1;
+
 	DBG_Print("M2MCLIRECV Below:",  DBG_DIR_AT);
 	DBG_Print(pch,  DBG_DIR_RX);
 
-    //յַeasy iot SDK
-	CoapHexInputStatic(pch + 12, receive_buff, EASYIOT_RECEIVE_MAX_SIZE - 1);
+	//ðźĿո
+	while((pos < len) && (pch[pos] == ' ')) pos++;
+	if(pos >= len) return;
+
+    //յHEXַڽbuffԭתΪƺ󽻸easy iot SDK⿽
+	CoapHexInputInPlace(pch + pos, len - pos);
 }
 
 
 
+//ѯģϢĲ
+static const AT_Step_t Information_Steps[] =
+{
+	{ AT_CMD_MODULE_I,              AT_BASE,    NULL,                   false },    // ATI               ѯģϢ
+	{ AT_CMD_NETWORK_MBAND,         AT_READ,    NULL,                   false },    // AT*MBAND?         ѯǰ BAND ֵ
+	{ AT_CMD_SIM_MICCID,            AT_BASE,    NULL,                   false },    // AT*MICCID         ȡ SIM  ICCID
+	{ AT_CMD_MODULE_CGSN,           AT_SET,     "2",                    false },    // AT+CGSN=2         ѯƷIMEISV
+	{ AT_CMD_NETWORK_CEREG,         AT_READ,    NULL,                   true  },    // ;+CEREG?          ѯע״̬
+	{ AT_CMD_HARDWARE_ZADC,         AT_READ,    NULL,                   true  },    // ;+ZADC?           ѯADCѹֵ
+	{ AT_CMD_PDN_MCGDEFCONT,        AT_READ,    NULL,                   false },    // AT*MCGDEFCONT?    ѯĬϵ PSD 
+	{ AT_CMD_NETWORK_MENGINFO,      AT_SET,     "0",                    false },    // AT*MENGINFO=0     ѯǰ״̬СϢ
+	{ AT_CMD_DNS_EDNS,              AT_SET,     "\"www.baidu.com\"",    false },    // AT+EDNS=          ȡٶwww.baidu.comIPַ
+};
+
 //ѯģϢ
 void me3616_test_information(Me3616_DeviceType * Me3616)
 {
@@ -141,57 +113,24 @@ void me3616_test_information(Me3616_DeviceType * Me3616)
     Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_NONE);
 	//ATӦ	
 	ME3616_Send_AT_Command(Me3616, AT_CMD_NONE, AT_BASE, true, NULL);
-	HAL_Delay(1000);
-
-    // ѯģϢ
-    // ATI
-    if (ME3616_Send_AT_Command(Me3616, AT_CMD_MODULE_I, AT_BASE, false, NULL) == false) 
-        ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
+	ME3616_Delay(Me3616, 1000);
 
-    // ѯǰ BAND ֵ
-    // AT*MBAND?
-    if (ME3616_Send_AT_Command(Me3616, AT_CMD_NETWORK_MBAND, AT_READ, false, NULL) == false) 
-        ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
-    
-    // ȡ SIM  ICCID
-    // AT*MICCID
-	if (ME3616_Send_AT_Command(Me3616, AT_CMD_SIM_MICCID, AT_BASE, false, NULL) == false) 
-		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
+    // ѯģϢͣȴCombineΪtrueĲһϲΪһз͡
+    // ʧܷܲͣء
+	if (ME3616_Run_Batch(Me3616, Information_Steps, sizeof(Information_Steps) / sizeof(Information_Steps[0])) == false)
+		DBG_Print("APP Information query has failed steps.", DBG_DIR_APP);
 
 	// ѯƶ̨豸ʶ
 	// AT+CIMI
 	if (ME3616_Send_AT_Command(Me3616, AT_CMD_MODULE_CIMI, AT_BASE, false, NULL) == false) 
 		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
-		
-	// ѯƷIMEISV
-	// AT+CGSN=2
-	if (ME3616_Send_AT_Command(Me3616, AT_CMD_MODULE_CGSN, AT_SET, false, "2") == false) 
-		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
-	
-    // ѯע״̬
-    // AT+CEREG?
-	if (ME3616_Send_AT_Command(Me3616, AT_CMD_NETWORK_CEREG, AT_READ, false, NULL) == false) 
-		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
-	
-    // ѯADCѹֵ
-    // AT+ZADC?
-	if (ME3616_Send_AT_Command(Me3616, AT_CMD_HARDWARE_ZADC, AT_READ, false, NULL) == false) 
-		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
 
-    // ѯĬϵ PSD 
-    // AT*MCGDEFCONT?
-	if (ME3616_Send_AT_Command(Me3616, AT_CMD_PDN_MCGDEFCONT, AT_READ, false, NULL) == false) 
-		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
-	
-    // ѯǰ״̬СϢ
-    // AT*MENGINFO=0
-	if (ME3616_Send_AT_Command(Me3616, AT_CMD_NETWORK_MENGINFO, AT_SET, false, "0") == false) 
-		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
-
-    // ȡٶwww.baidu.comIPַ
-    // AT+EDNS="www.baidu.com"
-	if (ME3616_Send_AT_Command(Me3616, AT_CMD_DNS_EDNS, AT_SET, false, "\"www.baidu.com\"") == false) 
-		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
+	//´ʾλһATָĻظظѰAT_Response_Spec
+	if (AT_Response_Get_String(ME3616_Get_Response(Me3616), 0) != NULL)
+	{
+		HAL_GPIO_WritePin (LD3_GPIO_Port, LD3_Pin, GPIO_PIN_SET);
+		DBG_Print("( APP-Demo ) I light up a LED for you  :)", DBG_DIR_APP);
+	}
 
 	//       ---ע⣬ʱϳ׵ATʱĬϿ---
 	// AT+IPERF=-c 219.144.130.27 -u -p 7000 -I 5 -t 10
@@ -201,6 +140,20 @@ void me3616_test_information(Me3616_DeviceType * Me3616)
 }
 
 
+//ȴURCλϵͳ״̬ȴڼգʱfalse
+static bool me3616_wait_sys_state(Me3616_DeviceType * Me3616, SYS_State_t mask, uint32_t timeout)
+{
+	uint32_t start_time = HAL_GetTick();
+
+	while(Get_Sys_State(Me3616, mask) == false)
+	{
+		if((HAL_GetTick() - start_time) > timeout) return false;
+		ME3616_Delay(Me3616, 100);
+	}
+	return true;
+}
+
+
 //LWM2MӡʹʾIMEIţƽ̨ע˺
 void me3616_test_lwm(Me3616_DeviceType * Me3616)
 {
@@ -225,7 +178,7 @@ void me3616_test_lwm(Me3616_DeviceType * Me3616)
     Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_NONE);
 	//ATӦ	
 	ME3616_Send_AT_Command(Me3616, AT_CMD_NONE, AT_BASE, true, NULL);
-	HAL_Delay(1000);
+	ME3616_Delay(Me3616, 1000);
 
 
 	// עIOTƽ̨
@@ -234,7 +187,8 @@ void me3616_test_lwm(Me3616_DeviceType * Me3616)
 		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
 
 	//ȴעɹ
-	while(Get_Sys_State (Me3616, SYS_STATE_LWM_OBSERVE_SUCCESS) == false);
+	if (me3616_wait_sys_state(Me3616, SYS_STATE_LWM_OBSERVE_SUCCESS, ME3616_APP_LWM_WAIT_TIMEOUT) == false)
+		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP LWM2M observe timeout, Halt.");
 	
 	// ݷ
 	// AT+M2MCLISEND=AA123456,1
@@ -242,7 +196,8 @@ void me3616_test_lwm(Me3616_DeviceType * Me3616)
 		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP Command fault, Halt.");
 
 	//ȴظɹ
-	while(Get_Sys_State (Me3616, SYS_STATE_LWM_NOTIFY_SUCCESS) == false);
+	if (me3616_wait_sys_state(Me3616, SYS_STATE_LWM_NOTIFY_SUCCESS, ME3616_APP_LWM_WAIT_TIMEOUT) == false)
+		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP LWM2M notify timeout, Halt.");
 
 	// עIOTƽ̨
 	// AT+M2MCLIDEL
@@ -288,7 +243,7 @@ int32_t getSignal(void)
 
 //Ϣģ鷢ƽ̨ack
 //ĿǰӡlogĿǰӰƽ̨״̬ɸҪѡʵ
-void ack_handler(struct Messages* req)
+void ack_handler(const struct MessageReader* req)
 {
 	DBG_Print ("msg_ack received.", DBG_DIR_APP);
 }
@@ -296,19 +251,8 @@ void ack_handler(struct Messages* req)
 //easy iot SDKɵݣģ
 void SendtoModule(const uint8_t* data, uint16_t inLength)
 {
-	//תΪַ
-	Hex2Str((char *)convert_buff, (char *)data, inLength);
-	convert_buff[inLength * 2 ] = '\0';
-    
-    //ݲż
-    if((inLength / 2) == 1)
-    {
-        inLength++;
-		convert_buff[inLength * 2 ] = '0';
-        convert_buff[inLength * 2 +1] = '\0';
-    }
-    
-	if (ME3616_Send_AT_Command(&ME3616_Instance, AT_CMD_LWM_M2MCLISEND, AT_SET, false, (char *)convert_buff) == false) 
+	//HEXֱַдATָķbuff
+	if (ME3616_Send_AT_Hex(&ME3616_Instance, AT_CMD_LWM_M2MCLISEND, data, inLength) == false) 
 		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "easy-iot LWM2M send failed.");
 }
 
@@ -318,21 +262,27 @@ void SendtoDBG(const unsigned char * data, uint16_t inLength)
 	DBG_Print((char *)data, DBG_DIR_SDK);	
 }
 
+//easy iot SDK־SDKڸʽDBG_Vprintf()
+void SendtoDBG_Format(enum LoggingLevel level, const char * fmt, va_list args)
+{
+	UNUSED(level);
+	DBG_Vprintf(DBG_DIR_SDK, fmt, args);
+}
+
 
 //ƽ̨ģcallback
-void cmd_handler_callback(struct Messages* req)
+//TLVֱӴӽbuffжȡصغʧЧ
+void cmd_handler_callback(const struct MessageReader* req)
 {
-	int8_t ret = 0;
-	int8_t cmd_value = 0;
-	ret = GetInt8(req, LED_GREEN_TLV_PARAMID, &cmd_value);
-	if( ret < 0) 
+	struct cmd_1_request cmd;
+	if(cmd_1_decode(req, &cmd) < 0) 
 	{
-		Logging (LOG_WARNING, "get cmd %d value fail", req->msgid);
+		LOG_W("get cmd %d value fail", req->msgid);
 		return;
 	}
 	else
 	{
-        if(cmd_value == 0)
+        if(cmd.led_green == 0)
         {
             HAL_GPIO_WritePin (LD3_GPIO_Port, LD3_Pin, GPIO_PIN_RESET);
         }
@@ -350,6 +300,7 @@ void cmd_handler_callback(struct Messages* req)
 void me3616_test_easyiot(Me3616_DeviceType * Me3616)
 {
     char command_string[50] = {0};
+    int32_t value = 0;
     
     //ʱ䣨PSMʱ䣩	
     //ʱԽ٣ռԽ̣ԽշԽߣעѡ
@@ -363,7 +314,7 @@ void me3616_test_easyiot(Me3616_DeviceType * Me3616)
 	//ATӦ	
      Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_NONE);
 	ME3616_Send_AT_Command(Me3616, AT_CMD_NONE, AT_BASE, true, NULL);
-	HAL_Delay(1000);
+	ME3616_Delay(Me3616, 1000);
     
     
 
@@ -371,15 +322,18 @@ void me3616_test_easyiot(Me3616_DeviceType * Me3616)
 	// ѯźǿ
 	// AT+CESQ
 	ME3616_Send_AT_Command(Me3616, AT_CMD_NETWORK_CESQ, AT_BASE, false, NULL);
+	if(AT_Response_Get_Int(ME3616_Get_Response(Me3616), 0, &value) == true) Signal_val = value - 110;
 	if(Signal_val > -48 ) DBG_Print ("No Signal or Out of range.", DBG_DIR_AT);
 	
 	// ѯADCѹֵ
     // AT+ZADC?
     ME3616_Send_AT_Command(Me3616, AT_CMD_HARDWARE_ZADC, AT_READ, false, NULL);
+    //ģͨADCõص
+    if(AT_Response_Get_Int(ME3616_Get_Response(Me3616), 0, &value) == true) Battery_val = value * 100 / 255;  //תΪٷֱ
 
     
     
-	HAL_Delay(3000);
+	ME3616_Delay(Me3616, 3000);
 
     
     
@@ -388,7 +342,7 @@ void me3616_test_easyiot(Me3616_DeviceType * Me3616)
         
 	for(uint8_t i = 0; i < 10; i++)
 	{
-        HAL_Delay(5000);
+        ME3616_Delay(Me3616, 5000);
 		if(Get_Sys_State(Me3616, SYS_STATE_LWM_REGISTER_SUCCESS) == true &&
 		   Get_Sys_State(Me3616, SYS_STATE_LWM_OBSERVE_SUCCESS) == true)
 			break;
@@ -398,7 +352,7 @@ void me3616_test_easyiot(Me3616_DeviceType * Me3616)
 	
     
 
-	HAL_Delay(3000);
+	ME3616_Delay(Me3616, 3000);
 
 
     
@@ -411,36 +365,26 @@ void me3616_test_easyiot(Me3616_DeviceType * Me3616)
 	setBatteryCb(getBattery);
 	
 	setLogSerialOutputCb(SendtoDBG);
+	setLogFormatOutputCb(SendtoDBG_Format);
 	setNbSerialOutputCb(SendtoModule);
 
 	//ôcallback
-	setCmdHandler(CMD_1_CMDID, cmd_handler_callback);
+	setCmdReader(CMD_1_CMDID, cmd_handler_callback);
 	//ôϢackcallback
-	setAckHandler(ack_handler);
+	setAckReader(ack_handler);
     
     
     
     /*  һϢeasy iotƽ̨  */
-	struct Messages * msg = NewMessageStatic(msg_buff, EASYIOT_MSG_BUFF_MAX_SIZE);
-	setMessages(msg, CMT_USER_UP, MSG_1_MSGID);
-
-    //Ϣ
-	msg->dtag_mid = last_dtag_mid++;
-    
-    //ѴݼϢ
-	AddInt8(msg, SENSOR_1_TLV_PARAMID, 60);
-	AddInt32 (msg, SENSOR_2_TLV_PARAMID, 888);
-	AddInt8 (msg, LED_GREEN_TLV_PARAMID, 0);
+    //ֱӹmsg_buffУϢţݰ TestDevice_codec.h Ĺ̶ƫд
+	int length = msg_1_encode(msg_buff, EASYIOT_MSG_BUFF_MAX_SIZE, last_dtag_mid++, 60, 888, 0);
     
     //Ϣ
-	pushMessages(msg);
-
-    //ͷ
-	FreeMessage(msg);
+	if(length > 0) CoapOutput(msg_buff, length);
 
         
     DBG_Print("MSG send performed, Check Data on IoT Platform.", DBG_DIR_APP);
-	HAL_Delay(3000);
+	ME3616_Delay(Me3616, 3000);
 	DBG_Print("Waiting CMD from IoT Platform.", DBG_DIR_APP);
     
     
@@ -449,32 +393,191 @@ void me3616_test_easyiot(Me3616_DeviceType * Me3616)
 	{
 		if(Get_Sys_State(Me3616, SYS_STATE_LWM_NEED_CMD_ACK) == true)
 		{
-			//response cmd ack
-			struct Messages * msg = NewMessageStatic(cmd_ack_buff, EASYIOT_CMD_BUFF_ACK_MAX_SIZE);
-			setMessages(msg, CMT_USER_CMD_RSP, CMD_1_CMDID);
-			msg->dtag_mid = last_dtag_mid;
-			AddInt8(msg, 0, 0);		//ִнظ
-			if(HAL_GPIO_ReadPin(LD3_GPIO_Port, LD3_Pin) == GPIO_PIN_SET)
-			{
-				AddInt8(msg, LED_GREEN_TLV_PARAMID, 1);
-			}
-			else
-			{
-				AddInt8(msg, LED_GREEN_TLV_PARAMID, 0);
-			}
-			pushMessages(msg);
-			FreeMessage(msg);
+			//response cmd ackִнָʾ״̬
+			int8_t led = (HAL_GPIO_ReadPin(LD3_GPIO_Port, LD3_Pin) == GPIO_PIN_SET) ? 1 : 0;
+			length = cmd_1_respond(cmd_ack_buff, EASYIOT_CMD_BUFF_ACK_MAX_SIZE, last_dtag_mid, 0, led);
+			if(length > 0) CoapOutput(cmd_ack_buff, length);
 
 			Clear_Sys_State(Me3616, SYS_STATE_LWM_NEED_CMD_ACK);
 		}
-		HAL_Delay(3000);
+		ME3616_Delay(Me3616, 3000);
+	}
+}
+
+
+//UDP socketңݲLWM2Mֱӷ͵UDP
+void me3616_test_socket(Me3616_DeviceType * Me3616)
+{
+	//UDPַ,˿ڣ밴޸
+	char * server_IP = "117.60.157.137";
+	uint16_t server_Port = 5684;
+	uint8_t rx_buff[64];
+	int length = 0;
+	int fd = 0;
+
+	//ңⱨLWM2MϱͬͷҪIMEIIMSI
+	EasyIotInit(client_imei, client_imsi);
+
+	// UDP socket÷ַ
+	// AT+ESOC=1,2,1
+	// AT+ESOCON=<socket>,5684,"117.60.157.137"
+	fd = me_socket(Me3616, ME_SOCK_DGRAM);
+	if((fd < 0) || (me_connect(fd, server_IP, server_Port) < 0))
+		ME3616_APP_ErrorHandler(__FILE__, __LINE__, "APP socket fault, Halt.");
+
+	while(1)
+	{
+		// AT+ESOSENDRAW=<socket>,<len>ԭʼ
+		length = msg_1_encode(msg_buff, EASYIOT_MSG_BUFF_MAX_SIZE, last_dtag_mid++, 60, 888, 0);
+		if((length > 0) && (me_send(fd, msg_buff, length) < 0))
+			DBG_Print("APP socket send failed.", DBG_DIR_APP);
+
+		//+ESONMIֱӴsocketĽջbuffbuffʱAT+ESOREADȡ
+		length = me_recv(fd, rx_buff, sizeof(rx_buff));
+		if(length > 0) DBG_Printf(DBG_DIR_APP, "APP socket received %d bytes.", length);
+
+		ME3616_Delay(Me3616, 3000);
+	}
+}
+
+
+static void me3616_mqtt_command(void * context, const char * topic, uint16_t topic_len, const uint8_t * payload, uint16_t len)
+{
+	UNUSED(context);
+	UNUSED(topic);
+	DBG_Printf(DBG_DIR_APP, "APP MQTT command, topic %u chars, %u bytes.", (unsigned)topic_len, (unsigned)len);
+}
+
+void me3616_test_mqtt(Me3616_DeviceType * Me3616)
+{
+	//MQTT밴޸
+	static const ME_MQTT_Config_t mqtt_config = {"117.60.157.137", 1883, "me3616-demo", NULL, NULL, 120, true};
+	int length = 0;
+
+	EasyIotInit(client_imei, client_imsi);
+
+	// ǰǼǣÿ()Ӻ󶼻ᷢ AT+EMQSUB
+	me_mqtt_subscribe("me3616/+/cmd", 1, me3616_mqtt_command, NULL);
+
+	// AT+EMQNEW="117.60.157.137","1883",12000,512
+	// AT+EMQCON=0,4,"me3616-demo",120,1,0
+	// ״ʧʱME_MQTT_Poll() ˱ʱ
+	if(me_mqtt_open(Me3616, &mqtt_config) == false)
+		DBG_Print("APP MQTT not connected yet.", DBG_DIR_APP);
+
+	while(1)
+	{
+		// AT+EMQPUB=0,"me3616/up",0,0,0,<len>,<hex>Ͽڼͬһֻһ
+		length = msg_1_encode(msg_buff, EASYIOT_MSG_BUFF_MAX_SIZE, last_dtag_mid++, 60, 888, 0);
+		if((length > 0) && (me_mqtt_publish("me3616/up", msg_buff, length, 0, false) == false))
+			DBG_Print("APP MQTT publish failed.", DBG_DIR_APP);
+
+		for(uint8_t i = 0; i < 30; i++)
+		{
+			ME_MQTT_Poll(Me3616);
+			ME3616_Delay(Me3616, 100);
+		}
+	}
+}
+
+
+static void me3616_coap_response(void * context, const ME_COAP_Message_t * response, uint32_t offset, bool more)
+{
+	UNUSED(context);
+	UNUSED(more);
+	if(response == NULL)
+	{
+		DBG_Print("APP CoAP no response.", DBG_DIR_APP);
+		return;
+	}
+	DBG_Printf(DBG_DIR_APP, "APP CoAP response %u.%02u, %u bytes at %lu.", (unsigned)(response->Code >> 5),
+	           (unsigned)(response->Code & 0x1F), (unsigned)response->PayloadLen, (unsigned long)offset);
+}
+
+void me3616_test_coap(Me3616_DeviceType * Me3616)
+{
+	ME_COAP_Request_t request = {ME_COAP_POST, "me3616/up", NULL, 42, msg_buff, 0, me3616_coap_response, NULL};
+	int length = 0;
+
+	EasyIotInit(client_imei, client_imsi);
+
+	//CoAP밴޸
+	// AT+ECOAPNEW="117.60.157.137",5683,1
+	if(me_coap_open(Me3616, "117.60.157.137", 5683) == false)
+	{
+		DBG_Print("APP CoAP client failed.", DBG_DIR_APP);
+		return;
+	}
+
+	while(1)
+	{
+		// CON  AT+ECOAPSEND=0,<len>,<hex> һPDUĸذ Block1 ֿ鷢
+		// һδǰ msg_buff ɸд
+		if(ME_COAP_Poll(Me3616) == false)
+		{
+			length = msg_1_encode(msg_buff, EASYIOT_MSG_BUFF_MAX_SIZE, last_dtag_mid++, 60, 888, 0);
+			request.Len = (length > 0) ? length : 0;
+			if(me_coap_request(&request) < 0) DBG_Print("APP CoAP request failed.", DBG_DIR_APP);
+		}
+
+		for(uint8_t i = 0; i < 30; i++)
+		{
+			ME_COAP_Poll(Me3616);
+			ME3616_Delay(Me3616, 100);
+		}
+	}
+}
+
+static void me3616_http_sink(void * context, ME_HTTP_Event_t event, const uint8_t * data, uint16_t len, uint32_t offset)
+{
+	UNUSED(context);
+	UNUSED(data);
+	if(event == ME_HTTP_DONE)
+	{
+		DBG_Printf(DBG_DIR_APP, "APP HTTP %ld, %lu bytes of content.", (long)ME_HTTP_Get()->Status, (unsigned long)offset);
+	}
+	else if(event == ME_HTTP_FAILED)
+	{
+		DBG_Print("APP HTTP request failed.", DBG_DIR_APP);
+	}
+	else if(event == ME_HTTP_CONTENT)
+	{
+		DBG_Printf(DBG_DIR_APP, "APP HTTP content, %u bytes at %lu.", (unsigned)len, (unsigned long)offset);
+	}
+}
+
+void me3616_test_http(Me3616_DeviceType * Me3616)
+{
+	ME_HTTP_Request_t request = {ME_HTTP_GET, "/config", NULL, NULL, NULL, 0, NULL, me3616_http_sink, NULL};
+
+	//HTTP밴޸
+	// AT+EHTTPCREATE=0,<len>,<len>,"http://117.60.157.137:8080/,,,0,,0,,0,"
+	if(me_http_open(Me3616, "http://117.60.157.137:8080/") == false)
+	{
+		DBG_Print("APP HTTP client failed.", DBG_DIR_APP);
+		return;
+	}
+
+	while(1)
+	{
+		// Ӧͷ +EHTTPNMIH / +EHTTPNMIC ֶν me3616_http_sink建
+		if(ME_HTTP_Poll(Me3616) == false)
+		{
+			if(me_http_request(&request) == false) DBG_Print("APP HTTP request failed.", DBG_DIR_APP);
+		}
+
+		for(uint8_t i = 0; i < 100; i++)
+		{
+			ME_HTTP_Poll(Me3616);
+			ME3616_Delay(Me3616, 100);
+		}
 	}
 }
 
 
 void ME3616_APP(Me3616_DeviceType * Me3616)
 {
-	HAL_Delay(1000);
+	ME3616_Delay(Me3616, 1000);
 
     /*ѯģϢ*/
 //	me3616_test_information(Me3616);
@@ -485,6 +588,18 @@ void ME3616_APP(Me3616_DeviceType * Me3616)
     /*Ϣ-ָշ*/
 	me3616_test_easyiot(Me3616);
 
+    /*UDP socketշ*/
+//	me3616_test_socket(Me3616);
+
+    /*MQTTϱ*/
+//	me3616_test_mqtt(Me3616);
+
+    /*CoAPϱ*/
+//	me3616_test_coap(Me3616);
+
+    /*HTTP*/
+//	me3616_test_http(Me3616);
+
 }
 
 
@@ -64,6 +64,9 @@
 
    	   (++) add Receive Function(me3616_if.c) to Interrupt Entry at UART IRQ Handler
 
+   	   (++) with ME3616_RX_IDLE_MODE, add UART_AT_Rx_Event() at UART IRQ Handler on
+   	   		IDLE flag instead, strings are parsed by ME3616_Rx_Process() in main loop.
+
 
    (#) Add me3616 to your project. such as -> main.c
 
@@ -73,6 +76,9 @@
 
 	   (++) program your NB-IoT functions at me3616_app.c
 
+	   (++) for non-blocking usage, queue commands by ME3616_Queue_AT_Command()
+	   		and call ME3616_Poll() from main loop, results come back by callback.
+
 	   (++) Have Fun!
 
 ===============================================================================
@@ -269,116 +275,475 @@ const char * AT_CMD_String[]=
     ""
 };
 
-//Prefix string of Active Report. 
-const char * AT_Report_String[] =
-{    
-	
-    "*MATREADY",
-    "+CFUN",
-    "+CPIN",
-    "+IP",
-    "+ESONMI",
-    "+ESODATA",
-    "+EMQDISCON",
-    "+EMQPUB",
-    "+ECOAPNMI",
-    "+M2MCLIRECV",
-    "+M2MCLI",
-    "+iperf",
-    "+ZGPSR",
-    "+MIPLEVENT",
-    "+MIPLREAD",
-    "+MIPLWRITE",
-    "+MIPLOBSERVE",
-    "+MIPLDISCOVER",
-    "+MIPLPARAMETER",
-    NULL
+//Response line of commands, parsed into AT_Response_t. Add a line here for a new command.
+#define AT_RESPONSE(cmd, prefix, count, ...)    { cmd, prefix, sizeof(prefix) - 1, count, { __VA_ARGS__ } }
+#define AT_OPT(type)                            ((type) | AT_FIELD_OPTIONAL)
+
+static const AT_Response_Spec_t AT_Response_Spec[] =
+{
+	AT_RESPONSE(AT_CMD_MODULE_GSN,      "",         1, AT_FIELD_STRING),
+	AT_RESPONSE(AT_CMD_MODULE_CIMI,     "",         1, AT_FIELD_STRING),
+	AT_RESPONSE(AT_CMD_COMMON_CFUN,     "+CFUN",    1, AT_FIELD_INT),
+	AT_RESPONSE(AT_CMD_SIM_CPIN,        "+CPIN",    1, AT_FIELD_STRING),
+	AT_RESPONSE(AT_CMD_SIM_CRSM,        "+CRSM",    3, AT_FIELD_INT, AT_FIELD_INT, AT_OPT(AT_FIELD_HEX)),
+	AT_RESPONSE(AT_CMD_SIM_MICCID,      "*MICCID",  1, AT_FIELD_STRING),
+	AT_RESPONSE(AT_CMD_NETWORK_CEREG,   "+CEREG",   5, AT_FIELD_INT, AT_FIELD_INT, AT_OPT(AT_FIELD_HEX), AT_OPT(AT_FIELD_HEX), AT_OPT(AT_FIELD_INT)),
+	AT_RESPONSE(AT_CMD_NETWORK_CESQ,    "+CESQ",    6, AT_FIELD_INT, AT_FIELD_INT, AT_FIELD_INT, AT_FIELD_INT, AT_FIELD_INT, AT_FIELD_INT),
+	AT_RESPONSE(AT_CMD_NETWORK_CSQ,     "+CSQ",     2, AT_FIELD_INT, AT_FIELD_INT),
+	AT_RESPONSE(AT_CMD_NETWORK_CCLK,    "+CCLK",    1, AT_FIELD_STRING),
+	AT_RESPONSE(AT_CMD_HARDWARE_ZADC,   "+ZADC",    1, AT_FIELD_INT),
+	AT_RESPONSE(AT_CMD_TCPIP_ESOC,      "+ESOC",    1, AT_FIELD_INT),
+	AT_RESPONSE(AT_CMD_TCPIP_ESOREAD,   "+ESOREAD", 4, AT_FIELD_INT, AT_FIELD_INT, AT_OPT(AT_FIELD_COUNTED), AT_OPT(AT_FIELD_INT)),
+	AT_RESPONSE(AT_CMD_MQTT_EMQNEW,     "+EMQNEW",  1, AT_FIELD_INT),
+	AT_RESPONSE(AT_CMD_COAP_ECOAPNEW,   "+ECOAPNEW", 1, AT_FIELD_INT),
+	AT_RESPONSE(AT_CMD_HTTP_EHTTPCREATE, "+EHTTPCREATE", 1, AT_FIELD_INT),
 };
 
-typedef void (* _AT_Report_Entry)(struct __Me3616_DeviceType * Me3616, char * pch, uint16_t len);
-
-_AT_Report_Entry AT_Report_Entry[20] = 
-{
-	MATREADY_Callback,
-	CFUN_Callback,
-	CPIN_Callback,
-	IP_Callback,
-	ESONMI_Callback,
-	ESODATA_Callback,
-	EMQDISCON_Callback,
-	EMQPUB_Callback,
-	ECOAPNMI_Callback,
-	M2MCLIRECV_Callback,
-	M2MCLI_Callback,
-	IPERF_Callback,
-	ZGPSR_Callback,
-	MIPLEVENT_Callback,
-	MIPLREAD_Callback,
-	MIPLWRITE_Callback,
-	MIPLOBSERVE_Callback,
-	MIPLDISCOVER_Callback,
-	MIPLPARAMETER_Callback,
-	NULL
+//Active Report handlers registered by default. Name is the part before ':' or '='.
+#define AT_REPORT(name, callback)       { name, sizeof(name) - 1, callback, false }
+
+static const AT_Report_Handler_t AT_Report_Default[] =
+{
+	AT_REPORT("*MATREADY",      MATREADY_Callback),
+	AT_REPORT("+CFUN",          CFUN_Callback),
+	AT_REPORT("+CPIN",          CPIN_Callback),
+	AT_REPORT("+IP",            IP_Callback),
+	AT_REPORT("+ESONMI",        ESONMI_Callback),
+	AT_REPORT("+ESODATA",       ESODATA_Callback),
+	AT_REPORT("+EMQDISCON",     EMQDISCON_Callback),
+	AT_REPORT("+EMQPUB",        EMQPUB_Callback),
+	AT_REPORT("+ECOAPNMI",      ECOAPNMI_Callback),
+	AT_REPORT("+EHTTPNMIH",     EHTTPNMIH_Callback),
+	AT_REPORT("+EHTTPNMIC",     EHTTPNMIC_Callback),
+	AT_REPORT("+EHTTPERR",      EHTTPERR_Callback),
+	AT_REPORT("+M2MCLIRECV",    M2MCLIRECV_Callback),
+	AT_REPORT("+M2MCLI",        M2MCLI_Callback),
+	AT_REPORT("+iperf",         IPERF_Callback),
+	AT_REPORT("+ZGPSR",         ZGPSR_Callback),
+	AT_REPORT("+MIPLEVENT",     MIPLEVENT_Callback),
+	AT_REPORT("+MIPLREAD",      MIPLREAD_Callback),
+	AT_REPORT("+MIPLWRITE",     MIPLWRITE_Callback),
+	AT_REPORT("+MIPLOBSERVE",   MIPLOBSERVE_Callback),
+	AT_REPORT("+MIPLDISCOVER",  MIPLDISCOVER_Callback),
+	AT_REPORT("+MIPLPARAMETER", MIPLPARAMETER_Callback),
 };
 
+//Open addressing hash table of Active Report handlers, by FNV-1a of the name, filled from
+//AT_Report_Default[] on first use. It is in RAM as client modules replace default handlers
+//and set Interleave at runtime, and C cannot hash a name in a constant initializer.
+//Empty slot: Name == NULL. Unregistered slot: Name != NULL, Callback == NULL.
+static AT_Report_Handler_t AT_Report_Table[ME3616_URC_TABLE_SIZE];
+static bool AT_Report_Table_Ready = false;
+
+//Lines carrying raw bytes, few, scanned in order. Empty slot: Name == NULL.
+static AT_Counted_t AT_Counted_Table[ME3616_COUNTED_TABLE_SIZE];
+
+#define AT_REPORT_HASH_INIT             2166136261U
+#define AT_REPORT_HASH_STEP(h, c)       (((h) ^ (uint8_t)(c)) * 16777619U)
+
 
 #ifdef DEBUG_ME3616
 
-extern DMA_HandleTypeDef hdma_usart2_tx;
+//A record in DBG_Log.Buffer, Length bytes of text or binary follow the header.
+//It takes Length plus header rounded up to DBG_LOG_ALIGN, so a header always fits before the end.
+typedef struct {
+    volatile uint8_t        State;                  //DBG_LOG_EMPTY until the producer has written all
+    uint8_t                 Direction;              //DBG_DIR_t, DBG_LOG_FORMAT set for DBG_Printf() records
+    uint16_t                Length;
+    uint32_t                Tick;
+}DBG_Log_Record_t;
+
+#define DBG_LOG_EMPTY                   0           //reserved, not written yet
+#define DBG_LOG_READY                   1
+#define DBG_LOG_PAD                     2           //skip to buffer begin
+#define DBG_LOG_ALIGN                   sizeof(DBG_Log_Record_t)
+#define DBG_LOG_SIZE_OF(len)            ((sizeof(DBG_Log_Record_t) + (len) + DBG_LOG_ALIGN - 1) & ~(DBG_LOG_ALIGN - 1))
+//Longest text kept, room for the prefix of DBG_Log_Format() in DBG_TxBuffer
+#define DBG_LOG_TEXT_MAX                (ME3616_DBG_TX_BUFFER_SIZE - 32)
+//Direction flag of a record holding format ID and raw arguments, see DBG_Log_Encode()
+#define DBG_LOG_FORMAT                  0x80
+
+#if (ME3616_DBG_LOG_SIZE & (ME3616_DBG_LOG_SIZE - 1)) != 0
+#error "ME3616_DBG_LOG_SIZE must be power of 2."
+#endif
+
+#if defined(ME3616_DBG_BINARY) && (DBG_LOG_TEXT_MAX > 0xFF)
+#error "ME3616_DBG_BINARY frames have 1 byte length, ME3616_DBG_TX_BUFFER_SIZE too large."
+#endif
+
+//Multi producer (thread and IRQ), single consumer. Head and Tail run free, masked on access.
+//Producers reserve by LDREX / STREX on Head, consumer zeroes a record before giving it back by Tail.
+static struct {
+    uint32_t                Buffer[ME3616_DBG_LOG_SIZE / sizeof(uint32_t)];
+    volatile uint32_t       Head;                   //next byte to reserve
+    volatile uint32_t       Tail;                   //next byte to drain
+    volatile uint32_t       Dropped;                //records not fit since last reported
+    volatile uint32_t       Draining;               //DBG_Log_Drain() lock
+}DBG_Log;
+
+//Format strings go out as their offset from here, Tools/dbg_decode looks them up in the ELF file.
+const char DBG_Log_FmtBase[] = "ME3616 DBG";
+
+static DBG_Log_Record_t * DBG_Log_At(uint32_t index)
+{
+	return (DBG_Log_Record_t *)((uint8_t *)DBG_Log.Buffer + (index & (ME3616_DBG_LOG_SIZE - 1)));
+}
+
+/**
+  * @brief  Reserve size bytes of DBG_Log, contiguous.
+  * @param  size: record size, multiple of DBG_LOG_ALIGN.
+  * @param  index: returns the first byte reserved.
+  * @retval bytes of padding before the record, to skip the buffer end. 0xFFFF if full.
+  */
+static uint16_t DBG_Log_Reserve(uint16_t size, uint32_t * index)
+{
+	uint32_t head = 0;
+	uint32_t offset = 0;
+	uint16_t pad = 0;
+
+	do
+	{
+		head = __LDREXW(&DBG_Log.Head);
+		offset = head & (ME3616_DBG_LOG_SIZE - 1);
+		pad = (offset + size > ME3616_DBG_LOG_SIZE) ? (uint16_t)(ME3616_DBG_LOG_SIZE - offset) : 0;
+
+		if(head + pad + size - DBG_Log.Tail > ME3616_DBG_LOG_SIZE)
+		{
+			__CLREX();
+			return 0xFFFF;
+		}
+	}while(__STREXW(head + pad + size, &DBG_Log.Head) != 0);
+
+	*index = head;
+	return pad;
+}
+
+/**
+  * @brief  Copy a record into DBG_Log and kick DBG_Log_Drain(), or count it dropped.
+  */
+static void DBG_Log_Put(uint8_t direction, const void * data, uint16_t len)
+{
+	DBG_Log_Record_t * record = NULL;
+	uint32_t index = 0;
+	uint16_t pad = 0;
+
+	pad = DBG_Log_Reserve(DBG_LOG_SIZE_OF(len), &index);
+	if(pad == 0xFFFF)
+	{
+		uint32_t dropped = 0;
+		do
+		{
+			dropped = __LDREXW(&DBG_Log.Dropped);
+		}while(__STREXW(dropped + 1, &DBG_Log.Dropped) != 0);
+		return;
+	}
+
+	if(pad != 0)
+	{
+		record = DBG_Log_At(index);
+		record->Length = pad - sizeof(DBG_Log_Record_t);
+		__DMB();
+		record->State = DBG_LOG_PAD;
+		index += pad;
+	}
+
+	record = DBG_Log_At(index);
+	record->Direction = direction;
+	record->Length = len;
+	record->Tick = HAL_GetTick();
+	memcpy((uint8_t *)record + sizeof(DBG_Log_Record_t), data, len);
+	__DMB();
+	record->State = DBG_LOG_READY;
+
+	DBG_Log_Drain();
+}
+
+#ifdef ME3616_DBG_BINARY
+/**
+  * @brief  Frame a record into DBG_TxBuffer: 0xA5, payload length, direction,
+  *         tick little endian, payload. Nothing is formatted on MCU.
+  * @retval length to send.
+  */
+static uint16_t DBG_Log_Format(uint32_t tick, uint8_t direction, const uint8_t * payload, uint16_t len)
+{
+	uint8_t * buff = ME3616_Instance.DBG_TxBuffer;
+
+	buff[0] = 0xA5;
+	buff[1] = (uint8_t)len;
+	buff[2] = direction;
+	buff[3] = (uint8_t)tick;
+	buff[4] = (uint8_t)(tick >> 8);
+	buff[5] = (uint8_t)(tick >> 16);
+	buff[6] = (uint8_t)(tick >> 24);
+	memcpy(&buff[7], payload, len);
+	return len + 7;
+}
+
+#define DBG_LOG_PUT_ARG(value, n)               \
+	do {                                        \
+		if(len + (n) > size) return len;        \
+		memcpy(&buff[len], &(value), (n));      \
+		len += (n);                             \
+	} while(0)
+
+/**
+  * @brief  Encode format ID and raw arguments of a DBG_Printf() call.
+  * @note   Only the conversions of fmt are walked: integers, chars and pointers
+  *         take 4 bytes, ll / j integers and floating point 8 bytes, strings
+  *         are copied with '\0'. Target is little endian, so is the payload.
+  * @param  buff: payload.
+  * @param  size: size of buff, arguments not fit are cut off.
+  * @retval payload length.
+  */
+static uint16_t DBG_Log_Encode(uint8_t * buff, uint16_t size, const char * fmt, va_list args)
+{
+	int32_t id = (int32_t)((intptr_t)fmt - (intptr_t)DBG_Log_FmtBase);
+	uint16_t len = 0;
+
+	DBG_LOG_PUT_ARG(id, 4);
+	while(*fmt != '\0')
+	{
+		uint8_t longs = 0;
+
+		if(*fmt++ != '%') continue;
+		if(*fmt == '%')
+		{
+			fmt++;
+			continue;
+		}
+
+		while((*fmt != '\0') && (strchr("-+ #0", *fmt) != NULL)) fmt++;
+		//width and precision, '*' takes an int argument
+		for(uint8_t i = 0; i < 2; i++)
+		{
+			if(*fmt == '*')
+			{
+				int32_t value = va_arg(args, int);
+				DBG_LOG_PUT_ARG(value, 4);
+				fmt++;
+			}
+			while(isdigit((unsigned char)*fmt)) fmt++;
+			if((i == 0) && (*fmt == '.')) fmt++;
+			else break;
+		}
+		while((*fmt != '\0') && (strchr("hlLjzt", *fmt) != NULL))
+		{
+			if((*fmt == 'l') || (*fmt == 'j')) longs += (*fmt == 'j') ? 2 : 1;
+			if((*fmt == 'z') || (*fmt == 't')) longs = 1;
+			fmt++;
+		}
+
+		switch(*fmt)
+		{
+			case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+			{
+				if(longs >= 2)
+				{
+					int64_t value = va_arg(args, long long);
+					DBG_LOG_PUT_ARG(value, 8);
+				}
+				else
+				{
+					int32_t value = (longs == 1) ? (int32_t)va_arg(args, long) : (int32_t)va_arg(args, int);
+					DBG_LOG_PUT_ARG(value, 4);
+				}
+				break;
+			}
+			case 'p':
+			{
+				uint32_t value = (uint32_t)(uintptr_t)va_arg(args, void *);
+				DBG_LOG_PUT_ARG(value, 4);
+				break;
+			}
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+			{
+				double value = va_arg(args, double);
+				DBG_LOG_PUT_ARG(value, 8);
+				break;
+			}
+			case 's':
+			{
+				const char * value = va_arg(args, const char *);
+				if(value == NULL) value = "(null)";
+				do
+				{
+					if(len >= size) return len;
+					buff[len++] = (uint8_t)*value;
+				}while(*value++ != '\0');
+				break;
+			}
+			case '\0':
+			{
+				return len;
+			}
+			default:
+			{
+				break;
+			}
+		}
+		fmt++;
+	}
+	return len;
+}
+
+#else
+/**
+  * @brief  Format a record into DBG_TxBuffer, as DBG_Print() always did.
+  * @retval length to send.
+  */
+static uint16_t DBG_Log_Format(uint32_t tick, uint8_t direction, const uint8_t * payload, uint16_t len)
+{
+	static const char * const tag[] = {"[Rx]", "[Tx]", "[MCU_AT]", "[EasyIoT]", "[APP]"};
+	char * buff = (char *)ME3616_Instance.DBG_TxBuffer;
+	int total = 0;
+
+	if(direction > DBG_DIR_APP) direction = DBG_DIR_APP;
+	total = snprintf(buff, ME3616_DBG_TX_BUFFER_SIZE + 1, "%s[%lu]%s: %.*s\r\n",
+	                 (direction == DBG_DIR_TX) ? "\r\n" : "", (unsigned long)tick, tag[direction], (int)len, (const char *)payload);
+
+	//Halt if DBG_Print() has error.
+	if(total <= 0) while(1);
+	if(total > ME3616_DBG_TX_BUFFER_SIZE)
+	{
+		total = ME3616_DBG_TX_BUFFER_SIZE;
+		buff[total - 2] = '\r';
+		buff[total - 1] = '\n';
+	}
+	return (uint16_t)total;
+}
+#endif
+
 /**
   * @brief  Print Debug message and forward Tx, Rx string.
-  * @note   Use ME3616 Instance directly.
+  * @note   Does not wait DBG_UART. The string is copied into a ring with the
+  *         tick and sent later by DBG_Log_Drain(), callable from IRQ too.
+  *         If the ring is full the message is dropped, and counted.
   * @param  ch: Debug string comes from.
   * @param  direction: Indicate string source: Tx, Rx, MCU_AT, APP.
   * @retval None.
   */
 void DBG_Print(const char * ch, DBG_DIR_t direction)
 {
-    int16_t len = 0;
-	uint32_t data = HAL_GetTick();
-	if ( ch == NULL || *ch == NULL) return;
+	uint16_t len = 0;
+
+	if ( ch == NULL || *ch == '\0') return;
+
+	while((len < DBG_LOG_TEXT_MAX) && (ch[len] != '\0')) len++;
+	DBG_Log_Put((uint8_t)direction, ch, len);
+}
+
+/**
+  * @brief  printf() to the debug log.
+  * @note   With ME3616_DBG_BINARY only the format ID and the arguments are
+  *         kept, fmt MUST be a string literal or other constant in flash.
+  * @param  direction: Indicate string source: Tx, Rx, MCU_AT, APP.
+  * @param  fmt: printf() format.
+  * @retval None.
+  */
+void DBG_Printf(DBG_DIR_t direction, const char * fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	DBG_Vprintf(direction, fmt, args);
+	va_end(args);
+}
 
-	//wait until DBG_UART ready.
-	while( __HAL_UART_GET_FLAG(&DBG_UART, UART_FLAG_TC) == 0);
+void DBG_Vprintf(DBG_DIR_t direction, const char * fmt, va_list args)
+{
+	uint8_t buff[DBG_LOG_TEXT_MAX + 1];
+	int len = 0;
+
+	if(fmt == NULL) return;
+
+#ifdef ME3616_DBG_BINARY
+	len = DBG_Log_Encode(buff, DBG_LOG_TEXT_MAX, fmt, args);
+	DBG_Log_Put((uint8_t)direction | DBG_LOG_FORMAT, buff, (uint16_t)len);
+#else
+	len = vsnprintf((char *)buff, sizeof(buff), fmt, args);
+	if(len <= 0) return;
+	if(len > DBG_LOG_TEXT_MAX) len = DBG_LOG_TEXT_MAX;
+	DBG_Log_Put((uint8_t)direction, buff, (uint16_t)len);
+#endif
+}
+
+/**
+  * @brief  Send the next record of DBG_Print() by DBG_UART DMA, if DBG_UART is free.
+  * @note   Called by DBG_Print(), and by HAL_UART_TxCpltCallback() of DBG_UART
+  *         to chain records back to back. Call it from main loop as well, it never waits.
+  *         Only one caller drains at a time, others return at once.
+  * @retval true while records are waiting or in flight.
+  */
+bool DBG_Log_Drain(void)
+{
+	DBG_Log_Record_t * record = NULL;
+	uint32_t dropped = 0;
+	uint16_t len = 0;
+	bool pending = true;
 
-	switch (direction)
+	do
 	{
-		case DBG_DIR_RX:
+		if(__LDREXW(&DBG_Log.Draining) != 0)
 		{
-			len = sprintf((char *)ME3616_Instance.DBG_TxBuffer, "[%d][Rx]: %s\r\n", data, ch );
-			break;
+			__CLREX();
+			return true;
 		}
-		
-		case DBG_DIR_TX:
+	}while(__STREXW(1, &DBG_Log.Draining) != 0);
+	__DMB();
+
+	while(1)
+	{
+		if(DBG_UART.gState != HAL_UART_STATE_READY) break;
+
+		if(DBG_Log.Dropped != 0)
 		{
-			len = sprintf((char *)ME3616_Instance.DBG_TxBuffer, "\r\n[%d][Tx]: %s\r\n", data, ch );
+			char notice[40];
+			do
+			{
+				dropped = __LDREXW(&DBG_Log.Dropped);
+			}while(__STREXW(0, &DBG_Log.Dropped) != 0);
+
+			len = (uint16_t)snprintf(notice, sizeof(notice), "%lu debug messages dropped.", (unsigned long)dropped);
+			len = DBG_Log_Format(HAL_GetTick(), DBG_DIR_AT, (const uint8_t *)notice, len);
+			HAL_UART_Transmit_DMA(&DBG_UART, ME3616_Instance.DBG_TxBuffer, len);
 			break;
 		}
-        
-		case DBG_DIR_AT:
+
+		if(DBG_Log.Tail == DBG_Log.Head)
 		{
-			len = sprintf((char *)ME3616_Instance.DBG_TxBuffer, "[%d][MCU_AT]: %s\r\n", data, ch );
+			pending = false;
 			break;
 		}
-        
-        case DBG_DIR_SDK:
+
+		//Reserved but still being written, by a producer interrupted.
+		record = DBG_Log_At(DBG_Log.Tail);
+		if(record->State == DBG_LOG_EMPTY) break;
+		__DMB();
+
+		len = 0;
+		if(record->State == DBG_LOG_READY)
 		{
-			len = sprintf((char *)ME3616_Instance.DBG_TxBuffer, "[%d][EasyIoT]: %s\r\n", data, ch );
-			break;
+			len = DBG_Log_Format(record->Tick, record->Direction, (uint8_t *)record + sizeof(DBG_Log_Record_t), record->Length);
 		}
-		default:
+
+		//Give the bytes back zeroed, a record reserved there reads DBG_LOG_EMPTY until written.
+		{
+			uint16_t size = DBG_LOG_SIZE_OF(record->Length);
+			memset(record, 0, size);
+			__DMB();
+			DBG_Log.Tail += size;
+		}
+
+		if(len != 0)
 		{
-			len = sprintf((char *)ME3616_Instance.DBG_TxBuffer, "[%d][APP]: %s\r\n", data, ch );
+			HAL_UART_Transmit_DMA(&DBG_UART, ME3616_Instance.DBG_TxBuffer, len);
+			break;
 		}
 	}
-	
-    //Halt if DBG_Print() has error.
-	if(len <= 0) while(1);
-    
-	while(hdma_usart2_tx.State != HAL_DMA_STATE_READY);
-	HAL_UART_Transmit_DMA(&DBG_UART, ME3616_Instance.DBG_TxBuffer, len);
-    while(hdma_usart2_tx.State != HAL_DMA_STATE_READY);
-    while(__HAL_UART_GET_FLAG(&DBG_UART, UART_FLAG_TC) == 0);
+
+	__DMB();
+	DBG_Log.Draining = 0;
+	return pending;
 }
 
 void State_Hex2Str(char *sDest, uint32_t uSrc)
@@ -397,7 +762,8 @@ void State_Hex2Str(char *sDest, uint32_t uSrc)
 	UNUSED(line);
 	DBG_Print(pch,  DBG_DIR_AT);
 	Set_Sys_State(&ME3616_Instance, SYS_STATE_ERR);
-	//Halt and do nothing for this Demo.	
+	//Let the debug log out, then halt and do nothing for this Demo.
+	while(DBG_Log_Drain() == true);
 	while(1);
 }
 
@@ -459,23 +825,63 @@ __INLINE void Set_AT_Info(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Action
 }
 
 /**
-  * @brief  Establist AT command and send to ME3616.
+  * @brief  Clear the last parsed response, and pick the AT_Response_Spec of at_cmd.
+  * @param  Me3616: Instance of Me3616.
+  * @param  at_cmd: AT Command refer by AT_CMD_t
+  * @retval None.
+  */
+static void AT_Response_Reset(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd)
+{
+	AT_Response_t * response = &Me3616->Response;
+
+	response->Spec = NULL;
+	response->Parsed = false;
+	response->FieldCount = 0;
+	response->Present = 0;
+	response->DataLen = 0;
+
+	for(uint16_t i = 0; i < sizeof(AT_Response_Spec) / sizeof(AT_Response_Spec[0]); i++)
+	{
+		if(AT_Response_Spec[i].CMDBase == at_cmd)
+		{
+			response->Spec = &AT_Response_Spec[i];
+			break;
+		}
+	}
+}
+
+static const char * AT_Action_String(AT_Action_t at_action)
+{
+	switch(at_action)
+	{
+		case AT_SET:	return AT_Set;
+		case AT_READ:	return AT_Read;
+		case AT_TEST:	return AT_Test;
+		default:		return "";
+	}
+}
+
+//Length of a step in a command line, without "AT" and CR LF.
+static uint16_t AT_Step_Length(const AT_Step_t * step)
+{
+	uint16_t len = strlen(AT_CMD_String[step->CMDBase]) + strlen(AT_Action_String(step->CMDAction));
+
+	if((step->CMDAction == AT_SET) && (step->Param != NULL)) len += strlen(step->Param);
+	return len;
+}
+
+/**
+  * @brief  Establist AT command string in TxBuffer.
   * @param  Me3616: Instance of Me3616.
   * @param  at_cmd: AT Command refer by AT_CMD_t
   * @param  at_action: Parameter type commands refer by 3GPP
-  * @param  override: if true, This Function will force send AT Command out
-  						with out consider AT state, timout, and command response.
   * @param  pch: while at_action is AT_SET, follow command strings.
-  * @retval true for send success. false for fail.
+  * @retval true for built, false for the line does not fit TxBuffer.
   */
-bool ME3616_Send_AT_Command(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Action_t at_action, bool override, char * pch)
+static bool AT_Command_Build(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Action_t at_action, const char * pch)
 {
-	bool res = 0;
+	char * p = (char *)Me3616->TxBuffer;
     int16_t len = 0;
-	//Check NULL pointer
-	if((at_action == AT_SET) && (pch == NULL)) ME3616_ErrorHandler(__FILE__, __LINE__, "Send_AT_Command() has a NULL CMD Pointer.");
-
-	Set_Sys_State(Me3616, SYS_STATE_BUSY);
 
 	//clear last CMD string
 	memset(Me3616->TxBuffer, 0, Me3616->TxStringLen);
@@ -483,26 +889,22 @@ bool ME3616_Send_AT_Command(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Acti
 	{
 		case AT_BASE:
 		{
-			len = sprintf( (char * )Me3616->TxBuffer, "%s%s%s", AT_Header, AT_CMD_String[at_cmd], AT_End);
-			if(len <= 0) ME3616_ErrorHandler(__FILE__, __LINE__, "AT Command Fault.");		
+			len = snprintf(p, ME3616_TX_BUFFER_SIZE, "%s%s%s", AT_Header, AT_CMD_String[at_cmd], AT_End);
 			break;
 		}
 		case AT_SET:
 		{
-			len = sprintf( (char * )Me3616->TxBuffer, "%s%s%s%s%s", AT_Header, AT_CMD_String[at_cmd], AT_Set, pch, AT_End);
-			if(len <= 0) ME3616_ErrorHandler(__FILE__, __LINE__, "AT Command Fault.");		
+			len = snprintf(p, ME3616_TX_BUFFER_SIZE, "%s%s%s%s%s", AT_Header, AT_CMD_String[at_cmd], AT_Set, pch, AT_End);
 			break;
 		}
 		case AT_READ:
 		{
-			len = sprintf( (char * )Me3616->TxBuffer, "%s%s%s%s", AT_Header, AT_CMD_String[at_cmd], AT_Read, AT_End);
-			if(len <= 0) ME3616_ErrorHandler(__FILE__, __LINE__, "AT Command Fault.");
+			len = snprintf(p, ME3616_TX_BUFFER_SIZE, "%s%s%s%s", AT_Header, AT_CMD_String[at_cmd], AT_Read, AT_End);
 			break;
 		}
 		case AT_TEST:
 		{
-			len = sprintf( (char * )Me3616->TxBuffer, "%s%s%s%s", AT_Header, AT_CMD_String[at_cmd], AT_Test, AT_End);
-			if(len <= 0) ME3616_ErrorHandler(__FILE__, __LINE__, "AT Command Fault.");
+			len = snprintf(p, ME3616_TX_BUFFER_SIZE, "%s%s%s%s", AT_Header, AT_CMD_String[at_cmd], AT_Test, AT_End);
 			break;
 		}
 		default:
@@ -511,14 +913,108 @@ bool ME3616_Send_AT_Command(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Acti
 			ME3616_ErrorHandler(__FILE__, __LINE__, "Unknow AT Action.");
 		}
 	}
+	if(len <= 0) ME3616_ErrorHandler(__FILE__, __LINE__, "AT Command Fault.");
+
+	//Truncated line would go out without its CR LF, send nothing.
+	if(len >= ME3616_TX_BUFFER_SIZE)
+	{
+		Me3616->TxStringLen = 0;
+		DBG_Print("AT command out of TxBuffer.", DBG_DIR_AT);
+		return false;
+	}
 	Me3616->TxStringLen = len;
-	
+
+	AT_Response_Reset(Me3616, at_cmd);
+	return true;
+}
+
+/**
+  * @brief  Append a step to the command line in TxBuffer, "AT<a>;<b>".
+  * @param  Me3616: Instance of Me3616.
+  * @param  step: step to append.
+  * @retval true for appended, false for the line does not fit TxBuffer.
+  */
+static bool AT_Command_Append(Me3616_DeviceType * Me3616, const AT_Step_t * step)
+{
+	//overwrite CR LF of the line
+	uint16_t start = Me3616->TxStringLen - strlen(AT_End);
+	char * p = (char *)Me3616->TxBuffer + start;
+	int16_t len = 0;
+
+	len = snprintf(p, ME3616_TX_BUFFER_SIZE - start, ";%s%s%s%s", AT_CMD_String[step->CMDBase], AT_Action_String(step->CMDAction),
+	               ((step->CMDAction == AT_SET) && (step->Param != NULL)) ? step->Param : "", AT_End);
+	if(len <= 0) ME3616_ErrorHandler(__FILE__, __LINE__, "AT Command Fault.");
+	if(len >= ME3616_TX_BUFFER_SIZE - start)
+	{
+		Me3616->TxStringLen = 0;
+		DBG_Print("AT command out of TxBuffer.", DBG_DIR_AT);
+		return false;
+	}
+
+	Me3616->TxStringLen += len - strlen(AT_End);
+	return true;
+}
+
+/**
+  * @brief  Establist "AT<cmd>=<pch><hex>" in TxBuffer, data is encoded straight into it.
+  * @param  Me3616: Instance of Me3616.
+  * @param  at_cmd: AT Command refer by AT_CMD_t
+  * @param  pch: parameters before the hex, such as "1,5,", NULL for none.
+  * @param  data: bytes to send as upper case hex.
+  * @param  len: bytes of data.
+  * @retval true for built, false for the line does not fit TxBuffer.
+  */
+static bool AT_Command_Build_Hex(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, const char * pch, const uint8_t * data, uint16_t len)
+{
+	char * p = (char *)Me3616->TxBuffer;
+	uint16_t cmd_len = strlen(AT_CMD_String[at_cmd]);
+	uint16_t param_len = (pch != NULL) ? strlen(pch) : 0;
+	uint16_t line_len = strlen(AT_Header) + cmd_len + strlen(AT_Set) + param_len + len * 2 + strlen(AT_End);
+
+	if(line_len > ME3616_TX_BUFFER_SIZE - 1) return false;
+
+	memcpy(p, AT_Header, strlen(AT_Header));
+	p += strlen(AT_Header);
+	memcpy(p, AT_CMD_String[at_cmd], cmd_len);
+	p += cmd_len;
+	memcpy(p, AT_Set, strlen(AT_Set));
+	p += strlen(AT_Set);
+	memcpy(p, pch, param_len);
+	p += param_len;
+
+	p += Hex_Encode(p, len * 2, data, len);
+
+	memcpy(p, AT_End, strlen(AT_End) + 1);
+	Me3616->TxStringLen = line_len;
+
+	AT_Response_Reset(Me3616, at_cmd);
+	return true;
+}
+
+/**
+  * @brief  Send the command line in TxBuffer to ME3616 and wait its response.
+  * @param  Me3616: Instance of Me3616.
+  * @param  at_cmd: AT Command refer by AT_CMD_t
+  * @param  at_action: Parameter type commands refer by 3GPP
+  * @param  override: if true, send without consider AT state, timout, and command response.
+  * @param  raw: bytes sent as they are after the command line, NULL for none.
+  * @param  raw_len: bytes of raw.
+  * @retval true for send success. false for fail.
+  */
+static bool AT_Command_Send(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Action_t at_action, bool override,
+                            const uint8_t * raw, uint16_t raw_len)
+{
+	bool res = 0;
+
+	Me3616->AT_Info.Timeout = ME3616_RECEIVE_TIMOUT;
+
 	//Ignore previous AT state, force send AT command 
 	if(override == true)
 	{
 		Set_AT_Info(Me3616,  at_cmd, at_action, AT_STATE_SEND);
 		Me3616->TxDataLastTime = HAL_GetTick();
 		res = UART_AT_Send(Me3616);
+		if((res == true) && (raw_len != 0)) res = UART_AT_Send_Data(Me3616, raw, raw_len);
 	}
 	else
 	{
@@ -532,6 +1028,7 @@ bool ME3616_Send_AT_Command(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Acti
 			Set_AT_Info(Me3616,  at_cmd, at_action, AT_STATE_SEND);
 			Me3616->TxDataLastTime = HAL_GetTick();
 			res = UART_AT_Send(Me3616);
+			if((res == true) && (raw_len != 0)) res = UART_AT_Send_Data(Me3616, raw, raw_len);
 		}
 		else
 		{
@@ -553,216 +1050,1594 @@ bool ME3616_Send_AT_Command(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Acti
 	}
 }
 
-bool Check_Response(Me3616_DeviceType * Me3616, char *pch, uint16_t len)
+/**
+  * @brief  Establist AT command and send to ME3616.
+  * @param  Me3616: Instance of Me3616.
+  * @param  at_cmd: AT Command refer by AT_CMD_t
+  * @param  at_action: Parameter type commands refer by 3GPP
+  * @param  override: if true, This Function will force send AT Command out
+  						with out consider AT state, timout, and command response.
+  * @param  pch: while at_action is AT_SET, follow command strings.
+  * @retval true for send success. false for fail.
+  */
+bool ME3616_Send_AT_Command(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Action_t at_action, bool override, char * pch)
 {
-	//Waiting a command response?
-	if( Get_AT_State(Me3616) == AT_STATE_SEND)
+	//Check NULL pointer
+	if((at_action == AT_SET) && (pch == NULL)) ME3616_ErrorHandler(__FILE__, __LINE__, "Send_AT_Command() has a NULL CMD Pointer.");
+
+	//Line not sent reads as an ERROR response.
+	if(AT_Command_Build(Me3616, at_cmd, at_action, pch) == false)
 	{
-		//check incoming string is AT OK?
-		if(!strncmp(pch, "OK", 2))
-		{
-			Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_ATOK);
-			DBG_Print("AT OK Confirmed.",  DBG_DIR_AT);
-			AT_ResultReport(Me3616, true);
-			return true;
-		}
-		
-		else if(!strncmp(pch, "ERROR", 5))
-		{	
-			//Command feedback Error With +CMEE = 0
-			Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_ATERR);
-			DBG_Print("AT ERROR Confirmed.",  DBG_DIR_AT);
-			AT_ResultReport(Me3616, false);
-			return true;
-		}
-		else if(!strncmp(pch, "+CME ERROR", 10))
-		{	
-			//Command feedback Error with +CMEE = 1 or 2
-			Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_ATERR);
-			DBG_Print("AT ERROR Confirmed.",  DBG_DIR_AT);
-			CME_Callback(Me3616, pch, len);
-			return true;
-		}
+		Set_AT_Info(Me3616, at_cmd, at_action, AT_STATE_ATERR);
+		return false;
+	}
+
+	Set_Sys_State(Me3616, SYS_STATE_BUSY);
+	return AT_Command_Send(Me3616, at_cmd, at_action, override, NULL, 0);
+}
+
+/**
+  * @brief  Send "AT<cmd>=<hex of data>" to ME3616, as AT+M2MCLISEND takes its payload.
+  *         Hex is written straight into TxBuffer, no string of it is kept elsewhere.
+  * @param  Me3616: Instance of Me3616.
+  * @param  at_cmd: AT Command refer by AT_CMD_t
+  * @param  data: bytes to send.
+  * @param  len: bytes of data, the line must fit ME3616_TX_BUFFER_SIZE.
+  * @retval true for send success. false for fail.
+  */
+bool ME3616_Send_AT_Hex(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, const uint8_t * data, uint16_t len)
+{
+	return ME3616_Send_AT_Hex_Param(Me3616, at_cmd, NULL, data, len);
+}
+
+/**
+  * @brief  Send "AT<cmd>=<pch><hex of data>" to ME3616, as AT+ESOSEND takes "<socket>,<len>,<hex>".
+  * @param  Me3616: Instance of Me3616.
+  * @param  at_cmd: AT Command refer by AT_CMD_t
+  * @param  pch: parameters before the hex, with the ',' after them. NULL for none.
+  * @param  data: bytes to send.
+  * @param  len: bytes of data, the line must fit ME3616_TX_BUFFER_SIZE.
+  * @retval true for send success. false for fail.
+  */
+bool ME3616_Send_AT_Hex_Param(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, const char * pch, const uint8_t * data, uint16_t len)
+{
+	//Check NULL pointer
+	if((data == NULL) && (len != 0)) ME3616_ErrorHandler(__FILE__, __LINE__, "Send_AT_Hex() has a NULL data Pointer.");
+
+	if(AT_Command_Build_Hex(Me3616, at_cmd, pch, data, len) == false)
+	{
+		DBG_Print("Send_AT_Hex() data out of TxBuffer.", DBG_DIR_AT);
+		Set_AT_Info(Me3616, at_cmd, AT_SET, AT_STATE_ATERR);
+		return false;
+	}
+
+	Set_Sys_State(Me3616, SYS_STATE_BUSY);
+	return AT_Command_Send(Me3616, at_cmd, AT_SET, false, NULL, 0);
+}
+
+/**
+  * @brief  Send "AT<cmd>=<pch>" to ME3616 and the bytes of data right after it, as
+  *         AT+ESOSENDRAW=<socket>,<len> takes its payload. No hex, data goes out by
+  *         DMA from where it is, TxBuffer only holds the command line.
+  * @param  Me3616: Instance of Me3616.
+  * @param  at_cmd: AT Command refer by AT_CMD_t
+  * @param  pch: parameters, the length of data among them.
+  * @param  data: bytes to send, valid until this returns.
+  * @param  len: bytes of data.
+  * @retval true for send success. false for fail.
+  */
+bool ME3616_Send_AT_Raw(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, const char * pch, const uint8_t * data, uint16_t len)
+{
+	//Check NULL pointer
+	if((pch == NULL) || ((data == NULL) && (len != 0))) ME3616_ErrorHandler(__FILE__, __LINE__, "Send_AT_Raw() has a NULL Pointer.");
+
+	if(AT_Command_Build(Me3616, at_cmd, AT_SET, pch) == false)
+	{
+		Set_AT_Info(Me3616, at_cmd, AT_SET, AT_STATE_ATERR);
+		return false;
+	}
+
+	Set_Sys_State(Me3616, SYS_STATE_BUSY);
+	return AT_Command_Send(Me3616, at_cmd, AT_SET, false, data, len);
+}
+
+static AT_Request_t * AT_Queue_Push(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Action_t at_action, const char * pch,
+                                    uint32_t timeout, AT_Complete_Callback_t callback, void * context)
+{
+	AT_Request_t * request = NULL;
+
+	//Check NULL pointer
+	if((at_action == AT_SET) && (pch == NULL)) ME3616_ErrorHandler(__FILE__, __LINE__, "Queue_AT_Command() has a NULL CMD Pointer.");
+
+	if(Me3616->AT_QueueCount >= ME3616_AT_QUEUE_SIZE) return NULL;
+
+	//Queue was idle, drop any state left by ME3616_Send_AT_Command(), head request is not sent yet.
+	if(Me3616->AT_QueueCount == 0) Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_NONE);
+
+	request = &Me3616->AT_Queue[(Me3616->AT_QueueHead + Me3616->AT_QueueCount) % ME3616_AT_QUEUE_SIZE];
+	request->CMDBase = at_cmd;
+	request->CMDAction = at_action;
+	request->Param = pch;
+	request->Timeout = (timeout == 0) ? ME3616_RECEIVE_TIMOUT : timeout;
+	request->Callback = callback;
+	request->Context = context;
+	request->Append = NULL;
+	request->AppendCount = 0;
+	Me3616->AT_QueueCount++;
+
+	Set_Sys_State(Me3616, SYS_STATE_BUSY);
+	return request;
+}
+
+/**
+  * @brief  Queue an AT command, it will be sent and completed by ME3616_Poll().
+  * @note   Call from thread context only. Do not mix with ME3616_Send_AT_Command()
+  *         while the queue is not idle, both share TxBuffer and AT_Info.
+  * @param  Me3616: Instance of Me3616.
+  * @param  at_cmd: AT Command refer by AT_CMD_t
+  * @param  at_action: Parameter type commands refer by 3GPP
+  * @param  pch: while at_action is AT_SET, follow command strings.
+  * @param  timeout: ticks to wait OK / ERROR after sent, 0 for ME3616_RECEIVE_TIMOUT.
+  * @param  callback: called once with AT_STATE_ATOK, AT_STATE_ATERR or AT_STATE_TIMEOUT.
+  * @param  context: user pointer, stored in the request.
+  * @retval true for queued. false for queue full.
+  */
+bool ME3616_Queue_AT_Command(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, AT_Action_t at_action, const char * pch,
+                             uint32_t timeout, AT_Complete_Callback_t callback, void * context)
+{
+	return (AT_Queue_Push(Me3616, at_cmd, at_action, pch, timeout, callback, context) != NULL);
+}
+
+/**
+  * @brief  Step the asynchronous AT engine, never blocks.
+  * @note   AT_Info.At_State drives it: AT_STATE_NONE means the head request is
+  *         not sent yet, AT_STATE_SEND waits for Check_Response() to turn it into
+  *         AT_STATE_ATOK / AT_STATE_ATERR, or for the request timeout.
+  *         Call from main loop, MCU can sleep between calls.
+  * @param  Me3616: Instance of Me3616.
+  * @retval true while requests are pending, false when the queue is idle.
+  */
+bool ME3616_Poll(Me3616_DeviceType * Me3616)
+{
+	AT_Request_t * request = NULL;
+	AT_Request_t finished;
+	AT_State_t state;
+	bool built = false;
+
+	ME3616_Rx_Process(Me3616);
+	DBG_Log_Drain();
+
+	if(Me3616->AT_QueueCount == 0) return false;
+
+	request = &Me3616->AT_Queue[Me3616->AT_QueueHead];
+	state = Get_AT_State(Me3616);
+
+	switch(state)
+	{
+		case AT_STATE_SEND:
+		{
+			if((HAL_GetTick() - Me3616->TxDataLastTime) <= Me3616->AT_Info.Timeout) return true;
+
+			Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_TIMEOUT);
+			DBG_Print("AT Timeout.", DBG_DIR_AT);
+			state = AT_STATE_TIMEOUT;
+			break;
+		}
+		case AT_STATE_ATOK:
+		case AT_STATE_ATERR:
+		case AT_STATE_TIMEOUT:
+		{
+			break;
+		}
+		default:
+		{
+			//Head request not sent yet. TxBuffer is still the DMA source of the
+			//last line until the UART is free, so build it only right before sending.
+			if(UART_AT_Tx_Ready(Me3616) == false) return true;
+
+			built = AT_Command_Build(Me3616, request->CMDBase, request->CMDAction, request->Param);
+			for(uint8_t i = 0; (built == true) && (i < request->AppendCount); i++) built = AT_Command_Append(Me3616, &request->Append[i]);
+			if(built == false)
+			{
+				//Finished as ERROR by the next poll, nothing sent.
+				Set_AT_Info(Me3616, request->CMDBase, request->CMDAction, AT_STATE_ATERR);
+				return true;
+			}
+			Set_AT_Info(Me3616, request->CMDBase, request->CMDAction, AT_STATE_SEND);
+			Me3616->AT_Info.Timeout = request->Timeout;
+			Me3616->TxDataLastTime = HAL_GetTick();
+			if(UART_AT_Send_Async(Me3616) == false)
+			{
+				Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_NONE);
+			}
+			return true;
+		}
+	}
+
+	//Request finished, release it before callback, so callback can queue the next one.
+	finished = *request;
+	Me3616->AT_QueueHead = (Me3616->AT_QueueHead + 1) % ME3616_AT_QUEUE_SIZE;
+	Me3616->AT_QueueCount--;
+	Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_NONE);
+
+	if(finished.Callback != NULL) finished.Callback(Me3616, &finished, state, &Me3616->Response);
+
+	if(Me3616->AT_QueueCount == 0)
+	{
+		Clear_Sys_State(Me3616, SYS_STATE_BUSY);
+		return false;
+	}
+	return true;
+}
+
+__INLINE bool ME3616_AT_Queue_Idle(Me3616_DeviceType * Me3616)
+{
+	return (Me3616->AT_QueueCount == 0);
+}
+
+/**
+  * @brief  Get ready for a blocking command of a client module.
+  * @param  Me3616: Instance of Me3616.
+  * @retval true for ready, false from an Active Report handler.
+  */
+static bool AT_Exec_Ready(Me3616_DeviceType * Me3616)
+{
+	//Nothing is parsed while an Active Report is handled, the response would never come.
+	if(Me3616->RxProcessing == true) return false;
+
+	//Queued commands share TxBuffer, let them finish.
+	while(ME3616_Poll(Me3616) == true);
+	return true;
+}
+
+//OK or not. ERROR and timeout are cleared, so the next command goes.
+static bool AT_Exec_Result(Me3616_DeviceType * Me3616, bool sent)
+{
+	if((sent == true) && (Get_AT_State(Me3616) == AT_STATE_ATOK)) return true;
+
+	Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_NONE);
+	return false;
+}
+
+/**
+  * @brief  Send "AT<cmd>=<pch>" after the queue, and tell if it got OK.
+  * @note   For client modules, socket, MQTT, CoAP, HTTP. Thread context only,
+  *         returns false at once from an Active Report handler. The response
+  *         stays in ME3616_Get_Response() until the next command.
+  * @param  Me3616: Instance of Me3616.
+  * @param  at_cmd: AT Command refer by AT_CMD_t
+  * @param  pch: parameters.
+  * @retval true for OK.
+  */
+bool ME3616_Exec_AT_Command(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, char * pch)
+{
+	if(AT_Exec_Ready(Me3616) == false) return false;
+	return AT_Exec_Result(Me3616, ME3616_Send_AT_Command(Me3616, at_cmd, AT_SET, false, pch));
+}
+
+/**
+  * @brief  ME3616_Exec_AT_Command() of "AT<cmd>=<pch><hex of data>", see ME3616_Send_AT_Hex_Param().
+  */
+bool ME3616_Exec_AT_Hex(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, const char * pch, const uint8_t * data, uint16_t len)
+{
+	if(AT_Exec_Ready(Me3616) == false) return false;
+	return AT_Exec_Result(Me3616, ME3616_Send_AT_Hex_Param(Me3616, at_cmd, pch, data, len));
+}
+
+/**
+  * @brief  ME3616_Exec_AT_Command() of "AT<cmd>=<pch>" and raw bytes, see ME3616_Send_AT_Raw().
+  */
+bool ME3616_Exec_AT_Raw(Me3616_DeviceType * Me3616, AT_CMD_t at_cmd, const char * pch, const uint8_t * data, uint16_t len)
+{
+	if(AT_Exec_Ready(Me3616) == false) return false;
+	return AT_Exec_Result(Me3616, ME3616_Send_AT_Raw(Me3616, at_cmd, pch, data, len));
+}
+
+static void AT_Batch_Step_Done(Me3616_DeviceType * Me3616, AT_Request_t * request, AT_State_t result, const AT_Response_t * response);
+
+/**
+  * @brief  Queue steps of a batch while the queue has room.
+  * @note   Steps with Combine are put into the command line of the step before,
+  *         as long as the line fits TxBuffer.
+  * @param  Me3616: Instance of Me3616.
+  * @param  batch: batch to continue.
+  * @retval None.
+  */
+static void AT_Batch_Fill(Me3616_DeviceType * Me3616, AT_Batch_t * batch)
+{
+	const AT_Step_t * step = NULL;
+	AT_Request_t * request = NULL;
+	uint16_t line_len = 0;
+	uint8_t count = 0;
+
+	while(batch->Queued < batch->StepCount)
+	{
+		step = &batch->Steps[batch->Queued];
+		line_len = strlen(AT_Header) + AT_Step_Length(step) + strlen(AT_End);
+
+		for(count = 1; batch->Queued + count < batch->StepCount; count++)
+		{
+			if(step[count].Combine == false) break;
+			if(line_len + 1 + AT_Step_Length(&step[count]) > ME3616_TX_BUFFER_SIZE - 1) break;
+			line_len += 1 + AT_Step_Length(&step[count]);
+		}
+
+		request = AT_Queue_Push(Me3616, step->CMDBase, step->CMDAction, step->Param, 0, AT_Batch_Step_Done, batch);
+		if(request == NULL) return;
+
+		request->Append = step + 1;
+		request->AppendCount = count - 1;
+		batch->Queued += count;
+	}
+}
+
+static void AT_Batch_Step_Done(Me3616_DeviceType * Me3616, AT_Request_t * request, AT_State_t result, const AT_Response_t * response)
+{
+	AT_Batch_t * batch = (AT_Batch_t *)request->Context;
+	UNUSED(response);
+
+	if((result != AT_STATE_ATOK) && (batch->Failed++ == 0))
+	{
+		batch->FirstFailed = batch->Done;
+		batch->Result = result;
+	}
+	batch->Done += request->AppendCount + 1;
+
+	if(batch->Done >= batch->StepCount)
+	{
+		if(batch->Callback != NULL) batch->Callback(Me3616, batch, batch->Result);
+		return;
+	}
+
+	AT_Batch_Fill(Me3616, batch);
+}
+
+/**
+  * @brief  Run a sequence of AT commands back to back, by ME3616_Poll().
+  * @note   Steps are queued ahead, each one is sent as soon as the one before gets
+  *         OK / ERROR, a failed step does not stop the batch. Steps marked Combine
+  *         share one command line with the step before, a failure of that line
+  *         counts for all of its steps.
+  * @param  Me3616: Instance of Me3616.
+  * @param  batch: state of the batch, MUST stay valid until the callback.
+  * @param  steps: steps to run.
+  * @param  count: number of steps.
+  * @param  callback: called once with AT_STATE_ATOK or result of the first failed step.
+  * @param  context: user pointer, stored in batch.
+  * @retval true for started, false for empty batch or queue full.
+  */
+bool ME3616_Batch_Start(Me3616_DeviceType * Me3616, AT_Batch_t * batch, const AT_Step_t * steps, uint8_t count,
+                        AT_Batch_Callback_t callback, void * context)
+{
+	if((batch == NULL) || (steps == NULL) || (count == 0)) return false;
+
+	batch->Steps = steps;
+	batch->StepCount = count;
+	batch->Queued = 0;
+	batch->Done = 0;
+	batch->Failed = 0;
+	batch->FirstFailed = 0;
+	batch->Result = AT_STATE_ATOK;
+	batch->Callback = callback;
+	batch->Context = context;
+
+	AT_Batch_Fill(Me3616, batch);
+	return (batch->Queued != 0);
+}
+
+/**
+  * @brief  Run a batch and wait until every step is completed.
+  * @param  Me3616: Instance of Me3616.
+  * @param  steps: steps to run.
+  * @param  count: number of steps.
+  * @retval true if every step got OK.
+  */
+bool ME3616_Run_Batch(Me3616_DeviceType * Me3616, const AT_Step_t * steps, uint8_t count)
+{
+	AT_Batch_t batch;
+
+	if(ME3616_Batch_Start(Me3616, &batch, steps, count, NULL, NULL) == false) return false;
+
+	while(batch.Done < batch.StepCount)
+	{
+		ME3616_Poll(Me3616);
+	}
+
+	if(batch.Failed != 0) DBG_Print("Batch has failed steps.", DBG_DIR_AT);
+	return (batch.Failed == 0);
+}
+
+/**
+  * @brief  Parse one field at p, by type, into field.
+  * @param  response: response to store strings / hex blobs.
+  * @param  field: field to fill.
+  * @param  type: AT_Field_Type_t without AT_FIELD_OPTIONAL.
+  * @param  p: first char of the field, not empty.
+  * @param  end: end of the line.
+  * @param  counted: the line carries raw bytes, see ME3616_Register_Counted().
+  * @retval char after the field, NULL for malformed.
+  */
+static const char * AT_Field_Parse(AT_Response_t * response, AT_Field_t * field, uint8_t type, const char * p, const char * const end,
+                                   bool counted)
+{
+	uint8_t * data = response->Data + response->DataLen;
+	uint16_t room = ME3616_RESPONSE_DATA_SIZE - response->DataLen;
+	bool quoted = false;
+	bool negative = false;
+
+	field->Int = 0;
+	field->Offset = response->DataLen;
+	field->Len = 0;
+
+	switch(type)
+	{
+		case AT_FIELD_INT:
+		{
+			if((*p == '-') || (*p == '+')) negative = (*p++ == '-');
+			if((p >= end) || (*p < '0') || (*p > '9')) return NULL;
+
+			while((p < end) && (*p >= '0') && (*p <= '9')) field->Int = field->Int * 10 + (*p++ - '0');
+			if(negative) field->Int = -field->Int;
+			return p;
+		}
+		case AT_FIELD_STRING:
+		{
+			if(*p == '"') { quoted = true; p++; }
+
+			while((p < end) && (quoted ? (*p != '"') : (*p != ',')))
+			{
+				//keep one byte for '\0'
+				if(field->Len + 1 >= room) return NULL;
+				data[field->Len++] = *p++;
+			}
+			data[field->Len] = '\0';
+			response->DataLen += field->Len + 1;
+			break;
+		}
+		case AT_FIELD_COUNTED:
+		{
+			int32_t count = 0;
+
+			//Count is the field before, it is never the first one
+			if(field == response->Field) return NULL;
+			count = (field - 1)->Int;
+			if((count < 0) || (count > room)) return NULL;
+			field->Len = count;
+
+			if(counted == true)
+			{
+				//Raw, ',' and '\n' may be among the bytes
+				if(end - p < count) return NULL;
+				memcpy(data, p, count);
+				p += count;
+			}
+			else
+			{
+				if(*p == '"') { quoted = true; p++; }
+				if((end - p < 2 * count) || (Hex_Decode(data, count, p, 2 * count) != count)) return NULL;
+				p += 2 * count;
+			}
+			response->DataLen += field->Len;
+			break;
+		}
+		case AT_FIELD_HEX:
+		{
+			if(*p == '"') { quoted = true; p++; }
+
+			field->Len = Hex_Decode(data, room, p, end - p);
+			p += 2 * field->Len;
+
+			//still hex, out of room
+			if((p + 1 < end) && (((Hex_Decode_LUT[(uint8_t)p[0]] | Hex_Decode_LUT[(uint8_t)p[1]]) & 0xF0) == 0)) return NULL;
+			response->DataLen += field->Len;
+			break;
+		}
+		default:
+		{
+			return NULL;
+		}
+	}
+
+	if(quoted)
+	{
+		if((p >= end) || (*p != '"')) return NULL;
+		p++;
+	}
+	return p;
+}
+
+/**
+  * @brief  Parse a response line of the command in flight, by its AT_Response_Spec_t.
+  * @note   One pass over the line. Command echo, lines of other prefix, and lines
+  *         after the first matched one are ignored.
+  * @param  Me3616: Instance of Me3616.
+  * @param  pch: response string.
+  * @param  len: length of pch.
+  * @retval true if the line is the response of the command.
+  */
+static bool AT_Response_Parse(Me3616_DeviceType * Me3616, const char * pch, uint16_t len)
+{
+	AT_Response_t * response = &Me3616->Response;
+	const AT_Response_Spec_t * spec = response->Spec;
+	const char * p = pch;
+	const char * const end = pch + len;
+	uint8_t index = 0;
+	uint8_t type = 0;
+	bool counted = false;
+
+	if((spec == NULL) || (response->Parsed == true)) return false;
+
+	//Command echo
+	if((len >= 2) && (pch[0] == 'A') && (pch[1] == 'T')) return false;
+
+	if(spec->PrefixLen != 0)
+	{
+		if((len <= spec->PrefixLen) || memcmp(pch, spec->Prefix, spec->PrefixLen)) return false;
+		p += spec->PrefixLen;
+		if((*p != ':') && (*p != '=')) return false;
+		p++;
+	}
+	response->Parsed = true;
+
+	for(index = 0; index < spec->FieldCount; index++)
+	{
+		type = spec->Field[index];
+
+		//Raw bytes may start with ' ' or ','
+		counted = (Me3616->RxLineCounted == true) && ((type & ~AT_FIELD_OPTIONAL) == AT_FIELD_COUNTED);
+		if(counted == false) while((p < end) && (*p == ' ')) p++;
+
+		//Empty or missing field
+		if((p >= end) || ((*p == ',') && (counted == false)))
+		{
+			if((type & AT_FIELD_OPTIONAL) == 0) break;
+		}
+		else
+		{
+			p = AT_Field_Parse(response, &response->Field[index], type & ~AT_FIELD_OPTIONAL, p, end, counted);
+			if(p == NULL) break;
+			response->Present |= (1 << index);
+		}
+
+		while((p < end) && (*p == ' ')) p++;
+		if(p < end)
+		{
+			if(*p != ',')
+			{
+				index++;
+				break;
+			}
+			p++;
+		}
+	}
+	response->FieldCount = index;
+	return true;
+}
+
+/**
+  * @brief  Typed response of the last command, valid until next command is sent.
+  * @param  Me3616: Instance of Me3616.
+  * @retval response.
+  */
+__INLINE const AT_Response_t * ME3616_Get_Response(Me3616_DeviceType * Me3616)
+{
+	return &Me3616->Response;
+}
+
+static bool AT_Response_Has(const AT_Response_t * response, uint8_t index, AT_Field_Type_t type)
+{
+	if((response == NULL) || (response->Spec == NULL) || (index >= response->FieldCount)) return false;
+	if((response->Spec->Field[index] & ~AT_FIELD_OPTIONAL) != type) return false;
+	return ((response->Present & (1 << index)) != 0);
+}
+
+/**
+  * @brief  Get an AT_FIELD_INT field of a response.
+  * @param  response: from ME3616_Get_Response() or completion callback.
+  * @param  index: field index in AT_Response_Spec_t.
+  * @param  value: field value.
+  * @retval true if the field is present.
+  */
+bool AT_Response_Get_Int(const AT_Response_t * response, uint8_t index, int32_t * value)
+{
+	if(AT_Response_Has(response, index, AT_FIELD_INT) == false) return false;
+	*value = response->Field[index].Int;
+	return true;
+}
+
+/**
+  * @brief  Get an AT_FIELD_STRING field of a response.
+  * @param  response: from ME3616_Get_Response() or completion callback.
+  * @param  index: field index in AT_Response_Spec_t.
+  * @retval '\0' ended string, NULL if the field is not present.
+  */
+const char * AT_Response_Get_String(const AT_Response_t * response, uint8_t index)
+{
+	if(AT_Response_Has(response, index, AT_FIELD_STRING) == false) return NULL;
+	return (const char *)response->Data + response->Field[index].Offset;
+}
+
+/**
+  * @brief  Get an AT_FIELD_HEX or AT_FIELD_COUNTED field of a response.
+  * @param  response: from ME3616_Get_Response() or completion callback.
+  * @param  index: field index in AT_Response_Spec_t.
+  * @param  data: decoded bytes.
+  * @retval number of bytes, 0 if the field is not present.
+  */
+uint16_t AT_Response_Get_Hex(const AT_Response_t * response, uint8_t index, const uint8_t ** data)
+{
+	if((AT_Response_Has(response, index, AT_FIELD_HEX) == false) &&
+	   (AT_Response_Has(response, index, AT_FIELD_COUNTED) == false)) return 0;
+	*data = response->Data + response->Field[index].Offset;
+	return response->Field[index].Len;
+}
+
+static AT_Report_Handler_t * AT_Report_Lookup(const char * pch, uint16_t len, uint16_t * name_len);
+
+/**
+  * @brief  Check if a line got while a command is in flight is an Active Report.
+  * @note   Only a registered name other than the command's own is taken, such as
+  *         +ESONMI while AT+ESOSEND waits OK. "+CFUN: 1" of AT+CFUN? stays a response.
+  *         A name set by ME3616_Set_URC_Interleave() is taken while its own command waits too.
+  * @param  Me3616: Instance of Me3616.
+  * @param  pch: received string.
+  * @param  len: length of pch.
+  * @retval true if pch goes to Active_Report().
+  */
+static bool AT_Report_In_Response(Me3616_DeviceType * Me3616, const char * pch, uint16_t len)
+{
+	const char * cmd = AT_CMD_String[Get_Last_AT_CMD(Me3616)];
+	AT_Report_Handler_t * handler = NULL;
+	uint16_t name_len = 0;
+
+	if((len == 0) || ((pch[0] != '+') && (pch[0] != '*'))) return false;
+
+	handler = AT_Report_Lookup(pch, len, &name_len);
+	if((handler == NULL) || (handler->Callback == NULL)) return false;
+	if(handler->Interleave == true) return true;
+
+	return ((strlen(cmd) != name_len) || memcmp(cmd, pch, name_len));
+}
+
+bool Check_Response(Me3616_DeviceType * Me3616, char *pch, uint16_t len)
+{
+	//Waiting a command response?
+	if( Get_AT_State(Me3616) == AT_STATE_SEND)
+	{
+		//check incoming string is AT OK?
+		if(!strncmp(pch, "OK", 2))
+		{
+			Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_ATOK);
+			DBG_Print("AT OK Confirmed.",  DBG_DIR_AT);
+			AT_ResultReport(Me3616, true);
+			return true;
+		}
+		
+		else if(!strncmp(pch, "ERROR", 5))
+		{	
+			//Command feedback Error With +CMEE = 0
+			Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_ATERR);
+			DBG_Print("AT ERROR Confirmed.",  DBG_DIR_AT);
+			AT_ResultReport(Me3616, false);
+			return true;
+		}
+		else if(!strncmp(pch, "+CME ERROR", 10))
+		{	
+			//Command feedback Error with +CMEE = 1 or 2
+			Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_ATERR);
+			DBG_Print("AT ERROR Confirmed.",  DBG_DIR_AT);
+			CME_Callback(Me3616, pch, len);
+			return true;
+		}
+		else if(AT_Report_In_Response(Me3616, pch, len) == true)
+		{
+			//Active Report came in between the command and its OK/ERROR
+			Active_Report(Me3616, pch, len);
+		}
 		else
 		{
-			//Command Response Before AT OK/ERROR
-			Command_Response(Me3616, pch, len);
+			//Command Response Before AT OK/ERROR
+			AT_Response_Parse(Me3616, pch, len);
+			Command_Response(Me3616, pch, len);
+		}
+	}
+	//Active Response or other unknow response.
+	else
+	{
+		//without state of AT_Send, but receive a string.
+		Active_Report(Me3616, pch, len);
+	}
+	return false;
+}
+
+void RxHandler(Me3616_DeviceType * Me3616, char *p_Buff, uint16_t len)
+{
+	Me3616->RxDataLastTime = HAL_GetTick();
+	
+	Set_Sys_State(Me3616, SYS_STATE_INCOMMING_NEW_AT_STRING);
+	Check_Response(Me3616, p_Buff, len);
+	Clear_Sys_State(Me3616, SYS_STATE_INCOMMING_NEW_AT_STRING);
+	Set_Sys_State (Me3616, SYS_STATE_READY);
+}
+
+
+/**
+  * @brief  Describe RxBuffer[begin..lf] as a line view, bottom CR LF excluded.
+  * @param  Me3616: Instance of Me3616.
+  * @param  line: view to fill, Seg[1] is used only when the text wraps the buffer end.
+  * @param  begin: index of the first char of the line.
+  * @param  lf: index of the '\n' ending the line.
+  * @retval None.
+  */
+static void AT_Line_Frame(Me3616_DeviceType * Me3616, AT_Line_t * line, uint16_t begin, uint16_t lf)
+{
+	char * const pBuff = (char *)Me3616->RxBuffer;
+	uint16_t uLength = (lf + ME3616_RX_BUFFER_SIZE - begin) % ME3616_RX_BUFFER_SIZE;
+
+	//drop CR before LF
+	if((uLength > 0) && (pBuff[(lf + ME3616_RX_BUFFER_SIZE - 1) % ME3616_RX_BUFFER_SIZE] == '\r')) uLength--;
+
+	line->Seg[0] = pBuff + begin;
+	line->Len[0] = (uLength < ME3616_RX_BUFFER_SIZE - begin) ? uLength : (ME3616_RX_BUFFER_SIZE - begin);
+	line->Len[1] = uLength - line->Len[0];
+	line->Seg[1] = (line->Len[1] != 0) ? pBuff : NULL;
+}
+
+/**
+  * @brief  Make a framed line a '\0' ended string.
+  * @note   A contiguous line is ended in place, over its own CR / LF, or the spare
+  *         byte RxBuffer[ME3616_RX_BUFFER_SIZE], DMA never writes there again before
+  *         the framer has passed it. Only a line wrapping the buffer end is copied
+  *         into RxVaildString.
+  * @param  Me3616: Instance of Me3616.
+  * @param  line: line view from AT_Line_Frame().
+  * @retval the string, Len[0] + Len[1] chars.
+  */
+static char * AT_Line_String(Me3616_DeviceType * Me3616, AT_Line_t * line)
+{
+	char * const pVaildBuff = (char *)Me3616->RxVaildString;
+
+	if(line->Len[1] == 0)
+	{
+		line->Seg[0][line->Len[0]] = '\0';
+		return line->Seg[0];
+	}
+
+	memcpy(pVaildBuff, line->Seg[0], line->Len[0]);
+	memcpy(pVaildBuff + line->Len[0], line->Seg[1], line->Len[1]);
+	pVaildBuff[line->Len[0] + line->Len[1]] = '\0';
+	return pVaildBuff;
+}
+
+/**
+  * @brief  Hand a framed line to RxHandler() as a string.
+  * @param  Me3616: Instance of Me3616.
+  * @param  line: line view from AT_Line_Frame().
+  * @retval None.
+  */
+void RxLineHandler(Me3616_DeviceType * Me3616, AT_Line_t * line)
+{
+	RxHandler(Me3616, AT_Line_String(Me3616, line), line->Len[0] + line->Len[1]);
+}
+
+/**
+  * @brief  Check if DMA has already written over the start of a line.
+  * @note   DMA goes on after uWrite was taken, and while earlier lines are handled.
+  *         Bytes ahead of uWrite are read from NDTR, a full lap is not seen.
+  * @param  Me3616: Instance of Me3616.
+  * @param  uBegin: index of the first char of the line.
+  * @param  uWrite: DMA write position the line was framed against.
+  * @retval true if the line is broken.
+  */
+static bool String_Lapped(Me3616_DeviceType * Me3616, uint16_t uBegin, uint16_t uWrite)
+{
+	uint16_t uBehind = (uWrite + ME3616_RX_BUFFER_SIZE - uBegin) % ME3616_RX_BUFFER_SIZE;
+	uint16_t uAhead = (UART_AT_Rx_WriteIndex(Me3616) + ME3616_RX_BUFFER_SIZE - uWrite) % ME3616_RX_BUFFER_SIZE;
+
+	return (uBehind + uAhead >= ME3616_RX_BUFFER_SIZE);
+}
+
+/**
+  * @brief  Back to line framing, for the next line.
+  * @param  Me3616: Instance of Me3616.
+  * @retval None.
+  */
+static void String_Counted_Reset(Me3616_DeviceType * Me3616)
+{
+	Me3616->RxCounted = 0;
+	Me3616->RxCountedFields = 0;
+	Me3616->RxCountedField = 0;
+	Me3616->RxCountedLeft = 0;
+	Me3616->RxCountedDrop = false;
+	Me3616->RxLineCounted = false;
+
+	//Streamed line not ended, its callback must not wait for the rest.
+	if(Me3616->RxStream != NULL) Me3616->RxStream(Me3616, AT_STREAM_ABORT, NULL, 0);
+	Me3616->RxStream = NULL;
+}
+
+static uint8_t AT_Counted_Lookup(const char * pBuff, uint16_t uBegin, uint16_t uEnd);
+
+/**
+  * @brief  Follow the head of a line, char by char, until its raw bytes start.
+  * @note   At ':' or '=' the name is looked up in the counted table, then commas are
+  *         counted up to the one after the length field. From there RxCountedLeft
+  *         bytes are taken by String_Frame() without looking for '\n'. A streamed
+  *         line needs no room in RxBuffer, any <length> up to 65535 goes.
+  * @param  Me3616: Instance of Me3616.
+  * @param  uBegin: index of the first char of the line.
+  * @param  uEnd: index of the char to look at.
+  * @retval None.
+  */
+static void String_Counted_Scan(Me3616_DeviceType * Me3616, uint16_t uBegin, uint16_t uEnd)
+{
+	const char * const pBuff = (char *)Me3616->RxBuffer;
+	const char ch = pBuff[uEnd];
+	const AT_Counted_t * counted = NULL;
+	uint16_t uHead = 0;
+	uint32_t count = 0;
+	bool bad = false;
+
+	if(Me3616->RxCounted == 0)
+	{
+		if((uEnd == uBegin) && (ch != '+') && (ch != '*')) Me3616->RxCounted = 0xFF;
+		else if((ch == ':') || (ch == '='))
+		{
+			Me3616->RxCounted = AT_Counted_Lookup(pBuff, uBegin, uEnd);
+			Me3616->RxCountedField = (uEnd + 1) % ME3616_RX_BUFFER_SIZE;
+		}
+		return;
+	}
+
+	if(ch != ',') return;
+	counted = &AT_Counted_Table[Me3616->RxCounted - 1];
+	if(Me3616->RxCountedFields++ != counted->Field)
+	{
+		Me3616->RxCountedField = (uEnd + 1) % ME3616_RX_BUFFER_SIZE;
+		return;
+	}
+
+	//Length field, digits between RxCountedField and this comma
+	for(uint16_t i = Me3616->RxCountedField; i != uEnd; i = (i + 1) % ME3616_RX_BUFFER_SIZE)
+	{
+		if((pBuff[i] >= '0') && (pBuff[i] <= '9')) count = count * 10 + (pBuff[i] - '0');
+		else if(pBuff[i] != ' ') bad = true;
+		if((bad == true) || (count > 0xFFFF)) break;
+	}
+	if(bad == true) count = ME3616_RX_BUFFER_SIZE;
+
+	if((counted->Stream != NULL) && (bad == false) && (count <= 0xFFFF))
+	{
+		//Raw bytes go to the callback as DMA writes them, nothing is kept.
+		Me3616->RxStream = counted->Stream;
+		Me3616->RxCountedDrop = false;
+	}
+	else
+	{
+		//Head, raw bytes and CR LF must fit RxBuffer with a spare byte, or the line goes.
+		uHead = (uEnd + ME3616_RX_BUFFER_SIZE - uBegin) % ME3616_RX_BUFFER_SIZE + 1;
+		Me3616->RxCountedDrop = (uHead + count + 2 > ME3616_RX_BUFFER_SIZE - 1);
+	}
+	Me3616->RxCountedLeft = (count < 0xFFFF) ? count : 0xFFFF;
+	Me3616->RxLineCounted = true;
+	Me3616->RxCounted = 0xFF;
+}
+
+/**
+  * @brief  Hand the head of a streamed line to its callback, RxBuffer[uBegin..uComma).
+  * @note   The head is ended over the comma after the length field.
+  * @param  Me3616: Instance of Me3616.
+  * @param  uBegin: index of the first char of the line.
+  * @param  uComma: index of the comma after the length field.
+  * @retval None.
+  */
+static void String_Stream_Head(Me3616_DeviceType * Me3616, uint16_t uBegin, uint16_t uComma)
+{
+	AT_Line_t line;
+
+	AT_Line_Frame(Me3616, &line, uBegin, uComma);
+	Me3616->RxStream(Me3616, AT_STREAM_HEAD, AT_Line_String(Me3616, &line), line.Len[0] + line.Len[1]);
+}
+
+/**
+  * @brief  Hand raw bytes of a streamed line to its callback, in two calls if they
+  *         wrap the buffer end.
+  * @param  Me3616: Instance of Me3616.
+  * @param  uStart: index of the first byte.
+  * @param  uLen: bytes to hand over.
+  * @retval None.
+  */
+static void String_Stream_Data(Me3616_DeviceType * Me3616, uint16_t uStart, uint16_t uLen)
+{
+	const char * const pBuff = (char *)Me3616->RxBuffer;
+	uint16_t uFirst = ME3616_RX_BUFFER_SIZE - uStart;
+
+	if(uFirst > uLen) uFirst = uLen;
+	if(uFirst != 0) Me3616->RxStream(Me3616, AT_STREAM_DATA, pBuff + uStart, uFirst);
+	if(uLen > uFirst) Me3616->RxStream(Me3616, AT_STREAM_DATA, pBuff, uLen - uFirst);
+}
+
+/**
+  * @brief  Frame every complete line DMA has written, up to uWrite.
+  * @note   Only bytes between the last scan position and uWrite are looked at,
+  *         once each. An unfinished line stays in RxBuffer until the next call.
+  *         RxStringBegin is the start of that line, RxStringEnd the scan position.
+  *         The raw bytes of a counted line are passed in one step, '\n' among them
+  *         does not end the line. A streamed line is handed over as it comes, head,
+  *         raw bytes and end, and let go at once.
+  * @param  Me3616: Instance of Me3616.
+  * @param  uWrite: DMA write position in RxBuffer.
+  * @retval None.
+  */
+static void String_Frame(Me3616_DeviceType * Me3616, uint16_t uWrite)
+{
+	const char * const pBuff = (char *)Me3616->RxBuffer;
+	uint16_t uBegin = Me3616->RxStringBegin;
+	uint16_t uEnd = Me3616->RxStringEnd;
+	uint16_t uRaw = 0;
+	AT_Line_t line;
+
+	//Ensure positions are legal.
+	if((uBegin >= ME3616_RX_BUFFER_SIZE) || (uEnd >= ME3616_RX_BUFFER_SIZE))
+	{
+		ME3616_IF_ErrorHandler(__FILE__, __LINE__, "UART Rx Buffer pointer illegal.");
+	}
+
+	while(uEnd != uWrite)
+	{
+		if(Me3616->RxCountedLeft != 0)
+		{
+			//Raw bytes of a counted line, as many as DMA has written
+			uRaw = (uWrite + ME3616_RX_BUFFER_SIZE - uEnd) % ME3616_RX_BUFFER_SIZE;
+			if(uRaw > Me3616->RxCountedLeft) uRaw = Me3616->RxCountedLeft;
+			Me3616->RxCountedLeft -= uRaw;
+			if(Me3616->RxStream != NULL) String_Stream_Data(Me3616, uEnd, uRaw);
+			uEnd = (uEnd + uRaw) % ME3616_RX_BUFFER_SIZE;
+
+			//Line too long to keep, or streamed, let DMA go over it.
+			if((Me3616->RxCountedDrop == true) || (Me3616->RxStream != NULL)) uBegin = uEnd;
+			continue;
+		}
+
+		if(pBuff[uEnd] == '\n')
+		{
+			AT_Line_Frame(Me3616, &line, uBegin, uEnd);
+
+			if(Me3616->RxResync == true)
+			{
+				Me3616->RxResync = false;
+			}
+			else if(String_Lapped(Me3616, uBegin, uWrite) == true)
+			{
+				//Bytes up to uWrite may be a lap newer than they look, go on at uWrite with the next whole line.
+				uBegin = uWrite;
+				uEnd = uWrite;
+				Me3616->RxResync = true;
+				Me3616->RxOverruns++;
+				String_Counted_Reset(Me3616);
+				DBG_Print("UART Rx overrun, strings dropped.", DBG_DIR_AT);
+				break;
+			}
+			else if(Me3616->RxCountedDrop == true)
+			{
+				DBG_Print("UART Receive counted line out of buffer, dropped.", DBG_DIR_AT);
+			}
+			else if(Me3616->RxStream != NULL)
+			{
+				Me3616->RxStream(Me3616, AT_STREAM_END, NULL, 0);
+				Me3616->RxStream = NULL;
+			}
+			//ignore the empty line of beginning CR LF
+			else if((line.Len[0] + line.Len[1]) != 0)
+			{
+				RxLineHandler(Me3616, &line);
+			}
+
+			uBegin = (uEnd + 1) % ME3616_RX_BUFFER_SIZE;
+			String_Counted_Reset(Me3616);
+		}
+		else
+		{
+			if(Me3616->RxCounted != 0xFF)
+			{
+				String_Counted_Scan(Me3616, uBegin, uEnd);
+
+				//Head of a streamed line, hand it over and let it go.
+				if(Me3616->RxStream != NULL)
+				{
+					String_Stream_Head(Me3616, uBegin, uEnd);
+					uBegin = uEnd;
+				}
+			}
+
+			//Length of a single string > Buffer size, DMA is overwriting it.
+			if((uEnd + ME3616_RX_BUFFER_SIZE - uBegin) % ME3616_RX_BUFFER_SIZE >= ME3616_RX_BUFFER_SIZE - 1)
+			{
+				ME3616_IF_ErrorHandler(__FILE__, __LINE__, "UART Receive out of buffer.");
+			}
+		}
+
+		uEnd = (uEnd + 1) % ME3616_RX_BUFFER_SIZE;
+	}
+
+	Me3616->RxStringBegin = uBegin;
+	Me3616->RxStringEnd = uEnd;
+}
+
+/**
+  * @brief  Frame received strings up to the current NDTR write position.
+  * @note   Called from USART IRQ on character match, without ME3616_RX_IDLE_MODE.
+  * @param  Me3616: Instance of Me3616.
+  * @retval None.
+  */
+void ME3616_String_Receive(Me3616_DeviceType * Me3616)
+{
+	String_Frame(Me3616, UART_AT_Rx_WriteIndex(Me3616));
+}
+
+/**
+  * @brief  Parse strings received since last call, in thread context.
+  * @note   With ME3616_RX_IDLE_MODE, IRQ only publishes RxWriteIndex / RxReceived on
+  *         UART IDLE and DMA half / full transfer. Call it from main loop, blocking
+  *         waits of this driver call it too. Without ME3616_RX_IDLE_MODE it does nothing.
+  * @param  Me3616: Instance of Me3616.
+  * @retval true if new bytes were handled.
+  */
+bool ME3616_Rx_Process(Me3616_DeviceType * Me3616)
+{
+#ifdef ME3616_RX_IDLE_MODE
+	uint32_t received = 0;
+	uint32_t uTotal = 0;
+	uint16_t uWrite = 0;
+	uint16_t uPending = 0;
+
+	//Callbacks may wait for AT response, do not frame recursively.
+	if(Me3616->RxProcessing == true) return false;
+
+	//Snapshot both, IRQ updates them together.
+	__disable_irq();
+	received = Me3616->RxReceived;
+	uWrite = Me3616->RxWriteIndex;
+	__enable_irq();
+
+	if(received == Me3616->RxProcessed) return false;
+
+	Me3616->RxProcessing = true;
+
+	//Unfinished line already scanned, plus bytes not scanned yet.
+	uPending = (Me3616->RxStringEnd + ME3616_RX_BUFFER_SIZE - Me3616->RxStringBegin) % ME3616_RX_BUFFER_SIZE;
+	uTotal = received - Me3616->RxProcessed + uPending;
+	if(uTotal > Me3616->RxHighWater) Me3616->RxHighWater = (uTotal < ME3616_RX_BUFFER_SIZE) ? uTotal : ME3616_RX_BUFFER_SIZE;
+
+	if(uTotal >= ME3616_RX_BUFFER_SIZE)
+	{
+		//DMA has lapped the parser, drop what is in RxBuffer and restart at write position.
+		//Unless a line starts right there, the rest of the broken line goes too.
+		Me3616->RxStringBegin = uWrite;
+		Me3616->RxStringEnd = uWrite;
+		Me3616->RxResync = (Me3616->RxBuffer[(uWrite + ME3616_RX_BUFFER_SIZE - 1) % ME3616_RX_BUFFER_SIZE] != '\n');
+		Me3616->RxOverruns++;
+		String_Counted_Reset(Me3616);
+		DBG_Print("UART Rx overrun, strings dropped.", DBG_DIR_AT);
+	}
+	else
+	{
+		String_Frame(Me3616, uWrite);
+	}
+
+	Me3616->RxProcessed = received;
+	Me3616->RxProcessing = false;
+	return true;
+#else
+	UNUSED(Me3616);
+	return false;
+#endif
+}
+
+/**
+  * @brief  Wait, and keep parsing received strings meanwhile.
+  * @note   Use it instead of HAL_Delay() while ME3616 may talk, with
+  *         ME3616_RX_IDLE_MODE nothing is parsed otherwise.
+  * @param  Me3616: Instance of Me3616.
+  * @param  delay_ticks: ticks to wait.
+  * @retval None.
+  */
+void ME3616_Delay(Me3616_DeviceType * Me3616, uint32_t delay_ticks)
+{
+	uint32_t start_time = HAL_GetTick();
+
+	while((HAL_GetTick() - start_time) < delay_ticks)
+	{
+		ME3616_Rx_Process(Me3616);
+	}
+}
+
+static uint32_t AT_Report_Hash(const char * name, uint16_t len)
+{
+	uint32_t hash = AT_REPORT_HASH_INIT;
+
+	while(len--) hash = AT_REPORT_HASH_STEP(hash, *name++);
+	return hash;
+}
+
+/**
+  * @brief  Find the slot of name, or NULL.
+  * @param  name: Active Report name, not need '\0' ended.
+  * @param  len: length of name.
+  * @param  hash: AT_Report_Hash() of name.
+  * @retval registered or unregistered slot holding name.
+  */
+static AT_Report_Handler_t * AT_Report_Find(const char * name, uint16_t len, uint32_t hash)
+{
+	AT_Report_Handler_t * handler = NULL;
+
+	for(uint16_t i = 0; i < ME3616_URC_TABLE_SIZE; i++)
+	{
+		handler = &AT_Report_Table[(hash + i) & (ME3616_URC_TABLE_SIZE - 1)];
+
+		if(handler->Name == NULL) return NULL;
+		if((handler->Len == len) && !memcmp(handler->Name, name, len)) return handler;
+	}
+	return NULL;
+}
+
+/**
+  * @brief  Register AT_Report_Default[], once, before any use of the table.
+  */
+static void AT_Report_Table_Init(void)
+{
+	AT_Report_Table_Ready = true;
+
+	for(uint16_t i = 0; i < sizeof(AT_Report_Default) / sizeof(AT_Report_Default[0]); i++)
+	{
+		if(ME3616_Register_URC(AT_Report_Default[i].Name, AT_Report_Default[i].Callback) == false)
+		{
+			ME3616_ErrorHandler(__FILE__, __LINE__, "ME3616_URC_TABLE_SIZE too small.");
 		}
 	}
-	//Active Response or other unknow response.
-	else
+}
+
+/**
+  * @brief  Register or replace the handler of an Active Report.
+  * @param  name: part before ':' or '=', such as "+CFUN". MUST stay valid, string literal is best.
+  * @param  callback: called with the whole Active Report string.
+  * @retval true for success, false for table full.
+  */
+bool ME3616_Register_URC(const char * name, AT_Report_Callback_t callback)
+{
+	AT_Report_Handler_t * handler = NULL;
+	AT_Report_Handler_t * free_slot = NULL;
+	uint16_t len = 0;
+	uint32_t hash = 0;
+
+	if(name == NULL || callback == NULL) return false;
+	if(AT_Report_Table_Ready == false) AT_Report_Table_Init();
+
+	len = strlen(name);
+	hash = AT_Report_Hash(name, len);
+
+	//Replace a registered one, or revive an unregistered one.
+	handler = AT_Report_Find(name, len, hash);
+	if(handler != NULL)
 	{
-		//without state of AT_Send, but receive a string.
-		Active_Report(Me3616, pch, len);
+		handler->Callback = callback;
+		return true;
 	}
-	return false;
+
+	//Take first unregistered or empty slot on the probe sequence.
+	for(uint16_t i = 0; i < ME3616_URC_TABLE_SIZE; i++)
+	{
+		handler = &AT_Report_Table[(hash + i) & (ME3616_URC_TABLE_SIZE - 1)];
+
+		if((handler->Name == NULL) || (handler->Callback == NULL))
+		{
+			free_slot = handler;
+			break;
+		}
+	}
+	if(free_slot == NULL) return false;
+
+	free_slot->Name = name;
+	free_slot->Len = len;
+	free_slot->Callback = callback;
+	free_slot->Interleave = false;
+	return true;
 }
 
-void RxHandler(Me3616_DeviceType * Me3616, char *p_Buff, uint16_t len)
+/**
+  * @brief  Unregister the handler of an Active Report, it goes to UnknowActiveReport_Callback().
+  * @param  name: part before ':' or '=', such as "+CFUN".
+  * @retval true for success, false for not registered.
+  */
+bool ME3616_Unregister_URC(const char * name)
 {
-	Me3616->RxDataLastTime = HAL_GetTick();
-	
-	Set_Sys_State(Me3616, SYS_STATE_INCOMMING_NEW_AT_STRING);
-	Check_Response(Me3616, p_Buff, len);
-	Clear_Sys_State(Me3616, SYS_STATE_INCOMMING_NEW_AT_STRING);
-	Set_Sys_State (Me3616, SYS_STATE_READY);
+	AT_Report_Handler_t * handler = NULL;
+	uint16_t len = 0;
+
+	if(name == NULL) return false;
+	if(AT_Report_Table_Ready == false) AT_Report_Table_Init();
+
+	len = strlen(name);
+	handler = AT_Report_Find(name, len, AT_Report_Hash(name, len));
+	if((handler == NULL) || (handler->Callback == NULL)) return false;
+
+	//Keep Name, probe sequences of other names may pass this slot.
+	handler->Callback = NULL;
+	handler->Interleave = false;
+	return true;
 }
 
+/**
+  * @brief  Tell if a registered Active Report may come in between its own command
+  *         and OK. Such a command answers OK only, a line of the name meanwhile is
+  *         the report, as +EMQPUB while AT+EMQPUB waits OK.
+  * @param  name: part before ':' or '=', such as "+EMQPUB".
+  * @param  interleave: true for a report even while its own command waits OK.
+  * @retval true for success, false for not registered.
+  */
+bool ME3616_Set_URC_Interleave(const char * name, bool interleave)
+{
+	AT_Report_Handler_t * handler = NULL;
+	uint16_t len = 0;
 
-void ME3616_String_Receive(Me3616_DeviceType * Me3616)
+	if(name == NULL) return false;
+	if(AT_Report_Table_Ready == false) AT_Report_Table_Init();
+
+	len = strlen(name);
+	handler = AT_Report_Find(name, len, AT_Report_Hash(name, len));
+	if((handler == NULL) || (handler->Callback == NULL)) return false;
+
+	handler->Interleave = interleave;
+	return true;
+}
+
+/**
+  * @brief  First field of an Active Report, after ':' or '=' of its name.
+  * @param  pch: Active Report string, as a handler gets it.
+  * @param  len: length of pch.
+  * @retval first char of the fields, pch + len for none.
+  */
+const char * ME3616_Report_Fields(const char * pch, uint16_t len)
 {
-    //Load previous positions of string in RxBuff. for easier to porting to another system.
-    char * const pBuff = (char *)Me3616->RxBuffer;
-	char * const pBuffBorder = (char *)Me3616->RxBuffer + ME3616_RX_BUFFER_SIZE - 1;
-    char * pBegin = (char *)Me3616->RxBuffer + Me3616->RxStringBegin;
-    char * pEnd = (char *)Me3616->RxBuffer + Me3616->RxStringEnd;
-	char * const pVaildBuff = (char *)Me3616->RxVaildString;
-	uint16_t uLength = 0;
-	
-	//delay 30 ticks for waitting DMA transfer complete.
-    //if system have havey duty on DMA, you should consider adjust Rx buffer and this time of delay.
-	HAL_Delay(30);
-	
-	//Ensure pointers are legal.
-	if(pEnd > pBuff + ME3616_RX_BUFFER_SIZE - 1) 
+	const char * end = pch + len;
+
+	while((pch < end) && (*pch != ':') && (*pch != '=')) pch++;
+	return (pch < end) ? pch + 1 : end;
+}
+
+/**
+  * @brief  Parse the decimal field at *p of an Active Report, and the ',' after it.
+  * @note   Spaces around the field are skipped, a handler walks the fields in place.
+  * @param  p: first char of the field, moved to the next field.
+  * @param  end: end of the line.
+  * @param  value: field value.
+  * @retval true for a number, false leaves *p where it was.
+  */
+bool ME3616_Parse_Int(const char ** p, const char * end, int32_t * value)
+{
+	const char * q = *p;
+
+	while((q < end) && (*q == ' ')) q++;
+	if((q >= end) || (*q < '0') || (*q > '9')) return false;
+
+	*value = 0;
+	while((q < end) && (*q >= '0') && (*q <= '9')) *value = *value * 10 + (*q++ - '0');
+	while((q < end) && (*q == ' ')) q++;
+	if((q < end) && (*q == ',')) q++;
+
+	*p = q;
+	return true;
+}
+
+/**
+  * @brief  Find a counted line by its name, RxBuffer[uBegin..uEnd), may wrap the buffer end.
+  * @param  pBuff: RxBuffer.
+  * @param  uBegin: index of the first char of the name.
+  * @param  uEnd: index of ':' or '=' after the name.
+  * @retval AT_Counted_Table index + 1, 0xFF for none.
+  */
+static uint8_t AT_Counted_Lookup(const char * pBuff, uint16_t uBegin, uint16_t uEnd)
+{
+	uint16_t len = (uEnd + ME3616_RX_BUFFER_SIZE - uBegin) % ME3616_RX_BUFFER_SIZE;
+	uint16_t n = 0;
+
+	for(uint8_t i = 0; i < ME3616_COUNTED_TABLE_SIZE; i++)
 	{
-		ME3616_IF_ErrorHandler(__FILE__, __LINE__, "UART Rx Buffer pointer illegal.");	
+		if((AT_Counted_Table[i].Name == NULL) || (AT_Counted_Table[i].Len != len)) continue;
+
+		for(n = 0; n < len; n++)
+		{
+			if(AT_Counted_Table[i].Name[n] != pBuff[(uBegin + n) % ME3616_RX_BUFFER_SIZE]) break;
+		}
+		if(n == len) return i + 1;
 	}
+	return 0xFF;
+}
+
+/**
+  * @brief  Put a counted line in the table, or update it if there already.
+  * @param  name: part before ':' or '='. MUST stay valid, string literal is best.
+  * @param  field: index of the length field.
+  * @param  stream: callback of a streamed line, NULL for one handled whole.
+  * @retval true for success, false for table full.
+  */
+static bool AT_Counted_Add(const char * name, uint8_t field, AT_Stream_Callback_t stream)
+{
+	AT_Counted_t * free_slot = NULL;
+	uint16_t len = 0;
 
-	//Scan whole RxBuffer, in a definite length.
-	for(uint16_t i = 0; i < ME3616_RX_BUFFER_SIZE - 1; i++)
+	if(name == NULL) return false;
+	len = strlen(name);
+	if((len == 0) || (len > 0xFF)) return false;
+
+	for(uint8_t i = 0; i < ME3616_COUNTED_TABLE_SIZE; i++)
 	{
-        //Out of Buffer by one string, length of a single string > Buffer size.
-        if( i >= ME3616_RX_BUFFER_SIZE - 1) ME3616_IF_ErrorHandler(__FILE__, __LINE__, "UART Receive out of buffer.");
+		if(AT_Counted_Table[i].Name == NULL)
+		{
+			if(free_slot == NULL) free_slot = &AT_Counted_Table[i];
+		}
+		else if((AT_Counted_Table[i].Len == len) && !memcmp(AT_Counted_Table[i].Name, name, len))
+		{
+			AT_Counted_Table[i].Field = field;
+			AT_Counted_Table[i].Stream = stream;
+			return true;
+		}
+	}
+	if(free_slot == NULL) return false;
+
+	free_slot->Field = field;
+	free_slot->Stream = stream;
+	free_slot->Len = len;
+	free_slot->Name = name;
+	return true;
+}
+
+/**
+  * @brief  Register a line carrying raw bytes after a length field, such as the
+  *         binary "+ESONMI=<socket>,<length>,<data>" of AT+ESOSETRPT.
+  * @note   The framer takes <length> bytes after the length field's comma as they
+  *         are, CR / LF among them included, then looks for the CR LF ending the
+  *         line. A response field of type AT_FIELD_COUNTED reads them.
+  * @param  name: part before ':' or '=', such as "+ESONMI". MUST stay valid, string literal is best.
+  * @param  field: index of the length field, 0 for the first one.
+  * @retval true for success, false for table full.
+  */
+bool ME3616_Register_Counted(const char * name, uint8_t field)
+{
+	return AT_Counted_Add(name, field, NULL);
+}
+
+/**
+  * @brief  Register a line carrying raw bytes after a length field, handed to
+  *         callback as it comes, such as "+EHTTPNMIC: ...,<len>,<content>" of a
+  *         body far longer than RxBuffer.
+  * @note   callback gets the head up to the length field, then the raw bytes in
+  *         pieces as DMA writes them, then the end. Nothing of the line is kept,
+  *         <length> may be up to 65535. callback runs where Active Reports are
+  *         handled, it must keep up with UART and MUST NOT send AT commands.
+  *         ME3616_Unregister_Counted() takes it off.
+  * @param  name: part before ':' or '=', such as "+EHTTPNMIC". MUST stay valid, string literal is best.
+  * @param  field: index of the length field, 0 for the first one.
+  * @param  callback: gets the line piece by piece.
+  * @retval true for success, false for table full or NULL callback.
+  */
+bool ME3616_Register_Stream(const char * name, uint8_t field, AT_Stream_Callback_t callback)
+{
+	if(callback == NULL) return false;
+	return AT_Counted_Add(name, field, callback);
+}
+
+/**
+  * @brief  Unregister a counted line, it is framed by CR LF again.
+  * @param  name: part before ':' or '=', such as "+ESONMI".
+  * @retval true for success, false for not registered.
+  */
+bool ME3616_Unregister_Counted(const char * name)
+{
+	uint16_t len = 0;
+
+	if(name == NULL) return false;
+	len = strlen(name);
 
-        //pick a char from RxBuff
-		switch( *pEnd )
+	for(uint8_t i = 0; i < ME3616_COUNTED_TABLE_SIZE; i++)
+	{
+		if((AT_Counted_Table[i].Name != NULL) && (AT_Counted_Table[i].Len == len) && !memcmp(AT_Counted_Table[i].Name, name, len))
 		{
-			//the end of the string found.
-			case '\n':
-			{
-				//judge the string whether segmented.
-				if( pBegin <= pEnd)
-				{ 
-					//get the length of string.
-                    uLength =  pEnd - pBegin + 1;
-                    
-					//Copy and Send string to RxVaildBuff, directly.
-					memcpy(pVaildBuff, pBegin, uLength);
-					
-                    //add '\0' to end the string. overwrite the bottom CR LF
-                    memset(pVaildBuff  + uLength - 2, 0, 2);
-					
-					//Clear this string in RxBuff.
-					memset(pBegin, 0,  uLength);
-				}
-				//String is segmented.
-				else
-				{
-					//copy two parts to RxVaildString
-					//from RxStringBegin to buffer bottom
-					strcpy(pVaildBuff, pBegin);
-					
-					//clear this string in RxBuffer.
-					memset(pBegin, 0,  pBuffBorder - pBegin + 1);
-					
-					//copy from buffer header to RxStringEnd
-					memcpy(pVaildBuff + ( pBuffBorder - pBegin + 1 ), pBuff, pEnd - pBuff + 1);
-
-					//add '\0' to end the string. overwrite the bottom CR LF
-					memset(pVaildBuff + ( pBuffBorder - pBegin) + (pEnd - pBuff), 0, 2);
-
-					//clear
- 					memset(pBuff, 0, pEnd - pBuff + 1); 
-				}
+			AT_Counted_Table[i].Name = NULL;
+			return true;
+		}
+	}
+	return false;
+}
 
-				//get the length of Vailded String.
-                uLength = strlen(pVaildBuff);
-
-				//if Vailded String has only beginning of CR LF, ignore this string. and prepare next string.
-                if( *pVaildBuff == '\0') 
-                {
-                    if( pEnd < pBuffBorder)
-					{
-				        pEnd++;
-						pBegin = pEnd;
-					}
-					else
-					{
-						pEnd = pBuff;
-						pBegin = pBuff;
-					}
-                    break;
-                }
-                else
-                {
-                    //Send the vailded string to RxHandler
-                    RxHandler(Me3616, pVaildBuff, uLength);
-					
-                    //Prepare to receive next string 
-					if( pEnd < pBuffBorder)
-					{
-						pEnd++;
-						pBegin = pEnd;
-					}
-					else
-					{
-						pEnd = pBuff;
-						pBegin = pBuff;
-					}
-                    break;
-                }
-			}
+/**
+  * @brief  Find the slot of an Active Report by its name, the part before ':' or '='.
+  * @note   Name is hashed while it is scanned, then one compare.
+  * @param  pch: Active Report string.
+  * @param  len: length of pch.
+  * @param  name_len: length of the name.
+  * @retval registered or unregistered slot holding the name, or NULL.
+  */
+static AT_Report_Handler_t * AT_Report_Lookup(const char * pch, uint16_t len, uint16_t * name_len)
+{
+	uint32_t hash = AT_REPORT_HASH_INIT;
+	uint16_t n = 0;
 
-		//RxBuff empty, store position.
-        case '\0':
-			{
-                pBegin = pEnd;
+	if(AT_Report_Table_Ready == false) AT_Report_Table_Init();
 
-				Me3616->RxStringBegin = pBegin - pBuff;
-				Me3616->RxStringEnd = pEnd - pBuff;
-				return;
-			}
-			
-			default:
-			{
-                //point to next char
-				if(pEnd < pBuffBorder)
-				{
-                    pEnd++;
-				}
-				else
-				{
-                    pEnd = pBuff;
-				}
-			}				
-		}  
+	while((n < len) && (pch[n] != ':') && (pch[n] != '='))
+	{
+		hash = AT_REPORT_HASH_STEP(hash, pch[n]);
+		n++;
 	}
+
+	*name_len = n;
+	return AT_Report_Find(pch, n, hash);
 }
 
+/**
+  * @brief  Dispatch an Active Report by its name, the part before ':' or '='.
+  * @note   Order of registration does not matter, "+M2MCLI" never takes "+M2MCLIRECV".
+  * @param  Me3616: Instance of Me3616.
+  * @param  pch: Active Report string.
+  * @param  len: length of pch.
+  * @retval None.
+  */
 void Active_Report(Me3616_DeviceType * Me3616, char *pch, uint16_t len)
 {
-	const char  ** String_P = NULL;
-	uint8_t Entry_num = 0;
-	if(Me3616 == NULL || pch == NULL || *pch == NULL) return;
+	AT_Report_Handler_t * handler = NULL;
+	uint16_t name_len = 0;
+	if(Me3616 == NULL || pch == NULL || *pch == '\0') return;
+
+	handler = AT_Report_Lookup(pch, len, &name_len);
+	if((handler != NULL) && (handler->Callback != NULL))
+	{
+		handler->Callback(Me3616, pch, len);
+	}
+	else
+	{
+		UnknowActiveReport_Callback(Me3616, pch, len);
+	}
+}
+
+static const char * const Boot_Stage_String[] =
+{
+	"POWER", "RESET", "MATREADY", "CPIN", "CFUN", "IP", "IPV6", "AT"
+};
+
+//Deadline of each waiting stage, in ticks.
+static const uint32_t Boot_Stage_Timeout[] =
+{
+	ME3616_BOOT_POWER_PULSE, ME3616_BOOT_RESET_PULSE, ME3616_BOOT_MATREADY_TIMOUT, ME3616_BOOT_CPIN_TIMOUT,
+	ME3616_BOOT_CFUN_TIMOUT, ME3616_BOOT_IP_TIMOUT, ME3616_BOOT_IPV6_WAIT, ME3616_BOOT_AT_TIMOUT
+};
+
+//A stage is passed by its own state, or state of a later stage. A missed Active Report does not stall boot.
+static const uint32_t Boot_Stage_Mask[] =
+{
+	0,
+	0,
+	SYS_STATE_MATREADY | SYS_STATE_CPIN | SYS_STATE_CFUN | SYS_STATE_IPV4 | SYS_STATE_IPV6,
+	SYS_STATE_CPIN | SYS_STATE_CFUN | SYS_STATE_IPV4 | SYS_STATE_IPV6,
+	SYS_STATE_CFUN | SYS_STATE_IPV4 | SYS_STATE_IPV6,
+	SYS_STATE_IPV4 | SYS_STATE_IPV6,
+	SYS_STATE_IPV6,
+	0
+};
+
+/**
+  * @brief  Record time spent in current boot stage, and enter next one.
+  * @param  Me3616: Instance of Me3616.
+  * @param  next: next stage.
+  * @retval None.
+  */
+static void Boot_Stage_Next(Me3616_DeviceType * Me3616, Boot_Stage_t next)
+{
+	uint32_t now = HAL_GetTick();
+
+	Me3616->Boot_StageTime[Me3616->Boot_Stage] = now - Me3616->Boot_StageStart;
+	DBG_Printf(DBG_DIR_AT, "Boot %s %s in %lu ms.", Boot_Stage_String[Me3616->Boot_Stage],
+	           (next == BOOT_STAGE_FAIL) ? "timeout" : "done", (unsigned long)Me3616->Boot_StageTime[Me3616->Boot_Stage]);
+
+	Me3616->Boot_Stage = next;
+	Me3616->Boot_StageStart = now;
+}
 
-	for(String_P = AT_Report_String; *String_P != NULL;	 String_P++, Entry_num++)
+static void Boot_AT_Done(Me3616_DeviceType * Me3616, AT_Request_t * request, AT_State_t result, const AT_Response_t * response)
+{
+	UNUSED(request);
+	UNUSED(response);
+	Me3616->Boot_AT_Result = result;
+}
+
+/**
+  * @brief  Step the boot state machine, never blocks.
+  * @note   Stage conditions are set by MATREADY_Callback(), CPIN_Callback(),
+  *         CFUN_Callback() and IP_Callback(). Each stage fails on its own deadline.
+  * @param  Me3616: Instance of Me3616.
+  * @retval None.
+  */
+static void Boot_Poll(Me3616_DeviceType * Me3616)
+{
+	Boot_Stage_t stage = Me3616->Boot_Stage;
+	uint32_t elapsed = 0;
+
+	ME3616_Poll(Me3616);
+	elapsed = HAL_GetTick() - Me3616->Boot_StageStart;
+
+	switch(stage)
 	{
-		if(!strncmp(pch, *String_P, strlen(*String_P) ))
+		case BOOT_STAGE_POWER:
+		{
+			if(elapsed < ME3616_BOOT_POWER_PULSE) break;
+			ME3616_Power_Key(Me3616, false);
+			ME3616_Reset_Key(Me3616, true);
+			Boot_Stage_Next(Me3616, BOOT_STAGE_RESET);
+			break;
+		}
+		case BOOT_STAGE_RESET:
+		{
+			if(elapsed < ME3616_BOOT_RESET_PULSE) break;
+			ME3616_Reset_Key(Me3616, false);
+			Boot_Stage_Next(Me3616, BOOT_STAGE_MATREADY);
+			break;
+		}
+		case BOOT_STAGE_MATREADY:
+		case BOOT_STAGE_CPIN:
+		case BOOT_STAGE_CFUN:
+		case BOOT_STAGE_IP:
 		{
-			//String Match
-			AT_Report_Entry[Entry_num](Me3616, pch, len);
-			return;
+			if(Get_Sys_State(Me3616, (SYS_State_t)Boot_Stage_Mask[stage]) == true)
+			{
+				//IPv6 assigned already, no need to wait it
+				if((stage == BOOT_STAGE_IP) && (Get_Sys_State(Me3616, SYS_STATE_IPV6) == true)) Boot_Stage_Next(Me3616, BOOT_STAGE_AT);
+				else Boot_Stage_Next(Me3616, (Boot_Stage_t)(stage + 1));
+			}
+			else if(elapsed > Boot_Stage_Timeout[stage])
+			{
+				Boot_Stage_Next(Me3616, BOOT_STAGE_FAIL);
+			}
+			break;
+		}
+		case BOOT_STAGE_IPV6:
+		{
+			//Without IPv6, go on with IPv4.
+			if((Get_Sys_State(Me3616, SYS_STATE_IPV6) == true) || (elapsed > ME3616_BOOT_IPV6_WAIT))
+			{
+				Boot_Stage_Next(Me3616, BOOT_STAGE_AT);
+			}
+			break;
+		}
+		case BOOT_STAGE_AT:
+		{
+			//ME3616 answers AT, ready to send a new command.
+			if(Me3616->Boot_AT_Result == AT_STATE_ATOK)
+			{
+				Boot_Stage_Next(Me3616, BOOT_STAGE_DONE);
+			}
+			else if(elapsed > ME3616_BOOT_AT_TIMOUT)
+			{
+				Boot_Stage_Next(Me3616, BOOT_STAGE_FAIL);
+			}
+			else if(Me3616->Boot_AT_Result != AT_STATE_SEND)
+			{
+				//Not sent yet, or ERROR / timeout, try again.
+				if(ME3616_Queue_AT_Command(Me3616, AT_CMD_NONE, AT_BASE, NULL, 500, Boot_AT_Done, NULL) == true)
+				{
+					Me3616->Boot_AT_Result = AT_STATE_SEND;
+				}
+			}
+			break;
+		}
+		default:
+		{
+			break;
 		}
 	}
-	if(*String_P == NULL)UnknowActiveReport_Callback(Me3616, pch, len);
-
-	return;
 }
 
 bool ME3616_Init(Me3616_DeviceType * Me3616, UART_HandleTypeDef * AT_huart, DMA_HandleTypeDef * DmaTx, DMA_HandleTypeDef * DmaRx)
 {
-    uint32_t start_time = 0;
 
 	__set_PRIMASK(1);
 	
@@ -776,9 +2651,19 @@ bool ME3616_Init(Me3616_DeviceType * Me3616, UART_HandleTypeDef * AT_huart, DMA_
 	//Init Buffer and pointer
 	Me3616->RxStringBegin = 0;
 	Me3616->RxStringEnd = 0;
+	Me3616->RxWriteIndex = 0;
+	Me3616->RxReceived = 0;
+	Me3616->RxProcessed = 0;
+	Me3616->RxProcessing = false;
+	Me3616->RxHighWater = 0;
+	Me3616->RxOverruns = 0;
+	Me3616->RxResync = false;
+	String_Counted_Reset(Me3616);
+	Me3616->AT_QueueHead = 0;
+	Me3616->AT_QueueCount = 0;
 		
 	memset(Me3616->RxVaildString, 0, ME3616_RX_BUFFER_SIZE);
-	memset(Me3616->RxBuffer, 0, ME3616_RX_BUFFER_SIZE);
+	memset(Me3616->RxBuffer, 0, ME3616_RX_BUFFER_SIZE + 1);
 	memset(Me3616->TxBuffer, 0, ME3616_TX_BUFFER_SIZE);
 
 	Me3616->UartDevice = AT_huart;
@@ -787,7 +2672,11 @@ bool ME3616_Init(Me3616_DeviceType * Me3616, UART_HandleTypeDef * AT_huart, DMA_
     
 	__set_PRIMASK(0);
     
+	#ifdef ME3616_RX_IDLE_MODE
+	Init_UART_Idle(Me3616->UartDevice);
+	#else
     Init_UART_CM(Me3616->UartDevice);
+	#endif
 
 	#ifdef DEBUG_ME3616
 	Init_UART_CM(&DBG_UART);
@@ -798,83 +2687,40 @@ bool ME3616_Init(Me3616_DeviceType * Me3616, UART_HandleTypeDef * AT_huart, DMA_
 	
 	
 
-	ME3616_PowerOn(Me3616, 1000);
-    HAL_Delay(1000);
-	ME3616_Reset(Me3616, 1000);
-
+	//Boot by stages, each one ends as soon as its condition is met.
+	memset(Me3616->Boot_StageTime, 0, sizeof(Me3616->Boot_StageTime));
+	Me3616->Boot_AT_Result = AT_STATE_NONE;
+	Me3616->Boot_Stage = BOOT_STAGE_POWER;
+	Me3616->Boot_StageStart = HAL_GetTick();
+	ME3616_Power_Key(Me3616, true);
 
+	while((Me3616->Boot_Stage != BOOT_STAGE_DONE) && (Me3616->Boot_Stage != BOOT_STAGE_FAIL))
+	{
+		Boot_Poll(Me3616);
+	}
 
-	
-    while( 1 )
-    { 
-		//wait for IPv6 address assigned
-		if(Get_Sys_State(Me3616, SYS_STATE_IPV6) == true) 
-		{
-			//wait ME3616 Module fully Idle, ready to send a new command.
-			HAL_Delay(5000);
-			Set_Sys_State (Me3616, SYS_STATE_READY);
-			return true;
-		}
-		else if((HAL_GetTick() - start_time) > ME3616_BOOT_TIMOUT)
-		{
-			//Some SIM Card does not support IPv6
-			if(Get_Sys_State(Me3616, SYS_STATE_IPV4) == true)
-			{
-				Set_Sys_State(Me3616, SYS_STATE_READY);
-				return true;
-			}
+	if(Me3616->Boot_Stage == BOOT_STAGE_FAIL)
+	{
+		Set_Sys_State(Me3616, SYS_STATE_ERR);
+		return false;
+	}
 
-			Set_Sys_State(Me3616, SYS_STATE_ERR);
-			//Timeout without IPv4 and IPv6 address.
-			return false;
-		}
-    HAL_Delay(2000);        
-    }
+	Set_Sys_State (Me3616, SYS_STATE_READY);
+	return true;
 }
 
 void Hex2Str(char *sDest, const char *sSrc, int nSrcLen )  
 {  
-    int  i;  
-    char szTmp[3];  
-  
-    for( i = 0; i < nSrcLen; i++ )  
-    {
-		sprintf( szTmp, "%02X", (unsigned char) sSrc[i] );  
-        memcpy( &sDest[i * 2], szTmp, 2 );  
-    }  
-    return ;  
+	Hex_Encode(sDest, nSrcLen * 2, (const uint8_t *)sSrc, nSrcLen);
 }
 
 //ʮַתΪֽ  
 bool HexStrToByte(unsigned char* dest, const char* source, int sourceLen)  
 {
-    short i;
-    unsigned char highByte, lowByte;
-	
-		if((sourceLen % 2) != 0)
-			return false;
-
-    for (i = 0; i < sourceLen; i += 2)
-    {
-        highByte = toupper(source[i]);
-        lowByte  = toupper(source[i + 1]);
-			
-		if((lowByte < 0x30 && lowByte > 0x46) || (highByte < 0x30 && highByte > 0x46))
-			return false;
-
-        if (highByte > 0x39)
-            highByte -= 0x37;
-        else
-            highByte -= 0x30;
+	if((sourceLen % 2) != 0)
+		return false;
 
-        if (lowByte > 0x39)
-            lowByte -= 0x37;
-        else
-            lowByte -= 0x30;
-  
-        dest[i / 2] = (highByte << 4) | lowByte;
-    }  
-    return true;
+	return (Hex_Decode(dest, sourceLen / 2, source, sourceLen) == sourceLen / 2);
 }
 
 
@@ -898,8 +2744,6 @@ __weak void Command_Response(Me3616_DeviceType * Me3616, char * pch, uint16_t le
 }
 __weak void MATREADY_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 {
-	char str_state[12] = {0};
-			
 	DBG_Print("MATREADY Below:",  DBG_DIR_AT);
 	DBG_Print(pch, DBG_DIR_RX);
 
@@ -911,9 +2755,7 @@ __weak void MATREADY_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t l
 	{
 		Clear_Sys_State(Me3616, SYS_STATE_MATREADY);
 	}
-	DBG_Print("Sys_State Changed. New state is:", DBG_DIR_AT);
-	State_Hex2Str(str_state, Me3616->Sys_State);
-	DBG_Print(str_state, DBG_DIR_AT);
+	DBG_Printf(DBG_DIR_AT, "Sys_State Changed. New state is: %lx", (unsigned long)Me3616->Sys_State);
 }
 __weak void CME_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 {
@@ -923,8 +2765,6 @@ __weak void CME_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 }
 __weak void CFUN_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 {
-	char str_state[12] = {0};
-		
 	DBG_Print("CFUN Below:",  DBG_DIR_AT);
 	DBG_Print(pch, DBG_DIR_RX);
 
@@ -936,14 +2776,10 @@ __weak void CFUN_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 	{
 		Clear_Sys_State(Me3616, SYS_STATE_CFUN);
 	}
-	DBG_Print("Sys_State Changed. New state is:",  DBG_DIR_AT);
-	State_Hex2Str(str_state, Me3616->Sys_State);
-	DBG_Print(str_state, DBG_DIR_AT);
+	DBG_Printf(DBG_DIR_AT, "Sys_State Changed. New state is: %lx", (unsigned long)Me3616->Sys_State);
 }
 __weak void CPIN_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 {
-	char str_state[12] = {0};
-	
 	DBG_Print("CPIN Below:",  DBG_DIR_AT);
 	DBG_Print(pch, DBG_DIR_RX);
 	
@@ -956,14 +2792,10 @@ __weak void CPIN_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 		//CPIN not in Ready state, check Manual.
 		Clear_Sys_State(Me3616, SYS_STATE_CPIN);
 	}
-	DBG_Print("Sys_State Changed. New state is:", DBG_DIR_AT);
-	State_Hex2Str(str_state, Me3616->Sys_State);
-	DBG_Print(str_state, DBG_DIR_AT);
+	DBG_Printf(DBG_DIR_AT, "Sys_State Changed. New state is: %lx", (unsigned long)Me3616->Sys_State);
 }
 __weak void IP_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 {	
-	char str_state[12] = {0};
-	
 	DBG_Print("IP Below:",  DBG_DIR_AT);
 	DBG_Print(pch, DBG_DIR_RX);
 	
@@ -987,9 +2819,7 @@ __weak void IP_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 		Clear_Sys_State(Me3616, SYS_STATE_IPV4);
 		Clear_Sys_State(Me3616, SYS_STATE_IPV6);
 	}
-	DBG_Print("Sys_State Changed. New state is:",  DBG_DIR_AT);
-	State_Hex2Str(str_state, Me3616->Sys_State);
-	DBG_Print(str_state, DBG_DIR_AT);
+	DBG_Printf(DBG_DIR_AT, "Sys_State Changed. New state is: %lx", (unsigned long)Me3616->Sys_State);
 }
 __weak void ESONMI_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 {
@@ -1016,9 +2846,23 @@ __weak void ECOAPNMI_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t l
 	DBG_Print("ECOAPNMI Below:",  DBG_DIR_AT);
 	DBG_Print(pch, DBG_DIR_RX);
 }
+__weak void EHTTPNMIH_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	DBG_Print("EHTTPNMIH Below:",  DBG_DIR_AT);
+	DBG_Print(pch, DBG_DIR_RX);
+}
+__weak void EHTTPNMIC_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	DBG_Print("EHTTPNMIC Below:",  DBG_DIR_AT);
+	DBG_Print(pch, DBG_DIR_RX);
+}
+__weak void EHTTPERR_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	DBG_Print("EHTTPERR Below:",  DBG_DIR_AT);
+	DBG_Print(pch, DBG_DIR_RX);
+}
 __weak void M2MCLI_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
 {
-	char str_state[12] = {0};
 	DBG_Print("M2MCLI Below:",  DBG_DIR_AT);
 	DBG_Print(pch, DBG_DIR_RX);
 
@@ -1028,34 +2872,26 @@ __weak void M2MCLI_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len
 		Clear_Sys_State(Me3616, SYS_STATE_LWM_REGISTER_SUCCESS);
 		Clear_Sys_State(Me3616, SYS_STATE_LWM_OBSERVE_SUCCESS);
 		
-		DBG_Print("Sys_State Changed. New state is:",  DBG_DIR_AT);
-		State_Hex2Str(str_state, Me3616->Sys_State);
-		DBG_Print(str_state,  DBG_DIR_AT);
+		DBG_Printf(DBG_DIR_AT, "Sys_State Changed. New state is: %lx", (unsigned long)Me3616->Sys_State);
 			
 	}
 	else if(strstr(pch, "register success") != NULL)
 	{
 		Set_Sys_State(Me3616, SYS_STATE_LWM_REGISTER_SUCCESS);
 		
-		DBG_Print("Sys_State Changed. New state is:",  DBG_DIR_AT);
-		State_Hex2Str(str_state, Me3616->Sys_State);
-		DBG_Print(str_state,  DBG_DIR_AT);	
+		DBG_Printf(DBG_DIR_AT, "Sys_State Changed. New state is: %lx", (unsigned long)Me3616->Sys_State);
 	}
 	else if(strstr(pch, "observe success") != NULL)
 	{
 		Set_Sys_State(Me3616, SYS_STATE_LWM_OBSERVE_SUCCESS);
 		
-		DBG_Print("Sys_State Changed. New state is:",  DBG_DIR_AT);
-		State_Hex2Str(str_state, Me3616->Sys_State);
-		DBG_Print(str_state,  DBG_DIR_AT);
+		DBG_Printf(DBG_DIR_AT, "Sys_State Changed. New state is: %lx", (unsigned long)Me3616->Sys_State);
 	}
 	else if (strstr(pch, "notify success") != NULL)
 	{
 		Set_Sys_State(Me3616, SYS_STATE_LWM_NOTIFY_SUCCESS);
 				
-		DBG_Print("Sys_State Changed. New state is:",  DBG_DIR_AT);
-		State_Hex2Str(str_state, Me3616->Sys_State);
-		DBG_Print(str_state,  DBG_DIR_AT);
+		DBG_Printf(DBG_DIR_AT, "Sys_State Changed. New state is: %lx", (unsigned long)Me3616->Sys_State);
 	}
 }
 __weak void M2MCLIRECV_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
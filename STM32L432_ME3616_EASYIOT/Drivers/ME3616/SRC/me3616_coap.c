@@ -0,0 +1,811 @@
+/**
+  ******************************************************************************
+  * @file    me3616_coap.c
+  * @author  Simon Luk (simonluk@unidevelop.net)
+  * @brief   CoAP client of ME3616, over AT+ECOAPNEW / AT+ECOAPSEND, PDUs built here,
+  *          confirmable requests tracked and block-wise transfer
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2018 Simon Luk </center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of Simon Luk nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+
+/*
+  One client, CoAP over UDP. ME3616 only carries the datagrams, AT+ECOAPSEND takes
+  a whole PDU as hex and +ECOAPNMI brings one, the rest of CoAP is done here:
+  - PDUs: header, token and options are built by ME_COAP_PDU_xxx() into Pdu[] of
+    the exchange, where it stays for retransmission.
+  - confirmable requests: every request is CON and has a slot of Exchange[]. The
+    token is the slot index and a count, the low bits of the Message ID are the
+    slot index, so an ACK / RST is matched by Message ID and a separate response
+    by token, neither by a search. Not answered, a PDU is sent again after
+    ACK_TIMEOUT, doubled each time, up to MAX_RETRANSMIT times (RFC 7252).
+  - block-wise transfer (RFC 7959): a payload longer than one PDU takes goes in
+    Block1 blocks, each after 2.31 Continue of the one before. A response with
+    Block2 is asked block by block, each one goes to the handler as it comes.
+    Blocks of ME3616_COAP_BLOCK2_SZX are asked, so +ECOAPNMI fits RxBuffer.
+  Active Report handlers only update state and call the request handlers. AT
+  commands are sent from thread context, by me_coap_request() and ME_COAP_Poll(),
+  the empty ACKs owed for CON responses of the server too.
+
+  AT+ECOAPNEW="<server>",<port>,<cid>    +ECOAPNEW: <coap_id>
+  AT+ECOAPSEND=<coap_id>,<len>,<hex PDU>
+  +ECOAPNMI: <coap_id>,<len>,<hex PDU>
+  AT+ECOAPDEL=<coap_id>
+  <len> counts bytes.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "me3616.h"
+#include "me3616_hex.h"
+#include "me3616_coap.h"
+
+#if (ME3616_COAP_CON_MAX & (ME3616_COAP_CON_MAX - 1)) != 0
+#error "ME3616_COAP_CON_MAX must be a power of 2."
+#endif
+
+#if ME3616_COAP_BLOCK2_SZX > 6
+#error "ME3616_COAP_BLOCK2_SZX must be 0 to 6."
+#endif
+
+#define COAP_VERSION                    1
+#define COAP_PAYLOAD_MARKER             0xFF
+
+//AT+ECOAPNEW <cid>
+#define COAP_CID                        1
+
+//Block option value, and SZX of 1024 bytes, the largest
+#define COAP_BLOCK(num, more, szx)      (((uint32_t)(num) << 4) | ((more) ? 0x08 : 0x00) | (szx))
+#define COAP_SZX_MAX                    6
+#define COAP_SZX_NONE                   0xFF
+
+//Block1 / Block2 option at its longest, 2 bytes of header and 3 of value
+#define COAP_BLOCK_OPTION_MAX           5
+
+static ME_COAP_t COAP;
+static bool COAP_Ready = false;
+
+static void COAP_ECOAPNMI_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len);
+
+static void COAP_Init(void)
+{
+	memset(&COAP, 0, sizeof(COAP));
+	COAP.Id = -1;
+
+	if(ME3616_Register_URC("+ECOAPNMI", COAP_ECOAPNMI_Report) == false)
+	{
+		ME3616_ErrorHandler(__FILE__, __LINE__, "ME3616_URC_TABLE_SIZE too small.");
+	}
+	COAP_Ready = true;
+}
+
+/**
+  * @brief  Start a PDU in buf, header and token.
+  * @param  pdu: PDU to build.
+  * @param  buf: bytes of the PDU.
+  * @param  size: size of buf.
+  * @param  type: ME_COAP_Type_t.
+  * @param  code: ME_COAP_GET and so on, ME_COAP_EMPTY for an empty ACK / RST.
+  * @param  message_id: Message ID.
+  * @param  token: token bytes, NULL for none.
+  * @param  token_len: 0 to 8.
+  * @retval None.
+  */
+void ME_COAP_PDU_Begin(ME_COAP_PDU_t * pdu, uint8_t * buf, uint16_t size, uint8_t type, uint8_t code,
+                       uint16_t message_id, const uint8_t * token, uint8_t token_len)
+{
+	pdu->Buf = buf;
+	pdu->Size = size;
+	pdu->Len = 0;
+	pdu->Option = 0;
+	pdu->Overflow = (token_len > 8) || (size < 4 + token_len);
+	if(pdu->Overflow == true) return;
+
+	buf[0] = (COAP_VERSION << 6) | ((type & 0x03) << 4) | token_len;
+	buf[1] = code;
+	buf[2] = message_id >> 8;
+	buf[3] = message_id & 0xFF;
+	if(token_len != 0) memcpy(buf + 4, token, token_len);
+	pdu->Len = 4 + token_len;
+}
+
+/**
+  * @brief  Nibble of an option delta or length, its extended bytes into ext.
+  */
+static uint8_t COAP_Nibble(uint16_t value, uint8_t * ext, uint8_t * ext_len)
+{
+	if(value < 13)
+	{
+		*ext_len = 0;
+		return value;
+	}
+	if(value < 269)
+	{
+		ext[0] = value - 13;
+		*ext_len = 1;
+		return 13;
+	}
+	ext[0] = (value - 269) >> 8;
+	ext[1] = (value - 269) & 0xFF;
+	*ext_len = 2;
+	return 14;
+}
+
+/**
+  * @brief  Append an option, delta encoded from the one before.
+  * @param  pdu: PDU to build.
+  * @param  number: option number, not less than the one before.
+  * @param  value: option value, NULL for none.
+  * @param  len: bytes of value.
+  * @retval true for appended, false for out of order or no room, the PDU is no good then.
+  */
+bool ME_COAP_PDU_Option(ME_COAP_PDU_t * pdu, uint16_t number, const void * value, uint16_t len)
+{
+	uint8_t ext[4];
+	uint8_t delta_len = 0;
+	uint8_t len_len = 0;
+	uint8_t head = 0;
+
+	if((pdu->Overflow == true) || (number < pdu->Option))
+	{
+		pdu->Overflow = true;
+		return false;
+	}
+
+	head = COAP_Nibble(number - pdu->Option, ext, &delta_len) << 4;
+	head |= COAP_Nibble(len, ext + delta_len, &len_len);
+	if(pdu->Len + 1 + delta_len + len_len + len > pdu->Size)
+	{
+		pdu->Overflow = true;
+		return false;
+	}
+
+	pdu->Buf[pdu->Len++] = head;
+	memcpy(pdu->Buf + pdu->Len, ext, delta_len + len_len);
+	pdu->Len += delta_len + len_len;
+	if(len != 0) memcpy(pdu->Buf + pdu->Len, value, len);
+	pdu->Len += len;
+	pdu->Option = number;
+	return true;
+}
+
+/**
+  * @brief  Append an option of uint value, in as few bytes as it takes, none for 0.
+  */
+bool ME_COAP_PDU_Option_Uint(ME_COAP_PDU_t * pdu, uint16_t number, uint32_t value)
+{
+	uint8_t bytes[4];
+	uint8_t len = 0;
+
+	for(int8_t shift = 24; shift >= 0; shift -= 8)
+	{
+		if((len != 0) || (((value >> shift) & 0xFF) != 0)) bytes[len++] = (value >> shift) & 0xFF;
+	}
+	return ME_COAP_PDU_Option(pdu, number, bytes, len);
+}
+
+/**
+  * @brief  Append the payload marker and payload, after the last option.
+  * @retval true for appended, false for no room, the PDU is no good then.
+  */
+bool ME_COAP_PDU_Payload(ME_COAP_PDU_t * pdu, const void * data, uint16_t len)
+{
+	if(pdu->Overflow == true) return false;
+	if(len == 0) return true;
+
+	if(pdu->Len + 1 + len > pdu->Size)
+	{
+		pdu->Overflow = true;
+		return false;
+	}
+	pdu->Buf[pdu->Len++] = COAP_PAYLOAD_MARKER;
+	memcpy(pdu->Buf + pdu->Len, data, len);
+	pdu->Len += len;
+	return true;
+}
+
+/**
+  * @brief  Option at *p, number is the one before and is updated.
+  * @retval false for a malformed option.
+  */
+static bool COAP_Option_Next(const uint8_t ** p, const uint8_t * end, uint16_t * number, const uint8_t ** value, uint16_t * len)
+{
+	const uint8_t * q = *p;
+	uint32_t field[2];
+
+	field[0] = *q >> 4;
+	field[1] = *q & 0x0F;
+	q++;
+
+	//Delta, then length
+	for(uint8_t i = 0; i < 2; i++)
+	{
+		if(field[i] == 13)
+		{
+			if(q >= end) return false;
+			field[i] = 13 + *q++;
+		}
+		else if(field[i] == 14)
+		{
+			if(end - q < 2) return false;
+			field[i] = 269 + ((q[0] << 8) | q[1]);
+			q += 2;
+		}
+		else if(field[i] == 15)
+		{
+			return false;
+		}
+	}
+	if((uint32_t)(end - q) < field[1]) return false;
+
+	*number += field[0];
+	*value = q;
+	*len = field[1];
+	*p = q + field[1];
+	return true;
+}
+
+/**
+  * @brief  Parse a PDU, nothing is copied.
+  * @param  message: set to point into data.
+  * @param  data: bytes of the PDU.
+  * @param  len: bytes of data.
+  * @retval true for a well formed PDU.
+  */
+bool ME_COAP_Parse(ME_COAP_Message_t * message, const uint8_t * data, uint16_t len)
+{
+	const uint8_t * end = data + len;
+	const uint8_t * p = NULL;
+	const uint8_t * value = NULL;
+	uint16_t number = 0;
+	uint16_t value_len = 0;
+
+	memset(message, 0, sizeof(ME_COAP_Message_t));
+	if((len < 4) || ((data[0] >> 6) != COAP_VERSION) || ((data[0] & 0x0F) > 8)) return false;
+
+	message->Type = (data[0] >> 4) & 0x03;
+	message->TokenLen = data[0] & 0x0F;
+	message->Code = data[1];
+	message->MessageId = (data[2] << 8) | data[3];
+	message->Token = data + 4;
+	if(len < 4 + message->TokenLen) return false;
+
+	p = data + 4 + message->TokenLen;
+	message->Options = p;
+	while((p < end) && (*p != COAP_PAYLOAD_MARKER))
+	{
+		if(COAP_Option_Next(&p, end, &number, &value, &value_len) == false) return false;
+	}
+	message->OptionsLen = p - message->Options;
+
+	if(p < end)
+	{
+		//A marker with no payload after it is a format error
+		if(++p == end) return false;
+		message->Payload = p;
+		message->PayloadLen = end - p;
+	}
+
+	//Empty message is the header only
+	return (message->Code != ME_COAP_EMPTY) || (len == 4);
+}
+
+/**
+  * @brief  First option of number in a parsed PDU.
+  * @param  message: parsed by ME_COAP_Parse().
+  * @param  number: option number.
+  * @param  value: set to the option value.
+  * @param  len: bytes of value.
+  * @retval true for found.
+  */
+bool ME_COAP_Get_Option(const ME_COAP_Message_t * message, uint16_t number, const uint8_t ** value, uint16_t * len)
+{
+	const uint8_t * p = message->Options;
+	const uint8_t * end = p + message->OptionsLen;
+	uint16_t current = 0;
+
+	while(p < end)
+	{
+		if(COAP_Option_Next(&p, end, &current, value, len) == false) return false;
+		if(current == number) return true;
+		if(current > number) return false;
+	}
+	return false;
+}
+
+/**
+  * @brief  First option of number in a parsed PDU, as uint of up to 4 bytes.
+  */
+bool ME_COAP_Get_Option_Uint(const ME_COAP_Message_t * message, uint16_t number, uint32_t * value)
+{
+	const uint8_t * bytes = NULL;
+	uint16_t len = 0;
+
+	if((ME_COAP_Get_Option(message, number, &bytes, &len) == false) || (len > 4)) return false;
+
+	*value = 0;
+	for(uint16_t i = 0; i < len; i++) *value = (*value << 8) | bytes[i];
+	return true;
+}
+
+/**
+  * @brief  Options of a string, one per part between separators, as "a/b" is Uri-Path "a" and "b".
+  */
+static void COAP_Option_String(ME_COAP_PDU_t * pdu, uint16_t number, const char * string, char separator)
+{
+	const char * end = NULL;
+
+	if(string == NULL) return;
+	if(*string == separator) string++;
+
+	while(*string != '\0')
+	{
+		end = strchr(string, separator);
+		if(end == NULL) end = string + strlen(string);
+		if(ME_COAP_PDU_Option(pdu, number, string, end - string) == false) return;
+		string = (*end != '\0') ? (end + 1) : end;
+	}
+}
+
+/**
+  * @brief  Build the next PDU of an exchange, with a new Message ID.
+  * @note   Payload not fitting one PDU takes Block1, the size of the first block is
+  *         kept, a smaller one the server asks is taken. The PDU of the last Block1
+  *         block, or of no Block1, asks Block2 of Szx2 from Num2. Payload is in the
+  *         PDU until the server has taken it all.
+  * @param  ex: exchange.
+  * @retval true for built, false for options too long for a PDU.
+  */
+static bool COAP_Build(ME_COAP_Exchange_t * ex)
+{
+	const ME_COAP_Request_t * request = &ex->Request;
+	uint16_t left = request->Len - ex->Sent;
+	uint16_t room = 0;
+	bool more = false;
+	ME_COAP_PDU_t pdu;
+
+	//Low bits of COAP.MessageId stay 0, they are the slot.
+	COAP.MessageId += ME3616_COAP_CON_MAX;
+	ex->MessageId = COAP.MessageId | ex->Token[0];
+
+	ME_COAP_PDU_Begin(&pdu, ex->Pdu, sizeof(ex->Pdu), ME_COAP_CON, request->Method, ex->MessageId, ex->Token, ME3616_COAP_TOKEN_LEN);
+	COAP_Option_String(&pdu, ME_COAP_OPTION_URI_PATH, request->Path, '/');
+	if((left != 0) && (request->Format >= 0)) ME_COAP_PDU_Option_Uint(&pdu, ME_COAP_OPTION_CONTENT_FORMAT, request->Format);
+	COAP_Option_String(&pdu, ME_COAP_OPTION_URI_QUERY, request->Query, '&');
+	if(pdu.Overflow == true) return false;
+
+	//Payload room besides Block2, Block1 and the marker
+	if(pdu.Size > pdu.Len + 2 * COAP_BLOCK_OPTION_MAX + 1) room = pdu.Size - pdu.Len - 2 * COAP_BLOCK_OPTION_MAX - 1;
+	if((ex->Szx1 == COAP_SZX_NONE) && (left > room))
+	{
+		//Largest block that fits, for the rest of the payload
+		if(room < 16) return false;
+		for(ex->Szx1 = COAP_SZX_MAX; (16u << ex->Szx1) > room; ex->Szx1--);
+	}
+
+	ex->BlockLen = left;
+	if((ex->Szx1 != COAP_SZX_NONE) && (left > (16u << ex->Szx1)))
+	{
+		ex->BlockLen = 16u << ex->Szx1;
+		more = true;
+	}
+
+	if(more == false) ME_COAP_PDU_Option_Uint(&pdu, ME_COAP_OPTION_BLOCK2, COAP_BLOCK(ex->Num2, false, ex->Szx2));
+	if((ex->Szx1 != COAP_SZX_NONE) && (left != 0))
+	{
+		ME_COAP_PDU_Option_Uint(&pdu, ME_COAP_OPTION_BLOCK1, COAP_BLOCK(ex->Sent >> (ex->Szx1 + 4), more, ex->Szx1));
+	}
+	ME_COAP_PDU_Payload(&pdu, request->Payload + ex->Sent, ex->BlockLen);
+
+	ex->PduLen = pdu.Len;
+	return (pdu.Overflow == false);
+}
+
+/**
+  * @brief  AT+ECOAPSEND of a PDU, its hex straight into TxBuffer.
+  * @note   Thread context only. A response may come before this returns.
+  * @retval true for OK.
+  */
+static bool COAP_Send(const uint8_t * pdu, uint16_t len)
+{
+	char param[24];
+
+	sprintf(param, "%ld,%u,", (long)COAP.Id, len);
+	return ME3616_Exec_AT_Hex(COAP.Me3616, AT_CMD_COAP_ECOAPSEND, param, pdu, len);
+}
+
+/**
+  * @brief  First transmission of the PDU of an exchange.
+  * @note   State goes first, the ACK may come while AT+ECOAPSEND waits OK. A failed
+  *         AT+ECOAPSEND counts as lost, the retransmission goes again.
+  */
+static void COAP_Transmit(ME_COAP_Exchange_t * ex)
+{
+	ex->State = ME_COAP_WAIT_ACK;
+	ex->Retries = 0;
+	ex->SentTime = HAL_GetTick();
+	//ACK_TIMEOUT to ACK_TIMEOUT * 1.5, ACK_RANDOM_FACTOR
+	ex->Timeout = ME3616_COAP_ACK_TIMEOUT + (ex->SentTime * 7919u) % (ME3616_COAP_ACK_TIMEOUT / 2);
+
+	COAP_Send(ex->Pdu, ex->PduLen);
+}
+
+/**
+  * @brief  Exchange is over, free it and give the handler the last response, NULL for none.
+  */
+static void COAP_Finish(ME_COAP_Exchange_t * ex, const ME_COAP_Message_t * response, uint32_t offset)
+{
+	ME_COAP_Handler_t handler = ex->Request.Handler;
+	void * context = ex->Request.Context;
+
+	//Free first, the handler may make the next request.
+	ex->State = ME_COAP_FREE;
+	if(handler != NULL) handler(context, response, offset, false);
+}
+
+/**
+  * @brief  Response of an exchange, the next Block1 / Block2 block, or the end of it.
+  */
+static void COAP_Response(ME_COAP_Exchange_t * ex, const ME_COAP_Message_t * message)
+{
+	uint32_t block = 0;
+	uint32_t offset = 0;
+	uint8_t szx = 0;
+
+	//Block taken, next one in the size the server asks if smaller
+	if((message->Code == ME_COAP_CONTINUE) && (ex->Sent + ex->BlockLen < ex->Request.Len) &&
+	   (ME_COAP_Get_Option_Uint(message, ME_COAP_OPTION_BLOCK1, &block) == true))
+	{
+		ex->Sent += ex->BlockLen;
+		szx = block & 0x07;
+		if(szx < ex->Szx1) ex->Szx1 = szx;
+		ex->State = ME_COAP_NEXT;
+		COAP.Blocks++;
+		return;
+	}
+	ex->Sent = ex->Request.Len;
+
+	if((ME_COAP_Get_Option_Uint(message, ME_COAP_OPTION_BLOCK2, &block) == true) && ((block & 0x07) <= COAP_SZX_MAX))
+	{
+		szx = block & 0x07;
+		offset = (block >> 4) << (szx + 4);
+
+		//Success with more to come, this block to the handler and ask the next one
+		if(((block & 0x08) != 0) && ((message->Code >> 5) == 2))
+		{
+			ex->Num2 = (block >> 4) + 1;
+			ex->Szx2 = szx;
+			ex->State = ME_COAP_NEXT;
+			COAP.Blocks++;
+			if(ex->Request.Handler != NULL) ex->Request.Handler(ex->Request.Context, message, offset, true);
+			return;
+		}
+	}
+	COAP_Finish(ex, message, offset);
+}
+
+/**
+  * @brief  Empty ACK or RST for ME_COAP_Poll() to send. Full, it is dropped, the
+  *         server sends its CON again.
+  */
+static void COAP_Owe(uint8_t type, uint16_t message_id)
+{
+	if(COAP.ControlCount >= ME3616_COAP_CON_MAX) return;
+
+	COAP.Control[COAP.ControlCount].Type = type;
+	COAP.Control[COAP.ControlCount].MessageId = message_id;
+	COAP.ControlCount++;
+}
+
+/**
+  * @brief  Fields of +ECOAPNMI: <coap_id>,<len>,<hex PDU>, hex decoded over itself.
+  */
+static bool COAP_Parse_Report(char * pch, uint16_t len, int32_t * id, uint8_t ** pdu, uint16_t * bytes)
+{
+	const char * end = pch + len;
+	const char * p = ME3616_Report_Fields(pch, len);
+	int32_t value = 0;
+
+	if((ME3616_Parse_Int(&p, end, id) == false) || (ME3616_Parse_Int(&p, end, &value) == false)) return false;
+
+	while((p < end) && (*p == ' ')) p++;
+	if((p < end) && (*p == '"')) p++;
+	if(end - p < 2 * value) return false;
+
+	*pdu = (uint8_t *)p;
+	*bytes = Hex_Decode(*pdu, value, p, 2 * value);
+	return (*bytes == value);
+}
+
+/**
+  * @brief  +ECOAPNMI, a PDU of the server. ACK / RST is matched to its request by
+  *         Message ID, a separate response by token, the slot is in either.
+  */
+static void COAP_ECOAPNMI_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	ME_COAP_Message_t message;
+	ME_COAP_Exchange_t * ex = NULL;
+	uint8_t * pdu = NULL;
+	uint16_t bytes = 0;
+	int32_t id = 0;
+
+	UNUSED(Me3616);
+	if((COAP_Parse_Report(pch, len, &id, &pdu, &bytes) == false) || (ME_COAP_Parse(&message, pdu, bytes) == false))
+	{
+		DBG_Print("CoAP +ECOAPNMI malformed.", DBG_DIR_AT);
+		return;
+	}
+	if(id != COAP.Id) return;
+
+	if((message.Type == ME_COAP_ACK) || (message.Type == ME_COAP_RST))
+	{
+		ex = &COAP.Exchange[message.MessageId & (ME3616_COAP_CON_MAX - 1)];
+
+		//ACK of a retransmitted PDU, taken already
+		if((ex->State != ME_COAP_WAIT_ACK) || (ex->MessageId != message.MessageId))
+		{
+			COAP.Duplicates++;
+		}
+		else if(message.Type == ME_COAP_RST)
+		{
+			COAP.Resets++;
+			COAP_Finish(ex, NULL, 0);
+		}
+		else if(message.Code == ME_COAP_EMPTY)
+		{
+			//Separate response to come
+			ex->State = ME_COAP_WAIT_RESPONSE;
+			ex->SentTime = HAL_GetTick();
+		}
+		else if((message.TokenLen != ME3616_COAP_TOKEN_LEN) || memcmp(message.Token, ex->Token, ME3616_COAP_TOKEN_LEN))
+		{
+			COAP.Unmatched++;
+		}
+		else
+		{
+			COAP_Response(ex, &message);
+		}
+		return;
+	}
+
+	//CON / NON separate response. A CON again of the one acknowledged last, the ACK was lost.
+	if((message.Type == ME_COAP_CON) && (COAP.Acked == true) && (message.MessageId == COAP.AckedId))
+	{
+		COAP.Duplicates++;
+		COAP_Owe(ME_COAP_ACK, message.MessageId);
+		return;
+	}
+
+	if((message.TokenLen == ME3616_COAP_TOKEN_LEN) && (message.Token[0] < ME3616_COAP_CON_MAX))
+	{
+		ex = &COAP.Exchange[message.Token[0]];
+		if(((ex->State != ME_COAP_WAIT_ACK) && (ex->State != ME_COAP_WAIT_RESPONSE)) ||
+		   memcmp(message.Token, ex->Token, ME3616_COAP_TOKEN_LEN)) ex = NULL;
+	}
+	if(ex == NULL)
+	{
+		COAP.Unmatched++;
+		if(message.Type == ME_COAP_CON) COAP_Owe(ME_COAP_RST, message.MessageId);
+		return;
+	}
+
+	if(message.Type == ME_COAP_CON)
+	{
+		COAP.Acked = true;
+		COAP.AckedId = message.MessageId;
+		COAP_Owe(ME_COAP_ACK, message.MessageId);
+	}
+	COAP_Response(ex, &message);
+}
+
+/**
+  * @brief  Send the empty ACKs and RSTs owed.
+  */
+static void COAP_Control_Flush(void)
+{
+	uint8_t pdu[4];
+	ME_COAP_PDU_t control;
+
+	//More may be owed while these go, they are sent too.
+	for(uint8_t i = 0; i < COAP.ControlCount; i++)
+	{
+		ME_COAP_PDU_Begin(&control, pdu, sizeof(pdu), COAP.Control[i].Type, ME_COAP_EMPTY, COAP.Control[i].MessageId, NULL, 0);
+		COAP_Send(pdu, control.Len);
+	}
+	COAP.ControlCount = 0;
+}
+
+/**
+  * @brief  Parse received strings, send next blocks, retransmit and time out requests,
+  *         send the empty ACKs owed.
+  * @note   Call from main loop while the client is open. Does nothing from an
+  *         Active Report handler.
+  * @param  Me3616: Instance of Me3616.
+  * @retval true while a request is outstanding.
+  */
+bool ME_COAP_Poll(Me3616_DeviceType * Me3616)
+{
+	bool outstanding = false;
+	uint32_t now = 0;
+
+	if((COAP_Ready == false) || (COAP.Me3616 != Me3616) || (COAP.Id < 0) || (Me3616->RxProcessing == true)) return false;
+
+	ME3616_Rx_Process(Me3616);
+
+	for(uint8_t i = 0; i < ME3616_COAP_CON_MAX; i++)
+	{
+		ME_COAP_Exchange_t * ex = &COAP.Exchange[i];
+
+		now = HAL_GetTick();
+		if(ex->State == ME_COAP_NEXT)
+		{
+			if(COAP_Build(ex) == false)
+			{
+				DBG_Print("CoAP options too long for a block.", DBG_DIR_AT);
+				COAP_Finish(ex, NULL, 0);
+				continue;
+			}
+			ex->State = ME_COAP_SEND;
+		}
+
+		if(ex->State == ME_COAP_SEND)
+		{
+			COAP_Transmit(ex);
+		}
+		else if((ex->State == ME_COAP_WAIT_ACK) && (now - ex->SentTime >= ex->Timeout))
+		{
+			if(ex->Retries >= ME3616_COAP_MAX_RETRANSMIT)
+			{
+				COAP.Timeouts++;
+				COAP_Finish(ex, NULL, 0);
+				continue;
+			}
+			ex->Retries++;
+			ex->SentTime = now;
+			ex->Timeout *= 2;
+			COAP.Retransmits++;
+			COAP_Send(ex->Pdu, ex->PduLen);
+		}
+		else if((ex->State == ME_COAP_WAIT_RESPONSE) && (now - ex->SentTime >= ME3616_COAP_RESPONSE_TIMEOUT))
+		{
+			COAP.Timeouts++;
+			COAP_Finish(ex, NULL, 0);
+		}
+	}
+
+	COAP_Control_Flush();
+
+	for(uint8_t i = 0; i < ME3616_COAP_CON_MAX; i++)
+	{
+		if(COAP.Exchange[i].State != ME_COAP_FREE) outstanding = true;
+	}
+	return outstanding;
+}
+
+/**
+  * @brief  Create the client of ME3616, AT+ECOAPNEW.
+  * @param  Me3616: Instance of Me3616.
+  * @param  server: address of the server.
+  * @param  port: UDP port of the server, 5683 by default.
+  * @retval true for success, false for already open or ME3616 refused.
+  */
+bool me_coap_open(Me3616_DeviceType * Me3616, const char * server, uint16_t port)
+{
+	char param[64];
+	int32_t id = -1;
+	int len = 0;
+
+	if(COAP_Ready == false) COAP_Init();
+	if((server == NULL) || (COAP.Id >= 0)) return false;
+
+	len = snprintf(param, sizeof(param), "\"%s\",%u,%d", server, (unsigned)port, COAP_CID);
+	if((len <= 0) || (len >= (int)sizeof(param))) return false;
+	if(ME3616_Exec_AT_Command(Me3616, AT_CMD_COAP_ECOAPNEW, param) == false) return false;
+	if(AT_Response_Get_Int(ME3616_Get_Response(Me3616), 0, &id) == false) return false;
+
+	COAP.Me3616 = Me3616;
+	COAP.Id = id;
+	COAP.Acked = false;
+	COAP.ControlCount = 0;
+	//Message IDs of this client start anywhere
+	COAP.MessageId = (uint16_t)(HAL_GetTick() * ME3616_COAP_CON_MAX);
+	return true;
+}
+
+/**
+  * @brief  Delete the client, AT+ECOAPDEL. Outstanding requests end, their handlers get NULL.
+  * @retval true for success, false for not open or ME3616 refused.
+  */
+bool me_coap_close(void)
+{
+	char param[24];
+	bool res = false;
+
+	if((COAP_Ready == false) || (COAP.Id < 0)) return false;
+
+	sprintf(param, "%ld", (long)COAP.Id);
+	res = ME3616_Exec_AT_Command(COAP.Me3616, AT_CMD_COAP_ECOAPDEL, param);
+	COAP.Id = -1;
+	COAP.ControlCount = 0;
+
+	for(uint8_t i = 0; i < ME3616_COAP_CON_MAX; i++)
+	{
+		if(COAP.Exchange[i].State != ME_COAP_FREE) COAP_Finish(&COAP.Exchange[i], NULL, 0);
+	}
+	return res;
+}
+
+/**
+  * @brief  Make a CON request, sent now unless called from an Active Report handler,
+  *         then by ME_COAP_Poll(). Block1 and Block2 go on in ME_COAP_Poll().
+  * @note   The handler may be called before this returns, the response can come
+  *         while AT+ECOAPSEND waits OK.
+  * @param  request: copied, its strings and Payload are not.
+  * @retval slot of the request, -1 for closed client, bad request, every slot
+  *         taken, or options too long for a PDU.
+  */
+int me_coap_request(const ME_COAP_Request_t * request)
+{
+	ME_COAP_Exchange_t * ex = NULL;
+	uint8_t slot = 0;
+
+	if((COAP_Ready == false) || (COAP.Id < 0) || (request == NULL)) return -1;
+	if((request->Method < ME_COAP_GET) || (request->Method > ME_COAP_DELETE)) return -1;
+	if((request->Payload == NULL) && (request->Len != 0)) return -1;
+
+	while((slot < ME3616_COAP_CON_MAX) && (COAP.Exchange[slot].State != ME_COAP_FREE)) slot++;
+	if(slot >= ME3616_COAP_CON_MAX) return -1;
+
+	ex = &COAP.Exchange[slot];
+	memset(ex, 0, sizeof(ME_COAP_Exchange_t));
+	ex->Request = *request;
+	ex->Szx1 = COAP_SZX_NONE;
+	ex->Szx2 = ME3616_COAP_BLOCK2_SZX;
+
+	COAP.Count++;
+	ex->Token[0] = slot;
+	ex->Token[1] = COAP.Count >> 8;
+	ex->Token[2] = COAP.Count & 0xFF;
+	if(COAP_Build(ex) == false) return -1;
+
+	COAP.Requests++;
+	ex->State = ME_COAP_SEND;
+	if(COAP.Me3616->RxProcessing == false) COAP_Transmit(ex);
+	return slot;
+}
+
+/**
+  * @brief  Requests, counters of the client.
+  */
+const ME_COAP_t * ME_COAP_Get(void)
+{
+	return &COAP;
+}
@@ -0,0 +1,224 @@
+/**
+  ******************************************************************************
+  * @file    me3616_hex.c
+  * @author  Simon Luk (simonluk@unidevelop.net)
+  * @brief   Hex codec shared by the ME3616 driver and the EasyIoT SDK, for
+  *          LWM2M, socket and OneNET payloads in AT commands
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2018 Simon Luk </center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of Simon Luk nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/*
+  Encode is one table load and one halfword store a byte.
+
+  Decode takes 4 chars at a time. On Cortex-M4, or any core with the DSP
+  extension, the 4 chars are validated and converted together by USUB8 / UADD8
+  and SEL, one check for all 4. Elsewhere 4 table loads share that check.
+  Define ME3616_HEX_SIMD32 to build the SIMD path on the host, with the
+  intrinsics of the HAL shim.
+*/
+
+#include <string.h>
+
+#include "me3616_hex.h"
+
+#if defined(__ARM_FEATURE_SIMD32) || defined(ME3616_HEX_SIMD32)
+#define HEX_DECODE_SIMD32
+#include "stm32l4xx_hal.h"
+#endif
+
+const char Hex_Encode_LUT[256][2] =
+{
+	{'0','0'}, {'0','1'}, {'0','2'}, {'0','3'}, {'0','4'}, {'0','5'}, {'0','6'}, {'0','7'},
+	{'0','8'}, {'0','9'}, {'0','A'}, {'0','B'}, {'0','C'}, {'0','D'}, {'0','E'}, {'0','F'},
+	{'1','0'}, {'1','1'}, {'1','2'}, {'1','3'}, {'1','4'}, {'1','5'}, {'1','6'}, {'1','7'},
+	{'1','8'}, {'1','9'}, {'1','A'}, {'1','B'}, {'1','C'}, {'1','D'}, {'1','E'}, {'1','F'},
+	{'2','0'}, {'2','1'}, {'2','2'}, {'2','3'}, {'2','4'}, {'2','5'}, {'2','6'}, {'2','7'},
+	{'2','8'}, {'2','9'}, {'2','A'}, {'2','B'}, {'2','C'}, {'2','D'}, {'2','E'}, {'2','F'},
+	{'3','0'}, {'3','1'}, {'3','2'}, {'3','3'}, {'3','4'}, {'3','5'}, {'3','6'}, {'3','7'},
+	{'3','8'}, {'3','9'}, {'3','A'}, {'3','B'}, {'3','C'}, {'3','D'}, {'3','E'}, {'3','F'},
+	{'4','0'}, {'4','1'}, {'4','2'}, {'4','3'}, {'4','4'}, {'4','5'}, {'4','6'}, {'4','7'},
+	{'4','8'}, {'4','9'}, {'4','A'}, {'4','B'}, {'4','C'}, {'4','D'}, {'4','E'}, {'4','F'},
+	{'5','0'}, {'5','1'}, {'5','2'}, {'5','3'}, {'5','4'}, {'5','5'}, {'5','6'}, {'5','7'},
+	{'5','8'}, {'5','9'}, {'5','A'}, {'5','B'}, {'5','C'}, {'5','D'}, {'5','E'}, {'5','F'},
+	{'6','0'}, {'6','1'}, {'6','2'}, {'6','3'}, {'6','4'}, {'6','5'}, {'6','6'}, {'6','7'},
+	{'6','8'}, {'6','9'}, {'6','A'}, {'6','B'}, {'6','C'}, {'6','D'}, {'6','E'}, {'6','F'},
+	{'7','0'}, {'7','1'}, {'7','2'}, {'7','3'}, {'7','4'}, {'7','5'}, {'7','6'}, {'7','7'},
+	{'7','8'}, {'7','9'}, {'7','A'}, {'7','B'}, {'7','C'}, {'7','D'}, {'7','E'}, {'7','F'},
+	{'8','0'}, {'8','1'}, {'8','2'}, {'8','3'}, {'8','4'}, {'8','5'}, {'8','6'}, {'8','7'},
+	{'8','8'}, {'8','9'}, {'8','A'}, {'8','B'}, {'8','C'}, {'8','D'}, {'8','E'}, {'8','F'},
+	{'9','0'}, {'9','1'}, {'9','2'}, {'9','3'}, {'9','4'}, {'9','5'}, {'9','6'}, {'9','7'},
+	{'9','8'}, {'9','9'}, {'9','A'}, {'9','B'}, {'9','C'}, {'9','D'}, {'9','E'}, {'9','F'},
+	{'A','0'}, {'A','1'}, {'A','2'}, {'A','3'}, {'A','4'}, {'A','5'}, {'A','6'}, {'A','7'},
+	{'A','8'}, {'A','9'}, {'A','A'}, {'A','B'}, {'A','C'}, {'A','D'}, {'A','E'}, {'A','F'},
+	{'B','0'}, {'B','1'}, {'B','2'}, {'B','3'}, {'B','4'}, {'B','5'}, {'B','6'}, {'B','7'},
+	{'B','8'}, {'B','9'}, {'B','A'}, {'B','B'}, {'B','C'}, {'B','D'}, {'B','E'}, {'B','F'},
+	{'C','0'}, {'C','1'}, {'C','2'}, {'C','3'}, {'C','4'}, {'C','5'}, {'C','6'}, {'C','7'},
+	{'C','8'}, {'C','9'}, {'C','A'}, {'C','B'}, {'C','C'}, {'C','D'}, {'C','E'}, {'C','F'},
+	{'D','0'}, {'D','1'}, {'D','2'}, {'D','3'}, {'D','4'}, {'D','5'}, {'D','6'}, {'D','7'},
+	{'D','8'}, {'D','9'}, {'D','A'}, {'D','B'}, {'D','C'}, {'D','D'}, {'D','E'}, {'D','F'},
+	{'E','0'}, {'E','1'}, {'E','2'}, {'E','3'}, {'E','4'}, {'E','5'}, {'E','6'}, {'E','7'},
+	{'E','8'}, {'E','9'}, {'E','A'}, {'E','B'}, {'E','C'}, {'E','D'}, {'E','E'}, {'E','F'},
+	{'F','0'}, {'F','1'}, {'F','2'}, {'F','3'}, {'F','4'}, {'F','5'}, {'F','6'}, {'F','7'},
+	{'F','8'}, {'F','9'}, {'F','A'}, {'F','B'}, {'F','C'}, {'F','D'}, {'F','E'}, {'F','F'},
+};
+
+const uint8_t Hex_Decode_LUT[256] =
+{
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0x00
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0x10
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0x20
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0x30
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0x40
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0x50
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0x60
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0x70
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0x80
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0x90
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0xA0
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0xB0
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0xC0
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0xD0
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0xE0
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,	//0xF0
+};
+
+/**
+  * @brief  Encode bytes as upper case hex, no '\0' is added.
+  * @param  dest: chars out.
+  * @param  dest_size: room of dest, bytes that do not fit are left out.
+  * @param  src: bytes in.
+  * @param  len: bytes of src.
+  * @retval chars written, 2 a byte.
+  */
+uint16_t Hex_Encode(char * dest, uint16_t dest_size, const uint8_t * src, uint16_t len)
+{
+	if(len > dest_size / 2) len = dest_size / 2;
+
+	for(uint16_t i = 0; i < len; i++)
+	{
+		memcpy(dest + 2 * i, Hex_Encode_LUT[src[i]], 2);
+	}
+	return 2 * len;
+}
+
+#ifdef HEX_DECODE_SIMD32
+/**
+  * @brief  4 hex digits, little endian in word, into 2 bytes.
+  * @retval false for any char not a hex digit.
+  */
+static inline bool Hex_Decode_Word(uint32_t word, uint8_t * dest)
+{
+	uint32_t digit, alpha, alpha10, value;
+
+	//'0'..'9': word - '0' in 0..9, lanes below '0' or above 9 become 0xFF
+	digit = __USUB8(word, 0x30303030);
+	digit = __SEL(digit, 0xFFFFFFFF);
+	__UADD8(digit, 0xF6F6F6F6);
+	digit = __SEL(0xFFFFFFFF, digit);
+
+	//'A'..'F' and 'a'..'f': (word | 0x20) - 'a' in 0..5, 10..15 after, the rest 0xFF
+	alpha = __USUB8(word | 0x20202020, 0x61616161);
+	alpha = __SEL(alpha, 0xFFFFFFFF);
+	alpha10 = __UADD8(alpha, 0x0A0A0A0A);
+	__UADD8(alpha, 0xFAFAFAFA);
+	alpha = __SEL(0xFFFFFFFF, alpha10);
+
+	//A char is at most one of the two, the other lane is 0xFF
+	value = digit & alpha;
+	if((value & 0xF0F0F0F0) != 0) return false;
+
+	value = (value << 4) | (value >> 8);
+	dest[0] = (uint8_t)value;
+	dest[1] = (uint8_t)(value >> 16);
+	return true;
+}
+#else
+/**
+  * @brief  4 hex digits into 2 bytes.
+  * @retval false for any char not a hex digit.
+  */
+static inline bool Hex_Decode_Word(const char * src, uint8_t * dest)
+{
+	uint8_t a = Hex_Decode_LUT[(uint8_t)src[0]];
+	uint8_t b = Hex_Decode_LUT[(uint8_t)src[1]];
+	uint8_t c = Hex_Decode_LUT[(uint8_t)src[2]];
+	uint8_t d = Hex_Decode_LUT[(uint8_t)src[3]];
+
+	if(((a | b | c | d) & 0xF0) != 0) return false;
+
+	dest[0] = (a << 4) | b;
+	dest[1] = (c << 4) | d;
+	return true;
+}
+#endif
+
+/**
+  * @brief  Decode hex digits of either case into bytes.
+  *         Stops at the first char not a hex digit, an odd char left, or dest full.
+  * @note   dest may be src, decoding in place: byte n is written after chars
+  *         2n and 2n + 1 are read, and behind every char still to read.
+  * @param  dest: bytes out.
+  * @param  dest_size: room of dest.
+  * @param  src: chars in, need not end by '\0'.
+  * @param  len: chars of src.
+  * @retval bytes written, len / 2 when src is all hex and fits dest.
+  */
+uint16_t Hex_Decode(uint8_t * dest, uint16_t dest_size, const char * src, uint16_t len)
+{
+	uint16_t count = 0;
+	uint8_t high, low;
+
+	if(len / 2 < dest_size) dest_size = len / 2;
+
+	while(count + 2 <= dest_size)
+	{
+#ifdef HEX_DECODE_SIMD32
+		uint32_t word;
+
+		memcpy(&word, src + 2 * count, 4);
+		if(Hex_Decode_Word(word, dest + count) == false) break;
+#else
+		if(Hex_Decode_Word(src + 2 * count, dest + count) == false) break;
+#endif
+		count += 2;
+	}
+
+	//Tail, or the word with a bad char, a pair at a time
+	while(count < dest_size)
+	{
+		high = Hex_Decode_LUT[(uint8_t)src[2 * count]];
+		low = Hex_Decode_LUT[(uint8_t)src[2 * count + 1]];
+		if(((high | low) & 0xF0) != 0) break;
+
+		dest[count++] = (high << 4) | low;
+	}
+	return count;
+}
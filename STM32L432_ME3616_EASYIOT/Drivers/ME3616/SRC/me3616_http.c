@@ -0,0 +1,470 @@
+/**
+  ******************************************************************************
+  * @file    me3616_http.c
+  * @author  Simon Luk (simonluk@unidevelop.net)
+  * @brief   HTTP client of ME3616, over AT+EHTTPCREATE / AT+EHTTPSEND, request
+  *          bodies sent piece by piece and responses streamed to a sink
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2018 Simon Luk </center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of Simon Luk nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+
+/*
+  One client, one request at a time. HTTP itself is done by ME3616, this keeps RAM
+  of a request the same whatever its body and response are:
+  - request: the data string of AT+EHTTPSEND is Head, built here, and the body.
+    It goes in pieces of ME3616_HTTP_PIECE_SIZE, one AT+EHTTPSEND each, the body
+    copied from Body or asked from Source piece by piece.
+  - response: +EHTTPNMIH and +EHTTPNMIC are streamed lines of the framer, see
+    ME3616_Register_Stream(). Header and content bytes go to the sink as DMA
+    writes them, a line far longer than RxBuffer included.
+  Pieces are sent from thread context, by me_http_request() and ME_HTTP_Poll().
+
+  AT+EHTTPCREATE=0,<len>,<len>,"<host>,,,0,,0,,0,"      +EHTTPCREATE: <id>
+  AT+EHTTPCON=<id>
+  AT+EHTTPSEND=<more>,<total_len>,<len>,"<data>"
+    data: <id>,<method>,<path_len>,<path>,<header_len>,<header>,<type_len>,<type>,
+          <content_len>,<content>
+  +EHTTPNMIH: <id>,<code>,<header_len>,<header>
+  +EHTTPNMIC: <id>,<more>,<content_len>,<len>,<content>
+  +EHTTPERR: <id>,<err>
+  AT+EHTTPDISCON=<id>
+  AT+EHTTPDESTROY=<id>
+  Lengths count bytes, <more> is 1 while more pieces follow, 0 for the last one.
+  A response of no content ends by a +EHTTPNMIC of <len> 0.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "me3616.h"
+#include "me3616_http.h"
+
+//Fields before the length field of +EHTTPNMIH / +EHTTPNMIC
+#define HTTP_NMIH_FIELD                 2
+#define HTTP_NMIC_FIELD                 3
+
+#define HTTP_STREAM_NONE                0xFF
+
+//"<more>,<total_len>,<len>,\"" of AT+EHTTPSEND at its longest, Total is 16 bits, a piece 3 digits
+#define HTTP_PREFIX_SIZE                (sizeof("1,65535,000,\"") - 1)
+
+#if ME3616_HTTP_PIECE_SIZE > 999
+#error "ME3616_HTTP_PIECE_SIZE must fit the 3 digits of HTTP_PREFIX_SIZE."
+#endif
+
+#if ME3616_HTTP_PIECE_SIZE > ME3616_TX_BUFFER_SIZE - 1 - 29
+#error "ME3616_HTTP_PIECE_SIZE must leave room in TxBuffer for AT+EHTTPSEND=1,65535,000,\"\"."
+#endif
+
+static ME_HTTP_t HTTP;
+static bool HTTP_Ready = false;
+
+//Parameters of the command in sending, a piece is written after room for its prefix.
+static char HTTP_Param[HTTP_PREFIX_SIZE + ME3616_HTTP_PIECE_SIZE + 2];
+
+static void HTTP_EHTTPNMIH_Stream(Me3616_DeviceType * Me3616, AT_Stream_Event_t event, const char * pch, uint16_t len);
+static void HTTP_EHTTPNMIC_Stream(Me3616_DeviceType * Me3616, AT_Stream_Event_t event, const char * pch, uint16_t len);
+static void HTTP_EHTTPERR_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len);
+
+static void HTTP_Init(void)
+{
+	memset(&HTTP, 0, sizeof(HTTP));
+	HTTP.Id = -1;
+	HTTP.Stream = HTTP_STREAM_NONE;
+
+	if((ME3616_Register_Stream("+EHTTPNMIH", HTTP_NMIH_FIELD, HTTP_EHTTPNMIH_Stream) == false) ||
+	   (ME3616_Register_Stream("+EHTTPNMIC", HTTP_NMIC_FIELD, HTTP_EHTTPNMIC_Stream) == false))
+	{
+		ME3616_ErrorHandler(__FILE__, __LINE__, "ME3616_COUNTED_TABLE_SIZE too small.");
+	}
+	if(ME3616_Register_URC("+EHTTPERR", HTTP_EHTTPERR_Report) == false)
+	{
+		ME3616_ErrorHandler(__FILE__, __LINE__, "ME3616_URC_TABLE_SIZE too small.");
+	}
+	HTTP_Ready = true;
+}
+
+/**
+  * @brief  Request is over, give its sink the end, DONE or FAILED.
+  */
+static void HTTP_Finish(ME_HTTP_Event_t event)
+{
+	ME_HTTP_Sink_t sink = HTTP.Request.Sink;
+
+	HTTP.State = ME_HTTP_IDLE;
+	HTTP.Stream = HTTP_STREAM_NONE;
+	if(event == ME_HTTP_DONE) HTTP.Responses++;
+	else HTTP.Failures++;
+
+	if(sink != NULL) sink(HTTP.Request.Context, event, NULL, 0, HTTP.ContentOffset);
+}
+
+/**
+  * @brief  Text fit for the quoted data string of AT+EHTTPSEND, no '\0', CR, LF or '"'.
+  */
+static bool HTTP_Text_Valid(const char * text, uint32_t len)
+{
+	for(uint32_t i = 0; i < len; i++)
+	{
+		if((text[i] == '\0') || (text[i] == '\r') || (text[i] == '\n') || (text[i] == '"')) return false;
+	}
+	return true;
+}
+
+/**
+  * @brief  Next piece of the data string by AT+EHTTPSEND, Head first, then the body.
+  * @note   Thread context only. State goes first, the response may come while the
+  *         last piece waits OK.
+  * @retval true for OK.
+  */
+static bool HTTP_Send_Piece(void)
+{
+	char * const data = HTTP_Param + HTTP_PREFIX_SIZE;
+	uint16_t len = 0;
+	uint16_t room = 0;
+	uint16_t n = 0;
+	char prefix[HTTP_PREFIX_SIZE + 1];
+	int prefix_len = 0;
+
+	if(HTTP.Sent < HTTP.HeadLen)
+	{
+		len = HTTP.HeadLen - HTTP.Sent;
+		if(len > ME3616_HTTP_PIECE_SIZE) len = ME3616_HTTP_PIECE_SIZE;
+		memcpy(data, HTTP.Head + HTTP.Sent, len);
+	}
+
+	while((len < ME3616_HTTP_PIECE_SIZE) && (HTTP.Sent + len < HTTP.Total))
+	{
+		uint32_t offset = HTTP.Sent + len - HTTP.HeadLen;
+
+		room = ME3616_HTTP_PIECE_SIZE - len;
+		if(room > HTTP.Total - HTTP.Sent - len) room = HTTP.Total - HTTP.Sent - len;
+
+		if(HTTP.Request.Body != NULL)
+		{
+			memcpy(data + len, (const uint8_t *)HTTP.Request.Body + offset, room);
+			n = room;
+		}
+		else
+		{
+			n = HTTP.Request.Source(HTTP.Request.Context, offset, (uint8_t *)data + len, room);
+		}
+
+		if((n == 0) || (n > room) || (HTTP_Text_Valid(data + len, n) == false))
+		{
+			DBG_Print("HTTP body shorter than BodyLen, or not text.", DBG_DIR_AT);
+			return false;
+		}
+		len += n;
+	}
+
+	data[len] = '"';
+	data[len + 1] = '\0';
+	prefix_len = snprintf(prefix, sizeof(prefix), "%u,%u,%u,\"", (HTTP.Sent + len < HTTP.Total) ? 1u : 0u,
+	                      (unsigned)HTTP.Total, (unsigned)len);
+	if((prefix_len <= 0) || (prefix_len >= (int)sizeof(prefix))) return false;
+	memcpy(data - prefix_len, prefix, prefix_len);
+
+	HTTP.Sent += len;
+	HTTP.Pieces++;
+	HTTP.LastTime = HAL_GetTick();
+	if(HTTP.Sent >= HTTP.Total) HTTP.State = ME_HTTP_WAIT;
+
+	return ME3616_Exec_AT_Command(HTTP.Me3616, AT_CMD_HTTP_EHTTPSEND, data - prefix_len);
+}
+
+/**
+  * @brief  Send the next piece of the request in sending, it fails if ME3616 refuses.
+  */
+static void HTTP_Send_Next(void)
+{
+	if(HTTP_Send_Piece() == true) return;
+
+	//The response may have ended it while the piece waited OK.
+	if(HTTP.State != ME_HTTP_IDLE) HTTP_Finish(ME_HTTP_FAILED);
+}
+
+/**
+  * @brief  Parse count decimal fields of an Active Report, after ':' or '='.
+  * @retval true if every field is there.
+  */
+static bool HTTP_Parse_Fields(const char * pch, uint16_t len, int32_t * value, uint8_t count)
+{
+	const char * end = pch + len;
+	const char * p = ME3616_Report_Fields(pch, len);
+
+	for(uint8_t i = 0; i < count; i++)
+	{
+		if(ME3616_Parse_Int(&p, end, &value[i]) == false) return false;
+	}
+	return true;
+}
+
+/**
+  * @brief  Raw bytes of the streamed line, header or content, to the sink.
+  */
+static void HTTP_Stream_Data(const char * pch, uint16_t len)
+{
+	uint32_t * offset = (HTTP.Stream == ME_HTTP_HEADER) ? &HTTP.HeaderOffset : &HTTP.ContentOffset;
+
+	HTTP.LastTime = HAL_GetTick();
+	HTTP.Fragments++;
+	if(HTTP.Request.Sink != NULL)
+	{
+		HTTP.Request.Sink(HTTP.Request.Context, (ME_HTTP_Event_t)HTTP.Stream, (const uint8_t *)pch, len, *offset);
+	}
+	*offset += len;
+}
+
+/**
+  * @brief  +EHTTPNMIH: <id>,<code>,<header_len>,<header>, header lines to the sink.
+  */
+static void HTTP_EHTTPNMIH_Stream(Me3616_DeviceType * Me3616, AT_Stream_Event_t event, const char * pch, uint16_t len)
+{
+	int32_t value[3];
+
+	UNUSED(Me3616);
+	switch(event)
+	{
+	case AT_STREAM_HEAD:
+		HTTP.Stream = HTTP_STREAM_NONE;
+		if((HTTP.State == ME_HTTP_IDLE) || (HTTP_Parse_Fields(pch, len, value, 3) == false) || (value[0] != HTTP.Id)) break;
+
+		HTTP.Stream = ME_HTTP_HEADER;
+		HTTP.Status = value[1];
+		HTTP.LastTime = HAL_GetTick();
+		break;
+
+	case AT_STREAM_DATA:
+		if(HTTP.Stream == ME_HTTP_HEADER) HTTP_Stream_Data(pch, len);
+		break;
+
+	case AT_STREAM_END:
+		HTTP.Stream = HTTP_STREAM_NONE;
+		break;
+
+	case AT_STREAM_ABORT:
+		if(HTTP.Stream == ME_HTTP_HEADER) HTTP_Finish(ME_HTTP_FAILED);
+		break;
+	}
+}
+
+/**
+  * @brief  +EHTTPNMIC: <id>,<more>,<content_len>,<len>,<content>, content to the
+  *         sink, the last one ends the request.
+  */
+static void HTTP_EHTTPNMIC_Stream(Me3616_DeviceType * Me3616, AT_Stream_Event_t event, const char * pch, uint16_t len)
+{
+	int32_t value[4];
+
+	UNUSED(Me3616);
+	switch(event)
+	{
+	case AT_STREAM_HEAD:
+		HTTP.Stream = HTTP_STREAM_NONE;
+		if((HTTP.State == ME_HTTP_IDLE) || (HTTP_Parse_Fields(pch, len, value, 4) == false) || (value[0] != HTTP.Id)) break;
+
+		HTTP.Stream = ME_HTTP_CONTENT;
+		HTTP.Last = (value[1] == 0);
+		HTTP.ContentLength = value[2];
+		HTTP.LastTime = HAL_GetTick();
+		break;
+
+	case AT_STREAM_DATA:
+		if(HTTP.Stream == ME_HTTP_CONTENT) HTTP_Stream_Data(pch, len);
+		break;
+
+	case AT_STREAM_END:
+		if(HTTP.Stream != ME_HTTP_CONTENT) break;
+		HTTP.Stream = HTTP_STREAM_NONE;
+		if((HTTP.Last == true) || ((HTTP.ContentLength != 0) && (HTTP.ContentOffset >= HTTP.ContentLength)))
+		{
+			HTTP_Finish(ME_HTTP_DONE);
+		}
+		break;
+
+	case AT_STREAM_ABORT:
+		if(HTTP.Stream == ME_HTTP_CONTENT) HTTP_Finish(ME_HTTP_FAILED);
+		break;
+	}
+}
+
+/**
+  * @brief  +EHTTPERR: <id>,<err>, the request in flight fails.
+  */
+static void HTTP_EHTTPERR_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	int32_t value[2];
+
+	UNUSED(Me3616);
+	if((HTTP_Parse_Fields(pch, len, value, 2) == false) || (value[0] != HTTP.Id)) return;
+
+	DBG_Printf(DBG_DIR_AT, "HTTP error %ld.", (long)value[1]);
+	HTTP.Error = value[1];
+	if(HTTP.State != ME_HTTP_IDLE) HTTP_Finish(ME_HTTP_FAILED);
+}
+
+/**
+  * @brief  Parse received strings, send the next piece of a request, time out a
+  *         request of no response.
+  * @note   Call from main loop while the client is open. Does nothing from an
+  *         Active Report handler.
+  * @param  Me3616: Instance of Me3616.
+  * @retval true while a request is outstanding.
+  */
+bool ME_HTTP_Poll(Me3616_DeviceType * Me3616)
+{
+	if((HTTP_Ready == false) || (HTTP.Me3616 != Me3616) || (HTTP.Id < 0) || (Me3616->RxProcessing == true)) return false;
+
+	ME3616_Rx_Process(Me3616);
+
+	if(HTTP.State == ME_HTTP_SEND)
+	{
+		HTTP_Send_Next();
+	}
+	else if((HTTP.State == ME_HTTP_WAIT) && (HAL_GetTick() - HTTP.LastTime >= ME3616_HTTP_TIMEOUT))
+	{
+		DBG_Print("HTTP response timeout.", DBG_DIR_AT);
+		HTTP_Finish(ME_HTTP_FAILED);
+	}
+	return (HTTP.State != ME_HTTP_IDLE);
+}
+
+/**
+  * @brief  Create the client of ME3616 and connect it, AT+EHTTPCREATE and AT+EHTTPCON.
+  * @param  Me3616: Instance of Me3616.
+  * @param  host: such as "http://117.60.157.137:8080/".
+  * @retval true for success, false for already open or ME3616 refused.
+  */
+bool me_http_open(Me3616_DeviceType * Me3616, const char * host)
+{
+	char param[96];
+	int32_t id = -1;
+	int len = 0;
+
+	if(HTTP_Ready == false) HTTP_Init();
+	if((host == NULL) || (HTTP.Id >= 0)) return false;
+
+	len = strlen(host) + sizeof(",,,0,,0,,0,") - 1;
+	len = snprintf(param, sizeof(param), "0,%d,%d,\"%s,,,0,,0,,0,\"", len, len, host);
+	if((len <= 0) || (len >= (int)sizeof(param))) return false;
+	if(ME3616_Exec_AT_Command(Me3616, AT_CMD_HTTP_EHTTPCREATE, param) == false) return false;
+	if(AT_Response_Get_Int(ME3616_Get_Response(Me3616), 0, &id) == false) return false;
+
+	sprintf(param, "%ld", (long)id);
+	if(ME3616_Exec_AT_Command(Me3616, AT_CMD_HTTP_EHTTPCON, param) == false)
+	{
+		ME3616_Exec_AT_Command(Me3616, AT_CMD_HTTP_EHTTPDESTROY, param);
+		return false;
+	}
+
+	HTTP.Me3616 = Me3616;
+	HTTP.Id = id;
+	HTTP.State = ME_HTTP_IDLE;
+	HTTP.Stream = HTTP_STREAM_NONE;
+	return true;
+}
+
+/**
+  * @brief  Disconnect and destroy the client, AT+EHTTPDISCON and AT+EHTTPDESTROY.
+  *         A request in flight fails.
+  * @retval true for success, false for not open or ME3616 refused.
+  */
+bool me_http_close(void)
+{
+	char param[16];
+	bool res = false;
+
+	if((HTTP_Ready == false) || (HTTP.Id < 0)) return false;
+
+	if(HTTP.State != ME_HTTP_IDLE) HTTP_Finish(ME_HTTP_FAILED);
+
+	sprintf(param, "%ld", (long)HTTP.Id);
+	res = ME3616_Exec_AT_Command(HTTP.Me3616, AT_CMD_HTTP_EHTTPDISCON, param);
+	res = (ME3616_Exec_AT_Command(HTTP.Me3616, AT_CMD_HTTP_EHTTPDESTROY, param) == true) && (res == true);
+	HTTP.Id = -1;
+	return res;
+}
+
+/**
+  * @brief  Make a request, its first piece sent now unless called from an Active
+  *         Report handler, the rest by ME_HTTP_Poll().
+  * @note   The sink may be called before this returns, the response can come while
+  *         the last piece waits OK.
+  * @param  request: copied, its strings, Body and Context are not.
+  * @retval true for success, false for closed client, a request in flight, bad
+  *         request, CR, LF or '"' in Path, Header or ContentType, Head longer than
+  *         ME3616_HTTP_HEAD_SIZE, or a data string past 65535 bytes.
+  */
+bool me_http_request(const ME_HTTP_Request_t * request)
+{
+	const char * header = NULL;
+	const char * type = NULL;
+	int len = 0;
+
+	if((HTTP_Ready == false) || (HTTP.Id < 0) || (HTTP.State != ME_HTTP_IDLE) || (request == NULL)) return false;
+	if((request->Method > ME_HTTP_DELETE) || (request->Path == NULL)) return false;
+	if((request->BodyLen != 0) && (request->Body == NULL) && (request->Source == NULL)) return false;
+
+	header = (request->Header != NULL) ? request->Header : "";
+	type = (request->ContentType != NULL) ? request->ContentType : "";
+	if((HTTP_Text_Valid(request->Path, strlen(request->Path)) == false) ||
+	   (HTTP_Text_Valid(header, strlen(header)) == false) || (HTTP_Text_Valid(type, strlen(type)) == false)) return false;
+	len = snprintf(HTTP.Head, sizeof(HTTP.Head), "%ld,%d,%u,%s,%u,%s,%u,%s,%lu,", (long)HTTP.Id, (int)request->Method,
+	               (unsigned)strlen(request->Path), request->Path, (unsigned)strlen(header), header,
+	               (unsigned)strlen(type), type, (unsigned long)request->BodyLen);
+	if((len <= 0) || (len >= (int)sizeof(HTTP.Head))) return false;
+	if((uint32_t)len + request->BodyLen > 0xFFFF) return false;
+
+	HTTP.Request = *request;
+	HTTP.HeadLen = len;
+	HTTP.Total = len + request->BodyLen;
+	HTTP.Sent = 0;
+	HTTP.Status = -1;
+	HTTP.Stream = HTTP_STREAM_NONE;
+	HTTP.Last = false;
+	HTTP.HeaderOffset = 0;
+	HTTP.ContentOffset = 0;
+	HTTP.ContentLength = 0;
+
+	HTTP.Requests++;
+	HTTP.State = ME_HTTP_SEND;
+	if(HTTP.Me3616->RxProcessing == false) HTTP_Send_Next();
+	return true;
+}
+
+/**
+  * @brief  Request in flight, counters of the client.
+  */
+const ME_HTTP_t * ME_HTTP_Get(void)
+{
+	return &HTTP;
+}
@@ -46,7 +46,8 @@ void ME3616_IF_ErrorHandler(char *file, int line, char * pch)
 	UNUSED(line);
 	DBG_Print(pch,  DBG_DIR_AT);
 	Set_Sys_State(&ME3616_Instance, SYS_STATE_ERR);
-	//Halt and do nothing for this Demo.
+	//Let the debug log out, then halt and do nothing for this Demo.
+	while(DBG_Log_Drain() == true);
 	while(1);
 }
 
@@ -58,6 +59,14 @@ void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
 	while(1);
 }
 
+/**
+  * @brief  DMA Tx of DBG_UART done, chain the next debug record.
+  */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+	if(huart == &DBG_UART) DBG_Log_Drain();
+}
+
 /**
   * @brief  Power off ME3616.
   * @param  Me3616: Instance of Me3616.
@@ -94,6 +103,28 @@ void ME3616_Reset(Me3616_DeviceType * Me3616, uint32_t	delay_ticks)
 	HAL_GPIO_WritePin(ME3616_Reset_Port, ME3616_Reset_Pin, GPIO_PIN_RESET);
 }
 
+/**
+  * @brief  Press or release power button of ME3616, without delay.
+  * @param  Me3616: Instance of Me3616.
+  * @param  press: true for push down.
+  * @retval None.
+  */
+void ME3616_Power_Key(Me3616_DeviceType * Me3616, bool press)
+{
+	HAL_GPIO_WritePin(ME3616_Power_Port, ME3616_Power_Pin, press ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+/**
+  * @brief  Press or release reset button of ME3616, without delay.
+  * @param  Me3616: Instance of Me3616.
+  * @param  press: true for push down.
+  * @retval None.
+  */
+void ME3616_Reset_Key(Me3616_DeviceType * Me3616, bool press)
+{
+	HAL_GPIO_WritePin(ME3616_Reset_Port, ME3616_Reset_Pin, press ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
 
 
 /**
@@ -129,6 +160,20 @@ void Init_UART_CM(UART_HandleTypeDef * huart)
 }
 
 
+/**
+  * @brief  Init UART IDLE line detection, for ME3616_RX_IDLE_MODE.
+  * @note   DMA half / full transfer IT are enabled by HAL_UART_Receive_DMA().
+  * @param  huart: for ME3616_UART.
+  * @retval None.
+  */
+void Init_UART_Idle(UART_HandleTypeDef * huart)
+{
+	//Clear the IDLE flag, then enable IT for the IDLE line
+	__HAL_UART_CLEAR_IDLEFLAG(huart);
+	__HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
+}
+
+
 /**
   * @brief  before send AT CMD, wait at state ready
   * @param  Me3616: Instance of Me3616.
@@ -142,6 +187,9 @@ bool Wait_AT_SendReady(Me3616_DeviceType * Me3616)
 	
 	while(1)
 	{
+		//Strings are not parsed in IRQ with ME3616_RX_IDLE_MODE
+		ME3616_Rx_Process(Me3616);
+
 		//Time out or Receive AT ERROR
 		if((HAL_GetTick() - start_time) > ME3616_SEND_TIMOUT)
 		{
@@ -164,8 +212,7 @@ bool Wait_AT_SendReady(Me3616_DeviceType * Me3616)
   */
 bool UART_AT_Send(Me3616_DeviceType * Me3616)
 {
-	uint16_t len = 0;
-	len = strlen((char *)(Me3616->TxBuffer));
+	uint16_t len = Me3616->TxStringLen;
 	
 	//Tx string, out of TxBuffer
 	if(ME3616_TX_BUFFER_SIZE -1 < len) ME3616_IF_ErrorHandler(__FILE__, __LINE__, "UART Send out of buffer.");
@@ -191,6 +238,74 @@ bool UART_AT_Send(Me3616_DeviceType * Me3616)
 }
 
 
+/**
+  * @brief  Send bytes after the command line, by DMA from where they are, and wait the transfer.
+  * @note   Payload of AT+ESOSENDRAW, logged by its length only.
+  * @param  Me3616: Instance of Me3616.
+  * @param  data: bytes to send.
+  * @param  len: bytes of data.
+  * @retval true for send success, false for fail.
+  */
+bool UART_AT_Send_Data(Me3616_DeviceType * Me3616, const uint8_t * data, uint16_t len)
+{
+	if(len == 0) return true;
+
+    DBG_Printf(DBG_DIR_TX, "[%u raw bytes]", len);
+
+	//Wait until transmit is idle
+	while(Me3616->UartDMA_Tx->State != HAL_DMA_STATE_READY);
+
+	if(HAL_UART_Transmit_DMA(&ME3616_UART, (uint8_t *)data, len) == HAL_OK)
+	{
+        //Wait until transmit is idle
+        while(Me3616->UartDMA_Tx->State != HAL_DMA_STATE_READY);
+        while(__HAL_UART_GET_FLAG (Me3616->UartDevice, UART_FLAG_TC) == 0);
+		return true;
+	}
+	else
+    {
+        while(__HAL_UART_GET_FLAG (Me3616->UartDevice, UART_FLAG_TC) == 0);
+		DBG_Print("UART_AT_Send_Data() DMA send failed.", DBG_DIR_AT);
+		return false;
+    }
+}
+
+
+/**
+  * @brief  Check the UART and its Tx DMA are free for the next command line.
+  * @param  Me3616: Instance of Me3616.
+  * @retval true for ready, false while the last transfer is in flight.
+  */
+bool UART_AT_Tx_Ready(Me3616_DeviceType * Me3616)
+{
+	if(Me3616->UartDevice->gState != HAL_UART_STATE_READY) return false;
+
+	return (Me3616->UartDMA_Tx->State == HAL_DMA_STATE_READY);
+}
+
+
+/**
+  * @brief  Start sending TxBuffer by DMA, do not wait for the transfer.
+  * @note   Used by ME3616_Poll(). TxBuffer MUST NOT be touched until UART is ready again.
+  * @param  Me3616: Instance of Me3616.
+  * @retval true for DMA started, false for UART still busy, try again later.
+  */
+bool UART_AT_Send_Async(Me3616_DeviceType * Me3616)
+{
+	uint16_t len = Me3616->TxStringLen;
+
+	//Tx string, out of TxBuffer
+	if(ME3616_TX_BUFFER_SIZE -1 < len) ME3616_IF_ErrorHandler(__FILE__, __LINE__, "UART Send out of buffer.");
+
+	//Last transfer not finished yet
+	if(UART_AT_Tx_Ready(Me3616) == false) return false;
+
+    DBG_Print((char *)(Me3616->TxBuffer), DBG_DIR_TX);
+
+	return (HAL_UART_Transmit_DMA(Me3616->UartDevice, Me3616->TxBuffer, len) == HAL_OK);
+}
+
+
 /**
   * @brief  after send AT CMD, wait at state OK
   * @param  Me3616: Instance of Me3616.
@@ -204,6 +319,9 @@ bool Wait_AT_Response(Me3616_DeviceType * Me3616)
 
 	while(1)
 	{
+		//Strings are not parsed in IRQ with ME3616_RX_IDLE_MODE
+		ME3616_Rx_Process(Me3616);
+
 		//Time out or Receive AT ERROR
 		if((HAL_GetTick() - start_time) > ME3616_RECEIVE_TIMOUT)
 		{
@@ -268,7 +386,54 @@ void HAL_UART_AbortReceiveCpltCallback(UART_HandleTypeDef * huart)
   */
 void UART_AT_Receive(Me3616_DeviceType * Me3616)
 {
-	ME3616_String_Receive(Me3616);
+	uint16_t wait = 0xFFFF;
+
+	//Clear first, so a '\n' arriving while framing raises a new interrupt.
     __HAL_UART_CLEAR_FLAG(Me3616->UartDevice, UART_FLAG_CMF);
+
+	//'\n' is matched in RDR, wait for DMA to move it into RxBuffer.
+	while(__HAL_UART_GET_FLAG(Me3616->UartDevice, UART_FLAG_RXNE) && --wait);
+
+	ME3616_String_Receive(Me3616);
+}
+
+
+/**
+  * @brief  DMA write position in RxBuffer, taken from NDTR of the Rx channel.
+  * @param  Me3616: Instance of Me3616.
+  * @retval index of the next byte DMA will write.
+  */
+uint16_t UART_AT_Rx_WriteIndex(Me3616_DeviceType * Me3616)
+{
+	return (uint16_t)((ME3616_RX_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(Me3616->UartDMA_Rx)) % ME3616_RX_BUFFER_SIZE);
+}
+
+
+/**
+  * @brief  On UART IDLE, DMA half or full transfer, publish the DMA write position.
+  * @note   IRQ context, nothing is parsed here, see ME3616_Rx_Process().
+  *         Half / full transfer keep it published at least twice a buffer lap.
+  * @param  Me3616: Instance of Me3616.
+  * @retval None.
+  */
+void UART_AT_Rx_Event(Me3616_DeviceType * Me3616)
+{
+	uint16_t write = UART_AT_Rx_WriteIndex(Me3616);
+
+	Me3616->RxReceived += (write + ME3616_RX_BUFFER_SIZE - Me3616->RxWriteIndex) % ME3616_RX_BUFFER_SIZE;
+	Me3616->RxWriteIndex = write;
+}
+
+
+#ifdef ME3616_RX_IDLE_MODE
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef * huart)
+{
+	if(huart == ME3616_Instance.UartDevice) UART_AT_Rx_Event(&ME3616_Instance);
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef * huart)
+{
+	if(huart == ME3616_Instance.UartDevice) UART_AT_Rx_Event(&ME3616_Instance);
 }
+#endif
 
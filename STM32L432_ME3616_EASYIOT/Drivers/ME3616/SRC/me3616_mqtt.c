@@ -0,0 +1,614 @@
+/**
+  ******************************************************************************
+  * @file    me3616_mqtt.c
+  * @author  Simon Luk (simonluk@unidevelop.net)
+  * @brief   MQTT client of ME3616, over AT+EMQNEW / AT+EMQCON / AT+EMQPUB, with
+  *          topic subscriptions, reconnect and a publish queue
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2018 Simon Luk </center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of Simon Luk nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/*
+  One client, MQTT. ME3616 keeps the MQTT session, this side keeps what has to
+  outlive it:
+  - subscriptions: filters and handlers. A +EMQPUB line is dispatched in place,
+    the topic is matched against each filter where it is in RxBuffer, the hex
+    payload is decoded over itself, the handler gets pointers into the line.
+  - reconnect: +EMQDISCON, or a command failing while connected, marks the
+    connection lost. ME_MQTT_Poll() tries AT+EMQNEW / AT+EMQCON again after
+    Wait, which doubles from ME3616_MQTT_BACKOFF_MIN to ME3616_MQTT_BACKOFF_MAX
+    with every failed try, then subscribes every filter again.
+  - publish queue: messages published while not connected are kept, one per
+    topic, a newer one replaces the payload of the queued one. They go in order
+    once connected.
+  Active Report handlers only update state, AT commands are sent from thread
+  context, by me_mqtt_xxx() and ME_MQTT_Poll().
+
+  AT+EMQNEW="<server>","<port>",<command_timeout_ms>,<bufsize>    +EMQNEW: <id>
+  AT+EMQCON=<id>,4,"<client_id>",<keepalive>,<cleansession>,0[,"<user>","<password>"]
+  AT+EMQSUB=<id>,"<topic>",<qos>    AT+EMQUNSUB=<id>,"<topic>"
+  AT+EMQPUB=<id>,"<topic>",<qos>,<retained>,<dup>,<message_len>,<hex message>
+  +EMQPUB: <id>,"<topic>",<qos>,<retained>,<dup>,<message_len>,<hex message>
+  +EMQDISCON: <id>,<err_code>
+  <message_len> counts hex digits.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "me3616.h"
+#include "me3616_hex.h"
+#include "me3616_mqtt.h"
+
+//AT+EMQPUB of the longest queued topic and payload must fit TxBuffer
+#define MQTT_PUB_OVERHEAD               28      //strlen("AT+EMQPUB=00,\"\",0,0,0,000,\r\n")
+
+#if MQTT_PUB_OVERHEAD + ME3616_MQTT_TOPIC_SIZE - 1 + 2 * ME3616_MQTT_PAYLOAD_SIZE > ME3616_TX_BUFFER_SIZE - 1
+#error "ME3616_MQTT_TOPIC_SIZE and ME3616_MQTT_PAYLOAD_SIZE must fit AT+EMQPUB in TxBuffer."
+#endif
+
+//Parameters of AT+EMQNEW / EMQCON / EMQSUB / EMQUNSUB, so the line with the longest command fits TxBuffer
+#define MQTT_PARAM_SIZE                 (ME3616_TX_BUFFER_SIZE - (sizeof("AT+EMQUNSUB=\r\n") - 1))
+
+//MQTT 3.1.1
+#define MQTT_PROTOCOL_VERSION           4
+
+static ME_MQTT_t MQTT;
+static bool MQTT_Ready = false;
+
+static void MQTT_EMQPUB_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len);
+static void MQTT_EMQDISCON_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len);
+
+static void MQTT_Init(void)
+{
+	memset(&MQTT, 0, sizeof(MQTT));
+	MQTT.Id = -1;
+	MQTT.Backoff = ME3616_MQTT_BACKOFF_MIN;
+
+	if((ME3616_Register_URC("+EMQPUB", MQTT_EMQPUB_Report) == false) ||
+	   (ME3616_Register_URC("+EMQDISCON", MQTT_EMQDISCON_Report) == false))
+	{
+		ME3616_ErrorHandler(__FILE__, __LINE__, "ME3616_URC_TABLE_SIZE too small.");
+	}
+	//AT+EMQPUB answers OK only, +EMQPUB meanwhile is a received message.
+	ME3616_Set_URC_Interleave("+EMQPUB", true);
+	MQTT_Ready = true;
+}
+
+/**
+  * @brief  Connection is gone, next try after Wait, and a longer Wait after that.
+  */
+static void MQTT_Lost(ME_MQTT_t * mqtt)
+{
+	mqtt->State = ME_MQTT_LOST;
+	mqtt->LostTime = HAL_GetTick();
+	mqtt->Wait = mqtt->Backoff;
+	mqtt->Backoff = (mqtt->Backoff < ME3616_MQTT_BACKOFF_MAX / 2) ? (2 * mqtt->Backoff) : ME3616_MQTT_BACKOFF_MAX;
+
+	for(uint8_t i = 0; i < ME3616_MQTT_SUB_MAX; i++) mqtt->Sub[i].Subscribed = false;
+}
+
+/**
+  * @brief  Match a topic against a filter, '+' takes one level, '#' the rest.
+  * @note   Neither is copied nor needs '\0'. A topic starting with '$' is not taken
+  *         by a filter starting with a wildcard. "a/#" takes "a" too.
+  * @param  filter: topic filter.
+  * @param  filter_len: length of filter.
+  * @param  topic: topic name.
+  * @param  topic_len: length of topic.
+  * @retval true for a match.
+  */
+bool ME_MQTT_Topic_Match(const char * filter, uint16_t filter_len, const char * topic, uint16_t topic_len)
+{
+	uint16_t f = 0;
+	uint16_t t = 0;
+
+	if((filter_len != 0) && (topic_len != 0) && (topic[0] == '$') && ((filter[0] == '+') || (filter[0] == '#'))) return false;
+
+	while(f < filter_len)
+	{
+		if(filter[f] == '#') return true;
+
+		//One level of both
+		if(filter[f] == '+')
+		{
+			while((t < topic_len) && (topic[t] != '/')) t++;
+			f++;
+		}
+		else
+		{
+			while((f < filter_len) && (filter[f] != '/'))
+			{
+				if((t >= topic_len) || (topic[t] != filter[f])) return false;
+				f++;
+				t++;
+			}
+		}
+
+		if(f == filter_len) break;
+
+		//filter[f] is '/', the topic may end here for "<level>/#"
+		if(t == topic_len) return ((f + 2 == filter_len) && (filter[f + 1] == '#'));
+		if(topic[t] != '/') return false;
+		f++;
+		t++;
+	}
+	return (t == topic_len);
+}
+
+/**
+  * @brief  '#' only as the last level, '+' only as a whole level.
+  */
+static bool MQTT_Filter_Valid(const char * filter, uint16_t len)
+{
+	if((len == 0) || (len > 0xFF)) return false;
+
+	for(uint16_t i = 0; i < len; i++)
+	{
+		if((filter[i] != '#') && (filter[i] != '+')) continue;
+		if((i != 0) && (filter[i - 1] != '/')) return false;
+		if(filter[i] == '#')
+		{
+			if(i + 1 != len) return false;
+		}
+		else if((i + 1 != len) && (filter[i + 1] != '/')) return false;
+	}
+	return true;
+}
+
+/**
+  * @brief  Fields of +EMQPUB: <id>,"<topic>",<qos>,<retained>,<dup>,<len>,<hex>,
+  *         hex decoded over itself.
+  * @param  pch: Active Report string.
+  * @param  len: length of pch.
+  * @param  id: mqtt id.
+  * @param  topic: set to the topic in pch, ',' may be in a quoted one.
+  * @param  topic_len: length of topic.
+  * @param  payload: set to the decoded bytes in pch.
+  * @param  bytes: bytes of payload.
+  * @retval true for a well formed message.
+  */
+static bool MQTT_Parse_Publish(char * pch, uint16_t len, int32_t * id, const char ** topic, uint16_t * topic_len,
+                               uint8_t ** payload, uint16_t * bytes)
+{
+	const char * end = pch + len;
+	const char * p = ME3616_Report_Fields(pch, len);
+	int32_t value = 0;
+
+	if(ME3616_Parse_Int(&p, end, id) == false) return false;
+
+	while((p < end) && (*p == ' ')) p++;
+	if((p < end) && (*p == '"'))
+	{
+		*topic = ++p;
+		while((p < end) && (*p != '"')) p++;
+		*topic_len = p - *topic;
+		if(p < end) p++;
+	}
+	else
+	{
+		*topic = p;
+		while((p < end) && (*p != ',')) p++;
+		*topic_len = p - *topic;
+	}
+	if((p >= end) || (*p != ',')) return false;
+	p++;
+
+	//<qos>,<retained>,<dup>, then <len> of hex
+	for(uint8_t i = 0; i < 4; i++)
+	{
+		if(ME3616_Parse_Int(&p, end, &value) == false) return false;
+	}
+	if((p < end) && (*p == '"')) p++;
+	if(((value & 1) != 0) || (end - p < value)) return false;
+
+	*payload = (uint8_t *)p;
+	*bytes = Hex_Decode(*payload, value / 2, p, value);
+	return (*bytes == value / 2);
+}
+
+/**
+  * @brief  +EMQPUB, a message of a subscribed topic, to the handler of every
+  *         matching filter. Topic and payload stay where they are in RxBuffer.
+  */
+static void MQTT_EMQPUB_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	const char * topic = NULL;
+	uint16_t topic_len = 0;
+	uint8_t * payload = NULL;
+	uint16_t bytes = 0;
+	int32_t id = 0;
+	bool taken = false;
+
+	UNUSED(Me3616);
+	if(MQTT_Parse_Publish(pch, len, &id, &topic, &topic_len, &payload, &bytes) == false)
+	{
+		DBG_Print("MQTT +EMQPUB malformed.", DBG_DIR_AT);
+		return;
+	}
+	if(id != MQTT.Id) return;
+
+	MQTT.Received++;
+	for(uint8_t i = 0; i < ME3616_MQTT_SUB_MAX; i++)
+	{
+		ME_MQTT_Sub_t * sub = &MQTT.Sub[i];
+
+		if((sub->Filter == NULL) || (sub->Handler == NULL)) continue;
+		if(ME_MQTT_Topic_Match(sub->Filter, sub->Len, topic, topic_len) == false) continue;
+
+		sub->Handler(sub->Context, topic, topic_len, payload, bytes);
+		taken = true;
+	}
+	if(taken == false) MQTT.Unmatched++;
+}
+
+/**
+  * @brief  +EMQDISCON: <id>,<err_code>, the broker connection is gone.
+  */
+static void MQTT_EMQDISCON_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	const char * end = pch + len;
+	const char * p = ME3616_Report_Fields(pch, len);
+	int32_t id = 0;
+	int32_t error = 0;
+
+	UNUSED(Me3616);
+	DBG_Print(pch, DBG_DIR_RX);
+
+	if((ME3616_Parse_Int(&p, end, &id) == false) || (id != MQTT.Id)) return;
+	if(ME3616_Parse_Int(&p, end, &error) == true) MQTT.Error = error;
+
+	if(MQTT.State == ME_MQTT_CONNECTED) MQTT_Lost(&MQTT);
+}
+
+static bool MQTT_Subscribe_Send(ME_MQTT_t * mqtt, ME_MQTT_Sub_t * sub)
+{
+	char param[MQTT_PARAM_SIZE];
+	int len = snprintf(param, sizeof(param), "%ld,\"%.*s\",%u", (long)mqtt->Id, sub->Len, sub->Filter, sub->QoS);
+
+	if((len <= 0) || (len >= (int)sizeof(param))) return false;
+
+	sub->Subscribed = ME3616_Exec_AT_Command(mqtt->Me3616, AT_CMD_MQTT_EMQSUB, param);
+	return sub->Subscribed;
+}
+
+static bool MQTT_Publish_Send(ME_MQTT_t * mqtt, const char * topic, const uint8_t * data, uint16_t len, uint8_t qos, bool retain)
+{
+	char param[ME3616_TX_BUFFER_SIZE];
+	int n = snprintf(param, sizeof(param), "%ld,\"%s\",%u,%d,0,%u,", (long)mqtt->Id, topic, qos, (retain == true) ? 1 : 0, 2 * len);
+
+	if((n <= 0) || (n >= (int)sizeof(param))) return false;
+
+	if(ME3616_Exec_AT_Hex(mqtt->Me3616, AT_CMD_MQTT_EMQPUB, param, data, len) == false) return false;
+	mqtt->Published++;
+	return true;
+}
+
+/**
+  * @brief  AT+EMQNEW, AT+EMQCON, and AT+EMQSUB of every filter.
+  * @retval true for connected.
+  */
+static bool MQTT_Connect(ME_MQTT_t * mqtt)
+{
+	const ME_MQTT_Config_t * config = &mqtt->Config;
+	char param[MQTT_PARAM_SIZE];
+	int len = 0;
+
+	//Old client of ME3616 goes first, it may be gone already.
+	if(mqtt->Id >= 0)
+	{
+		sprintf(param, "%ld", (long)mqtt->Id);
+		ME3616_Exec_AT_Command(mqtt->Me3616, AT_CMD_MQTT_EMQDISCON, param);
+		mqtt->Id = -1;
+	}
+
+	len = snprintf(param, sizeof(param), "\"%s\",\"%u\",%u,%u", config->Server, (unsigned)config->Port,
+	               ME3616_MQTT_COMMAND_TIMEOUT, ME3616_MQTT_BUFFER_SIZE);
+	if((len <= 0) || (len >= (int)sizeof(param))) return false;
+	if(ME3616_Exec_AT_Command(mqtt->Me3616, AT_CMD_MQTT_EMQNEW, param) == false) return false;
+	if(AT_Response_Get_Int(ME3616_Get_Response(mqtt->Me3616), 0, &mqtt->Id) == false) return false;
+
+	if(config->User != NULL)
+	{
+		len = snprintf(param, sizeof(param), "%ld,%d,\"%s\",%u,%d,0,\"%s\",\"%s\"", (long)mqtt->Id, MQTT_PROTOCOL_VERSION,
+		               config->ClientId, (unsigned)config->KeepAlive, (config->CleanSession == true) ? 1 : 0,
+		               config->User, (config->Password != NULL) ? config->Password : "");
+	}
+	else
+	{
+		len = snprintf(param, sizeof(param), "%ld,%d,\"%s\",%u,%d,0", (long)mqtt->Id, MQTT_PROTOCOL_VERSION,
+		               config->ClientId, (unsigned)config->KeepAlive, (config->CleanSession == true) ? 1 : 0);
+	}
+	if((len <= 0) || (len >= (int)sizeof(param))) return false;
+	if(ME3616_Exec_AT_Command(mqtt->Me3616, AT_CMD_MQTT_EMQCON, param) == false) return false;
+
+	for(uint8_t i = 0; i < ME3616_MQTT_SUB_MAX; i++)
+	{
+		if((mqtt->Sub[i].Filter != NULL) && (MQTT_Subscribe_Send(mqtt, &mqtt->Sub[i]) == false)) return false;
+	}
+
+	mqtt->State = ME_MQTT_CONNECTED;
+	mqtt->Backoff = ME3616_MQTT_BACKOFF_MIN;
+	mqtt->Connects++;
+	return true;
+}
+
+/**
+  * @brief  Keep a message for the next connect, a queued one of the topic takes its payload.
+  */
+static void MQTT_Enqueue(ME_MQTT_t * mqtt, const char * topic, const uint8_t * data, uint16_t len, uint8_t qos, bool retain)
+{
+	ME_MQTT_Message_t * message = NULL;
+
+	for(uint8_t i = 0; i < mqtt->QueueCount; i++)
+	{
+		message = &mqtt->Queue[(mqtt->QueueHead + i) % ME3616_MQTT_QUEUE_SIZE];
+		if(strcmp(message->Topic, topic) == 0)
+		{
+			mqtt->Coalesced++;
+			break;
+		}
+		message = NULL;
+	}
+
+	if(message == NULL)
+	{
+		if(mqtt->QueueCount >= ME3616_MQTT_QUEUE_SIZE)
+		{
+			mqtt->QueueHead = (mqtt->QueueHead + 1) % ME3616_MQTT_QUEUE_SIZE;
+			mqtt->QueueCount--;
+			mqtt->Dropped++;
+		}
+		message = &mqtt->Queue[(mqtt->QueueHead + mqtt->QueueCount) % ME3616_MQTT_QUEUE_SIZE];
+		mqtt->QueueCount++;
+		strcpy(message->Topic, topic);
+	}
+
+	message->QoS = qos;
+	message->Retain = retain;
+	message->Len = len;
+	memcpy(message->Payload, data, len);
+}
+
+/**
+  * @brief  Publish queued messages in order, stop at the first failed one.
+  */
+static void MQTT_Flush(ME_MQTT_t * mqtt)
+{
+	ME_MQTT_Message_t * message = NULL;
+
+	while((mqtt->QueueCount != 0) && (mqtt->State == ME_MQTT_CONNECTED))
+	{
+		message = &mqtt->Queue[mqtt->QueueHead];
+		if(MQTT_Publish_Send(mqtt, message->Topic, message->Payload, message->Len, message->QoS, message->Retain) == false)
+		{
+			MQTT_Lost(mqtt);
+			break;
+		}
+		mqtt->QueueHead = (mqtt->QueueHead + 1) % ME3616_MQTT_QUEUE_SIZE;
+		mqtt->QueueCount--;
+	}
+}
+
+/**
+  * @brief  Parse received strings, reconnect once Wait is over, publish queued messages.
+  * @note   Call from main loop while the client is open. Does nothing from an
+  *         Active Report handler.
+  * @param  Me3616: Instance of Me3616.
+  * @retval true if connected.
+  */
+bool ME_MQTT_Poll(Me3616_DeviceType * Me3616)
+{
+	if((MQTT_Ready == false) || (MQTT.Me3616 != Me3616) || (Me3616->RxProcessing == true)) return false;
+
+	ME3616_Rx_Process(Me3616);
+
+	if((MQTT.State == ME_MQTT_LOST) && ((HAL_GetTick() - MQTT.LostTime) >= MQTT.Wait))
+	{
+		if(MQTT_Connect(&MQTT) == true)
+		{
+			DBG_Print("MQTT reconnected.", DBG_DIR_AT);
+		}
+		else
+		{
+			MQTT_Lost(&MQTT);
+			DBG_Printf(DBG_DIR_AT, "MQTT reconnect failed, next in %lu ms.", (unsigned long)MQTT.Wait);
+		}
+	}
+
+	MQTT_Flush(&MQTT);
+	return (MQTT.State == ME_MQTT_CONNECTED);
+}
+
+/**
+  * @brief  Connect to the broker, AT+EMQNEW and AT+EMQCON, and subscribe every filter.
+  * @param  Me3616: Instance of Me3616.
+  * @param  config: broker and session, its strings MUST stay valid until me_mqtt_close().
+  * @retval true for connected. false for already open, or the first try failed,
+  *         ME_MQTT_Poll() goes on trying then.
+  */
+bool me_mqtt_open(Me3616_DeviceType * Me3616, const ME_MQTT_Config_t * config)
+{
+	if(MQTT_Ready == false) MQTT_Init();
+	if((config == NULL) || (config->Server == NULL) || (config->ClientId == NULL)) return false;
+	if(MQTT.State != ME_MQTT_CLOSED) return false;
+
+	MQTT.Me3616 = Me3616;
+	MQTT.Config = *config;
+	MQTT.Backoff = ME3616_MQTT_BACKOFF_MIN;
+
+	if(MQTT_Connect(&MQTT) == false)
+	{
+		MQTT_Lost(&MQTT);
+		return false;
+	}
+	MQTT_Flush(&MQTT);
+	return true;
+}
+
+/**
+  * @brief  Disconnect, AT+EMQDISCON. Queued messages go, subscriptions stay for the next open.
+  * @retval true for success, false for not open or ME3616 refused.
+  */
+bool me_mqtt_close(void)
+{
+	char param[16];
+	bool res = true;
+
+	if((MQTT_Ready == false) || (MQTT.State == ME_MQTT_CLOSED)) return false;
+
+	if(MQTT.Id >= 0)
+	{
+		sprintf(param, "%ld", (long)MQTT.Id);
+		res = ME3616_Exec_AT_Command(MQTT.Me3616, AT_CMD_MQTT_EMQDISCON, param);
+	}
+	MQTT.State = ME_MQTT_CLOSED;
+	MQTT.Id = -1;
+	MQTT.QueueHead = 0;
+	MQTT.QueueCount = 0;
+	for(uint8_t i = 0; i < ME3616_MQTT_SUB_MAX; i++) MQTT.Sub[i].Subscribed = false;
+	return res;
+}
+
+/**
+  * @brief  Subscribe a topic filter, AT+EMQSUB if connected, on every connect after.
+  * @note   A filter subscribed again takes the new qos and handler.
+  * @param  filter: topic filter, '+' and '#' wildcards. MUST stay valid, string literal is best.
+  * @param  qos: 0 to 2.
+  * @param  handler: called with each message of a matching topic.
+  * @param  context: passed to handler.
+  * @retval true for success, false for bad filter, table full or ME3616 refused.
+  */
+bool me_mqtt_subscribe(const char * filter, uint8_t qos, ME_MQTT_Handler_t handler, void * context)
+{
+	ME_MQTT_Sub_t * sub = NULL;
+	uint16_t len = 0;
+
+	if(MQTT_Ready == false) MQTT_Init();
+	if((filter == NULL) || (handler == NULL) || (qos > 2)) return false;
+
+	len = strlen(filter);
+	if(MQTT_Filter_Valid(filter, len) == false) return false;
+
+	for(uint8_t i = 0; i < ME3616_MQTT_SUB_MAX; i++)
+	{
+		if(MQTT.Sub[i].Filter == NULL)
+		{
+			if(sub == NULL) sub = &MQTT.Sub[i];
+		}
+		else if((MQTT.Sub[i].Len == len) && !memcmp(MQTT.Sub[i].Filter, filter, len))
+		{
+			sub = &MQTT.Sub[i];
+			break;
+		}
+	}
+	if(sub == NULL) return false;
+
+	sub->Filter = filter;
+	sub->Len = len;
+	sub->QoS = qos;
+	sub->Handler = handler;
+	sub->Context = context;
+	sub->Subscribed = false;
+
+	if((MQTT.State == ME_MQTT_CONNECTED) && (MQTT_Subscribe_Send(&MQTT, sub) == false))
+	{
+		sub->Filter = NULL;
+		return false;
+	}
+	return true;
+}
+
+/**
+  * @brief  Unsubscribe a topic filter, AT+EMQUNSUB if it is subscribed.
+  * @retval true for success, false for not subscribed.
+  */
+bool me_mqtt_unsubscribe(const char * filter)
+{
+	char param[MQTT_PARAM_SIZE];
+	uint16_t len = 0;
+
+	if((MQTT_Ready == false) || (filter == NULL)) return false;
+	len = strlen(filter);
+
+	for(uint8_t i = 0; i < ME3616_MQTT_SUB_MAX; i++)
+	{
+		ME_MQTT_Sub_t * sub = &MQTT.Sub[i];
+
+		if((sub->Filter == NULL) || (sub->Len != len) || memcmp(sub->Filter, filter, len)) continue;
+
+		if((MQTT.State == ME_MQTT_CONNECTED) && (sub->Subscribed == true) &&
+		   (snprintf(param, sizeof(param), "%ld,\"%s\"", (long)MQTT.Id, filter) < (int)sizeof(param)))
+		{
+			ME3616_Exec_AT_Command(MQTT.Me3616, AT_CMD_MQTT_EMQUNSUB, param);
+		}
+		sub->Filter = NULL;
+		sub->Handler = NULL;
+		sub->Subscribed = false;
+		return true;
+	}
+	return false;
+}
+
+/**
+  * @brief  Publish a message, AT+EMQPUB with the hex of data. Not connected, it is
+  *         queued, replacing a queued one of the same topic.
+  * @param  topic: topic name, shorter than ME3616_MQTT_TOPIC_SIZE.
+  * @param  data: payload, up to ME3616_MQTT_PAYLOAD_SIZE bytes.
+  * @param  len: bytes of data.
+  * @param  qos: 0 to 2.
+  * @param  retain: retained message.
+  * @retval true for published or queued, false for closed client or too long.
+  */
+bool me_mqtt_publish(const char * topic, const void * data, uint16_t len, uint8_t qos, bool retain)
+{
+	if((MQTT_Ready == false) || (MQTT.State == ME_MQTT_CLOSED)) return false;
+	if((topic == NULL) || ((data == NULL) && (len != 0)) || (qos > 2)) return false;
+	if((strlen(topic) >= ME3616_MQTT_TOPIC_SIZE) || (len > ME3616_MQTT_PAYLOAD_SIZE)) return false;
+
+	//Straight out, nothing queued before it
+	if((MQTT.State == ME_MQTT_CONNECTED) && (MQTT.QueueCount == 0) && (MQTT.Me3616->RxProcessing == false))
+	{
+		if(MQTT_Publish_Send(&MQTT, topic, (const uint8_t *)data, len, qos, retain) == true) return true;
+		MQTT_Lost(&MQTT);
+	}
+
+	MQTT_Enqueue(&MQTT, topic, (const uint8_t *)data, len, qos, retain);
+	if(MQTT.Me3616->RxProcessing == false) MQTT_Flush(&MQTT);
+	return true;
+}
+
+/**
+  * @brief  State, subscriptions and counters of the client.
+  */
+const ME_MQTT_t * ME_MQTT_Get(void)
+{
+	return &MQTT;
+}
@@ -0,0 +1,171 @@
+/**
+  ******************************************************************************
+  * @file    me3616_pool.c
+  * @author  Simon Luk (simonluk@unidevelop.net)
+  * @brief   Fixed block memory pools, O(1) and safe from IRQ
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2018 Simon Luk </center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of Simon Luk nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/*
+  Alloc and free are a single LDREX / STREX on Free, no IRQ is masked.
+  A thread interrupted between the two retries: exception entry and return
+  clear the exclusive monitor, so a block taken and given back by an IRQ
+  meanwhile (the ABA case of a lock-free stack) fails the STREX, it is not
+  linked twice.
+*/
+
+#include <string.h>
+
+#include "stm32l4xx_hal.h"
+#include "me3616_pool.h"
+
+static inline uint32_t * Pool_Link(Pool_t * pool, uint32_t index)
+{
+	return (uint32_t *)(pool->Storage + index * pool->BlockSize);
+}
+
+static uint32_t Pool_Add(volatile uint32_t * counter, int32_t delta)
+{
+	uint32_t value = 0;
+
+	do
+	{
+		value = __LDREXW(counter) + (uint32_t)delta;
+	}while(__STREXW(value, counter) != 0);
+	return value;
+}
+
+static void Pool_Track(Pool_t * pool, uint32_t used)
+{
+	uint32_t high = 0;
+
+	do
+	{
+		high = __LDREXW(&pool->HighWater);
+		if(used <= high)
+		{
+			__CLREX();
+			return;
+		}
+	}while(__STREXW(used, &pool->HighWater) != 0);
+}
+
+/**
+  * @brief  Set up a pool over storage, all blocks free, statistics cleared.
+  * @note   Not safe against Pool_Alloc() / Pool_Free() of the same pool, call
+  *         before the pool is used. POOL_DEFINE() needs no call at all.
+  * @param  pool: pool to set up.
+  * @param  storage: block_count blocks of POOL_BLOCK_SIZE(block_size), aligned to POOL_ALIGN.
+  * @param  block_size: bytes of a block, rounded up to POOL_ALIGN.
+  * @param  block_count: blocks in storage.
+  * @retval false if storage is NULL or misaligned, or there is no block.
+  */
+bool Pool_Init(Pool_t * pool, void * storage, uint16_t block_size, uint16_t block_count)
+{
+	if((pool == NULL) || (storage == NULL) || (((uintptr_t)storage % POOL_ALIGN) != 0)) return false;
+	if((block_size == 0) || (block_count == 0)) return false;
+
+	memset(pool, 0, sizeof(Pool_t));
+	pool->Storage = (uint8_t *)storage;
+	pool->BlockSize = POOL_BLOCK_SIZE(block_size);
+	pool->BlockCount = block_count;
+	return true;
+}
+
+/**
+  * @brief  Take a block, the last one freed first, else one never used.
+  * @note   Contents of the block are left as they are.
+  * @param  pool: pool to take from.
+  * @retval the block, NULL if all blocks are out.
+  */
+void * Pool_Alloc(Pool_t * pool)
+{
+	uint32_t head = 0;
+	uint32_t index = 0;
+
+	do
+	{
+		head = __LDREXW(&pool->Free);
+		if(head == 0)
+		{
+			__CLREX();
+			break;
+		}
+	}while(__STREXW(*Pool_Link(pool, head - 1), &pool->Free) != 0);
+
+	if(head != 0)
+	{
+		index = head - 1;
+	}
+	else
+	{
+		do
+		{
+			index = __LDREXW(&pool->Fresh);
+			if(index >= pool->BlockCount)
+			{
+				__CLREX();
+				Pool_Add(&pool->Failed, 1);
+				return NULL;
+			}
+		}while(__STREXW(index + 1, &pool->Fresh) != 0);
+	}
+
+	Pool_Track(pool, Pool_Add(&pool->Used, 1));
+	return Pool_Link(pool, index);
+}
+
+/**
+  * @brief  Give a block back to its pool.
+  * @param  pool: pool the block was taken from.
+  * @param  block: from Pool_Alloc() of this pool, NULL is ignored.
+  * @retval false if block is not a block of this pool.
+  */
+bool Pool_Free(Pool_t * pool, void * block)
+{
+	uint32_t offset = 0;
+	uint32_t head = 0;
+
+	if(block == NULL) return true;
+	if((uint8_t *)block < pool->Storage) return false;
+
+	offset = (uint32_t)((uint8_t *)block - pool->Storage);
+	if((offset % pool->BlockSize) != 0 || (offset / pool->BlockSize) >= pool->BlockCount) return false;
+
+	do
+	{
+		head = __LDREXW(&pool->Free);
+		*(uint32_t *)block = head;
+	}while(__STREXW(offset / pool->BlockSize + 1, &pool->Free) != 0);
+
+	Pool_Add(&pool->Used, -1);
+	return true;
+}
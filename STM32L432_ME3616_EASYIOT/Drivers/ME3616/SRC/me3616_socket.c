@@ -0,0 +1,685 @@
+/**
+  ******************************************************************************
+  * @file    me3616_socket.c
+  * @author  Simon Luk (simonluk@unidevelop.net)
+  * @brief   TCP / UDP sockets of ME3616, over AT+ESOC / AT+ESOCON / AT+ESOSENDRAW,
+  *          with a receive ring for each socket
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2018 Simon Luk </center></h2>
+  *
+  * Redistribution and use in source and binary forms, with or without modification,
+  * are permitted provided that the following conditions are met:
+  *   1. Redistributions of source code must retain the above copyright notice,
+  *      this list of conditions and the following disclaimer.
+  *   2. Redistributions in binary form must reproduce the above copyright notice,
+  *      this list of conditions and the following disclaimer in the documentation
+  *      and/or other materials provided with the distribution.
+  *   3. Neither the name of Simon Luk nor the names of its contributors
+  *      may be used to endorse or promote products derived from this software
+  *      without specific prior written permission.
+  *
+  * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+  * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+  * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+  * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+  * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+  * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+  * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+  *
+  ******************************************************************************
+  */
+
+/*
+  A socket is a slot of Socket[], fd is its index, Id the socket id ME3616 gave
+  by +ESOC. Received bytes go into the ring of the socket, two ways:
+  - push: +ESONMI=<id>,<len>,<data> carries the data, copied or decoded straight
+    into the ring from RxBuffer, this is the default of ME3616.
+  - hold: after AT+ESOREADEN=1 ME3616 keeps the data and only tells its length by
+    +ESODATA=<id>,<len>. It is read by AT+ESOREAD=<id>,<len> when the ring has room.
+  Once a ring has less than ME3616_SOCKET_RX_LOW_ROOM, ME_Socket_Poll() turns
+  ME3616 to hold, so nothing more is pushed than the ring takes. It goes back to
+  push when every ring has drained and nothing is held. A push that still does
+  not fit is dropped, for UDP the datagram alone, for TCP the socket is broken.
+  Active Report handlers only update the rings and counters, AT commands are
+  sent from thread context, by me_xxx() and ME_Socket_Poll().
+
+  With ME3616_SOCKET_RAW <data> is binary, AT+ESOSETRPT=1. +ESOREAD is a counted
+  line, the framer takes <len> bytes after the length field as they are. +ESONMI
+  is a streamed line, its bytes go into the ring as DMA writes them, so <len> is
+  not bounded by RxBuffer, and are published at its end. A line broken by an Rx
+  overrun is dropped like one the ring can not take. Data is sent by
+  AT+ESOSENDRAW=<id>,<len> followed by the bytes, DMA reads them from the
+  caller's buffer, nothing is hex encoded.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "me3616.h"
+#include "me3616_hex.h"
+#include "me3616_socket.h"
+
+#if (ME3616_SOCKET_RX_SIZE & (ME3616_SOCKET_RX_SIZE - 1)) != 0
+#error "ME3616_SOCKET_RX_SIZE must be a power of 2."
+#endif
+
+#if ME3616_SOCKET_READ_CHUNK > ME3616_RESPONSE_DATA_SIZE
+#error "ME3616_SOCKET_READ_CHUNK must fit ME3616_RESPONSE_DATA_SIZE."
+#endif
+
+#ifdef ME3616_SOCKET_RAW
+#define SOCKET_SEND_CHUNK               ME3616_SOCKET_SEND_MAX
+#else
+//Payload bytes of one AT+ESOSEND=<id>,<len>,<hex> line in TxBuffer, socket id and length up to 2 and 3 digits
+#define SOCKET_SEND_CHUNK               ((uint16_t)((ME3616_TX_BUFFER_SIZE - 1 - (sizeof("AT+ESOSEND=00,000,\r\n") - 1)) / 2))
+#endif
+
+//AT+ESOSETRPT=<mode> of +ESONMI / +ESOREAD data
+#define SOCKET_REPORT_HEX               0
+#define SOCKET_REPORT_RAW               1
+
+//Index of <len> in +ESONMI=<id>,<len>,<data> and +ESOREAD: <id>,<len>,<data>,<remaining>
+#define SOCKET_LENGTH_FIELD             1
+
+//AT+ESOC=<domain>,<type>,<protocol>, IPv4 and IP
+#define SOCKET_DOMAIN_IPV4              1
+#define SOCKET_PROTOCOL_IP              1
+
+static ME_Socket_t Socket[ME3616_SOCKET_MAX];
+static bool Socket_Ready = false;
+static bool Socket_Hold = false;             //ME3616 holds received data, AT+ESOREADEN=1 answered OK
+static bool Socket_Hold_Wanted = false;      //a ring is short of room, ME_Socket_Poll() turns hold on
+
+#ifdef ME3616_SOCKET_RAW
+static ME_Socket_t * Socket_Stream = NULL;   //socket of the +ESONMI in framing, NULL for none or dropped
+static uint32_t Socket_Stream_Head = 0;      //ring position of its next byte, RxHead once it ends
+static uint32_t Socket_Stream_Left = 0;      //bytes of it still to come
+#endif
+
+#ifdef ME3616_SOCKET_RAW
+static void Socket_ESONMI_Stream(Me3616_DeviceType * Me3616, AT_Stream_Event_t event, const char * pch, uint16_t len);
+#else
+static void Socket_ESONMI_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len);
+#endif
+static void Socket_ESODATA_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len);
+static void Socket_ESOERR_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len);
+
+/**
+  * @brief  Register the Active Reports, and with ME3616_SOCKET_RAW turn ME3616 to binary data.
+  * @param  Me3616: Instance of Me3616.
+  * @retval true for ready.
+  */
+static bool Socket_Init(Me3616_DeviceType * Me3616)
+{
+	char param[4];
+
+	memset(Socket, 0, sizeof(Socket));
+	Socket_Hold = false;
+	Socket_Hold_Wanted = false;
+
+	if((ME3616_Register_URC("+ESODATA", Socket_ESODATA_Report) == false) ||
+	   (ME3616_Register_URC("+ESOERR", Socket_ESOERR_Report) == false))
+	{
+		ME3616_ErrorHandler(__FILE__, __LINE__, "ME3616_URC_TABLE_SIZE too small.");
+	}
+
+#ifdef ME3616_SOCKET_RAW
+	//Counted before ME3616 may send them binary.
+	Socket_Stream = NULL;
+	if((ME3616_Register_Stream("+ESONMI", SOCKET_LENGTH_FIELD, Socket_ESONMI_Stream) == false) ||
+	   (ME3616_Register_Counted("+ESOREAD", SOCKET_LENGTH_FIELD) == false))
+	{
+		ME3616_ErrorHandler(__FILE__, __LINE__, "ME3616_COUNTED_TABLE_SIZE too small.");
+	}
+	sprintf(param, "%d", SOCKET_REPORT_RAW);
+#else
+	if(ME3616_Register_URC("+ESONMI", Socket_ESONMI_Report) == false)
+	{
+		ME3616_ErrorHandler(__FILE__, __LINE__, "ME3616_URC_TABLE_SIZE too small.");
+	}
+	sprintf(param, "%d", SOCKET_REPORT_HEX);
+#endif
+	if(ME3616_Exec_AT_Command(Me3616, AT_CMD_TCPIP_ESOSETRPT, param) == false)
+	{
+#ifdef ME3616_SOCKET_RAW
+		ME3616_Unregister_Counted("+ESONMI");
+		ME3616_Unregister_Counted("+ESOREAD");
+#endif
+		return false;
+	}
+
+	Socket_Ready = true;
+	return true;
+}
+
+static ME_Socket_t * Socket_From_fd(int fd)
+{
+	if((fd < 0) || (fd >= ME3616_SOCKET_MAX) || (Socket[fd].State == ME_SOCKET_CLOSED)) return NULL;
+	return &Socket[fd];
+}
+
+static ME_Socket_t * Socket_From_Id(int32_t id)
+{
+	for(uint8_t i = 0; i < ME3616_SOCKET_MAX; i++)
+	{
+		if((Socket[i].State != ME_SOCKET_CLOSED) && (Socket[i].Id == id)) return &Socket[i];
+	}
+	return NULL;
+}
+
+static inline uint32_t Socket_Room(const ME_Socket_t * s)
+{
+	return ME3616_SOCKET_RX_SIZE - (s->RxHead - s->RxTail);
+}
+
+//Copy into the ring at position head, not published until RxHead moves past it.
+static void Socket_Copy(ME_Socket_t * s, uint32_t head, const uint8_t * data, uint16_t len)
+{
+	uint16_t index = head & (ME3616_SOCKET_RX_SIZE - 1);
+	uint16_t first = (len < ME3616_SOCKET_RX_SIZE - index) ? len : (ME3616_SOCKET_RX_SIZE - index);
+
+	memcpy(s->Rx + index, data, first);
+	memcpy(s->Rx, data + first, len - first);
+}
+
+static void Socket_Write(ME_Socket_t * s, const uint8_t * data, uint16_t len)
+{
+	Socket_Copy(s, s->RxHead, data, len);
+	s->RxHead += len;
+}
+
+static uint16_t Socket_Read(ME_Socket_t * s, uint8_t * buf, uint16_t size)
+{
+	uint32_t count = s->RxHead - s->RxTail;
+	uint16_t index = s->RxTail & (ME3616_SOCKET_RX_SIZE - 1);
+	uint16_t len = (count < size) ? count : size;
+	uint16_t first = (len < ME3616_SOCKET_RX_SIZE - index) ? len : (ME3616_SOCKET_RX_SIZE - index);
+
+	memcpy(buf, s->Rx + index, first);
+	memcpy(buf + first, s->Rx, len - first);
+	s->RxTail += len;
+	return len;
+}
+
+/**
+  * @brief  Fields of "<name>=<id>,<len>..." or "<name>: <id>,<len>...".
+  * @param  pch: Active Report string.
+  * @param  len: length of pch.
+  * @param  p: set to the field after <len>.
+  * @param  id: socket id.
+  * @param  length: second field.
+  * @retval true for both fields parsed.
+  */
+static bool Socket_Parse_Report(const char * pch, uint16_t len, const char ** p, int32_t * id, int32_t * length)
+{
+	const char * end = pch + len;
+	const char * q = ME3616_Report_Fields(pch, len);
+
+	if((ME3616_Parse_Int(&q, end, id) == false) || (ME3616_Parse_Int(&q, end, length) == false)) return false;
+
+	*p = q;
+	return true;
+}
+
+/**
+  * @brief  Count pushed data that is lost, a TCP socket is broken by it.
+  * @param  s: socket.
+  * @param  length: bytes lost.
+  * @retval None.
+  */
+static void Socket_Drop(ME_Socket_t * s, uint32_t length)
+{
+	s->RxDropped += length;
+	Socket_Hold_Wanted = true;
+	if(s->Type == ME_SOCK_STREAM)
+	{
+		s->State = ME_SOCKET_ERROR;
+		s->Error = ME_SOCKET_ERR_RX_OVERFLOW;
+	}
+	DBG_Printf(DBG_DIR_AT, "Socket %ld, %ld bytes dropped.", (long)s->Id, (long)length);
+}
+
+/**
+  * @brief  Take or drop pushed data of length bytes. Once the ring is short of
+  *         room ME_Socket_Poll() turns ME3616 to hold.
+  * @note   A datagram is kept whole or dropped. A TCP stream with a gap is broken,
+  *         me_recv() hands out the ring, then fails.
+  * @param  s: socket.
+  * @param  length: bytes pushed.
+  * @retval true if the ring takes them.
+  */
+static bool Socket_Accept(ME_Socket_t * s, uint32_t length)
+{
+	if(length <= Socket_Room(s))
+	{
+		if(Socket_Room(s) - length < ME3616_SOCKET_RX_LOW_ROOM) Socket_Hold_Wanted = true;
+		return true;
+	}
+
+	Socket_Drop(s, length);
+	return false;
+}
+
+#ifdef ME3616_SOCKET_RAW
+/**
+  * @brief  +ESONMI=<id>,<len>,<data> streamed, data goes into the ring as DMA writes it.
+  * @note   The ring has room for the whole line before a byte goes in, RxHead moves
+  *         at its end, so me_recv() never sees a part of it.
+  */
+static void Socket_ESONMI_Stream(Me3616_DeviceType * Me3616, AT_Stream_Event_t event, const char * pch, uint16_t len)
+{
+	const char * p = NULL;
+	int32_t id = 0;
+	int32_t length = 0;
+	uint16_t piece = 0;
+
+	UNUSED(Me3616);
+	switch(event)
+	{
+	case AT_STREAM_HEAD:
+		Socket_Stream = NULL;
+		if(Socket_Parse_Report(pch, len, &p, &id, &length) == false)
+		{
+			DBG_Print("Socket +ESONMI malformed.", DBG_DIR_AT);
+			break;
+		}
+
+		Socket_Stream = Socket_From_Id(id);
+		if(Socket_Stream == NULL)
+		{
+			DBG_Printf(DBG_DIR_AT, "Socket +ESONMI of unknown socket %ld.", (long)id);
+		}
+		else if(Socket_Accept(Socket_Stream, length) == false)
+		{
+			Socket_Stream = NULL;
+		}
+		else
+		{
+			Socket_Stream_Head = Socket_Stream->RxHead;
+			Socket_Stream_Left = length;
+		}
+		break;
+
+	case AT_STREAM_DATA:
+		if(Socket_Stream == NULL) break;
+		piece = (len < Socket_Stream_Left) ? len : (uint16_t)Socket_Stream_Left;
+		Socket_Copy(Socket_Stream, Socket_Stream_Head, (const uint8_t *)pch, piece);
+		Socket_Stream_Head += piece;
+		Socket_Stream_Left -= piece;
+		break;
+
+	case AT_STREAM_END:
+		if(Socket_Stream != NULL) Socket_Stream->RxHead = Socket_Stream_Head;
+		Socket_Stream = NULL;
+		break;
+
+	case AT_STREAM_ABORT:
+		//Rx overrun broke the line, the bytes it had are not published.
+		if(Socket_Stream != NULL) Socket_Drop(Socket_Stream, Socket_Stream_Head - Socket_Stream->RxHead + Socket_Stream_Left);
+		Socket_Stream = NULL;
+		break;
+	}
+}
+#else
+/**
+  * @brief  Decode hex into the ring, in up to two pieces, the caller checked room.
+  * @param  s: socket.
+  * @param  hex: 2 * len hex digits.
+  * @param  len: bytes to write.
+  * @retval true for written, false for not hex.
+  */
+static bool Socket_Write_Hex(ME_Socket_t * s, const char * hex, uint16_t len)
+{
+	uint16_t index = s->RxHead & (ME3616_SOCKET_RX_SIZE - 1);
+	uint16_t first = (len < ME3616_SOCKET_RX_SIZE - index) ? len : (ME3616_SOCKET_RX_SIZE - index);
+
+	if(Hex_Decode(s->Rx + index, first, hex, 2 * first) != first) return false;
+	if(Hex_Decode(s->Rx, len - first, hex + 2 * first, 2 * (len - first)) != len - first) return false;
+
+	s->RxHead += len;
+	return true;
+}
+
+/**
+  * @brief  +ESONMI=<id>,<len>,<data>, hex data pushed by ME3616, decoded into the ring in place.
+  */
+static void Socket_ESONMI_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	const char * end = pch + len;
+	const char * p = NULL;
+	ME_Socket_t * s = NULL;
+	int32_t id = 0;
+	int32_t length = 0;
+
+	UNUSED(Me3616);
+	if(Socket_Parse_Report(pch, len, &p, &id, &length) == false)
+	{
+		DBG_Print("Socket +ESONMI malformed.", DBG_DIR_AT);
+		return;
+	}
+	if((p < end) && (*p == '"')) p++;
+
+	s = Socket_From_Id(id);
+	if(s == NULL)
+	{
+		DBG_Printf(DBG_DIR_AT, "Socket +ESONMI of unknown socket %ld.", (long)id);
+		return;
+	}
+	if(end - p < 2 * length)
+	{
+		DBG_Print("Socket +ESONMI data short.", DBG_DIR_AT);
+		Socket_Drop(s, length);
+		return;
+	}
+
+	if(Socket_Accept(s, length) == false) return;
+	if(Socket_Write_Hex(s, p, (uint16_t)length) == false)
+	{
+		DBG_Print("Socket +ESONMI not hex.", DBG_DIR_AT);
+		Socket_Drop(s, length);
+	}
+}
+#endif
+
+/**
+  * @brief  +ESODATA=<id>,<len>, ME3616 holds len more bytes for AT+ESOREAD.
+  */
+static void Socket_ESODATA_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	const char * p = NULL;
+	ME_Socket_t * s = NULL;
+	int32_t id = 0;
+	int32_t length = 0;
+
+	UNUSED(Me3616);
+	if(Socket_Parse_Report(pch, len, &p, &id, &length) == false) return;
+
+	s = Socket_From_Id(id);
+	if(s != NULL) s->Pending += length;
+}
+
+/**
+  * @brief  +ESOERR=<id>,<error>, the socket is broken, TCP peer closed included.
+  */
+static void Socket_ESOERR_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	const char * p = NULL;
+	ME_Socket_t * s = NULL;
+	int32_t id = 0;
+	int32_t error = 0;
+
+	UNUSED(Me3616);
+	DBG_Print(pch, DBG_DIR_RX);
+	if(Socket_Parse_Report(pch, len, &p, &id, &error) == false) return;
+
+	s = Socket_From_Id(id);
+	if(s == NULL) return;
+	s->State = ME_SOCKET_ERROR;
+	s->Error = error;
+}
+
+/**
+  * @brief  Read what ME3616 holds for a socket, as much as its ring takes.
+  * @param  s: socket.
+  * @retval bytes read.
+  */
+static uint32_t Socket_Fetch(ME_Socket_t * s)
+{
+	const AT_Response_t * response = NULL;
+	const uint8_t * data = NULL;
+	char param[24];
+	uint32_t fetched = 0;
+	uint32_t chunk = 0;
+	int32_t remaining = 0;
+	uint16_t got = 0;
+
+	while((s->Pending != 0) && (s->State != ME_SOCKET_CLOSED))
+	{
+		chunk = Socket_Room(s);
+		if(chunk > s->Pending) chunk = s->Pending;
+		if(chunk > ME3616_SOCKET_READ_CHUNK) chunk = ME3616_SOCKET_READ_CHUNK;
+		if(chunk == 0) break;
+
+		sprintf(param, "%ld,%lu", (long)s->Id, (unsigned long)chunk);
+		if(ME3616_Exec_AT_Command(s->Me3616, AT_CMD_TCPIP_ESOREAD, param) == false)
+		{
+			//ME3616 has nothing more, do not ask again and again.
+			s->Pending = 0;
+			break;
+		}
+
+		response = ME3616_Get_Response(s->Me3616);
+		got = AT_Response_Get_Hex(response, 2, &data);
+		if(got > chunk) got = chunk;
+		Socket_Write(s, data, got);
+		fetched += got;
+
+		if(AT_Response_Get_Int(response, 3, &remaining) == true) s->Pending = remaining;
+		else s->Pending -= (got < s->Pending) ? got : s->Pending;
+
+		if(got == 0) s->Pending = 0;
+	}
+	return fetched;
+}
+
+static bool Socket_Drained(void)
+{
+	for(uint8_t i = 0; i < ME3616_SOCKET_MAX; i++)
+	{
+		if(Socket[i].State == ME_SOCKET_CLOSED) continue;
+		if((Socket[i].Pending != 0) || (Socket_Room(&Socket[i]) < 2 * ME3616_SOCKET_RX_LOW_ROOM)) return false;
+	}
+	return true;
+}
+
+/**
+  * @brief  Parse received strings, turn ME3616 to hold or push, and read data
+  *         ME3616 holds into rings with room.
+  * @note   Call from main loop while sockets are open, me_recv() calls it too.
+  *         Does nothing from an Active Report handler.
+  * @param  Me3616: Instance of Me3616.
+  * @retval true if bytes were read by AT+ESOREAD.
+  */
+bool ME_Socket_Poll(Me3616_DeviceType * Me3616)
+{
+	uint32_t fetched = 0;
+
+	if((Socket_Ready == false) || (Me3616->RxProcessing == true)) return false;
+
+	ME3616_Rx_Process(Me3616);
+
+	if((Socket_Hold_Wanted == true) && (Socket_Hold == false))
+	{
+		if(ME3616_Exec_AT_Command(Me3616, AT_CMD_TCPIP_ESOREADEN, "1") == true)
+		{
+			Socket_Hold = true;
+			DBG_Print("Socket receive held by ME3616.", DBG_DIR_AT);
+		}
+	}
+	if(Socket_Hold == true) Socket_Hold_Wanted = false;
+
+	for(uint8_t i = 0; i < ME3616_SOCKET_MAX; i++)
+	{
+		if((Socket[i].State != ME_SOCKET_CLOSED) && (Socket[i].Me3616 == Me3616)) fetched += Socket_Fetch(&Socket[i]);
+	}
+
+	if((Socket_Hold == true) && (Socket_Hold_Wanted == false) && (Socket_Drained() == true))
+	{
+		if(ME3616_Exec_AT_Command(Me3616, AT_CMD_TCPIP_ESOREADEN, "0") == true)
+		{
+			Socket_Hold = false;
+			DBG_Print("Socket receive pushed by ME3616.", DBG_DIR_AT);
+		}
+	}
+	return (fetched != 0);
+}
+
+/**
+  * @brief  Create a socket, AT+ESOC.
+  * @param  Me3616: Instance of Me3616.
+  * @param  type: ME_SOCK_STREAM for TCP, ME_SOCK_DGRAM for UDP.
+  * @retval fd of the socket, -1 for no free slot or ME3616 refused.
+  */
+int me_socket(Me3616_DeviceType * Me3616, ME_Socket_Type_t type)
+{
+	ME_Socket_t * s = NULL;
+	char param[24];
+	int32_t id = 0;
+	int fd = 0;
+
+	if((Socket_Ready == false) && (Socket_Init(Me3616) == false)) return -1;
+
+	for(fd = 0; fd < ME3616_SOCKET_MAX; fd++)
+	{
+		if(Socket[fd].State == ME_SOCKET_CLOSED) break;
+	}
+	if(fd >= ME3616_SOCKET_MAX) return -1;
+
+	sprintf(param, "%d,%d,%d", SOCKET_DOMAIN_IPV4, (int)type, SOCKET_PROTOCOL_IP);
+	if(ME3616_Exec_AT_Command(Me3616, AT_CMD_TCPIP_ESOC, param) == false) return -1;
+	if(AT_Response_Get_Int(ME3616_Get_Response(Me3616), 0, &id) == false) return -1;
+
+	s = &Socket[fd];
+	memset(s, 0, sizeof(ME_Socket_t));
+	s->Me3616 = Me3616;
+	s->Type = type;
+	s->Id = id;
+	s->State = ME_SOCKET_CREATED;
+	return fd;
+}
+
+/**
+  * @brief  Connect a TCP socket, or set the peer of a UDP socket, AT+ESOCON.
+  * @param  fd: from me_socket().
+  * @param  address: IPv4 address of the peer.
+  * @param  port: port of the peer.
+  * @retval 0 for success, -1 for fail.
+  */
+int me_connect(int fd, const char * address, uint16_t port)
+{
+	ME_Socket_t * s = Socket_From_fd(fd);
+	char param[64];
+	int len = 0;
+
+	if((s == NULL) || (s->State != ME_SOCKET_CREATED) || (address == NULL)) return -1;
+
+	len = snprintf(param, sizeof(param), "%ld,%u,\"%s\"", (long)s->Id, (unsigned)port, address);
+	if((len <= 0) || (len >= (int)sizeof(param))) return -1;
+
+	if(ME3616_Exec_AT_Command(s->Me3616, AT_CMD_TCPIP_ESOCON, param) == false) return -1;
+
+	s->State = ME_SOCKET_CONNECTED;
+	return 0;
+}
+
+/**
+  * @brief  Send data to the peer, AT+ESOSENDRAW with data as it is, or AT+ESOSEND
+  *         with the hex of data without ME3616_SOCKET_RAW.
+  * @note   TCP data goes in as many commands as needed, a UDP datagram must fit
+  *         one, ME3616_SOCKET_SEND_MAX bytes, or TxBuffer for hex.
+  * @param  fd: from me_socket(), connected.
+  * @param  data: bytes to send.
+  * @param  len: bytes of data.
+  * @retval bytes sent, -1 for nothing sent.
+  */
+int me_send(int fd, const void * data, uint16_t len)
+{
+	ME_Socket_t * s = Socket_From_fd(fd);
+	const uint8_t * p = (const uint8_t *)data;
+	char param[24];
+	uint16_t sent = 0;
+	uint16_t chunk = 0;
+
+	if((s == NULL) || (s->State != ME_SOCKET_CONNECTED) || (data == NULL)) return -1;
+	if(s->Me3616->RxProcessing == true) return -1;
+	if((s->Type == ME_SOCK_DGRAM) && (len > SOCKET_SEND_CHUNK))
+	{
+		DBG_Print("Socket datagram too long.", DBG_DIR_AT);
+		return -1;
+	}
+
+	while(sent < len)
+	{
+		chunk = ((len - sent) < SOCKET_SEND_CHUNK) ? (len - sent) : SOCKET_SEND_CHUNK;
+
+#ifdef ME3616_SOCKET_RAW
+		sprintf(param, "%ld,%u", (long)s->Id, (unsigned)chunk);
+		if(ME3616_Exec_AT_Raw(s->Me3616, AT_CMD_TCPIP_ESOSENDRAW, param, p + sent, chunk) == false) break;
+#else
+		sprintf(param, "%ld,%u,", (long)s->Id, (unsigned)chunk);
+		if(ME3616_Exec_AT_Hex(s->Me3616, AT_CMD_TCPIP_ESOSEND, param, p + sent, chunk) == false) break;
+#endif
+		sent += chunk;
+	}
+	s->TxBytes += sent;
+	return (sent == 0) ? -1 : sent;
+}
+
+/**
+  * @brief  Take received bytes of a socket, never waits for more.
+  * @param  fd: from me_socket().
+  * @param  buf: buffer to fill.
+  * @param  size: size of buf.
+  * @retval bytes taken, 0 for none yet, -1 for a broken socket with nothing left.
+  */
+int me_recv(int fd, void * buf, uint16_t size)
+{
+	ME_Socket_t * s = Socket_From_fd(fd);
+	uint16_t len = 0;
+
+	if((s == NULL) || (buf == NULL)) return -1;
+
+	ME_Socket_Poll(s->Me3616);
+	len = Socket_Read(s, (uint8_t *)buf, size);
+
+	if((len == 0) && (s->State == ME_SOCKET_ERROR)) return -1;
+	return len;
+}
+
+/**
+  * @brief  Close a socket, AT+ESOCL. The slot is free even if ME3616 refuses.
+  * @param  fd: from me_socket().
+  * @retval 0 for success, -1 for fail.
+  */
+int me_close(int fd)
+{
+	ME_Socket_t * s = Socket_From_fd(fd);
+	char param[24];
+	bool res = false;
+
+	if(s == NULL) return -1;
+
+	sprintf(param, "%ld", (long)s->Id);
+	res = ME3616_Exec_AT_Command(s->Me3616, AT_CMD_TCPIP_ESOCL, param);
+#ifdef ME3616_SOCKET_RAW
+	//The rest of an +ESONMI in framing must not land in the slot once reused.
+	if(Socket_Stream == s) Socket_Stream = NULL;
+#endif
+	s->State = ME_SOCKET_CLOSED;
+	s->Pending = 0;
+	return (res == true) ? 0 : -1;
+}
+
+/**
+  * @brief  Bytes in the ring of a socket, me_recv() takes them without AT command.
+  */
+uint16_t me_available(int fd)
+{
+	ME_Socket_t * s = Socket_From_fd(fd);
+
+	return (s == NULL) ? 0 : (uint16_t)(s->RxHead - s->RxTail);
+}
+
+/**
+  * @brief  State and counters of a socket, NULL for a closed one.
+  */
+const ME_Socket_t * ME_Socket_Get(int fd)
+{
+	return Socket_From_fd(fd);
+}
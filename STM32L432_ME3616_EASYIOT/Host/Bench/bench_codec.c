@@ -0,0 +1,227 @@
+/**
+  ******************************************************************************
+  * @file    bench_codec.c
+  * @brief   Encoders of TestDevice_codec.h, generated by Tools/easyiot_gen,
+  *          against the MessageWriter calls they replace in Me3616_app.c.
+  *
+  *          bench_codec [-r rounds]
+  *
+  *          msg_1_encode() and cmd_1_respond() must give the bytes of
+  *          BeginMessage(), Put*() and EndMessage() for any values,
+  *          cmd_1_decode() must read a command laid out as the platform sends
+  *          it and one with the TLVs in another order. A mismatch fails the
+  *          run. Then times the uplink both ways.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()                  __rdtsc()
+#else
+#define BENCH_CYCLES()                  0ULL
+#endif
+
+#include "easyiot.h"
+#include "TestDevice.h"
+#include "TestDevice_codec.h"
+
+#define BENCH_MSG_BUFF_SIZE             200
+
+static bool Bench_Failed = false;
+static volatile uint32_t Bench_Sink = 0;
+
+static uint64_t Bench_Timestamp(void)
+{
+	return 1546300800000ULL;
+}
+
+static int32_t Bench_Signal(void)
+{
+	return -85;
+}
+
+static uint8_t Bench_Battery(void)
+{
+	return 90;
+}
+
+/* Checks --------------------------------------------------------------------*/
+static void Bench_Check(bool condition, const char * what)
+{
+	printf("  %-40s %s\n", what, condition ? "ok" : "FAILED");
+	if(condition == false) Bench_Failed = true;
+}
+
+static int Writer_Msg_1(uint8_t * buf, uint16_t dtag, int8_t sensor_1, int32_t sensor_2, int8_t led_green)
+{
+	struct MessageWriter w;
+
+	BeginMessage(&w, buf, BENCH_MSG_BUFF_SIZE, CMT_USER_UP, MSG_1_MSGID, dtag);
+	PutInt8(&w, SENSOR_1_TLV_PARAMID, sensor_1);
+	PutInt32(&w, SENSOR_2_TLV_PARAMID, sensor_2);
+	PutInt8(&w, LED_GREEN_TLV_PARAMID, led_green);
+	return EndMessage(&w);
+}
+
+static int Writer_Cmd_1(uint8_t * buf, uint16_t mid, int8_t result, int8_t led_green)
+{
+	struct MessageWriter w;
+
+	BeginMessage(&w, buf, BENCH_MSG_BUFF_SIZE, CMT_USER_CMD_RSP, CMD_1_CMDID, mid);
+	PutInt8(&w, RESULT_TLV_PARAMID, result);
+	PutInt8(&w, LED_GREEN_TLV_PARAMID, led_green);
+	return EndMessage(&w);
+}
+
+/**
+  * @brief  CMD_1 request with the LED TLV, and an extra TLV before it if asked.
+  */
+static uint16_t Bench_Command(uint8_t * buf, int8_t led_green, bool reordered)
+{
+	uint16_t length = 9;
+	uint8_t sum = 0;
+
+	buf[0] = 0x01;
+	buf[1] = CMT_USER_CMD_REQ;
+	buf[4] = 0x34;
+	buf[5] = 0x12;
+	buf[6] = CMD_1_CMDID;
+	if(reordered == true)
+	{
+		static const uint8_t extra[] = {0x09, 0x00, 0x02, 0xAB, 0xCD};
+
+		memcpy(buf + length, extra, sizeof(extra));
+		length += sizeof(extra);
+	}
+	buf[length++] = LED_GREEN_TLV_PARAMID;
+	buf[length++] = 0x00;
+	buf[length++] = 0x01;
+	buf[length++] = (uint8_t)led_green;
+	buf[2] = 0;
+	buf[3] = (uint8_t)(length + 1 - 4);
+	buf[7] = 0;
+	buf[8] = (uint8_t)(length - 9);
+	for(uint16_t i = 0; i < length; i++) sum += buf[i];
+	buf[length] = sum;
+	return length + 1;
+}
+
+static void Bench_Verify(void)
+{
+	uint8_t expected[BENCH_MSG_BUFF_SIZE];
+	uint8_t generated[BENCH_MSG_BUFF_SIZE];
+	uint8_t command[32];
+	bool encode = true, respond = true, fixed = true, other = true;
+	uint32_t seed = 12345;
+
+	for(uint32_t n = 0; n < 10000; n++)
+	{
+		int8_t s1, led;
+		int32_t s2;
+		int length;
+
+		seed = seed * 1103515245u + 12345u;
+		s1 = (int8_t)(seed >> 24);
+		s2 = (int32_t)(seed * 2654435761u);
+		led = (int8_t)(seed >> 16);
+
+		memset(expected, 0xA5, sizeof(expected));
+		memset(generated, 0xA5, sizeof(generated));
+		length = Writer_Msg_1(expected, (uint16_t)n, s1, s2, led);
+		if((msg_1_encode(generated, BENCH_MSG_BUFF_SIZE, (uint16_t)n, s1, s2, led) != length) ||
+		   (memcmp(expected, generated, sizeof(expected)) != 0)) encode = false;
+
+		memset(expected, 0xA5, sizeof(expected));
+		memset(generated, 0xA5, sizeof(generated));
+		length = Writer_Cmd_1(expected, (uint16_t)n, s1, led);
+		if((cmd_1_respond(generated, BENCH_MSG_BUFF_SIZE, (uint16_t)n, s1, led) != length) ||
+		   (memcmp(expected, generated, sizeof(expected)) != 0)) respond = false;
+
+		for(uint8_t reordered = 0; reordered < 2; reordered++)
+		{
+			struct MessageReader r;
+			struct cmd_1_request request = {0};
+			bool ok = (OpenMessage(&r, command, Bench_Command(command, led, reordered == 1)) >= 0) &&
+			          (cmd_1_decode(&r, &request) == 0) && (request.led_green == led);
+
+			if(ok == false)
+			{
+				if(reordered == 0) fixed = false;
+				else other = false;
+			}
+		}
+	}
+	Bench_Check(encode, "msg_1_encode() as Put*()");
+	Bench_Check(respond, "cmd_1_respond() as Put*()");
+	Bench_Check(fixed, "cmd_1_decode() fixed layout");
+	Bench_Check(other, "cmd_1_decode() other layout");
+	Bench_Check(msg_1_encode(generated, MSG_1_LENGTH - 1, 0, 1, 2, 3) == -1, "msg_1_encode() bounded by buffer");
+}
+
+/* Timing --------------------------------------------------------------------*/
+static uint64_t Host_Now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint8_t Bench_Buff[BENCH_MSG_BUFF_SIZE];
+static uint16_t Bench_Dtag = 0;
+
+static void Run_Writer(void)
+{
+	Bench_Sink += Writer_Msg_1(Bench_Buff, Bench_Dtag++, 60, 888, 0);
+}
+
+static void Run_Generated(void)
+{
+	Bench_Sink += msg_1_encode(Bench_Buff, BENCH_MSG_BUFF_SIZE, Bench_Dtag++, 60, 888, 0);
+}
+
+static void Bench_Run(const char * name, void (* run)(void), uint32_t rounds)
+{
+	uint64_t start_ns = Host_Now_ns();
+	uint64_t start_cycles = BENCH_CYCLES();
+	uint64_t cycles = 0;
+	uint64_t ns = 0;
+
+	for(uint32_t round = 0; round < rounds; round++) run();
+	cycles = BENCH_CYCLES() - start_cycles;
+	ns = Host_Now_ns() - start_ns;
+
+	printf("  %-24s %8.1f ns", name, (double)ns / rounds);
+	if(cycles != 0) printf(" %8.1f cycles", (double)cycles / rounds);
+	printf(" per msg_1 uplink\n");
+}
+
+int main(int argc, char ** argv)
+{
+	uint32_t rounds = 200000;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) rounds = (uint32_t)strtoul(argv[++i], NULL, 10);
+	}
+	if(rounds == 0) rounds = 1;
+
+	EasyIotInit("861234567890123", "460113009509999");
+	setsTimestampCb(Bench_Timestamp);
+	setSignalCb(Bench_Signal);
+	setBatteryCb(Bench_Battery);
+
+	printf("Generated TestDevice codec:\n");
+	Bench_Verify();
+
+	Bench_Run("MessageWriter Put*()", Run_Writer, rounds);
+	Bench_Run("msg_1_encode()", Run_Generated, rounds);
+
+	return (Bench_Failed == true) ? 1 : 0;
+}
@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    bench_dbg.c
+  * @brief   Cost of a DBG_Printf() record, from the call to the bytes handed
+  *          to DBG_UART DMA, and the bytes it takes on the wire.
+  *
+  *          Built twice: bench_dbg formats text on MCU, bench_dbg_bin is the
+  *          ME3616_DBG_BINARY build that leaves formatting to Tools/dbg_decode.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "me3616.h"
+#include "sim_me3616.h"
+
+#define BENCH_ROUNDS                    20000
+
+void ME3616_ErrorHandler(char *file, int line, char * pch)
+{
+	fprintf(stderr, "%s:%d: %s\n", file, line, pch);
+	exit(2);
+}
+
+static uint64_t Host_Now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+  * @brief  Log, then let UART2 finish, so every record is formatted and sent once.
+  *         Only the logging call is timed, not the simulated wire.
+  */
+static void Bench_Run(const char * name, void (* log)(uint32_t round))
+{
+	uint32_t bytes = Sim_Get_Stats()->BytesToDbg;
+	uint64_t host_ns = 0;
+
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		uint64_t start_ns = Host_Now_ns();
+		log(round);
+		host_ns += Host_Now_ns() - start_ns;
+
+		while(DBG_Log_Drain() == true) Sim_Advance(1000);
+	}
+	bytes = Sim_Get_Stats()->BytesToDbg - bytes;
+
+	printf("%-12s %8.1f ns/record %6.1f bytes/record\n", name, (double)host_ns / BENCH_ROUNDS, (double)bytes / BENCH_ROUNDS);
+}
+
+static void Log_Boot(uint32_t round)
+{
+	DBG_Printf(DBG_DIR_AT, "Boot %s %s in %lu ms.", "MATREADY", "done", (unsigned long)round);
+}
+
+static void Log_State(uint32_t round)
+{
+	DBG_Printf(DBG_DIR_AT, "Sys_State Changed. New state is: %lx", (unsigned long)(0x40000000UL | round));
+}
+
+static void Log_Text(uint32_t round)
+{
+	UNUSED(round);
+	DBG_Print("+M2MCLI: observe success", DBG_DIR_RX);
+}
+
+int main(void)
+{
+	Sim_Board_Init();
+
+#ifdef ME3616_DBG_BINARY
+	printf("Binary debug log, DBG_Printf() to DBG_UART DMA start:\n");
+#else
+	printf("Text debug log, DBG_Printf() to DBG_UART DMA start:\n");
+#endif
+	Bench_Run("boot stage", Log_Boot);
+	Bench_Run("sys state", Log_State);
+	Bench_Run("rx line", Log_Text);
+	return 0;
+}
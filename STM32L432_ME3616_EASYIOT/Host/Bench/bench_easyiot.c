@@ -0,0 +1,239 @@
+/**
+  ******************************************************************************
+  * @file    bench_easyiot.c
+  * @brief   Cost of EasyIoT logging inside pushMessages(), the uplink of
+  *          Me3616_app.c: three TLVs serialized and handed to the output.
+  *          The same uplink is then built whole both ways, struct Messages
+  *          with its TLVs and one MessageWriter pass.
+  *          Last a command downlink is taken both ways, CoapHexInputStatic() into
+  *          a receive buffer and Messages, CoapHexInputInPlace() and TLV views.
+  *
+  *          Built three times, with easyiot.c compiled along:
+  *            bench_easyiot_trace      everything compiled in, runtime level
+  *                                     LOG_TRACE, as EasyIotInit() used to force
+  *            bench_easyiot_filtered   everything compiled in, runtime level
+  *                                     LOG_INFO filters trace and debug
+  *            bench_easyiot            EASYIOT_LOG_MIN_LEVEL default, trace and
+  *                                     debug compiled out
+  *          Cycles are read by rdtsc on x86, elsewhere only ns are reported.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()                  __rdtsc()
+#else
+#define BENCH_CYCLES()                  0ULL
+#endif
+
+#include "easyiot.h"
+#include "me3616_hex.h"
+
+#define BENCH_ROUNDS                    200000
+#define BENCH_MSG_BUFF_SIZE             200
+
+#ifndef BENCH_RUNTIME_LEVEL
+#define BENCH_RUNTIME_LEVEL             EASYIOT_LOG_DEFAULT_LEVEL
+#endif
+
+static uint8_t Bench_Msg_Buff[BENCH_MSG_BUFF_SIZE];
+static volatile uint32_t Bench_Out_Bytes = 0;
+
+static void Bench_Out(const uint8_t * buf, uint16_t length)
+{
+	(void)buf;
+	Bench_Out_Bytes += length;
+}
+
+static uint64_t Bench_Timestamp(void)
+{
+	return 1546300800000ULL;
+}
+
+static int32_t Bench_Signal(void)
+{
+	return -85;
+}
+
+static uint8_t Bench_Battery(void)
+{
+	return 90;
+}
+
+static uint64_t Host_Now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+  * @brief  The whole uplink of Me3616_app.c, struct Messages and its TLVs.
+  */
+static void Bench_Build_Messages(uint16_t dtag)
+{
+	struct Messages * msg = NewMessageStatic(Bench_Msg_Buff, BENCH_MSG_BUFF_SIZE);
+
+	setMessages(msg, CMT_USER_UP, 1);
+	msg->dtag_mid = dtag;
+	AddInt8(msg, 1, 60);
+	AddInt32(msg, 2, 888);
+	AddInt8(msg, 3, 0);
+	pushMessages(msg);
+	FreeMessage(msg);
+}
+
+/**
+  * @brief  The same uplink written once into the buffer.
+  */
+static void Bench_Build_Writer(uint16_t dtag)
+{
+	struct MessageWriter msg;
+
+	BeginMessage(&msg, Bench_Msg_Buff, BENCH_MSG_BUFF_SIZE, CMT_USER_UP, 1, dtag);
+	PutInt8(&msg, 1, 60);
+	PutInt32(&msg, 2, 888);
+	PutInt8(&msg, 3, 0);
+	pushMessageWriter(&msg);
+}
+
+/**
+  * @brief  Command of Me3616_app.c, LED TLV and two more, as hex of +M2MCLIRECV.
+  *         Each round starts from a fresh copy of the line, in place decoding
+  *         writes over it, the copy is timed both ways.
+  */
+static const uint8_t Bench_Cmd[] =
+{
+	0x01, 0xF2, 0x00, 0x19, 0x00, 0x01, 0x02, 0x00, 0x13,
+	0x03, 0x00, 0x01, 0x01,
+	0x04, 0x00, 0x04, 0x00, 0x00, 0x03, 0x78,
+	0x05, 0x00, 0x05, 'h', 'e', 'l', 'l', 'o',
+	0x00
+};
+static char Bench_Cmd_Hex[2 * sizeof(Bench_Cmd) + 1];
+static char Bench_Cmd_Line[2 * sizeof(Bench_Cmd) + 1];
+static uint8_t Bench_Receive_Buff[250];
+static volatile int32_t Bench_Cmd_Sum = 0;
+
+static void Bench_Cmd_Handler(struct Messages * req)
+{
+	int8_t led = 0;
+	int32_t value = 0;
+
+	GetInt8(req, 3, &led);
+	GetInt32(req, 4, &value);
+	Bench_Cmd_Sum += led + value;
+}
+
+static void Bench_Cmd_Reader(const struct MessageReader * req)
+{
+	int8_t led = 0;
+	int32_t value = 0;
+
+	ReadInt8(req, 3, &led);
+	ReadInt32(req, 4, &value);
+	Bench_Cmd_Sum += led + value;
+}
+
+static void Bench_Recv_Static(uint16_t round)
+{
+	(void)round;
+	memcpy(Bench_Cmd_Line, Bench_Cmd_Hex, sizeof(Bench_Cmd_Hex));
+	CoapHexInputStatic(Bench_Cmd_Line, Bench_Receive_Buff, sizeof(Bench_Receive_Buff) - 1);
+}
+
+static void Bench_Recv_In_Place(uint16_t round)
+{
+	(void)round;
+	memcpy(Bench_Cmd_Line, Bench_Cmd_Hex, sizeof(Bench_Cmd_Hex));
+	CoapHexInputInPlace(Bench_Cmd_Line, 2 * sizeof(Bench_Cmd));
+}
+
+static void Bench_Build(const char * name, void (* build)(uint16_t dtag))
+{
+	uint64_t cycles = 0;
+	uint64_t ns = 0;
+
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		uint64_t start_ns = Host_Now_ns();
+		uint64_t start_cycles = BENCH_CYCLES();
+
+		build((uint16_t)round);
+		cycles += BENCH_CYCLES() - start_cycles;
+		ns += Host_Now_ns() - start_ns;
+	}
+
+	printf("%-14s %8.1f ns", name, (double)ns / BENCH_ROUNDS);
+	if(cycles != 0) printf(" %8.1f cycles", (double)cycles / BENCH_ROUNDS);
+	printf(" per uplink built and pushed, or command taken\n");
+}
+
+int main(void)
+{
+	uint64_t cycles = 0;
+	uint64_t ns = 0;
+	uint16_t dtag = 0;
+
+	EasyIotInit("861234567890123", "460113009509999");
+	setsTimestampCb(Bench_Timestamp);
+	setSignalCb(Bench_Signal);
+	setBatteryCb(Bench_Battery);
+	setNbSerialOutputCb(Bench_Out);
+	//Logs are formatted and thrown away, a UART would cost more
+	setLogSerialOutputCb(Bench_Out);
+	SetLogLevel(BENCH_RUNTIME_LEVEL);
+
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		struct Messages * msg = NewMessageStatic(Bench_Msg_Buff, BENCH_MSG_BUFF_SIZE);
+		uint64_t start_ns = 0;
+		uint64_t start_cycles = 0;
+
+		setMessages(msg, CMT_USER_UP, 1);
+		msg->dtag_mid = dtag++;
+		AddInt8(msg, 1, 60);
+		AddInt32(msg, 2, 888);
+		AddInt8(msg, 3, 0);
+
+		start_ns = Host_Now_ns();
+		start_cycles = BENCH_CYCLES();
+		pushMessages(msg);
+		cycles += BENCH_CYCLES() - start_cycles;
+		ns += Host_Now_ns() - start_ns;
+
+		FreeMessage(msg);
+	}
+
+	printf("compile level %d, runtime level %d: %8.1f ns", EASYIOT_LOG_MIN_LEVEL, (int)BENCH_RUNTIME_LEVEL,
+	       (double)ns / BENCH_ROUNDS);
+	if(cycles != 0) printf(" %8.1f cycles", (double)cycles / BENCH_ROUNDS);
+	printf(" per pushMessages()\n");
+
+	Bench_Build("Messages", Bench_Build_Messages);
+	Bench_Build("MessageWriter", Bench_Build_Writer);
+
+	{
+		uint8_t cmd[sizeof(Bench_Cmd)];
+		uint8_t sum = 0;
+
+		memcpy(cmd, Bench_Cmd, sizeof(cmd));
+		for(uint16_t i = 0; i < sizeof(cmd) - 1; i++) sum += cmd[i];
+		cmd[sizeof(cmd) - 1] = sum;
+		Hex_Encode(Bench_Cmd_Hex, sizeof(Bench_Cmd_Hex), cmd, sizeof(cmd));
+	}
+	setCmdHandler(2, Bench_Cmd_Handler);
+	setCmdReader(2, Bench_Cmd_Reader);
+
+	Bench_Build("Static", Bench_Recv_Static);
+	if(Bench_Cmd_Sum != 889 * BENCH_ROUNDS) return 1;
+	Bench_Build("InPlace", Bench_Recv_In_Place);
+	if(Bench_Cmd_Sum != 2 * 889 * BENCH_ROUNDS) return 1;
+	return (Bench_Out_Bytes != 0) ? 0 : 1;
+}
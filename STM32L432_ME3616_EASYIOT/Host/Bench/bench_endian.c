@@ -0,0 +1,529 @@
+/**
+  ******************************************************************************
+  * @file    bench_endian.c
+  * @brief   Byte order layer of easyiot_endian.h against the conversions it
+  *          replaced: host2Net*() of easyiot.c by shifts and union loops, and
+  *          the alignment_u*_w() setters, as they were.
+  *
+  *          bench_endian [-r rounds]
+  *
+  *          Checks the swaps and unaligned loads / stores at every offset,
+  *          host2Net*() bit for bit against the old ones, then every
+  *          TlvValueType both ways: PutBuffer() and TLVSerialize() must give
+  *          the big endian bytes, Read*() of a CMD_REQ and Get*() of the same
+  *          message deserialized must give the values back. A mismatch fails
+  *          the run. Then times the numbers of one uplink written and read.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()                  __rdtsc()
+#else
+#define BENCH_CYCLES()                  0ULL
+#endif
+
+#include "easyiot.h"
+#include "easyiot_endian.h"
+
+#define BENCH_MSG_BUFF_SIZE             200
+
+/* Not in easyiot.h, used inside the SDK only */
+int PutBuffer(struct MessageWriter* w, uint8_t type, const uint8_t* v, uint16_t length, uint8_t vformat);
+float host2NetFloat(float value);
+double host2NetDouble(double value);
+int16_t host2NetInt16(int16_t value);
+int32_t host2NetInt32(int32_t value);
+int64_t host2NetInt64(int64_t value);
+float net2HostFloat(float value);
+double net2HostDouble(double value);
+
+static bool Bench_Failed = false;
+static volatile uint64_t Bench_Sink = 0;
+
+/* Replaced conversions ------------------------------------------------------*/
+typedef union
+{
+	float f;
+	char c[4];
+} Old_Float_Conv;
+
+typedef union
+{
+	double d;
+	char c[8];
+} Old_Double_Conv;
+
+static float Old_host2NetFloat(float value)
+{
+	Old_Float_Conv f1, f2;
+
+	f1.f = value;
+	f2.c[0] = f1.c[3];
+	f2.c[1] = f1.c[2];
+	f2.c[2] = f1.c[1];
+	f2.c[3] = f1.c[0];
+	return f2.f;
+}
+
+static double Old_host2NetDouble(double value)
+{
+	Old_Double_Conv d1, d2;
+	int size = sizeof(double);
+
+	d1.d = value;
+	for(int i = 0; i < size; i++) d2.c[size - 1 - i] = d1.c[i];
+	return d2.d;
+}
+
+static int16_t Old_host2NetInt16(int16_t value)
+{
+	return ((uint16_t)((((value) & 0xff) << 8) | (((value) >> 8) & 0xff)));
+}
+
+static int32_t Old_host2NetInt32(int32_t value)
+{
+	return ((uint32_t)((((value) & 0xff) << 24) | (((value) & 0xff00) << 8) | (((value) >> 8) & 0xff00) | (((value) >> 24) & 0xff)));
+}
+
+static int64_t Old_host2NetInt64(int64_t value)
+{
+	return (value & 0x00000000000000FF) << 56 | (value & 0x000000000000FF00) << 40 |
+		(value & 0x0000000000FF0000) << 24 | (value & 0x00000000FF000000) << 8 |
+		(value & 0x000000FF00000000) >> 8 | (value & 0x0000FF0000000000) >> 24 |
+		(value & 0x00FF000000000000) >> 40 | (value & 0xFF00000000000000) >> 56;
+}
+
+static void Old_alignment_u32_w(char* buf, uint32_t val)
+{
+	union { uint32_t val; char buf[4]; } setter;
+
+	setter.val = val;
+	memcpy(buf, setter.buf, sizeof(setter));
+}
+
+static void Old_alignment_u64_w(char* buf, uint64_t val)
+{
+	union { uint64_t val; char buf[8]; } setter;
+
+	setter.val = val;
+	memcpy(buf, setter.buf, sizeof(setter));
+}
+
+/* Checks --------------------------------------------------------------------*/
+static void Bench_Check(bool condition, const char * what)
+{
+	printf("  %-44s %s\n", what, condition ? "ok" : "FAILED");
+	if(condition == false) Bench_Failed = true;
+}
+
+static uint64_t Bench_Random(void)
+{
+	static uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static void Big_Endian_Bytes(uint8_t * out, uint64_t value, uint16_t size)
+{
+	for(uint16_t i = 0; i < size; i++) out[i] = (uint8_t)(value >> (8 * (size - 1 - i)));
+}
+
+static uint64_t Reference_Swap(uint64_t value, uint16_t size)
+{
+	uint64_t swapped = 0;
+
+	for(uint16_t i = 0; i < size; i++) swapped |= ((value >> (8 * i)) & 0xFF) << (8 * (size - 1 - i));
+	return swapped;
+}
+
+static void Bench_Verify_Layer(void)
+{
+	uint8_t buf[16 + 8];
+	uint8_t expected[8];
+	bool swap = true, load = true, store = true, old = true;
+
+	for(uint32_t n = 0; n < 4096; n++)
+	{
+		uint64_t v = Bench_Random();
+
+		if(nb_bswap16((uint16_t)v) != Reference_Swap((uint16_t)v, 2)) swap = false;
+		if(nb_bswap32((uint32_t)v) != Reference_Swap((uint32_t)v, 4)) swap = false;
+		if(nb_bswap64(v) != Reference_Swap(v, 8)) swap = false;
+		Big_Endian_Bytes(expected, v, 8);
+		if(nb_htonll(v) != nb_load_u64(expected)) swap = false;
+		if(nb_htonl((uint32_t)v) != nb_load_u32(expected + 4)) swap = false;
+		if(nb_htons((uint16_t)v) != nb_load_u16(expected + 6)) swap = false;
+
+		for(uint16_t off = 0; off < 8; off++)
+		{
+			memset(buf, 0xA5, sizeof(buf));
+			nb_store_be64(buf + off, v);
+			if(memcmp(buf + off, expected, 8) != 0 || buf[off + 8] != 0xA5 || (off && buf[off - 1] != 0xA5)) store = false;
+			if(nb_load_be64(buf + off) != v) load = false;
+
+			memset(buf, 0xA5, sizeof(buf));
+			nb_store_be32(buf + off, (uint32_t)v);
+			if(memcmp(buf + off, expected + 4, 4) != 0 || buf[off + 4] != 0xA5) store = false;
+			if(nb_load_be32(buf + off) != (uint32_t)v) load = false;
+
+			memset(buf, 0xA5, sizeof(buf));
+			nb_store_be16(buf + off, (uint16_t)v);
+			if(memcmp(buf + off, expected + 6, 2) != 0 || buf[off + 2] != 0xA5) store = false;
+			if(nb_load_be16(buf + off) != (uint16_t)v) load = false;
+		}
+
+		{
+			float f, f_new, f_old;
+			double d, d_new, d_old;
+
+			memcpy(&f, &v, sizeof(f));
+			memcpy(&d, &v, sizeof(d));
+			f_new = host2NetFloat(f);
+			f_old = Old_host2NetFloat(f);
+			d_new = host2NetDouble(d);
+			d_old = Old_host2NetDouble(d);
+			if(memcmp(&f_new, &f_old, sizeof(f)) != 0 || memcmp(&d_new, &d_old, sizeof(d)) != 0) old = false;
+			f_new = net2HostFloat(f_new);
+			d_new = net2HostDouble(d_new);
+			if(memcmp(&f_new, &f, sizeof(f)) != 0 || memcmp(&d_new, &d, sizeof(d)) != 0) old = false;
+			if(host2NetInt16((int16_t)v) != Old_host2NetInt16((int16_t)v)) old = false;
+			if(host2NetInt32((int32_t)v) != Old_host2NetInt32((int32_t)v)) old = false;
+			if(host2NetInt64((int64_t)v) != Old_host2NetInt64((int64_t)v)) old = false;
+		}
+	}
+	Bench_Check(swap, "swaps give network order");
+	Bench_Check(store, "stores at every offset, nothing past");
+	Bench_Check(load, "loads at every offset");
+	Bench_Check(old, "host2Net*() as the old ones, bit for bit");
+}
+
+/**
+  * @brief  One value of each TlvValueType, in host order, and its length.
+  */
+typedef struct
+{
+	uint8_t vformat;
+	const char * name;
+	uint16_t length;
+	union
+	{
+		int8_t i8;
+		int16_t i16;
+		int32_t i32;
+		int64_t i64;
+		float f;
+		double d;
+		uint8_t bytes[16];
+	} host;
+} Bench_Value_t;
+
+static const Bench_Value_t Bench_Values[] =
+{
+	{ TLV_TYPE_BYTE,            "BYTE",            1, { .i8 = -100 } },
+	{ TLV_TYPE_SHORT,           "SHORT",           2, { .i16 = -12345 } },
+	{ TLV_TYPE_INT32,           "INT32",           4, { .i32 = -123456789 } },
+	{ TLV_TYPE_LONG64,          "LONG64",          8, { .i64 = -1234567890123456789LL } },
+	{ TLV_TYPE_FLOAT,           "FLOAT",           4, { .f = -3.25f } },
+	{ TLV_TYPE_DOUBLE,          "DOUBLE",          8, { .d = 6.02214076e23 } },
+	{ TLV_TYPE_BOOL,            "BOOL",            1, { .i8 = 1 } },
+	{ TLV_TYPE_ENUM,            "ENUM",            1, { .i8 = 7 } },
+	{ TLV_TYPE_STRING_ISO_8859, "STRING_ISO_8859", 6, { .bytes = "endian" } },
+	{ TLV_TYPE_STRING_HEX,      "STRING_HEX",      3, { .bytes = { 0x0A, 0x1B, 0x2C } } },
+	{ TLV_TYPE_UNKNOWN,         "UNKNOWN",         5, { .bytes = { 0xFF, 0x00, 0x80, 0x7F, 0x01 } } },
+};
+#define BENCH_VALUES                    (sizeof(Bench_Values) / sizeof(Bench_Values[0]))
+
+static uint8_t Bench_Msg_Buff[BENCH_MSG_BUFF_SIZE];
+
+/**
+  * @brief  The TLV as it must be on the wire: type, big endian length, and
+  *         numbers in big endian, strings and binary as they are.
+  */
+static uint16_t Bench_Expected_TLV(const Bench_Value_t * value, uint8_t type, uint8_t * out)
+{
+	out[0] = type;
+	out[1] = (uint8_t)(value->length >> 8);
+	out[2] = (uint8_t)value->length;
+	if(value->vformat == TLV_TYPE_STRING_ISO_8859 || value->vformat == TLV_TYPE_STRING_HEX || value->vformat == TLV_TYPE_UNKNOWN)
+	{
+		memcpy(out + 3, value->host.bytes, value->length);
+	}
+	else
+	{
+		uint64_t bits = 0;
+
+		if(value->length == 1) bits = (uint8_t)value->host.i8;
+		if(value->length == 2) bits = (uint16_t)value->host.i16;
+		if(value->length == 4) { uint32_t u; memcpy(&u, value->host.bytes, 4); bits = u; }
+		if(value->length == 8) memcpy(&bits, value->host.bytes, 8);
+		Big_Endian_Bytes(out + 3, bits, value->length);
+	}
+	return value->length + 3;
+}
+
+/**
+  * @brief  A CMD_REQ with the one TLV, written at buf, checksum included.
+  */
+static uint16_t Bench_Command(const Bench_Value_t * value, uint8_t * buf)
+{
+	uint16_t length = 9;
+	uint8_t sum = 0;
+
+	buf[0] = 0x01;
+	buf[1] = CMT_USER_CMD_REQ;
+	buf[4] = 0x12;
+	buf[5] = 0x34;
+	buf[6] = 2;
+	length += Bench_Expected_TLV(value, 10, buf + length);
+	buf[2] = (uint8_t)((length + 1 - 4) >> 8);
+	buf[3] = (uint8_t)(length + 1 - 4);
+	buf[7] = (uint8_t)((length - 9) >> 8);
+	buf[8] = (uint8_t)(length - 9);
+	for(uint16_t i = 0; i < length; i++) sum += buf[i];
+	buf[length] = sum;
+	return length + 1;
+}
+
+static bool Bench_Read(const Bench_Value_t * value, const struct MessageReader * r)
+{
+	const uint8_t * bytes = NULL;
+	int8_t i8 = 0;
+	int16_t i16 = 0;
+	int32_t i32 = 0;
+	int64_t i64 = 0;
+	float f = 0;
+	double d = 0;
+
+	switch(value->vformat)
+	{
+		case TLV_TYPE_BYTE:
+		case TLV_TYPE_BOOL:
+		case TLV_TYPE_ENUM:   return ReadInt8(r, 10, &i8) == 1 && i8 == value->host.i8;
+		case TLV_TYPE_SHORT:  return ReadInt16(r, 10, &i16) == 2 && i16 == value->host.i16;
+		case TLV_TYPE_INT32:  return ReadInt32(r, 10, &i32) == 4 && i32 == value->host.i32;
+		case TLV_TYPE_LONG64: return ReadLong64(r, 10, &i64) == 8 && i64 == value->host.i64;
+		case TLV_TYPE_FLOAT:  return ReadFloat(r, 10, &f) == 4 && f == value->host.f;
+		case TLV_TYPE_DOUBLE: return ReadDouble(r, 10, &d) == 8 && d == value->host.d;
+		case TLV_TYPE_STRING_ISO_8859:
+			return ReadString(r, 10, (const char **)&bytes) == value->length && memcmp(bytes, value->host.bytes, value->length) == 0;
+		default:
+			return ReadBinary(r, 10, &bytes) == value->length && memcmp(bytes, value->host.bytes, value->length) == 0;
+	}
+}
+
+static bool Bench_Get(const Bench_Value_t * value, const struct Messages * msg)
+{
+	uint8_t * bytes = NULL;
+	int8_t i8 = 0;
+	int16_t i16 = 0;
+	int32_t i32 = 0;
+	int64_t i64 = 0;
+	float f = 0;
+	double d = 0;
+
+	switch(value->vformat)
+	{
+		case TLV_TYPE_BYTE:
+		case TLV_TYPE_BOOL:
+		case TLV_TYPE_ENUM:   return GetInt8(msg, 10, &i8) == 1 && i8 == value->host.i8;
+		case TLV_TYPE_SHORT:  return GetInt16(msg, 10, &i16) == 2 && i16 == value->host.i16;
+		case TLV_TYPE_INT32:  return GetInt32(msg, 10, &i32) == 4 && i32 == value->host.i32;
+		case TLV_TYPE_LONG64: return GetLong64(msg, 10, &i64) == 8 && i64 == value->host.i64;
+		case TLV_TYPE_FLOAT:  return GetFloat(msg, 10, &f) == 4 && f == value->host.f;
+		case TLV_TYPE_DOUBLE: return GetDouble(msg, 10, &d) == 8 && d == value->host.d;
+		case TLV_TYPE_STRING_ISO_8859:
+			return GetString(msg, 10, (char **)&bytes) == value->length && memcmp(bytes, value->host.bytes, value->length) == 0;
+		default:
+			return GetBinary(msg, 10, &bytes) == value->length && memcmp(bytes, value->host.bytes, value->length) == 0;
+	}
+}
+
+static void Bench_Verify_Types(void)
+{
+	for(uint16_t n = 0; n < BENCH_VALUES; n++)
+	{
+		const Bench_Value_t * value = &Bench_Values[n];
+		uint8_t expected[3 + 16];
+		uint8_t command[32 + 8];
+		uint16_t expected_length = Bench_Expected_TLV(value, 10, expected);
+		uint16_t command_length = 0;
+		struct MessageWriter w;
+		struct MessageReader r;
+		struct TLV tlv;
+		struct Messages * msg;
+		char serialized[3 + 16 + 1];
+		char what[64];
+		uint16_t at;
+		bool put, serialize, read = true, get;
+
+		//Up message header puts the TLV at an odd offset
+		BeginMessage(&w, Bench_Msg_Buff, BENCH_MSG_BUFF_SIZE, CMT_USER_UP, 1, 0x1234);
+		at = w.pos;
+		put = (PutBuffer(&w, 10, value->host.bytes, value->length, value->vformat) >= 0) &&
+		      (memcmp(Bench_Msg_Buff + at, expected, expected_length) == 0);
+
+		tlv.type = 10;
+		tlv.length = value->length;
+		tlv.vformat = value->vformat;
+		tlv.value = (uint8_t *)value->host.bytes;
+		memset(serialized, 0xA5, sizeof(serialized));
+		serialize = (TLVSerialize(&tlv, serialized + 1, sizeof(serialized) - 1) == expected_length) &&
+		            (memcmp(serialized + 1, expected, expected_length) == 0) &&
+		            ((uint8_t)serialized[0] == 0xA5) && ((uint8_t)serialized[1 + expected_length] == 0xA5);
+
+		for(uint16_t off = 0; off < 8; off++)
+		{
+			command_length = Bench_Command(value, command + off);
+			if((OpenMessage(&r, command + off, command_length) != 1) || (Bench_Read(value, &r) == false)) read = false;
+		}
+
+		command_length = Bench_Command(value, command + 1);
+		msg = NewMessageStatic(Bench_Msg_Buff, BENCH_MSG_BUFF_SIZE);
+		get = (MessagesDeserialize((const char *)command + 1, command_length, msg) >= 0) && Bench_Get(value, msg);
+		FreeMessage(msg);
+
+		snprintf(what, sizeof(what), "%-15s put, serialize, read, get", value->name);
+		Bench_Check(put && serialize && read && get, what);
+		if(!put) printf("    PutBuffer() bytes differ\n");
+		if(!serialize) printf("    TLVSerialize() bytes differ\n");
+		if(!read) printf("    Read*() of CMD_REQ differs\n");
+		if(!get) printf("    Get*() of deserialized CMD_REQ differs\n");
+	}
+}
+
+/* Timing --------------------------------------------------------------------*/
+static uint64_t Host_Now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static volatile int16_t Bench_I16 = -12345;
+static volatile int32_t Bench_I32 = -123456789;
+static volatile int64_t Bench_I64 = 1546300800000LL;
+static volatile float Bench_F = -3.25f;
+static volatile double Bench_D = 6.02214076e23;
+static char Bench_Wire[1 + 2 + 4 + 8 + 4 + 8];
+
+/**
+  * @brief  The numbers of one uplink written at odd offsets and read back,
+  *         as easyiot.c did: swap, then setter union or memcpy.
+  */
+static void Run_Old(void)
+{
+	char * p = Bench_Wire + 1;
+	int16_t i16 = Old_host2NetInt16(Bench_I16);
+	float f = Old_host2NetFloat(Bench_F);
+	double d = Old_host2NetDouble(Bench_D);
+	int16_t r16;
+	int32_t r32;
+	int64_t r64;
+	float rf;
+	double rd;
+
+	memcpy(p, &i16, 2);
+	Old_alignment_u32_w(p + 2, Old_host2NetInt32(Bench_I32));
+	Old_alignment_u64_w(p + 6, Old_host2NetInt64(Bench_I64));
+	memcpy(p + 14, &f, 4);
+	memcpy(p + 18, &d, 8);
+
+	memcpy(&r16, p, 2);
+	memcpy(&r32, p + 2, 4);
+	memcpy(&r64, p + 6, 8);
+	memcpy(&rf, p + 14, 4);
+	memcpy(&rd, p + 18, 8);
+	Bench_Sink += (uint64_t)(Old_host2NetInt16(r16) + Old_host2NetInt32(r32) + Old_host2NetInt64(r64)) +
+	              (uint64_t)Old_host2NetFloat(rf) + (uint64_t)Old_host2NetDouble(rd);
+}
+
+static void Run_New(void)
+{
+	char * p = Bench_Wire + 1;
+	float f = Bench_F;
+	double d = Bench_D;
+	uint32_t f_bits;
+	uint64_t d_bits;
+
+	memcpy(&f_bits, &f, 4);
+	memcpy(&d_bits, &d, 8);
+	nb_store_be16(p, (uint16_t)Bench_I16);
+	nb_store_be32(p + 2, (uint32_t)Bench_I32);
+	nb_store_be64(p + 6, (uint64_t)Bench_I64);
+	nb_store_be32(p + 14, f_bits);
+	nb_store_be64(p + 18, d_bits);
+
+	f_bits = nb_load_be32(p + 14);
+	d_bits = nb_load_be64(p + 18);
+	memcpy(&f, &f_bits, 4);
+	memcpy(&d, &d_bits, 8);
+	Bench_Sink += (uint64_t)((int16_t)nb_load_be16(p) + (int32_t)nb_load_be32(p + 2) + (int64_t)nb_load_be64(p + 6)) +
+	              (uint64_t)f + (uint64_t)d;
+}
+
+static void Bench_Run(const char * name, void (* run)(void), uint32_t rounds)
+{
+	uint64_t start_ns = Host_Now_ns();
+	uint64_t start_cycles = BENCH_CYCLES();
+	uint64_t cycles = 0;
+	uint64_t ns = 0;
+
+	for(uint32_t round = 0; round < rounds; round++) run();
+	cycles = BENCH_CYCLES() - start_cycles;
+	ns = Host_Now_ns() - start_ns;
+
+	printf("  %-24s %8.1f ns", name, (double)ns / rounds);
+	if(cycles != 0) printf(" %8.1f cycles", (double)cycles / rounds);
+	printf(" per 5 numbers written and read\n");
+}
+
+static uint64_t Bench_Timestamp(void)
+{
+	return 1546300800000ULL;
+}
+
+static int32_t Bench_Signal(void)
+{
+	return -85;
+}
+
+static uint8_t Bench_Battery(void)
+{
+	return 90;
+}
+
+int main(int argc, char ** argv)
+{
+	uint32_t rounds = 2000000;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) rounds = (uint32_t)strtoul(argv[++i], NULL, 10);
+	}
+	if(rounds == 0) rounds = 1;
+
+	EasyIotInit("861234567890123", "460113009509999");
+	setsTimestampCb(Bench_Timestamp);
+	setSignalCb(Bench_Signal);
+	setBatteryCb(Bench_Battery);
+
+	printf("Byte order, %s endian host:\n", EASYIOT_BIG_ENDIAN ? "big" : "little");
+	Bench_Verify_Layer();
+	Bench_Verify_Types();
+
+	Bench_Run("swap and setters", Run_Old, rounds);
+	Bench_Run("nb_store_be / load_be", Run_New, rounds);
+
+	return (Bench_Failed == true) ? 1 : 0;
+}
@@ -0,0 +1,239 @@
+/**
+  ******************************************************************************
+  * @file    bench_hex.c
+  * @brief   Hex codec of me3616_hex.c against the conversions it replaced:
+  *          Hex2Str() by sprintf, HexStrToByte() by toupper and a2b_hex() of
+  *          easyiot.c, as they were.
+  *
+  *          bench_hex [-r rounds]
+  *
+  *          Checks every byte value both ways, lower case input and stops at
+  *          bad chars first, a mismatch fails the run. Then times a 64 byte
+  *          payload, the size of an EasyIoT uplink.
+  *          Built twice: bench_hex_simd runs the USUB8 / UADD8 / SEL decode of
+  *          Cortex-M4 on the intrinsics of the HAL shim, its times mean nothing,
+  *          it is there to check the result.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()                  __rdtsc()
+#else
+#define BENCH_CYCLES()                  0ULL
+#endif
+
+#include "me3616_hex.h"
+
+#define BENCH_PAYLOAD                   64
+
+static bool Bench_Failed = false;
+static volatile uint32_t Bench_Sink = 0;
+
+/* Replaced conversions ------------------------------------------------------*/
+static void Old_Hex2Str(char *sDest, const char *sSrc, int nSrcLen)
+{
+	char szTmp[3];
+
+	for(int i = 0; i < nSrcLen; i++)
+	{
+		sprintf(szTmp, "%02X", (unsigned char)sSrc[i]);
+		memcpy(&sDest[i * 2], szTmp, 2);
+	}
+}
+
+static bool Old_HexStrToByte(unsigned char* dest, const char* source, int sourceLen)
+{
+	unsigned char highByte, lowByte;
+
+	if((sourceLen % 2) != 0) return false;
+
+	for(short i = 0; i < sourceLen; i += 2)
+	{
+		highByte = toupper(source[i]);
+		lowByte  = toupper(source[i + 1]);
+
+		if((lowByte < 0x30 && lowByte > 0x46) || (highByte < 0x30 && highByte > 0x46)) return false;
+
+		if(highByte > 0x39) highByte -= 0x37;
+		else highByte -= 0x30;
+
+		if(lowByte > 0x39) lowByte -= 0x37;
+		else lowByte -= 0x30;
+
+		dest[i / 2] = (highByte << 4) | lowByte;
+	}
+	return true;
+}
+
+static int Old_a2b_hex(const char* s, char* out, int inMaxLength)
+{
+	int i, pos;
+	int length = strlen(s);
+
+	if(length % 2) return -1;
+	if(inMaxLength < length / 2) return -1;
+
+	pos = 0;
+	for(i = 0; i < length - 1; i += 2)
+	{
+		out[pos++] = (s[i] >= 'A' ? s[i] - 'A' + 10 : s[i] - '0') * 16 + (s[i + 1] >= 'A' ? s[i + 1] - 'A' + 10 : s[i + 1] - '0');
+	}
+	return length / 2;
+}
+
+/* Checks --------------------------------------------------------------------*/
+static void Bench_Check(bool condition, const char * what)
+{
+	printf("  %-40s %s\n", what, condition ? "ok" : "FAILED");
+	if(condition == false) Bench_Failed = true;
+}
+
+static void Bench_Verify(void)
+{
+	uint8_t bytes[256];
+	uint8_t back[256];
+	char old_hex[513];
+	char new_hex[513];
+	bool ok = true;
+
+	for(uint16_t i = 0; i < 256; i++) bytes[i] = (uint8_t)i;
+
+	Old_Hex2Str(old_hex, (const char *)bytes, 256);
+	Bench_Check(Hex_Encode(new_hex, sizeof(new_hex), bytes, 256) == 512, "encode all byte values");
+	Bench_Check(memcmp(old_hex, new_hex, 512) == 0, "encode as Hex2Str()");
+	Bench_Check(Hex_Encode(new_hex, 7, bytes, 256) == 6, "encode bounded by dest");
+
+	Bench_Check(Hex_Decode(back, sizeof(back), new_hex, 512) == 256, "decode all byte values");
+	Bench_Check(memcmp(back, bytes, 256) == 0, "decode as encoded");
+
+	//Every length and alignment, so word and tail paths both run
+	for(uint16_t off = 0; off < 4; off++)
+	{
+		for(uint16_t len = 0; len + off <= 40; len++)
+		{
+			memset(back, 0, sizeof(back));
+			if((Hex_Decode(back, sizeof(back), new_hex + 2 * off, 2 * len) != len) ||
+			   (memcmp(back, bytes + off, len) != 0)) ok = false;
+		}
+	}
+	Bench_Check(ok, "decode every length and alignment");
+
+	for(uint16_t i = 0; i < 512; i++) old_hex[i] = (char)tolower((unsigned char)new_hex[i]);
+	Bench_Check((Hex_Decode(back, sizeof(back), old_hex, 512) == 256) && (memcmp(back, bytes, 256) == 0), "decode lower case");
+
+	//Each char value at each place of a word: a hex digit decodes, anything else stops there
+	ok = true;
+	for(uint16_t ch = 0; ch < 256; ch++)
+	{
+		bool digit = isxdigit(ch) != 0;
+
+		for(uint16_t at = 0; at < 8; at++)
+		{
+			char text[8];
+			uint8_t expected[4];
+
+			memcpy(text, "A0b1C2d3", 8);
+			text[at] = (char)ch;
+			if(Hex_Decode(back, sizeof(back), text, 8) != (digit ? 4 : at / 2)) ok = false;
+			if(digit && ((Old_HexStrToByte(expected, text, 8) == false) || (memcmp(back, expected, 4) != 0))) ok = false;
+		}
+	}
+	Bench_Check(ok, "decode stops at the first bad char");
+
+	Bench_Check(Hex_Decode(back, 3, new_hex, 512) == 3, "decode bounded by dest");
+	Bench_Check(Hex_Decode(back, sizeof(back), new_hex, 7) == 3, "decode leaves odd char");
+	Bench_Check(Old_HexStrToByte(back, "0G", 2) == true, "old HexStrToByte() takes 'G'");
+	Bench_Check(Old_a2b_hex("0a", (char *)back, 1) == 1 && back[0] != 0x0A, "old a2b_hex() misreads 'a'");
+}
+
+/* Timing --------------------------------------------------------------------*/
+static uint64_t Host_Now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint8_t Bench_Bytes[BENCH_PAYLOAD];
+static char Bench_Hex[2 * BENCH_PAYLOAD + 1];
+static uint8_t Bench_Out[BENCH_PAYLOAD];
+
+static void Run_Old_Encode(void)
+{
+	Old_Hex2Str(Bench_Hex, (const char *)Bench_Bytes, BENCH_PAYLOAD);
+}
+
+static void Run_New_Encode(void)
+{
+	Bench_Sink += Hex_Encode(Bench_Hex, sizeof(Bench_Hex), Bench_Bytes, BENCH_PAYLOAD);
+}
+
+static void Run_Old_HexStrToByte(void)
+{
+	Bench_Sink += Old_HexStrToByte(Bench_Out, Bench_Hex, 2 * BENCH_PAYLOAD);
+}
+
+static void Run_Old_a2b_hex(void)
+{
+	Bench_Sink += Old_a2b_hex(Bench_Hex, (char *)Bench_Out, sizeof(Bench_Out));
+}
+
+static void Run_New_Decode(void)
+{
+	Bench_Sink += Hex_Decode(Bench_Out, sizeof(Bench_Out), Bench_Hex, 2 * BENCH_PAYLOAD);
+}
+
+static void Bench_Run(const char * name, void (* run)(void), uint32_t rounds)
+{
+	uint64_t start_ns = Host_Now_ns();
+	uint64_t start_cycles = BENCH_CYCLES();
+	uint64_t cycles = 0;
+	uint64_t ns = 0;
+
+	for(uint32_t round = 0; round < rounds; round++) run();
+	cycles = BENCH_CYCLES() - start_cycles;
+	ns = Host_Now_ns() - start_ns;
+
+	printf("  %-24s %8.1f ns", name, (double)ns / rounds);
+	if(cycles != 0) printf(" %8.1f cycles", (double)cycles / rounds);
+	printf(" per %u bytes\n", BENCH_PAYLOAD);
+}
+
+int main(int argc, char ** argv)
+{
+	uint32_t rounds = 200000;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) rounds = (uint32_t)strtoul(argv[++i], NULL, 10);
+	}
+	if(rounds == 0) rounds = 1;
+
+#ifdef ME3616_HEX_SIMD32
+	printf("Hex codec, SIMD32 decode on emulated intrinsics:\n");
+#else
+	printf("Hex codec:\n");
+#endif
+	Bench_Verify();
+
+	for(uint16_t i = 0; i < BENCH_PAYLOAD; i++) Bench_Bytes[i] = (uint8_t)(i * 37 + 11);
+	Hex_Encode(Bench_Hex, sizeof(Bench_Hex), Bench_Bytes, BENCH_PAYLOAD);
+	Bench_Hex[2 * BENCH_PAYLOAD] = '\0';
+
+	Bench_Run("Hex2Str() sprintf", Run_Old_Encode, rounds);
+	Bench_Run("Hex_Encode()", Run_New_Encode, rounds);
+	Bench_Run("HexStrToByte() toupper", Run_Old_HexStrToByte, rounds);
+	Bench_Run("a2b_hex() strlen", Run_Old_a2b_hex, rounds);
+	Bench_Run("Hex_Decode()", Run_New_Decode, rounds);
+
+	return (Bench_Failed == true) ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+/**
+  ******************************************************************************
+  * @file    bench_pool.c
+  * @brief   Fixed block pools of me3616_pool.c against malloc / free, and the
+  *          EasyIoT message pools on top of them.
+  *
+  *          bench_pool [-r rounds]
+  *
+  *          Checks blocks are distinct and aligned, an empty pool fails and
+  *          counts it, freed blocks come back, foreign pointers are refused, a
+  *          Messages with TLVs gives every block back, a command whose TLV does
+  *          not fit the pool fails CoapInput(). Then times one block
+  *          taken and given back, and a Messages of 3 TLVs built and freed.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()                  __rdtsc()
+#else
+#define BENCH_CYCLES()                  0ULL
+#endif
+
+#include "me3616_pool.h"
+#include "easyiot.h"
+
+#define BENCH_BLOCKS                    8
+
+POOL_DEFINE(Bench_Pool, 20, BENCH_BLOCKS);
+
+static bool Bench_Failed = false;
+static void * volatile Bench_Sink = NULL;
+
+static void Bench_Check(bool condition, const char * what)
+{
+	printf("  %-40s %s\n", what, condition ? "ok" : "FAILED");
+	if(condition == false) Bench_Failed = true;
+}
+
+static void Bench_Verify(void)
+{
+	void * block[BENCH_BLOCKS];
+	uint8_t outside[8];
+	struct PoolStats stats;
+	struct Messages * msg = NULL;
+	uint8_t cmd[9 + 3 + EASYIOT_TLV_VALUE_SIZE + 1 + 1];
+	uint16_t length = 0;
+	bool ok = true;
+
+	for(uint16_t i = 0; i < BENCH_BLOCKS; i++)
+	{
+		block[i] = Pool_Alloc(&Bench_Pool);
+		if((block[i] == NULL) || (((uintptr_t)block[i] % POOL_ALIGN) != 0)) ok = false;
+		for(uint16_t j = 0; j < i; j++) if(block[j] == block[i]) ok = false;
+		if(block[i] != NULL) memset(block[i], 0xA5, 20);
+	}
+	Bench_Check(ok, "all blocks distinct and aligned");
+	Bench_Check((Pool_Alloc(&Bench_Pool) == NULL) && (Bench_Pool.Failed == 1), "empty pool fails, counted");
+
+	Bench_Check(Pool_Free(&Bench_Pool, block[3]) && Pool_Free(&Bench_Pool, block[5]), "blocks freed");
+	Bench_Check((Pool_Alloc(&Bench_Pool) == block[5]) && (Pool_Alloc(&Bench_Pool) == block[3]), "freed blocks come back, last first");
+	Bench_Check((Pool_Free(&Bench_Pool, outside) == false) && (Pool_Free(&Bench_Pool, (uint8_t *)block[0] + 4) == false),
+	            "foreign pointers refused");
+
+	for(uint16_t i = 0; i < BENCH_BLOCKS; i++) Pool_Free(&Bench_Pool, block[i]);
+	Bench_Check((Bench_Pool.Used == 0) && (Bench_Pool.HighWater == BENCH_BLOCKS), "used back to 0, high water kept");
+
+	msg = NewMessage();
+	if(msg != NULL)
+	{
+		setMessages(msg, CMT_USER_UP, 1);
+		AddInt8(msg, 1, 60);
+		AddDouble(msg, 2, 1.5);
+		AddString(msg, 3, "longer than a TLV block value");
+	}
+	GetTLVPoolStats(&stats);
+	Bench_Check((msg != NULL) && (msg->tlv_count == 2) && (stats.used == 2), "message of pool, long value refused");
+	FreeMessage(msg);
+	GetTLVPoolStats(&stats);
+	Bench_Check(stats.used == 0, "message gives its TLVs back");
+	GetMessagePoolStats(&stats);
+	Bench_Check((stats.used == 0) && (stats.high_water == 1), "message gives itself back");
+
+	//Command of one TLV, 1 byte longer than a TLV block value
+	length = 9 + 3 + EASYIOT_TLV_VALUE_SIZE + 1 + 1;
+	memset(cmd, 0x5A, sizeof(cmd));
+	cmd[0] = 0x01;
+	cmd[1] = CMT_USER_CMD_REQ;
+	cmd[2] = (uint8_t)((length - 4) >> 8);
+	cmd[3] = (uint8_t)(length - 4);
+	cmd[6] = 1;
+	cmd[7] = (uint8_t)((length - 10) >> 8);
+	cmd[8] = (uint8_t)(length - 10);
+	cmd[9] = 1;
+	cmd[10] = 0;
+	cmd[11] = EASYIOT_TLV_VALUE_SIZE + 1;
+	cmd[length - 1] = 0;
+	for(uint16_t i = 0; i < length - 1; i++) cmd[length - 1] += cmd[i];
+	Bench_Check(CoapInput(NewMessage(), cmd, length) == -1, "command of a too long TLV fails");
+	GetTLVPoolStats(&stats);
+	Bench_Check(stats.used == 0, "failed command gives its TLVs back");
+}
+
+static uint64_t Host_Now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void Run_Malloc(void)
+{
+	void * block = malloc(20);
+
+	Bench_Sink = block;
+	free(block);
+}
+
+static void Run_Pool(void)
+{
+	void * block = Pool_Alloc(&Bench_Pool);
+
+	Bench_Sink = block;
+	Pool_Free(&Bench_Pool, block);
+}
+
+static void Run_Message(void)
+{
+	struct Messages * msg = NewMessage();
+
+	AddInt8(msg, 1, 60);
+	AddInt32(msg, 2, 888);
+	AddInt8(msg, 3, 0);
+	FreeMessage(msg);
+}
+
+static void Bench_Run(const char * name, void (* run)(void), uint32_t rounds)
+{
+	uint64_t start_ns = Host_Now_ns();
+	uint64_t start_cycles = BENCH_CYCLES();
+	uint64_t cycles = 0;
+	uint64_t ns = 0;
+
+	for(uint32_t round = 0; round < rounds; round++) run();
+	cycles = BENCH_CYCLES() - start_cycles;
+	ns = Host_Now_ns() - start_ns;
+
+	printf("  %-24s %8.1f ns", name, (double)ns / rounds);
+	if(cycles != 0) printf(" %8.1f cycles", (double)cycles / rounds);
+	printf("\n");
+}
+
+int main(int argc, char ** argv)
+{
+	uint32_t rounds = 1000000;
+	struct PoolStats stats;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) rounds = (uint32_t)strtoul(argv[++i], NULL, 10);
+	}
+	if(rounds == 0) rounds = 1;
+
+	EasyIotInit("861234567890123", "460113009509999");
+	SetLogLevel(LOG_FATAL);
+
+	printf("Memory pools:\n");
+	Bench_Verify();
+
+	Bench_Run("malloc() / free()", Run_Malloc, rounds);
+	Bench_Run("Pool_Alloc() / Pool_Free()", Run_Pool, rounds);
+	Bench_Run("NewMessage(), 3 TLVs", Run_Message, rounds);
+
+	GetTLVPoolStats(&stats);
+	printf("  TLV pool: %u blocks of %u bytes, high water %u, failed %lu\n", stats.block_count, stats.block_size,
+	       stats.high_water, (unsigned long)stats.failed);
+	return (Bench_Failed == true) ? 1 : 0;
+}
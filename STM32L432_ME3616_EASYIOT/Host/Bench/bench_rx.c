@@ -0,0 +1,276 @@
+/**
+  ******************************************************************************
+  * @file    bench_rx.c
+  * @brief   Receive path under load: ME3616_Rx_Process(), String_Frame(),
+  *          RxHandler() and Active_Report().
+  *
+  *          bench_rx [-r rounds] [-g gap_chars] [trace]
+  *
+  *          Replays a trace of Active Reports back to back, or gap_chars char
+  *          times apart, at each baud rate and main loop period of the table.
+  *          Without a gap UART IDLE never comes, only DMA half / full transfer
+  *          publish what was received. The main loop calls
+  *          ME3616_Rx_Process() once a period, as a busy application would.
+  *          For each row:
+  *            lost      lines never dispatched, dropped by overruns
+  *            overrun   times DMA lapped the parser, Me3616->RxOverruns
+  *            hiwater   most bytes waiting in RxBuffer, Me3616->RxHighWater
+  *            worst_us  virtual time from '\n' on the wire to the handler
+  *            MB/s, klines/s
+  *                      host CPU throughput of ME3616_Rx_Process()
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "me3616.h"
+#include "sim_me3616.h"
+
+#ifndef BENCH_TRACE
+#define BENCH_TRACE                     "session.trace"
+#endif
+
+#define BENCH_TRACE_LINES               128
+#define BENCH_PENDING_LINES             512
+//Bytes kept scheduled ahead, more than the fastest baud sends in the longest period
+#define BENCH_BACKLOG                   3000
+
+static const uint32_t Bench_Baud[] = {9600, 57600, 115200, 230400, 460800, 921600};
+static const uint32_t Bench_Period_us[] = {1000, 5000, 20000};
+
+static char Bench_Trace[BENCH_TRACE_LINES][SIM_LINE_SIZE];
+static uint16_t Bench_TraceCount = 0;
+
+//Lines on the wire, not dispatched yet, by hash of their text
+static struct {
+    uint32_t                Hash;
+    uint64_t                Time_us;            //'\n' reached UART1
+}Bench_Pending[BENCH_PENDING_LINES];
+static uint16_t Bench_PendingHead = 0;
+static uint16_t Bench_PendingCount = 0;
+
+static uint32_t Bench_LineHash = 2166136261U;
+static uint16_t Bench_LineLen = 0;
+
+static uint32_t Bench_Dispatched = 0;
+static uint64_t Bench_Worst_us = 0;
+
+void ME3616_ErrorHandler(char *file, int line, char * pch)
+{
+	fprintf(stderr, "%s:%d: %s\n", file, line, pch);
+	exit(2);
+}
+
+static uint64_t Host_Now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t Bench_Hash(const char * pch, uint16_t len)
+{
+	uint32_t hash = 2166136261U;
+
+	for(uint16_t i = 0; i < len; i++) hash = (hash ^ (uint8_t)pch[i]) * 16777619U;
+	return hash;
+}
+
+/**
+  * @brief  Note the time each non empty line ends on the wire.
+  */
+static void Bench_Rx_Hook(uint8_t byte)
+{
+	if(byte == '\n')
+	{
+		if((Bench_LineLen != 0) && (Bench_PendingCount < BENCH_PENDING_LINES))
+		{
+			uint16_t tail = (Bench_PendingHead + Bench_PendingCount) % BENCH_PENDING_LINES;
+			Bench_Pending[tail].Hash = Bench_LineHash;
+			Bench_Pending[tail].Time_us = Sim_Now_us();
+			Bench_PendingCount++;
+		}
+		Bench_LineHash = 2166136261U;
+		Bench_LineLen = 0;
+	}
+	else if(byte != '\r')
+	{
+		Bench_LineHash = (Bench_LineHash ^ byte) * 16777619U;
+		Bench_LineLen++;
+	}
+}
+
+/**
+  * @brief  Handler of every Active Report in the trace. Lines before the one
+  *         dispatched were lost, a line broken by an overrun matches nothing.
+  */
+static void Bench_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	uint32_t hash = Bench_Hash(pch, len);
+
+	UNUSED(Me3616);
+
+	//Newest match, a lost copy of the same line from an earlier round is older
+	for(uint16_t i = Bench_PendingCount; i > 0; i--)
+	{
+		uint16_t index = (Bench_PendingHead + i - 1) % BENCH_PENDING_LINES;
+		if(Bench_Pending[index].Hash == hash)
+		{
+			uint64_t latency = Sim_Now_us() - Bench_Pending[index].Time_us;
+			if(latency > Bench_Worst_us) Bench_Worst_us = latency;
+			Bench_Dispatched++;
+
+			Bench_PendingHead = (index + 1) % BENCH_PENDING_LINES;
+			Bench_PendingCount -= i;
+			return;
+		}
+	}
+}
+
+void UnknowActiveReport_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	Bench_Report(Me3616, pch, len);
+}
+
+static bool Bench_Load(const char * path)
+{
+	char line[SIM_LINE_SIZE];
+	FILE * file = fopen(path, "r");
+
+	if(file == NULL)
+	{
+		fprintf(stderr, "bench_rx: can not open %s\n", path);
+		return false;
+	}
+
+	while((fgets(line, sizeof(line), file) != NULL) && (Bench_TraceCount < BENCH_TRACE_LINES))
+	{
+		line[strcspn(line, "\r\n")] = '\0';
+		if((line[0] == '\0') || (line[0] == '#')) continue;
+		strcpy(Bench_Trace[Bench_TraceCount++], line);
+	}
+	fclose(file);
+	return (Bench_TraceCount != 0);
+}
+
+/**
+  * @brief  Route every name in the trace to Bench_Report().
+  */
+static bool Bench_Register(void)
+{
+	static char name[BENCH_TRACE_LINES][32];
+
+	for(uint16_t i = 0; i < Bench_TraceCount; i++)
+	{
+		size_t len = strcspn(Bench_Trace[i], ":=");
+		if(len >= sizeof(name[0])) continue;
+
+		memcpy(name[i], Bench_Trace[i], len);
+		name[i][len] = '\0';
+		if(ME3616_Register_URC(name[i], Bench_Report) == false) return false;
+	}
+	return true;
+}
+
+static void Bench_Row(Me3616_DeviceType * Me3616, uint32_t baud, uint32_t period_us, uint32_t rounds, uint32_t gap)
+{
+	char directive[32];
+	uint32_t total = rounds * Bench_TraceCount;
+	uint32_t emitted = 0;
+	uint32_t bytes = 0;
+	uint32_t start_bytes = 0;
+	uint64_t host_ns = 0;
+
+	snprintf(directive, sizeof(directive), "baud %lu", (unsigned long)baud);
+	Sim_Command(directive);
+	snprintf(directive, sizeof(directive), "gap %lu", (unsigned long)(gap * Sim_Modem_Char_us()));
+	Sim_Command(directive);
+
+	//Start clean
+	ME3616_Delay(Me3616, 20);
+	Me3616->RxHighWater = 0;
+	Me3616->RxOverruns = 0;
+	Bench_PendingHead = 0;
+	Bench_PendingCount = 0;
+	Bench_Dispatched = 0;
+	Bench_Worst_us = 0;
+	start_bytes = Sim_Get_Stats()->BytesToMcu;
+
+	while(1)
+	{
+		uint32_t received = Sim_Get_Stats()->BytesToMcu;
+		bool handled = false;
+		uint64_t start_ns = 0;
+
+		//Keep the wire busy, lines go back to back
+		while((emitted < total) && (Sim_Modem_Backlog() < BENCH_BACKLOG))
+		{
+			Sim_Emit(0, Bench_Trace[emitted % Bench_TraceCount]);
+			emitted++;
+		}
+
+		Sim_Advance(period_us);
+		//Last line is published by IDLE, a period may be shorter than the IDLE time
+		if((emitted == total) && (Sim_Modem_Backlog() == 0) && (Sim_Get_Stats()->BytesToMcu == received))
+		{
+			Sim_Advance(4 * Sim_Modem_Char_us());
+		}
+
+		start_ns = Host_Now_ns();
+		handled = ME3616_Rx_Process(Me3616);
+		host_ns += Host_Now_ns() - start_ns;
+
+		if((emitted == total) && (Sim_Modem_Backlog() == 0) && (Sim_Get_Stats()->BytesToMcu == received) && (handled == false)) break;
+	}
+	bytes = Sim_Get_Stats()->BytesToMcu - start_bytes;
+	if(host_ns == 0) host_ns = 1;
+
+	printf("%7lu %9lu %7lu %6lu %8lu %8u %9lu %8.1f %10.1f\n",
+	       (unsigned long)baud, (unsigned long)period_us, (unsigned long)total,
+	       (unsigned long)(total - Bench_Dispatched), (unsigned long)Me3616->RxOverruns,
+	       (unsigned)Me3616->RxHighWater, (unsigned long)Bench_Worst_us,
+	       (double)bytes * 1000.0 / host_ns, (double)Bench_Dispatched * 1000000.0 / host_ns);
+}
+
+int main(int argc, char ** argv)
+{
+	Me3616_DeviceType * Me3616 = &ME3616_Instance;
+	const char * trace = BENCH_TRACE;
+	uint32_t rounds = 20;
+	uint32_t gap = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) rounds = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if((strcmp(argv[i], "-g") == 0) && (i + 1 < argc)) gap = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else trace = argv[i];
+	}
+	if(rounds == 0) rounds = 1;
+
+	if(Bench_Load(trace) == false) return 2;
+
+	Sim_Board_Init();
+	Sim_Command("echo off");
+	Sim_Command("latency 0");
+	if(ME3616_Init(Me3616, &ME3616_UART, &hdma_usart1_tx, &hdma_usart1_rx) == false) return 1;
+	if(Bench_Register() == false) return 1;
+	Sim_Set_Rx_Hook(Bench_Rx_Hook);
+
+	printf("%s, %u lines x %lu rounds, %lu chars apart, RxBuffer %u bytes\n", trace, (unsigned)Bench_TraceCount,
+	       (unsigned long)rounds, (unsigned long)gap, (unsigned)ME3616_RX_BUFFER_SIZE);
+	printf("%7s %9s %7s %6s %8s %8s %9s %8s %10s\n",
+	       "baud", "period_us", "lines", "lost", "overrun", "hiwater", "worst_us", "MB/s", "klines/s");
+
+	for(uint8_t b = 0; b < sizeof(Bench_Baud) / sizeof(Bench_Baud[0]); b++)
+	{
+		for(uint8_t p = 0; p < sizeof(Bench_Period_us) / sizeof(Bench_Period_us[0]); p++)
+		{
+			Bench_Row(Me3616, Bench_Baud[b], Bench_Period_us[p], rounds, gap);
+		}
+	}
+	return 0;
+}
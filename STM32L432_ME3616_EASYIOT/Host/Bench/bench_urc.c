@@ -0,0 +1,136 @@
+/**
+  ******************************************************************************
+  * @file    bench_urc.c
+  * @brief   Cost of dispatching an Active Report line to its handler.
+  *
+  *          Active_Report() with the hashed handler table, against a linear
+  *          strncmp() walk over the same names, which is how the driver used
+  *          to do it. Handlers do nothing, so only the dispatch is measured.
+  *          Cycles are read by rdtsc on x86, elsewhere only ns are reported.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()                  __rdtsc()
+#else
+#define BENCH_CYCLES()                  0ULL
+#endif
+
+#include "me3616.h"
+#include "sim_me3616.h"
+
+#define BENCH_ROUNDS                    200000
+
+//Names of the default table, in the order the linear walk needs
+static const char * const Bench_Name[] =
+{
+	"*MATREADY", "+CFUN", "+CPIN", "+IP", "+ESONMI", "+ESODATA", "+EMQDISCON", "+EMQPUB",
+	"+ECOAPNMI", "+M2MCLIRECV", "+M2MCLI", "+iperf", "+ZGPSR", "+MIPLEVENT", "+MIPLREAD",
+	"+MIPLWRITE", "+MIPLOBSERVE", "+MIPLDISCOVER", "+MIPLPARAMETER"
+};
+#define BENCH_NAME_COUNT                (sizeof(Bench_Name) / sizeof(Bench_Name[0]))
+
+//A mix of a busy session, late table entries and one nobody handles
+static char Bench_Line[][48] =
+{
+	"+M2MCLIRECV: 0A0B0C0D",
+	"+M2MCLI: notify success",
+	"+ESONMI=0,4,31323334",
+	"+IP: 10.20.30.40",
+	"+MIPLPARAMETER: 0,1,2",
+	"*MATREADY: 1",
+	"+CPIN: READY",
+	"+UNKNOWN: 1",
+};
+#define BENCH_LINE_COUNT                (sizeof(Bench_Line) / sizeof(Bench_Line[0]))
+
+static volatile uint32_t Bench_Hits = 0;
+
+void ME3616_ErrorHandler(char *file, int line, char * pch)
+{
+	fprintf(stderr, "%s:%d: %s\n", file, line, pch);
+	exit(2);
+}
+
+void UnknowActiveReport_Callback(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	UNUSED(Me3616);
+	UNUSED(pch);
+	UNUSED(len);
+	Bench_Hits++;
+}
+
+static void Bench_Handler(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	UNUSED(Me3616);
+	UNUSED(pch);
+	UNUSED(len);
+	Bench_Hits++;
+}
+
+static void Linear_Report(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	for(uint8_t i = 0; i < BENCH_NAME_COUNT; i++)
+	{
+		if(strncmp(pch, Bench_Name[i], strlen(Bench_Name[i])) == 0)
+		{
+			Bench_Handler(Me3616, pch, len);
+			return;
+		}
+	}
+	UnknowActiveReport_Callback(Me3616, pch, len);
+}
+
+static uint64_t Host_Now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void Bench_Run(const char * name, void (* report)(Me3616_DeviceType *, char *, uint16_t))
+{
+	uint16_t len[BENCH_LINE_COUNT];
+	uint64_t lines = (uint64_t)BENCH_ROUNDS * BENCH_LINE_COUNT;
+	uint64_t start_ns = 0;
+	uint64_t start_cycles = 0;
+	uint64_t cycles = 0;
+	uint64_t ns = 0;
+
+	for(uint8_t i = 0; i < BENCH_LINE_COUNT; i++) len[i] = (uint16_t)strlen(Bench_Line[i]);
+
+	Bench_Hits = 0;
+	start_ns = Host_Now_ns();
+	start_cycles = BENCH_CYCLES();
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		for(uint8_t i = 0; i < BENCH_LINE_COUNT; i++) report(&ME3616_Instance, Bench_Line[i], len[i]);
+	}
+	cycles = BENCH_CYCLES() - start_cycles;
+	ns = Host_Now_ns() - start_ns;
+
+	printf("%-8s %8.1f ns/line", name, (double)ns / lines);
+	if(cycles != 0) printf(" %8.1f cycles/line", (double)cycles / lines);
+	printf("  (%lu lines)\n", (unsigned long)Bench_Hits);
+}
+
+int main(void)
+{
+	Sim_Board_Init();
+
+	for(uint8_t i = 0; i < BENCH_NAME_COUNT; i++)
+	{
+		if(ME3616_Register_URC(Bench_Name[i], Bench_Handler) == false) return 1;
+	}
+
+	Bench_Run("linear", Linear_Report);
+	Bench_Run("hashed", Active_Report);
+	return 0;
+}
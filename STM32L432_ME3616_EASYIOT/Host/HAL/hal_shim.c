@@ -0,0 +1,395 @@
+/**
+  ******************************************************************************
+  * @file    hal_shim.c
+  * @brief   Host shim of the STM32L4 HAL: virtual time, GPIO, UART1 with a
+  *          circular Rx DMA, UART2 Tx DMA taking as long as the wire would,
+  *          and the IRQ entries the target wires up in stm32l4xx_it.c.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "me3616.h"
+#include "sim_me3616.h"
+
+GPIO_TypeDef Sim_GPIOA;
+GPIO_TypeDef Sim_GPIOB;
+
+static USART_TypeDef Sim_USART1;
+static USART_TypeDef Sim_USART2;
+static DMA_Channel_TypeDef Sim_DMA1_Channel4;
+static DMA_Channel_TypeDef Sim_DMA1_Channel5;
+static DMA_Channel_TypeDef Sim_DMA1_Channel7;
+
+UART_HandleTypeDef huart1;
+UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart1_tx;
+DMA_HandleTypeDef hdma_usart1_rx;
+DMA_HandleTypeDef hdma_usart2_tx;
+
+static uint64_t Sim_Time_us = 0;
+static bool Sim_Irq_Masked = false;
+static bool Sim_In_Irq = false;
+static bool Sim_Verbose = false;
+static Sim_Stats_t Sim_Stats;
+static Sim_Rx_Hook_t Sim_Rx_Hook = NULL;
+static FILE * Sim_Dbg_Capture = NULL;
+
+//UART1 Rx DMA, circular
+static uint8_t * Rx_Buffer = NULL;
+static uint16_t Rx_Size = 0;
+static uint16_t Rx_Pos = 0;
+static bool Rx_Half_Pending = false;
+static bool Rx_Full_Pending = false;
+
+//UART1 IDLE line, raised one frame after the last byte
+static bool Idle_Armed = false;
+static uint64_t Idle_Due = 0;
+
+//UART2 Tx DMA, debug port at 115200, 8N1
+#define SIM_DBG_CHAR_US                 87
+static bool Tx2_Busy = false;
+static bool Tx2_Cplt_Pending = false;
+static uint64_t Tx2_Due = 0;
+
+
+void Sim_Board_Init(void)
+{
+	memset(&Sim_USART1, 0, sizeof(Sim_USART1));
+	memset(&Sim_USART2, 0, sizeof(Sim_USART2));
+	memset(&Sim_Stats, 0, sizeof(Sim_Stats));
+
+	hdma_usart1_tx.Instance = &Sim_DMA1_Channel4;
+	hdma_usart1_rx.Instance = &Sim_DMA1_Channel5;
+	hdma_usart2_tx.Instance = &Sim_DMA1_Channel7;
+	hdma_usart1_tx.State = HAL_DMA_STATE_READY;
+	hdma_usart1_rx.State = HAL_DMA_STATE_READY;
+	hdma_usart2_tx.State = HAL_DMA_STATE_READY;
+
+	huart1.Instance = &Sim_USART1;
+	huart1.hdmatx = &hdma_usart1_tx;
+	huart1.hdmarx = &hdma_usart1_rx;
+	huart1.gState = HAL_UART_STATE_READY;
+	huart1.RxState = HAL_UART_STATE_READY;
+
+	huart2.Instance = &Sim_USART2;
+	huart2.hdmatx = &hdma_usart2_tx;
+	huart2.hdmarx = NULL;
+	huart2.gState = HAL_UART_STATE_READY;
+	huart2.RxState = HAL_UART_STATE_READY;
+
+	//Enabled by MX_USARTx_UART_Init() on target. Tx is done at once, transfer complete is always set
+	Sim_USART1.CR1 = USART_CR1_UE;
+	Sim_USART2.CR1 = USART_CR1_UE;
+	Sim_USART1.ISR = UART_FLAG_TC;
+	Sim_USART2.ISR = UART_FLAG_TC;
+
+	Rx_Buffer = NULL;
+	Rx_Size = 0;
+	Rx_Pos = 0;
+	Rx_Half_Pending = false;
+	Rx_Full_Pending = false;
+	Idle_Armed = false;
+	Tx2_Busy = false;
+	Tx2_Cplt_Pending = false;
+
+	Sim_Verbose = (getenv("ME3616_SIM_VERBOSE") != NULL);
+	Sim_Modem_Reset();
+}
+
+void Sim_Set_Verbose(bool verbose)
+{
+	Sim_Verbose = verbose;
+}
+
+uint64_t Sim_Now_us(void)
+{
+	return Sim_Time_us;
+}
+
+const Sim_Stats_t * Sim_Get_Stats(void)
+{
+	return &Sim_Stats;
+}
+
+void Sim_Set_Rx_Hook(Sim_Rx_Hook_t hook)
+{
+	Sim_Rx_Hook = hook;
+}
+
+/**
+  * @brief  Write every byte MCU sends on UART2 into a file, as a PC terminal would log it.
+  * @param  path: file, truncated. NULL to stop.
+  * @retval false if the file can not be opened.
+  */
+bool Sim_Set_Dbg_Capture(const char * path)
+{
+	if(Sim_Dbg_Capture != NULL) fclose(Sim_Dbg_Capture);
+	Sim_Dbg_Capture = NULL;
+	if(path == NULL) return true;
+
+	Sim_Dbg_Capture = fopen(path, "wb");
+	return (Sim_Dbg_Capture != NULL);
+}
+
+
+/**
+  * @brief  Run IRQ entries with a pending request, as the NVIC would.
+  * @note   Mirrors DMA1_Channel5_IRQHandler(), USART1_IRQHandler() and
+  *         USART2_IRQHandler() of stm32l4xx_it.c.
+  */
+static void Sim_Irq_Dispatch(void)
+{
+	if(Sim_Irq_Masked || Sim_In_Irq) return;
+	Sim_In_Irq = true;
+
+	if(Rx_Half_Pending)
+	{
+		Rx_Half_Pending = false;
+		HAL_UART_RxHalfCpltCallback(&huart1);
+	}
+	if(Rx_Full_Pending)
+	{
+		Rx_Full_Pending = false;
+		HAL_UART_RxCpltCallback(&huart1);
+	}
+
+#ifdef ME3616_RX_IDLE_MODE
+	if(__HAL_UART_GET_FLAG(&huart1, UART_FLAG_IDLE) && (Sim_USART1.CR1 & UART_IT_IDLE))
+	{
+		__HAL_UART_CLEAR_IDLEFLAG(&huart1);
+		UART_AT_Rx_Event(&ME3616_Instance);
+	}
+#else
+	if(__HAL_UART_GET_FLAG(&huart1, UART_FLAG_CMF) && (Sim_USART1.CR1 & UART_IT_CM))
+	{
+		UART_AT_Receive(&ME3616_Instance);
+	}
+#endif
+
+	if(Tx2_Cplt_Pending)
+	{
+		Tx2_Cplt_Pending = false;
+		huart2.gState = HAL_UART_STATE_READY;
+		hdma_usart2_tx.State = HAL_DMA_STATE_READY;
+		Sim_USART2.ISR |= UART_FLAG_TC;
+		HAL_UART_TxCpltCallback(&huart2);
+	}
+
+	Sim_In_Irq = false;
+}
+
+/**
+  * @brief  A byte from ME3616 reaches UART1, DMA moves it into the ring.
+  */
+static void Sim_Uart1_Rx(uint8_t byte)
+{
+	uint8_t match = (uint8_t)((Sim_USART1.CR2 & USART_CR2_ADD) >> USART_CR2_ADD_Pos);
+
+	Sim_Stats.BytesToMcu++;
+	if(Sim_Rx_Hook != NULL) Sim_Rx_Hook(byte);
+
+	if((Sim_USART1.CR1 & USART_CR1_UE) && (byte == match))
+	{
+		Sim_USART1.ISR |= UART_FLAG_CMF;
+		Sim_Stats.MatchEvents++;
+	}
+
+	Idle_Armed = true;
+	Idle_Due = Sim_Time_us + 2 * Sim_Modem_Char_us();
+
+	//DMA not started, byte is lost
+	if((Rx_Buffer == NULL) || (Rx_Size == 0)) return;
+
+	Rx_Buffer[Rx_Pos++] = byte;
+	if(Rx_Pos == Rx_Size / 2)
+	{
+		Rx_Half_Pending = true;
+		Sim_Stats.HalfEvents++;
+	}
+	if(Rx_Pos == Rx_Size)
+	{
+		Rx_Pos = 0;
+		Rx_Full_Pending = true;
+		Sim_Stats.FullEvents++;
+		Sim_Stats.Wraps++;
+	}
+	hdma_usart1_rx.Instance->CNDTR = Rx_Size - Rx_Pos;
+}
+
+/**
+  * @brief  Move virtual time forward, deliver due bytes and raise IRQs on the way.
+  * @param  us: microseconds.
+  */
+void Sim_Advance(uint32_t us)
+{
+	const uint64_t target = Sim_Time_us + us;
+	uint64_t next_due = 0;
+	uint8_t byte = 0;
+
+	while(1)
+	{
+		if(Sim_Modem_Poll(Sim_Time_us, &byte, &next_due))
+		{
+			Sim_Uart1_Rx(byte);
+			Sim_Irq_Dispatch();
+			continue;
+		}
+
+		if(Idle_Armed && (Idle_Due <= Sim_Time_us))
+		{
+			Idle_Armed = false;
+			Sim_USART1.ISR |= UART_FLAG_IDLE;
+			Sim_Stats.IdleEvents++;
+			Sim_Irq_Dispatch();
+			continue;
+		}
+
+		if(Tx2_Busy && (Tx2_Due <= Sim_Time_us))
+		{
+			Tx2_Busy = false;
+			Tx2_Cplt_Pending = true;
+			Sim_Irq_Dispatch();
+			continue;
+		}
+
+		if(Idle_Armed && (Idle_Due < next_due)) next_due = Idle_Due;
+		if(Tx2_Busy && (Tx2_Due < next_due)) next_due = Tx2_Due;
+		if(next_due > target) break;
+		Sim_Time_us = next_due;
+	}
+
+	Sim_Time_us = target;
+	Sim_Irq_Dispatch();
+}
+
+
+/* Core ----------------------------------------------------------------------*/
+uint32_t HAL_GetTick(void)
+{
+	Sim_Advance(SIM_TICK_QUANTUM_US);
+	return (uint32_t)(Sim_Time_us / 1000);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+	Sim_Advance(Delay * 1000);
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+	Sim_Irq_Masked = (priMask != 0);
+	Sim_Irq_Dispatch();
+}
+
+void __disable_irq(void)
+{
+	Sim_Irq_Masked = true;
+}
+
+void __enable_irq(void)
+{
+	Sim_Irq_Masked = false;
+	Sim_Irq_Dispatch();
+}
+
+
+/* GPIO ----------------------------------------------------------------------*/
+void HAL_GPIO_WritePin(GPIO_TypeDef * GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	if(PinState == GPIO_PIN_SET) GPIOx->ODR |= GPIO_Pin;
+	else GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+
+	Sim_Modem_Pin(GPIOx, GPIO_Pin, PinState);
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef * GPIOx, uint16_t GPIO_Pin)
+{
+	return (GPIOx->ODR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+
+/* UART ----------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef * huart, uint8_t * pData, uint16_t Size)
+{
+	if((pData == NULL) || (Size == 0)) return HAL_ERROR;
+
+	if(huart == &huart1)
+	{
+		Sim_Stats.BytesFromMcu += Size;
+		Sim_Modem_Input(pData, Size);
+		huart->Instance->ISR |= UART_FLAG_TC;
+		return HAL_OK;
+	}
+
+	//UART2 is busy until the last char is out, then USART2 IRQ calls back
+	if(huart->gState != HAL_UART_STATE_READY) return HAL_BUSY;
+	Sim_Stats.BytesToDbg += Size;
+	if(Sim_Verbose) fwrite(pData, 1, Size, stdout);
+	if(Sim_Dbg_Capture != NULL)
+	{
+		fwrite(pData, 1, Size, Sim_Dbg_Capture);
+		fflush(Sim_Dbg_Capture);
+	}
+
+	huart->gState = HAL_UART_STATE_BUSY_TX;
+	hdma_usart2_tx.State = HAL_DMA_STATE_BUSY;
+	huart->Instance->ISR &= ~UART_FLAG_TC;
+	Tx2_Busy = true;
+	Tx2_Due = Sim_Time_us + (uint64_t)Size * SIM_DBG_CHAR_US;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef * huart, uint8_t * pData, uint16_t Size)
+{
+	if((pData == NULL) || (Size == 0)) return HAL_ERROR;
+	if(huart != &huart1) return HAL_OK;
+
+	Rx_Buffer = pData;
+	Rx_Size = Size;
+	Rx_Pos = 0;
+	hdma_usart1_rx.Instance->CNDTR = Size;
+	huart->RxState = HAL_UART_STATE_BUSY_RX;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef * huart, uint8_t * pData, uint16_t Size)
+{
+	UNUSED(huart);
+	UNUSED(pData);
+	UNUSED(Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive_IT(UART_HandleTypeDef * huart)
+{
+	UNUSED(huart);
+	return HAL_OK;
+}
+
+__weak void HAL_UART_TxCpltCallback(UART_HandleTypeDef * huart)
+{
+	UNUSED(huart);
+}
+
+__weak void HAL_UART_RxCpltCallback(UART_HandleTypeDef * huart)
+{
+	UNUSED(huart);
+}
+
+__weak void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef * huart)
+{
+	UNUSED(huart);
+}
+
+__weak void HAL_UART_ErrorCallback(UART_HandleTypeDef * huart)
+{
+	UNUSED(huart);
+}
+
+__weak void HAL_UART_AbortReceiveCpltCallback(UART_HandleTypeDef * huart)
+{
+	UNUSED(huart);
+}
@@ -0,0 +1,231 @@
+/**
+  ******************************************************************************
+  * @file    stm32l4xx_hal.h
+  * @brief   Host shim of the STM32L4 HAL, just enough for the ME3616 driver
+  *          to build and run on Linux against the simulated ME3616 (sim_me3616.c).
+  *
+  *          Time is virtual. Every HAL_GetTick() moves it forward by
+  *          SIM_TICK_QUANTUM_US, so polling loops of the driver let the
+  *          simulated UART deliver bytes and raise "interrupts".
+  ******************************************************************************
+  */
+
+#ifndef __STM32L4xx_HAL_HOST_H
+#define __STM32L4xx_HAL_HOST_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __weak                          __attribute__((weak))
+#define __INLINE                        inline
+#define UNUSED(X)                       (void)X
+
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR,
+    HAL_BUSY,
+    HAL_TIMEOUT
+}HAL_StatusTypeDef;
+
+
+/* GPIO ----------------------------------------------------------------------*/
+typedef struct {
+    uint32_t                ODR;
+}GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+}GPIO_PinState;
+
+extern GPIO_TypeDef Sim_GPIOA;
+extern GPIO_TypeDef Sim_GPIOB;
+#define GPIOA                           (&Sim_GPIOA)
+#define GPIOB                           (&Sim_GPIOB)
+
+#define GPIO_PIN_0                      ((uint16_t)0x0001)
+#define GPIO_PIN_1                      ((uint16_t)0x0002)
+#define GPIO_PIN_2                      ((uint16_t)0x0004)
+#define GPIO_PIN_3                      ((uint16_t)0x0008)
+#define GPIO_PIN_4                      ((uint16_t)0x0010)
+#define GPIO_PIN_5                      ((uint16_t)0x0020)
+#define GPIO_PIN_6                      ((uint16_t)0x0040)
+#define GPIO_PIN_7                      ((uint16_t)0x0080)
+#define GPIO_PIN_8                      ((uint16_t)0x0100)
+#define GPIO_PIN_9                      ((uint16_t)0x0200)
+#define GPIO_PIN_10                     ((uint16_t)0x0400)
+#define GPIO_PIN_11                     ((uint16_t)0x0800)
+#define GPIO_PIN_12                     ((uint16_t)0x1000)
+#define GPIO_PIN_13                     ((uint16_t)0x2000)
+#define GPIO_PIN_14                     ((uint16_t)0x4000)
+#define GPIO_PIN_15                     ((uint16_t)0x8000)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef * GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef * GPIOx, uint16_t GPIO_Pin);
+
+
+/* DMA -----------------------------------------------------------------------*/
+typedef struct {
+    volatile uint32_t       CNDTR;
+}DMA_Channel_TypeDef;
+
+typedef enum {
+    HAL_DMA_STATE_RESET = 0,
+    HAL_DMA_STATE_READY,
+    HAL_DMA_STATE_BUSY
+}HAL_DMA_StateTypeDef;
+
+typedef struct {
+    DMA_Channel_TypeDef   * Instance;
+    HAL_DMA_StateTypeDef    State;
+}DMA_HandleTypeDef;
+
+#define __HAL_DMA_GET_COUNTER(__HANDLE__)           ((__HANDLE__)->Instance->CNDTR)
+
+
+/* UART ----------------------------------------------------------------------*/
+typedef struct {
+    volatile uint32_t       CR1;
+    volatile uint32_t       CR2;
+    volatile uint32_t       CR3;
+    volatile uint32_t       ISR;
+}USART_TypeDef;
+
+typedef enum {
+    HAL_UART_STATE_RESET = 0x00,
+    HAL_UART_STATE_READY = 0x20,
+    HAL_UART_STATE_BUSY = 0x24,
+    HAL_UART_STATE_BUSY_TX = 0x21,
+    HAL_UART_STATE_BUSY_RX = 0x22
+}HAL_UART_StateTypeDef;
+
+typedef struct {
+    USART_TypeDef         * Instance;
+    DMA_HandleTypeDef     * hdmatx;
+    DMA_HandleTypeDef     * hdmarx;
+    HAL_UART_StateTypeDef   gState;
+    HAL_UART_StateTypeDef   RxState;
+}UART_HandleTypeDef;
+
+//ISR flags, clear flags use the same bits
+#define UART_FLAG_IDLE                  (1U << 4)
+#define UART_FLAG_RXNE                  (1U << 5)
+#define UART_FLAG_TC                    (1U << 6)
+#define UART_FLAG_CMF                   (1U << 17)
+#define UART_CLEAR_IDLEF                UART_FLAG_IDLE
+#define UART_CLEAR_CMF                  UART_FLAG_CMF
+
+//CR1 interrupt enable bits, UART_IT_ERR lives in CR3 on target and is ignored here
+#define UART_IT_IDLE                    (1U << 4)
+#define UART_IT_CM                      (1U << 14)
+#define UART_IT_ERR                     (1U << 31)
+#define USART_CR1_UE                    (1U << 0)
+
+#define USART_CR2_ADD_Pos               24U
+#define USART_CR2_ADD                   (0xFFU << USART_CR2_ADD_Pos)
+
+#define __HAL_UART_GET_FLAG(__HANDLE__, __FLAG__)   (((__HANDLE__)->Instance->ISR & (__FLAG__)) == (__FLAG__))
+#define __HAL_UART_CLEAR_FLAG(__HANDLE__, __FLAG__) ((__HANDLE__)->Instance->ISR &= ~(uint32_t)(__FLAG__))
+#define __HAL_UART_CLEAR_IDLEFLAG(__HANDLE__)       __HAL_UART_CLEAR_FLAG((__HANDLE__), UART_CLEAR_IDLEF)
+#define __HAL_UART_ENABLE_IT(__HANDLE__, __IT__)    ((__HANDLE__)->Instance->CR1 |= (uint32_t)(__IT__))
+#define __HAL_UART_DISABLE_IT(__HANDLE__, __IT__)   ((__HANDLE__)->Instance->CR1 &= ~(uint32_t)(__IT__))
+#define __HAL_UART_ENABLE(__HANDLE__)               ((__HANDLE__)->Instance->CR1 |= USART_CR1_UE)
+#define __HAL_UART_DISABLE(__HANDLE__)              ((__HANDLE__)->Instance->CR1 &= ~USART_CR1_UE)
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef * huart, uint8_t * pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef * huart, uint8_t * pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef * huart, uint8_t * pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_AbortReceive_IT(UART_HandleTypeDef * huart);
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef * huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef * huart);
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef * huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef * huart);
+void HAL_UART_AbortReceiveCpltCallback(UART_HandleTypeDef * huart);
+
+
+/* Core ----------------------------------------------------------------------*/
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+void __set_PRIMASK(uint32_t priMask);
+void __disable_irq(void);
+void __enable_irq(void);
+
+//Exclusive access of CMSIS. IRQs of the shim only run inside HAL calls, never
+//between __LDREXW() and __STREXW(), so the store always succeeds.
+static inline uint32_t __LDREXW(volatile uint32_t * addr)
+{
+    return *addr;
+}
+
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t * addr)
+{
+    *addr = value;
+    return 0;
+}
+
+static inline void __CLREX(void)
+{
+}
+
+#define __DMB()                         __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+//SIMD of the Cortex-M4 DSP extension, APSR.GE kept per file as the lane flags.
+static inline uint32_t * Sim_APSR_GE(void)
+{
+    static uint32_t ge;
+    return &ge;
+}
+
+static inline uint32_t __USUB8(uint32_t op1, uint32_t op2)
+{
+    uint32_t result = 0;
+
+    *Sim_APSR_GE() = 0;
+    for(uint8_t lane = 0; lane < 4; lane++)
+    {
+        uint8_t a = (uint8_t)(op1 >> (8 * lane));
+        uint8_t b = (uint8_t)(op2 >> (8 * lane));
+        if(a >= b) *Sim_APSR_GE() |= 1U << lane;
+        result |= (uint32_t)(uint8_t)(a - b) << (8 * lane);
+    }
+    return result;
+}
+
+static inline uint32_t __UADD8(uint32_t op1, uint32_t op2)
+{
+    uint32_t result = 0;
+
+    *Sim_APSR_GE() = 0;
+    for(uint8_t lane = 0; lane < 4; lane++)
+    {
+        uint16_t sum = (uint16_t)(uint8_t)(op1 >> (8 * lane)) + (uint8_t)(op2 >> (8 * lane));
+        if(sum > 0xFF) *Sim_APSR_GE() |= 1U << lane;
+        result |= (uint32_t)(uint8_t)sum << (8 * lane);
+    }
+    return result;
+}
+
+static inline uint32_t __SEL(uint32_t op1, uint32_t op2)
+{
+    uint32_t result = 0;
+
+    for(uint8_t lane = 0; lane < 4; lane++)
+    {
+        uint32_t mask = 0xFFU << (8 * lane);
+        result |= ((*Sim_APSR_GE() >> lane) & 1U) ? (op1 & mask) : (op2 & mask);
+    }
+    return result;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32L4xx_HAL_HOST_H */
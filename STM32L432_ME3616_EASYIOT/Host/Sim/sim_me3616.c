@@ -0,0 +1,758 @@
+/**
+  ******************************************************************************
+  * @file    sim_me3616.c
+  * @brief   Simulated ME3616 for the host build. See sim_me3616.h for the
+  *          script directives.
+  *
+  *          Lines to send are kept as events with a due time. Once due, an
+  *          event is serialized into the output FIFO byte by byte, one char
+  *          time apart, with a gap after every fragment. hal_shim.c pulls the
+  *          bytes by Sim_Modem_Poll() as virtual time goes on.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "me3616.h"
+#include "sim_me3616.h"
+
+#define SIM_EVENT_COUNT                 64
+#define SIM_RULE_COUNT                  48
+#define SIM_AFTER_COUNT                 16
+#define SIM_BOOT_COUNT                  16
+#define SIM_FIFO_SIZE                   4096
+#define SIM_SEGMENT_COUNT               8
+#define SIM_RAW_SIZE                    2048
+
+typedef struct {
+    uint64_t                Due;
+    uint32_t                Seq;                //keeps order of events due at the same time
+    uint16_t                Len;
+    char                    Text[SIM_LINE_SIZE + 4];
+}Sim_Event_t;
+
+typedef struct {
+    char                    Prefix[48];
+    char                    Answer[SIM_LINE_SIZE];  //lines split by '|', last one is the final result
+}Sim_Rule_t;
+
+typedef struct {
+    char                    Prefix[48];
+    uint32_t                Delay_ms;
+    char                    Line[SIM_LINE_SIZE];
+}Sim_After_t;
+
+typedef struct {
+    uint32_t                Delay_ms;
+    char                    Line[SIM_LINE_SIZE];
+}Sim_Boot_t;
+
+typedef struct {
+    uint64_t                Due;
+    uint8_t                 Byte;
+}Sim_Byte_t;
+
+static const Sim_Rule_t Sim_Rule_Default[] =
+{
+    {"AT",                  "OK"},
+    {"AT+CIMI",             "460113009501234|OK"},
+    {"AT+CGSN=2",           "+CGSN: 3531110912345678|OK"},
+    {"AT+CGSN=1",           "+CGSN: 868334031234567|OK"},
+    {"AT*MICCID",           "*MICCID: 89860317492039123456|OK"},
+    {"AT+CESQ",             "+CESQ: 31,0,255,255,18,52|OK"},
+    {"AT+CSQ",              "+CSQ: 21,99|OK"},
+    {"AT+CEREG?",           "+CEREG: 2,1,\"5D04\",\"0BE7A21\",9|OK"},
+    {"AT+ZADC?",            "+ZADC: 3612|OK"},
+    {"AT+CFUN?",            "+CFUN: 1|OK"},
+    {"AT+CPIN?",            "+CPIN: READY|OK"},
+    {"AT+CCLK?",            "+CCLK: \"26/10/17,08:30:00+32\"|OK"},
+    {"AT+ESOC=",            "+ESOC=1|OK"},
+    {"AT+ESOCON=",          "OK"},
+    {"AT+ESOSEND=",         "OK"},
+    {"AT+ESOSENDRAW=",      "OK"},
+    {"AT+ESOSETRPT=",       "OK"},
+    {"AT+ESOREADEN=",       "OK"},
+    {"AT+ESOCL=",           "OK"},
+    {"AT+EMQNEW=",          "+EMQNEW: 0|OK"},
+    {"AT+EMQCON=",          "OK"},
+    {"AT+EMQSUB=",          "OK"},
+    {"AT+EMQUNSUB=",        "OK"},
+    {"AT+EMQPUB=",          "OK"},
+    {"AT+EMQDISCON=",       "OK"},
+    {"AT+ECOAPNEW=",        "+ECOAPNEW: 0|OK"},
+    {"AT+ECOAPSEND=",       "OK"},
+    {"AT+ECOAPDEL=",        "OK"},
+    {"AT+EHTTPCREATE=",     "+EHTTPCREATE: 0|OK"},
+    {"AT+EHTTPCON=",        "OK"},
+    {"AT+EHTTPSEND=",       "OK"},
+    {"AT+EHTTPDISCON=",     "OK"},
+    {"AT+EHTTPDESTROY=",    "OK"},
+};
+
+static const Sim_After_t Sim_After_Default[] =
+{
+    {"AT+M2MCLINEW=",       500,    "+M2MCLI: register success"},
+    {"AT+M2MCLINEW=",       800,    "+M2MCLI: observe success"},
+    {"AT+M2MCLISEND=",      300,    "+M2MCLI: notify success"},
+    {"AT+M2MCLIDEL",        200,    "+M2MCLI: deregister success"},
+};
+
+static const Sim_Boot_t Sim_Boot_Default[] =
+{
+    {1200,  "*MATREADY: 1"},
+    {300,   "+CFUN: 1"},
+    {100,   "+CPIN: READY"},
+    {2500,  "+IP: 10.20.30.40"},
+    {400,   "+IP: 2001:DB8::1"},
+};
+
+static struct {
+    bool                    Echo;
+    uint32_t                Baud;
+    uint32_t                Char_us;
+    uint32_t                Latency_us;
+    uint32_t                Fragment;
+    uint32_t                Fragment_Gap_us;
+    bool                    Powered;
+    bool                    InReset;
+
+    Sim_Rule_t              Rule[SIM_RULE_COUNT];
+    uint16_t                RuleCount;
+    Sim_After_t             After[SIM_AFTER_COUNT];
+    uint16_t                AfterCount;
+    Sim_Boot_t              Boot[SIM_BOOT_COUNT];
+    uint16_t                BootCount;
+    bool                    BootScripted;       //a "boot" directive replaced the default ones
+
+    Sim_Event_t             Event[SIM_EVENT_COUNT];
+    uint16_t                EventCount;
+    uint32_t                EventSeq;
+
+    Sim_Byte_t              Fifo[SIM_FIFO_SIZE];
+    uint16_t                FifoHead;
+    uint16_t                FifoCount;
+    uint64_t                WireFree;           //earliest time next byte can go
+    uint32_t                FragmentSent;
+    uint32_t                Line_Gap_us;
+
+    char                    Input[SIM_LINE_SIZE];
+    uint16_t                InputLen;
+    char                    LastCommand[SIM_LINE_SIZE];
+
+    uint16_t                RawLeft;            //payload bytes of AT+ESOSENDRAW not received yet
+    bool                    RawSkipLf;          //'\n' after the command '\r' is not payload
+    uint8_t                 Raw[SIM_RAW_SIZE];  //last AT+ESOSENDRAW payload
+    uint16_t                RawLen;
+}Sim;
+
+//Kept over Sim_Modem_Reset()
+static Sim_Command_Hook_t Sim_Command_Hook = NULL;
+
+
+uint32_t Sim_Modem_Char_us(void)
+{
+	return Sim.Char_us;
+}
+
+/**
+  * @brief  Bytes scheduled and not yet on the wire.
+  */
+uint32_t Sim_Modem_Backlog(void)
+{
+	uint32_t bytes = Sim.FifoCount;
+
+	for(uint16_t i = 0; i < Sim.EventCount; i++) bytes += Sim.Event[i].Len;
+	return bytes;
+}
+
+static void Sim_Set_Baud(uint32_t baud)
+{
+	if(baud == 0) baud = 115200;
+	Sim.Baud = baud;
+	//8N1, 10 bits a char
+	Sim.Char_us = (10 * 1000000 + baud - 1) / baud;
+}
+
+void Sim_Modem_Reset(void)
+{
+	memset(&Sim, 0, sizeof(Sim));
+
+	Sim.Echo = true;
+	Sim_Set_Baud(115200);
+	Sim.Latency_us = 20 * 1000;
+
+	memcpy(Sim.Rule, Sim_Rule_Default, sizeof(Sim_Rule_Default));
+	Sim.RuleCount = sizeof(Sim_Rule_Default) / sizeof(Sim_Rule_Default[0]);
+	memcpy(Sim.After, Sim_After_Default, sizeof(Sim_After_Default));
+	Sim.AfterCount = sizeof(Sim_After_Default) / sizeof(Sim_After_Default[0]);
+	memcpy(Sim.Boot, Sim_Boot_Default, sizeof(Sim_Boot_Default));
+	Sim.BootCount = sizeof(Sim_Boot_Default) / sizeof(Sim_Boot_Default[0]);
+}
+
+
+/**
+  * @brief  Schedule bytes to send.
+  * @param  due: virtual time in us.
+  * @param  text: bytes as they are.
+  * @param  len: length of text.
+  */
+static void Sim_Schedule(uint64_t due, const char * text, uint16_t len)
+{
+	Sim_Event_t * event = NULL;
+
+	if(Sim.EventCount >= SIM_EVENT_COUNT)
+	{
+		fprintf(stderr, "sim: event queue full, \"%.*s\" dropped\n", (int)len, text);
+		return;
+	}
+	if(len > SIM_LINE_SIZE + 4) len = SIM_LINE_SIZE + 4;
+
+	event = &Sim.Event[Sim.EventCount++];
+	event->Due = due;
+	event->Seq = Sim.EventSeq++;
+	event->Len = len;
+	memcpy(event->Text, text, len);
+}
+
+/**
+  * @brief  Schedule bytes as ME3616 frames a line, "\r\n<data>\r\n".
+  */
+static void Sim_Schedule_Bytes(uint64_t due, const char * data, uint16_t len)
+{
+	char text[SIM_LINE_SIZE + 4];
+
+	if(len > SIM_LINE_SIZE) len = SIM_LINE_SIZE;
+	memcpy(text, "\r\n", 2);
+	memcpy(text + 2, data, len);
+	memcpy(text + 2 + len, "\r\n", 2);
+	Sim_Schedule(due, text, len + 4);
+}
+
+static void Sim_Schedule_Line(uint64_t due, const char * line)
+{
+	Sim_Schedule_Bytes(due, line, (uint16_t)strnlen(line, SIM_LINE_SIZE - 1));
+}
+
+static void Sim_Fifo_Push(uint64_t due, uint8_t byte)
+{
+	if(Sim.FifoCount >= SIM_FIFO_SIZE)
+	{
+		fprintf(stderr, "sim: output FIFO full\n");
+		return;
+	}
+	Sim.Fifo[(Sim.FifoHead + Sim.FifoCount) % SIM_FIFO_SIZE].Due = due;
+	Sim.Fifo[(Sim.FifoHead + Sim.FifoCount) % SIM_FIFO_SIZE].Byte = byte;
+	Sim.FifoCount++;
+}
+
+/**
+  * @brief  Serialize the event at index, UART paces bytes by char time.
+  */
+static void Sim_Serialize(uint16_t index)
+{
+	Sim_Event_t * event = &Sim.Event[index];
+	uint64_t due = event->Due;
+
+	if(due < Sim.WireFree) due = Sim.WireFree;
+
+	for(uint16_t i = 0; i < event->Len; i++)
+	{
+		Sim_Fifo_Push(due, (uint8_t)event->Text[i]);
+		due += Sim.Char_us;
+
+		if((Sim.Fragment != 0) && (++Sim.FragmentSent >= Sim.Fragment))
+		{
+			Sim.FragmentSent = 0;
+			due += Sim.Fragment_Gap_us;
+		}
+	}
+	Sim.WireFree = due + Sim.Line_Gap_us;
+
+	Sim.Event[index] = Sim.Event[--Sim.EventCount];
+}
+
+/**
+  * @brief  Hand over next byte due by now.
+  * @param  now: virtual time in us.
+  * @param  byte: byte to receive.
+  * @param  next_due: if nothing is due, time of next byte or event, UINT64_MAX if none.
+  * @retval true with a byte due.
+  */
+bool Sim_Modem_Poll(uint64_t now, uint8_t * byte, uint64_t * next_due)
+{
+	uint64_t earliest = UINT64_MAX;
+
+	//Serialize due events, oldest first
+	while(1)
+	{
+		int16_t pick = -1;
+
+		for(uint16_t i = 0; i < Sim.EventCount; i++)
+		{
+			if(Sim.Event[i].Due > now) continue;
+			if((pick < 0) || (Sim.Event[i].Due < Sim.Event[pick].Due)
+			   || ((Sim.Event[i].Due == Sim.Event[pick].Due) && (Sim.Event[i].Seq < Sim.Event[pick].Seq)))
+			{
+				pick = (int16_t)i;
+			}
+		}
+		if(pick < 0) break;
+		Sim_Serialize((uint16_t)pick);
+	}
+
+	if(Sim.FifoCount != 0)
+	{
+		if(Sim.Fifo[Sim.FifoHead].Due <= now)
+		{
+			*byte = Sim.Fifo[Sim.FifoHead].Byte;
+			Sim.FifoHead = (Sim.FifoHead + 1) % SIM_FIFO_SIZE;
+			Sim.FifoCount--;
+			return true;
+		}
+		earliest = Sim.Fifo[Sim.FifoHead].Due;
+	}
+
+	for(uint16_t i = 0; i < Sim.EventCount; i++)
+	{
+		if(Sim.Event[i].Due < earliest) earliest = Sim.Event[i].Due;
+	}
+
+	*next_due = earliest;
+	return false;
+}
+
+
+static void Sim_Boot(void)
+{
+	uint64_t due = Sim_Now_us();
+
+	Sim.Powered = true;
+	for(uint16_t i = 0; i < Sim.BootCount; i++)
+	{
+		due += (uint64_t)Sim.Boot[i].Delay_ms * 1000;
+		Sim_Schedule_Line(due, Sim.Boot[i].Line);
+	}
+}
+
+/**
+  * @brief  Module pins driven by MCU. Reset held low drops everything pending,
+  *         release of reset, or of power key while off, boots the module.
+  */
+void Sim_Modem_Pin(GPIO_TypeDef * port, uint16_t pin, GPIO_PinState state)
+{
+	if((port == ME3616_Reset_Port) && (pin == ME3616_Reset_Pin))
+	{
+		if(state == GPIO_PIN_SET)
+		{
+			Sim.InReset = true;
+			Sim.EventCount = 0;
+			Sim.InputLen = 0;
+		}
+		else if(Sim.InReset == true)
+		{
+			Sim.InReset = false;
+			Sim_Boot();
+		}
+	}
+	else if((port == ME3616_Power_Port) && (pin == ME3616_Power_Pin))
+	{
+		if((state == GPIO_PIN_RESET) && (Sim.Powered == false) && (Sim.InReset == false)) Sim_Boot();
+	}
+}
+
+
+static const Sim_Rule_t * Sim_Find_Rule(const char * command)
+{
+	const Sim_Rule_t * best = NULL;
+	size_t best_len = 0;
+
+	for(uint16_t i = 0; i < Sim.RuleCount; i++)
+	{
+		size_t len = strlen(Sim.Rule[i].Prefix);
+		if((len >= best_len) && (strncmp(command, Sim.Rule[i].Prefix, len) == 0))
+		{
+			best = &Sim.Rule[i];
+			best_len = len;
+		}
+	}
+	return best;
+}
+
+static char * Sim_Trim(char * str)
+{
+	char * end = NULL;
+
+	while(isspace((unsigned char)*str)) str++;
+	end = str + strlen(str);
+	while((end > str) && isspace((unsigned char)end[-1])) *--end = '\0';
+	return str;
+}
+
+/**
+  * @brief  Undo "\r", "\n", "\\" and "\xNN" escapes in place.
+  * @retval bytes, '\0' may be among them.
+  */
+static uint16_t Sim_Unescape(char * str)
+{
+	char * out = str;
+
+	for(char * in = str; *in != '\0'; in++)
+	{
+		if((in[0] == '\\') && (in[1] == 'x') && isxdigit((unsigned char)in[2]) && isxdigit((unsigned char)in[3]))
+		{
+			char hex[3] = {in[2], in[3], '\0'};
+
+			*out++ = (char)strtoul(hex, NULL, 16);
+			in += 3;
+		}
+		else if((in[0] == '\\') && (in[1] != '\0'))
+		{
+			in++;
+			if(*in == 'r') *out++ = '\r';
+			else if(*in == 'n') *out++ = '\n';
+			else *out++ = *in;
+		}
+		else
+		{
+			*out++ = *in;
+		}
+	}
+	*out = '\0';
+	return (uint16_t)(out - str);
+}
+
+/**
+  * @brief  Answer one command segment, lines go at *due.
+  * @retval true if the final result is "OK".
+  */
+static bool Sim_Answer(const char * command, uint64_t due, bool last)
+{
+	const Sim_Rule_t * rule = Sim_Find_Rule(command);
+	char answer[SIM_LINE_SIZE];
+	char * line = NULL;
+	char * next = NULL;
+	bool ok = true;
+
+	if(rule == NULL)
+	{
+		Sim_Schedule_Line(due, "ERROR");
+		return false;
+	}
+
+	strcpy(answer, rule->Answer);
+	line = answer;
+	while(line != NULL)
+	{
+		next = strchr(line, '|');
+		if(next != NULL) *next++ = '\0';
+		line = Sim_Trim(line);
+
+		if(next == NULL)
+		{
+			//Final result, combined commands share one "OK" at the end.
+			ok = (strcmp(line, "OK") == 0);
+			if((ok == false) || (last == true)) Sim_Schedule_Line(due, line);
+		}
+		else
+		{
+			//Binary payload of a response, "\xNN" escaped
+			Sim_Schedule_Bytes(due, line, Sim_Unescape(line));
+		}
+		line = next;
+	}
+
+	for(uint16_t i = 0; ok && (i < Sim.AfterCount); i++)
+	{
+		if(strncmp(command, Sim.After[i].Prefix, strlen(Sim.After[i].Prefix)) == 0)
+		{
+			Sim_Schedule_Line(due + (uint64_t)Sim.After[i].Delay_ms * 1000, Sim.After[i].Line);
+		}
+	}
+	return ok;
+}
+
+/**
+  * @brief  A full command line from MCU, "AT+A;+B" runs A then B.
+  */
+static void Sim_Command_Line(const char * line, uint16_t len)
+{
+	char command[SIM_LINE_SIZE];
+	char segment[SIM_LINE_SIZE];
+	char * seg[SIM_SEGMENT_COUNT];
+	uint16_t count = 0;
+	uint64_t due = Sim_Now_us();
+	char * pch = NULL;
+
+	if(len >= SIM_LINE_SIZE) len = SIM_LINE_SIZE - 1;
+	memcpy(command, line, len);
+	command[len] = '\0';
+	memcpy(Sim.LastCommand, command, len + 1);
+
+	if(Sim.Echo == true)
+	{
+		char echo[SIM_LINE_SIZE + 2];
+		int n = snprintf(echo, sizeof(echo), "%s\r\n", command);
+		Sim_Schedule(due, echo, (uint16_t)n);
+	}
+	if(Sim_Command_Hook != NULL) Sim_Command_Hook(Sim.LastCommand);
+	if(len < 2) return;
+
+	due += Sim.Latency_us;
+
+	//Split combined commands, quoted ';' is not a separator
+	pch = command;
+	seg[count++] = command;
+	for(bool quoted = false; *pch != '\0'; pch++)
+	{
+		if(*pch == '"') quoted = !quoted;
+		if((*pch == ';') && (quoted == false) && (count < SIM_SEGMENT_COUNT))
+		{
+			*pch = '\0';
+			seg[count++] = pch + 1;
+		}
+	}
+
+	for(uint16_t i = 0; i < count; i++)
+	{
+		if(i == 0) snprintf(segment, sizeof(segment), "%s", seg[i]);
+		else snprintf(segment, sizeof(segment), "AT%s", seg[i]);
+
+		if(Sim_Answer(segment, due, (i + 1) == count) == false) break;
+	}
+}
+
+/**
+  * @brief  Bytes from MCU, commands end with '\r'.
+  * @note   "AT+ESOSENDRAW=<socket>,<length>" is followed by <length> bytes as they
+  *         are, it is answered once they are all in.
+  */
+void Sim_Modem_Input(const uint8_t * data, uint16_t len)
+{
+	static const char raw_command[] = "AT+ESOSENDRAW=";
+	const char * pch = NULL;
+
+	if((Sim.InReset == true) || (Sim.Powered == false)) return;
+
+	for(uint16_t i = 0; i < len; i++)
+	{
+		if((Sim.RawSkipLf == true) && (data[i] == '\n'))
+		{
+			Sim.RawSkipLf = false;
+		}
+		else if(Sim.RawLeft != 0)
+		{
+			Sim.RawSkipLf = false;
+			if(Sim.RawLen < SIM_RAW_SIZE) Sim.Raw[Sim.RawLen++] = data[i];
+			if(--Sim.RawLeft == 0)
+			{
+				Sim_Command_Line(Sim.Input, Sim.InputLen);
+				Sim.InputLen = 0;
+			}
+		}
+		else if((data[i] == '\r') || (data[i] == '\n'))
+		{
+			pch = (Sim.InputLen > sizeof(raw_command) - 1) ? memchr(Sim.Input, ',', Sim.InputLen) : NULL;
+			if((pch != NULL) && (strncmp(Sim.Input, raw_command, sizeof(raw_command) - 1) == 0))
+			{
+				//Length field, then the payload, the answer waits for it
+				Sim.Input[Sim.InputLen] = '\0';
+				Sim.RawLeft = (uint16_t)strtoul(pch + 1, NULL, 10);
+				Sim.RawSkipLf = (data[i] == '\r');
+				Sim.RawLen = 0;
+				if(Sim.RawLeft != 0) continue;
+			}
+			if(Sim.InputLen != 0) Sim_Command_Line(Sim.Input, Sim.InputLen);
+			Sim.InputLen = 0;
+		}
+		else if(Sim.InputLen < SIM_LINE_SIZE - 1)
+		{
+			Sim.Input[Sim.InputLen++] = (char)data[i];
+		}
+	}
+}
+
+
+const char * Sim_Modem_Last_Command(void)
+{
+	return Sim.LastCommand;
+}
+
+const uint8_t * Sim_Modem_Last_Raw(uint16_t * len)
+{
+	*len = Sim.RawLen;
+	return Sim.Raw;
+}
+
+
+void Sim_Emit(uint32_t delay_ms, const char * line)
+{
+	Sim_Schedule_Line(Sim_Now_us() + (uint64_t)delay_ms * 1000, line);
+}
+
+void Sim_Emit_Bytes(uint32_t delay_ms, const uint8_t * data, uint16_t len)
+{
+	Sim_Schedule_Bytes(Sim_Now_us() + (uint64_t)delay_ms * 1000, (const char *)data, len);
+}
+
+void Sim_Emit_Raw(uint32_t delay_ms, const uint8_t * data, uint16_t len)
+{
+	if(len > SIM_LINE_SIZE) len = SIM_LINE_SIZE;
+	Sim_Schedule(Sim_Now_us() + (uint64_t)delay_ms * 1000, (const char *)data, len);
+}
+
+void Sim_Set_Command_Hook(Sim_Command_Hook_t hook)
+{
+	Sim_Command_Hook = hook;
+}
+
+/**
+  * @brief  Split first word off str.
+  * @retval rest of str, after blanks.
+  */
+static char * Sim_Word(char * str, char ** word)
+{
+	while(isspace((unsigned char)*str)) str++;
+	*word = str;
+	while((*str != '\0') && !isspace((unsigned char)*str)) str++;
+	if(*str != '\0') *str++ = '\0';
+	while(isspace((unsigned char)*str)) str++;
+	return str;
+}
+
+/**
+  * @brief  Run one script directive.
+  * @retval false on a bad directive.
+  */
+bool Sim_Command(const char * directive)
+{
+	char buffer[SIM_LINE_SIZE * 2];
+	char * rest = NULL;
+	char * word = NULL;
+	char * arg = NULL;
+
+	snprintf(buffer, sizeof(buffer), "%s", directive);
+	rest = Sim_Trim(buffer);
+	if((*rest == '\0') || (*rest == '#')) return true;
+
+	rest = Sim_Word(rest, &word);
+
+	if(strcmp(word, "echo") == 0)
+	{
+		Sim.Echo = (strcmp(rest, "off") != 0);
+	}
+	else if(strcmp(word, "baud") == 0)
+	{
+		Sim_Set_Baud((uint32_t)strtoul(rest, NULL, 10));
+	}
+	else if(strcmp(word, "latency") == 0)
+	{
+		Sim.Latency_us = (uint32_t)strtoul(rest, NULL, 10) * 1000;
+	}
+	else if(strcmp(word, "fragment") == 0)
+	{
+		rest = Sim_Word(rest, &arg);
+		Sim.Fragment = (uint32_t)strtoul(arg, NULL, 10);
+		Sim.Fragment_Gap_us = (uint32_t)strtoul(rest, NULL, 10);
+		Sim.FragmentSent = 0;
+	}
+	else if(strcmp(word, "gap") == 0)
+	{
+		Sim.Line_Gap_us = (uint32_t)strtoul(rest, NULL, 10);
+	}
+	else if(strcmp(word, "boot") == 0)
+	{
+		if(Sim.BootScripted == false)
+		{
+			Sim.BootScripted = true;
+			Sim.BootCount = 0;
+		}
+		if(Sim.BootCount >= SIM_BOOT_COUNT) return false;
+		rest = Sim_Word(rest, &arg);
+		Sim.Boot[Sim.BootCount].Delay_ms = (uint32_t)strtoul(arg, NULL, 10);
+		snprintf(Sim.Boot[Sim.BootCount].Line, SIM_LINE_SIZE, "%s", rest);
+		Sim.BootCount++;
+	}
+	else if(strcmp(word, "rule") == 0)
+	{
+		Sim_Rule_t * rule = NULL;
+		char * answer = strstr(rest, "=>");
+
+		if(answer == NULL) return false;
+		*answer = '\0';
+		answer += 2;
+		rest = Sim_Trim(rest);
+
+		//Same prefix replaces the rule
+		for(uint16_t i = 0; i < Sim.RuleCount; i++)
+		{
+			if(strcmp(Sim.Rule[i].Prefix, rest) == 0) rule = &Sim.Rule[i];
+		}
+		if(rule == NULL)
+		{
+			if(Sim.RuleCount >= SIM_RULE_COUNT) return false;
+			rule = &Sim.Rule[Sim.RuleCount++];
+		}
+		snprintf(rule->Prefix, sizeof(rule->Prefix), "%s", rest);
+		snprintf(rule->Answer, sizeof(rule->Answer), "%s", Sim_Trim(answer));
+	}
+	else if(strcmp(word, "after") == 0)
+	{
+		char * prefix = NULL;
+
+		if(Sim.AfterCount >= SIM_AFTER_COUNT) return false;
+		rest = Sim_Word(rest, &prefix);
+		rest = Sim_Word(rest, &arg);
+		snprintf(Sim.After[Sim.AfterCount].Prefix, sizeof(Sim.After[0].Prefix), "%s", prefix);
+		Sim.After[Sim.AfterCount].Delay_ms = (uint32_t)strtoul(arg, NULL, 10);
+		snprintf(Sim.After[Sim.AfterCount].Line, SIM_LINE_SIZE, "%s", rest);
+		Sim.AfterCount++;
+	}
+	else if(strcmp(word, "urc") == 0)
+	{
+		rest = Sim_Word(rest, &arg);
+		Sim_Emit((uint32_t)strtoul(arg, NULL, 10), rest);
+	}
+	else if(strcmp(word, "raw") == 0)
+	{
+		uint16_t len = 0;
+
+		rest = Sim_Word(rest, &arg);
+		len = Sim_Unescape(rest);
+		Sim_Schedule(Sim_Now_us() + strtoull(arg, NULL, 10) * 1000, rest, len);
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+bool Sim_Load_Script(const char * path)
+{
+	char line[SIM_LINE_SIZE * 2];
+	uint32_t number = 0;
+	bool ok = true;
+	FILE * file = fopen(path, "r");
+
+	if(file == NULL)
+	{
+		fprintf(stderr, "sim: can not open %s\n", path);
+		return false;
+	}
+
+	while(fgets(line, sizeof(line), file) != NULL)
+	{
+		number++;
+		if(Sim_Command(line) == false)
+		{
+			fprintf(stderr, "%s:%lu: bad directive: %s", path, (unsigned long)number, line);
+			ok = false;
+		}
+	}
+
+	fclose(file);
+	return ok;
+}
@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * @file    sim_me3616.h
+  * @brief   Simulated ME3616 and board for the host build.
+  *
+  *          hal_shim.c owns virtual time, the MCU side of UART1 (DMA ring,
+  *          IDLE, half / full transfer, character match) and the IRQs.
+  *          sim_me3616.c is the module: it answers AT commands by rules, plays
+  *          boot Active Reports after reset, and emits scripted lines with
+  *          configurable latency and fragmentation.
+  *
+  *          Script directives, one per line, '#' starts a comment:
+  *            echo on|off                  echo commands back, default on
+  *            baud <bps>                   UART speed, default 115200
+  *            latency <ms>                 command end to response, default 20
+  *            fragment <bytes> <gap_us>    pause gap_us after every bytes sent
+  *            gap <us>                     pause after every line or raw text sent
+  *            boot <delay_ms> <line>       Active Report after reset, delay from
+  *                                         the previous one, first one replaces defaults
+  *            rule <prefix> => <l1> | <l2> | <final>
+  *                                         answer of commands starting with prefix,
+  *                                         longest prefix wins, "AT" is the fallback,
+  *                                         lines before final take raw escapes and \xNN
+  *            after <prefix> <delay_ms> <line>
+  *                                         Active Report delay_ms after the answer
+  *            urc <delay_ms> <line>        Active Report delay_ms from now
+  *            raw <delay_ms> <text>        bytes as they are, \r \n \\ \xNN escaped
+  ******************************************************************************
+  */
+
+#ifndef __SIM_ME3616_H__
+#define __SIM_ME3616_H__
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32l4xx_hal.h"
+
+//Virtual time moved forward by each HAL_GetTick()
+#define SIM_TICK_QUANTUM_US             10
+
+#define SIM_LINE_SIZE                   256
+
+//Board handles, as usart.c of the target defines them
+extern UART_HandleTypeDef huart1;
+extern UART_HandleTypeDef huart2;
+extern DMA_HandleTypeDef hdma_usart1_tx;
+extern DMA_HandleTypeDef hdma_usart1_rx;
+extern DMA_HandleTypeDef hdma_usart2_tx;
+
+typedef struct {
+    uint32_t                BytesToMcu;         //bytes written into the DMA ring
+    uint32_t                BytesFromMcu;       //bytes sent by MCU
+    uint32_t                IdleEvents;
+    uint32_t                HalfEvents;
+    uint32_t                FullEvents;
+    uint32_t                MatchEvents;        //character match
+    uint32_t                Wraps;              //DMA ring wraparounds
+    uint32_t                BytesToDbg;         //bytes sent by MCU on UART2, the debug port
+}Sim_Stats_t;
+
+//Sees every byte from ME3616 as it reaches UART1, before DMA stores it
+typedef void (* Sim_Rx_Hook_t)(uint8_t byte);
+
+//Sees every command line from MCU, without CR LF, as it is answered. Lines it
+//emits go after the answer if delayed beyond latency.
+typedef void (* Sim_Command_Hook_t)(const char * line);
+
+
+//hal_shim.c
+void Sim_Board_Init(void);
+void Sim_Advance(uint32_t us);
+uint64_t Sim_Now_us(void);
+void Sim_Set_Verbose(bool verbose);
+const Sim_Stats_t * Sim_Get_Stats(void);
+void Sim_Set_Rx_Hook(Sim_Rx_Hook_t hook);
+bool Sim_Set_Dbg_Capture(const char * path);
+
+//sim_me3616.c, called by hal_shim.c
+void Sim_Modem_Reset(void);
+void Sim_Modem_Input(const uint8_t * data, uint16_t len);
+void Sim_Modem_Pin(GPIO_TypeDef * port, uint16_t pin, GPIO_PinState state);
+bool Sim_Modem_Poll(uint64_t now, uint8_t * byte, uint64_t * next_due);
+uint32_t Sim_Modem_Char_us(void);
+uint32_t Sim_Modem_Backlog(void);
+//Last command line received, without CR LF
+const char * Sim_Modem_Last_Command(void);
+//Payload of the last AT+ESOSENDRAW
+const uint8_t * Sim_Modem_Last_Raw(uint16_t * len);
+
+//sim_me3616.c, scripting
+bool Sim_Command(const char * directive);
+bool Sim_Load_Script(const char * path);
+void Sim_Emit(uint32_t delay_ms, const char * line);
+//Line of bytes as they are, binary +ESONMI for one
+void Sim_Emit_Bytes(uint32_t delay_ms, const uint8_t * data, uint16_t len);
+//Bytes as they are, no CR LF around, a line longer than SIM_LINE_SIZE in parts
+void Sim_Emit_Raw(uint32_t delay_ms, const uint8_t * data, uint16_t len);
+//Peer behind ME3616, a CoAP server for one, NULL for none
+void Sim_Set_Command_Hook(Sim_Command_Hook_t hook);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SIM_ME3616_H__ */
@@ -0,0 +1,14 @@
+# Decode CAPTURE of a ME3616_DBG_BINARY run by DECODER with ELF, and compare
+# with EXPECTED, the debug log of the plain text build.
+execute_process(COMMAND ${DECODER} ${ELF} ${CAPTURE}
+  OUTPUT_FILE ${CAPTURE}.log
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "dbg_decode failed: ${result}")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${CAPTURE}.log ${EXPECTED}
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${CAPTURE}.log differs from ${EXPECTED}")
+endif()
@@ -0,0 +1,386 @@
+/**
+  ******************************************************************************
+  * @file    dbg_decode.c
+  * @brief   Turns DBG_UART output of a ME3616_DBG_BINARY build back into the
+  *          text a plain build prints.
+  *
+  *          dbg_decode <elf> [capture]
+  *
+  *          elf is the image running on the board (.axf of MDK-ARM, .out of
+  *          EWARM, or me3616_sim of the host build), capture the bytes logged
+  *          from DBG_UART, stdin if not given.
+  *
+  *          Frame: 0xA5, payload length, direction, tick (4, little endian),
+  *          payload. With DBG_LOG_FORMAT in direction the payload is the
+  *          offset of the format string from DBG_Log_FmtBase (4) and the raw
+  *          arguments, see DBG_Log_Encode() of me3616.c; otherwise it is text.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+#define DBG_FRAME_SYNC                  0xA5
+#define DBG_FRAME_HEADER                7
+#define DBG_LOG_FORMAT                  0x80
+#define DBG_FMT_BASE_SYMBOL             "DBG_Log_FmtBase"
+
+//ELF, only what is needed to find a string by its address
+#define ELF_SHT_SYMTAB                  2
+#define ELF_SHT_NOBITS                  8
+#define ELF_SHF_ALLOC                   0x2
+
+static const char * const Dbg_Tag[] = {"[Rx]", "[Tx]", "[MCU_AT]", "[EasyIoT]", "[APP]"};
+
+static uint8_t * Elf_Image = NULL;
+static size_t Elf_Size = 0;
+static bool Elf_64 = false;
+static uint64_t Elf_FmtBase = 0;
+
+static uint64_t Elf_Read(size_t offset, uint8_t size)
+{
+	uint64_t value = 0;
+
+	if(offset + size > Elf_Size) return 0;
+	for(uint8_t i = 0; i < size; i++) value |= (uint64_t)Elf_Image[offset + i] << (8 * i);
+	return value;
+}
+
+typedef struct {
+    uint32_t                Type;
+    uint64_t                Flags;
+    uint64_t                Addr;
+    uint64_t                Offset;
+    uint64_t                Size;
+    uint32_t                Link;
+    uint64_t                EntSize;
+}Elf_Section_t;
+
+static bool Elf_Get_Section(uint16_t index, Elf_Section_t * section)
+{
+	uint64_t shoff = Elf_64 ? Elf_Read(0x28, 8) : Elf_Read(0x20, 4);
+	uint16_t shentsize = (uint16_t)(Elf_64 ? Elf_Read(0x3A, 2) : Elf_Read(0x2E, 2));
+	size_t base = (size_t)(shoff + (uint64_t)index * shentsize);
+
+	if(base + shentsize > Elf_Size) return false;
+	section->Type = (uint32_t)Elf_Read(base + 0x04, 4);
+	if(Elf_64)
+	{
+		section->Flags = Elf_Read(base + 0x08, 8);
+		section->Addr = Elf_Read(base + 0x10, 8);
+		section->Offset = Elf_Read(base + 0x18, 8);
+		section->Size = Elf_Read(base + 0x20, 8);
+		section->Link = (uint32_t)Elf_Read(base + 0x28, 4);
+		section->EntSize = Elf_Read(base + 0x38, 8);
+	}
+	else
+	{
+		section->Flags = Elf_Read(base + 0x08, 4);
+		section->Addr = Elf_Read(base + 0x0C, 4);
+		section->Offset = Elf_Read(base + 0x10, 4);
+		section->Size = Elf_Read(base + 0x14, 4);
+		section->Link = (uint32_t)Elf_Read(base + 0x18, 4);
+		section->EntSize = Elf_Read(base + 0x24, 4);
+	}
+	return true;
+}
+
+static uint16_t Elf_Section_Count(void)
+{
+	return (uint16_t)(Elf_64 ? Elf_Read(0x3C, 2) : Elf_Read(0x30, 2));
+}
+
+/**
+  * @brief  Load the ELF file and find DBG_Log_FmtBase in its symbol table.
+  */
+static bool Elf_Load(const char * path)
+{
+	FILE * file = fopen(path, "rb");
+	Elf_Section_t symtab;
+	Elf_Section_t strtab;
+
+	if(file == NULL)
+	{
+		fprintf(stderr, "dbg_decode: can not open %s\n", path);
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	Elf_Size = (size_t)ftell(file);
+	fseek(file, 0, SEEK_SET);
+	Elf_Image = malloc(Elf_Size);
+	if((Elf_Image == NULL) || (fread(Elf_Image, 1, Elf_Size, file) != Elf_Size))
+	{
+		fclose(file);
+		fprintf(stderr, "dbg_decode: can not read %s\n", path);
+		return false;
+	}
+	fclose(file);
+
+	if((Elf_Size < 0x40) || (memcmp(Elf_Image, "\x7F" "ELF", 4) != 0) || (Elf_Image[5] != 1))
+	{
+		fprintf(stderr, "dbg_decode: %s is not a little endian ELF file\n", path);
+		return false;
+	}
+	Elf_64 = (Elf_Image[4] == 2);
+
+	for(uint16_t i = 0; i < Elf_Section_Count(); i++)
+	{
+		if((Elf_Get_Section(i, &symtab) == false) || (symtab.Type != ELF_SHT_SYMTAB)) continue;
+		if((symtab.EntSize == 0) || (Elf_Get_Section((uint16_t)symtab.Link, &strtab) == false)) continue;
+
+		for(uint64_t sym = 0; sym < symtab.Size / symtab.EntSize; sym++)
+		{
+			size_t base = (size_t)(symtab.Offset + sym * symtab.EntSize);
+			size_t name = (size_t)(strtab.Offset + Elf_Read(base, 4));
+
+			if((name >= Elf_Size) || (strncmp((char *)&Elf_Image[name], DBG_FMT_BASE_SYMBOL, Elf_Size - name) != 0)) continue;
+			Elf_FmtBase = Elf_64 ? Elf_Read(base + 0x08, 8) : Elf_Read(base + 0x04, 4);
+			return true;
+		}
+	}
+
+	fprintf(stderr, "dbg_decode: no symbol " DBG_FMT_BASE_SYMBOL " in %s, not a ME3616_DBG_BINARY build?\n", path);
+	return false;
+}
+
+/**
+  * @brief  The '\0' ended string at addr of the image, NULL if addr is not loaded from the file.
+  */
+static const char * Elf_String(uint64_t addr)
+{
+	Elf_Section_t section;
+
+	for(uint16_t i = 0; i < Elf_Section_Count(); i++)
+	{
+		if(Elf_Get_Section(i, &section) == false) continue;
+		if(((section.Flags & ELF_SHF_ALLOC) == 0) || (section.Type == ELF_SHT_NOBITS)) continue;
+		if((addr < section.Addr) || (addr >= section.Addr + section.Size)) continue;
+
+		size_t offset = (size_t)(section.Offset + addr - section.Addr);
+		if(memchr(&Elf_Image[offset], '\0', Elf_Size - offset) == NULL) return NULL;
+		return (const char *)&Elf_Image[offset];
+	}
+	return NULL;
+}
+
+/**
+  * @brief  Take size bytes of argument, little endian.
+  */
+static bool Arg_Take(const uint8_t ** p, const uint8_t * end, uint8_t size, uint64_t * value)
+{
+	if(*p + size > end) return false;
+
+	*value = 0;
+	for(uint8_t i = 0; i < size; i++) *value |= (uint64_t)(*p)[i] << (8 * i);
+	*p += size;
+	return true;
+}
+
+/**
+  * @brief  printf() fmt with the arguments DBG_Log_Encode() packed, conversion by
+  *         conversion, into out.
+  */
+static void Dbg_Format(const char * fmt, const uint8_t * args, const uint8_t * end, FILE * out)
+{
+	while(*fmt != '\0')
+	{
+		char spec[48];
+		uint8_t n = 0;
+		uint8_t longs = 0;
+		uint64_t value = 0;
+
+		if(*fmt != '%')
+		{
+			fputc(*fmt++, out);
+			continue;
+		}
+		if(fmt[1] == '%')
+		{
+			fputc('%', out);
+			fmt += 2;
+			continue;
+		}
+
+		//Rebuild the conversion with '*' filled in and the length modifiers of host printf()
+		spec[n++] = *fmt++;
+		while((*fmt != '\0') && (strchr("-+ #0", *fmt) != NULL) && (n < 8)) spec[n++] = *fmt++;
+		for(uint8_t i = 0; i < 2; i++)
+		{
+			if(*fmt == '*')
+			{
+				if(Arg_Take(&args, end, 4, &value) == false) goto cut;
+				n += (uint8_t)snprintf(&spec[n], sizeof(spec) - n - 4, "%d", (int32_t)value);
+				fmt++;
+			}
+			while(isdigit((unsigned char)*fmt) && (n < sizeof(spec) - 8)) spec[n++] = *fmt++;
+			if((i == 0) && (*fmt == '.')) spec[n++] = *fmt++;
+			else break;
+		}
+		while((*fmt != '\0') && (strchr("hlLjzt", *fmt) != NULL))
+		{
+			if((*fmt == 'l') || (*fmt == 'j')) longs += (*fmt == 'j') ? 2 : 1;
+			fmt++;
+		}
+		spec[n] = '\0';
+
+		switch(*fmt)
+		{
+			case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+			{
+				uint8_t size = (longs >= 2) ? 8 : 4;
+				long long number = 0;
+
+				if(Arg_Take(&args, end, size, &value) == false) goto cut;
+				if(size == 8) number = (long long)value;
+				else if((*fmt == 'd') || (*fmt == 'i')) number = (int32_t)value;
+				else number = (uint32_t)value;
+
+				if(*fmt == 'c')
+				{
+					strcat(spec, "c");
+					fprintf(out, spec, (int)number);
+				}
+				else
+				{
+					spec[n] = 'l';
+					spec[n + 1] = 'l';
+					spec[n + 2] = *fmt;
+					spec[n + 3] = '\0';
+					fprintf(out, spec, number);
+				}
+				break;
+			}
+			case 'p':
+			{
+				if(Arg_Take(&args, end, 4, &value) == false) goto cut;
+				strcat(spec, "x");
+				fputs("0x", out);
+				fprintf(out, spec, (unsigned)value);
+				break;
+			}
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+			{
+				double number = 0;
+
+				if(Arg_Take(&args, end, 8, &value) == false) goto cut;
+				memcpy(&number, &value, sizeof(number));
+				spec[n] = *fmt;
+				spec[n + 1] = '\0';
+				fprintf(out, spec, number);
+				break;
+			}
+			case 's':
+			{
+				const uint8_t * text = args;
+
+				while((args < end) && (*args != '\0')) args++;
+				if(args == end) goto cut;
+				args++;
+				strcat(spec, "s");
+				fprintf(out, spec, (const char *)text);
+				break;
+			}
+			case '\0':
+			{
+				return;
+			}
+			default:
+			{
+				fputs(spec, out);
+				fputc(*fmt, out);
+				break;
+			}
+		}
+		fmt++;
+	}
+	return;
+
+cut:
+	//DBG_Log_Encode() ran out of room, as vsnprintf() would the text is cut here
+	return;
+}
+
+/**
+  * @brief  One frame, printed as DBG_Log_Format() of a plain text build does.
+  * @retval false if the format string is not in the image.
+  */
+static bool Dbg_Frame(uint8_t direction, uint32_t tick, const uint8_t * payload, uint8_t len, FILE * out)
+{
+	uint8_t dir = direction & (uint8_t)~DBG_LOG_FORMAT;
+
+	if(dir > 4) dir = 4;
+	fprintf(out, "%s[%lu]%s: ", (dir == 1) ? "\r\n" : "", (unsigned long)tick, Dbg_Tag[dir]);
+
+	if(direction & DBG_LOG_FORMAT)
+	{
+		uint64_t id = 0;
+		const uint8_t * args = payload;
+		const char * fmt = NULL;
+
+		if(Arg_Take(&args, payload + len, 4, &id) == false) return false;
+		fmt = Elf_String(Elf_FmtBase + (int64_t)(int32_t)id);
+		if(fmt == NULL)
+		{
+			fprintf(out, "<format %+d not found>\r\n", (int32_t)id);
+			return false;
+		}
+		Dbg_Format(fmt, args, payload + len, out);
+	}
+	else
+	{
+		fwrite(payload, 1, len, out);
+	}
+	fputs("\r\n", out);
+	return true;
+}
+
+int main(int argc, char ** argv)
+{
+	FILE * in = stdin;
+	uint8_t frame[DBG_FRAME_HEADER + 0xFF];
+	uint32_t frames = 0;
+	uint32_t skipped = 0;
+	uint32_t unknown = 0;
+	int c = 0;
+
+	if((argc < 2) || (argc > 3))
+	{
+		fprintf(stderr, "usage: dbg_decode <elf> [capture]\n");
+		return 2;
+	}
+	if(Elf_Load(argv[1]) == false) return 2;
+	if(argc == 3)
+	{
+		in = fopen(argv[2], "rb");
+		if(in == NULL)
+		{
+			fprintf(stderr, "dbg_decode: can not open %s\n", argv[2]);
+			return 2;
+		}
+	}
+
+	while((c = fgetc(in)) != EOF)
+	{
+		if(c != DBG_FRAME_SYNC)
+		{
+			skipped++;
+			continue;
+		}
+		frame[0] = (uint8_t)c;
+		if(fread(&frame[1], 1, DBG_FRAME_HEADER - 1, in) != DBG_FRAME_HEADER - 1) break;
+		if(fread(&frame[DBG_FRAME_HEADER], 1, frame[1], in) != frame[1]) break;
+
+		if(Dbg_Frame(frame[2], (uint32_t)frame[3] | ((uint32_t)frame[4] << 8) | ((uint32_t)frame[5] << 16) | ((uint32_t)frame[6] << 24),
+		             &frame[DBG_FRAME_HEADER], frame[1], stdout) == false) unknown++;
+		frames++;
+	}
+	if(in != stdin) fclose(in);
+
+	fprintf(stderr, "dbg_decode: %lu frames, %lu bytes out of frame, %lu formats not found\n",
+	        (unsigned long)frames, (unsigned long)skipped, (unsigned long)unknown);
+	return ((skipped != 0) || (unknown != 0)) ? 1 : 0;
+}
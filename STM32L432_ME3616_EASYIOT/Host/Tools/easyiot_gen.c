@@ -0,0 +1,625 @@
+/**
+  ******************************************************************************
+  * @file    easyiot_gen.c
+  * @brief   Turns an EasyIoT product header, as exported by the product
+  *          center (Drivers/EASYIOT/inc/TestDevice.h), into static inline
+  *          encoders and decoders with every offset fixed at generation.
+  *
+  *          easyiot_gen [-o out.h] <product.h> <name>=<sensor>,... ...
+  *
+  *          The header gives the sensors (<X>_TLV_PARAMID and the C type of
+  *          <name>_v in the commented struct), the messages (<X>_MSGID) and
+  *          the commands (<X>_CMDID), but not which sensors a message
+  *          carries. That is given on the command line, by the name of the
+  *          message or command and the names of its sensors:
+  *            msg_1=Sensor_1,Sensor_2,Led_Green
+  *            CMD_1=Led_Green:result,Led_Green
+  *          a command lists its request sensors, then after ':' its response.
+  *
+  *          Generated, names in lower case:
+  *            message <m>   <m>_encode(buf, max, dtag, values...), <M>_LENGTH
+  *            command <c>   struct <c>_request, <c>_decode(reader, request)
+  *                          <c>_respond(buf, max, mid, values...), <C>_RSP_LENGTH
+  *          Encoders return the packet length, ready for CoapOutput(), or -1.
+  *          The checksum of the TLV headers and length fields is summed here,
+  *          only the value bytes are summed at run time.
+  *          Only fixed size sensors are supported, strings still go through
+  *          PutString().
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+#define GEN_NAME_SIZE                   64
+#define GEN_MAX_SENSORS                 64
+#define GEN_MAX_MESSAGES                32
+#define GEN_MAX_FIELDS                  32
+
+//Must match easyiot.h, the generated header checks it again
+#define GEN_UP_HEADER_SIZE              49
+#define GEN_RSP_HEADER_SIZE             6
+#define GEN_CMD_REQ_BODY                9
+
+typedef struct {
+    const char *            CType;
+    uint8_t                 Size;
+    bool                    Float;
+    const char *            Read;
+}Gen_Type_t;
+
+static const Gen_Type_t Gen_Types[] =
+{
+	{"int8_t",  1, false, "ReadInt8"},
+	{"int16_t", 2, false, "ReadInt16"},
+	{"int32_t", 4, false, "ReadInt32"},
+	{"int64_t", 8, false, "ReadLong64"},
+	{"float",   4, true,  "ReadFloat"},
+	{"double",  8, true,  "ReadDouble"},
+};
+
+typedef struct {
+    char                    Name[GEN_NAME_SIZE];
+    char                    Macro[GEN_NAME_SIZE];
+    uint8_t                 Id;
+    const Gen_Type_t *      Type;
+}Gen_Sensor_t;
+
+typedef struct {
+    char                    Name[GEN_NAME_SIZE];
+    char                    Macro[GEN_NAME_SIZE];
+    uint8_t                 Id;
+    bool                    Command;
+    //Message: the uplink. Command: the request, then the response
+    const Gen_Sensor_t *    Fields[2][GEN_MAX_FIELDS];
+    uint8_t                 Count[2];
+    bool                    Used;
+}Gen_Message_t;
+
+static Gen_Sensor_t Gen_Sensors[GEN_MAX_SENSORS];
+static uint16_t Gen_Sensor_Count = 0;
+static Gen_Message_t Gen_Messages[GEN_MAX_MESSAGES];
+static uint16_t Gen_Message_Count = 0;
+static char Gen_Product[GEN_NAME_SIZE];
+static char Gen_Prefix[GEN_NAME_SIZE];
+static char Gen_Guard[GEN_NAME_SIZE];
+
+/* Product header ------------------------------------------------------------*/
+static void Gen_Lower(char * dest, const char * src)
+{
+	size_t i = 0;
+
+	for(; src[i] != '\0' && i + 1 < GEN_NAME_SIZE; i++) dest[i] = (char)tolower((unsigned char)src[i]);
+	dest[i] = '\0';
+}
+
+static const char * Gen_Upper(const char * src)
+{
+	static char upper[GEN_NAME_SIZE];
+	size_t i = 0;
+
+	for(; src[i] != '\0' && i + 1 < GEN_NAME_SIZE; i++) upper[i] = (char)toupper((unsigned char)src[i]);
+	upper[i] = '\0';
+	return upper;
+}
+
+/**
+  * @brief  "#define <macro> <n>" with macro ending in suffix.
+  */
+static bool Gen_Define(const char * line, const char * suffix, char * macro, uint8_t * id)
+{
+	char name[GEN_NAME_SIZE];
+	unsigned value = 0;
+	size_t len = 0;
+
+	if(sscanf(line, " #define %63s %u", name, &value) != 2) return false;
+	len = strlen(name);
+	if(len <= strlen(suffix) || strcmp(name + len - strlen(suffix), suffix) != 0) return false;
+	if(value > 0xFF) return false;
+	strcpy(macro, name);
+	*id = (uint8_t)value;
+	return true;
+}
+
+/**
+  * @brief  "//  <ctype> <name>_v;" of a commented sensor struct.
+  */
+static bool Gen_Value_Field(const char * line, char * ctype, char * name)
+{
+	char field[GEN_NAME_SIZE];
+	size_t len = 0;
+
+	if(sscanf(line, " // %63s %63[A-Za-z0-9_];", ctype, field) != 2) return false;
+	len = strlen(field);
+	if(len < 3 || strcmp(field + len - 2, "_v") != 0) return false;
+	memcpy(name, field, len - 2);
+	name[len - 2] = '\0';
+	return true;
+}
+
+/**
+  * @brief  "//} <name><suffix>;" closing a commented message or command struct.
+  */
+static bool Gen_Struct_Name(const char * line, const char * suffix, char * name)
+{
+	char word[GEN_NAME_SIZE];
+	size_t len = 0;
+
+	if(sscanf(line, " //} %63[A-Za-z0-9_];", word) != 1) return false;
+	len = strlen(word);
+	if(len <= strlen(suffix) || strcmp(word + len - strlen(suffix), suffix) != 0) return false;
+	memcpy(name, word, len - strlen(suffix));
+	name[len - strlen(suffix)] = '\0';
+	return true;
+}
+
+static bool Gen_Load(const char * path)
+{
+	FILE * in = fopen(path, "r");
+	char line[512];
+	Gen_Sensor_t * sensor = NULL;
+	Gen_Message_t * message = NULL;
+
+	if(in == NULL)
+	{
+		fprintf(stderr, "easyiot_gen: cannot open %s\n", path);
+		return false;
+	}
+
+	while(fgets(line, sizeof(line), in) != NULL)
+	{
+		char macro[GEN_NAME_SIZE];
+		char ctype[GEN_NAME_SIZE];
+		char name[GEN_NAME_SIZE];
+		uint8_t id = 0;
+
+		if(Gen_Define(line, "_TLV_PARAMID", macro, &id) == true)
+		{
+			if(Gen_Sensor_Count >= GEN_MAX_SENSORS) break;
+			sensor = &Gen_Sensors[Gen_Sensor_Count++];
+			strcpy(sensor->Macro, macro);
+			sensor->Id = id;
+			message = NULL;
+		}
+		else if((Gen_Define(line, "_MSGID", macro, &id) == true) || (Gen_Define(line, "_CMDID", macro, &id) == true))
+		{
+			if(Gen_Message_Count >= GEN_MAX_MESSAGES) break;
+			message = &Gen_Messages[Gen_Message_Count++];
+			strcpy(message->Macro, macro);
+			message->Id = id;
+			message->Command = strstr(macro, "_CMDID") != NULL;
+			sensor = NULL;
+		}
+		else if((sensor != NULL) && (sensor->Name[0] == '\0') && (Gen_Value_Field(line, ctype, name) == true))
+		{
+			strcpy(sensor->Name, name);
+			for(size_t i = 0; i < sizeof(Gen_Types) / sizeof(Gen_Types[0]); i++)
+			{
+				if(strcmp(ctype, Gen_Types[i].CType) == 0) sensor->Type = &Gen_Types[i];
+			}
+		}
+		else if((message != NULL) && (message->Name[0] == '\0') &&
+		        (Gen_Struct_Name(line, message->Command ? "_Command" : "_Message", name) == true))
+		{
+			strcpy(message->Name, name);
+		}
+	}
+	fclose(in);
+
+	for(uint16_t i = 0; i < Gen_Sensor_Count; i++)
+	{
+		if(Gen_Sensors[i].Name[0] == '\0')
+		{
+			fprintf(stderr, "easyiot_gen: %s has no value field\n", Gen_Sensors[i].Macro);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Command line --------------------------------------------------------------*/
+static const Gen_Sensor_t * Gen_Find_Sensor(const char * name)
+{
+	for(uint16_t i = 0; i < Gen_Sensor_Count; i++)
+	{
+		if(strcmp(Gen_Sensors[i].Name, name) == 0) return &Gen_Sensors[i];
+	}
+	return NULL;
+}
+
+static bool Gen_Fields(Gen_Message_t * message, uint8_t part, char * list)
+{
+	char * save = NULL;
+
+	for(char * name = strtok_r(list, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save))
+	{
+		const Gen_Sensor_t * sensor = Gen_Find_Sensor(name);
+
+		if(sensor == NULL)
+		{
+			fprintf(stderr, "easyiot_gen: no sensor %s\n", name);
+			return false;
+		}
+		if(sensor->Type == NULL)
+		{
+			fprintf(stderr, "easyiot_gen: sensor %s is not fixed size, use PutString()\n", name);
+			return false;
+		}
+		if(message->Count[part] >= GEN_MAX_FIELDS) return false;
+		message->Fields[part][message->Count[part]++] = sensor;
+	}
+	return true;
+}
+
+static bool Gen_Spec(char * spec)
+{
+	char * fields = strchr(spec, '=');
+	char * response = NULL;
+
+	if(fields == NULL)
+	{
+		fprintf(stderr, "easyiot_gen: %s is not <name>=<sensor>,...\n", spec);
+		return false;
+	}
+	*fields++ = '\0';
+
+	for(uint16_t i = 0; i < Gen_Message_Count; i++)
+	{
+		Gen_Message_t * message = &Gen_Messages[i];
+
+		if(strcmp(message->Name, spec) != 0) continue;
+		response = strchr(fields, ':');
+		if(response != NULL) *response++ = '\0';
+		if((message->Command == false) && (response != NULL))
+		{
+			fprintf(stderr, "easyiot_gen: message %s has no response\n", spec);
+			return false;
+		}
+		message->Used = true;
+		if(Gen_Fields(message, 0, fields) == false) return false;
+		return (response == NULL) || (Gen_Fields(message, 1, response) == true);
+	}
+	fprintf(stderr, "easyiot_gen: no message or command %s\n", spec);
+	return false;
+}
+
+/* Output --------------------------------------------------------------------*/
+static uint16_t Gen_Body_Length(const Gen_Message_t * message, uint8_t part)
+{
+	uint16_t length = 0;
+
+	for(uint8_t i = 0; i < message->Count[part]; i++) length += 3 + message->Fields[part][i]->Type->Size;
+	return length;
+}
+
+static void Gen_Param_List(FILE * out, const Gen_Message_t * message, uint8_t part)
+{
+	for(uint8_t i = 0; i < message->Count[part]; i++)
+	{
+		char name[GEN_NAME_SIZE];
+
+		Gen_Lower(name, message->Fields[part][i]->Name);
+		fprintf(out, ", %s %s", message->Fields[part][i]->Type->CType, name);
+	}
+}
+
+/**
+  * @brief  The whole encoder: BeginMessage() for the header and what it reads
+  *         from the callbacks, then straight stores at fixed offsets.
+  */
+static void Gen_Encoder(FILE * out, const Gen_Message_t * message, uint8_t part, const char * function,
+                        const char * length_macro, const char * type, uint16_t header)
+{
+	uint16_t body = Gen_Body_Length(message, part);
+	uint16_t length = header + 3 + body + 1;
+	uint16_t offset = header + 3;
+	uint32_t sum = 0;
+	bool u16 = false, u32 = false, u64 = false;
+
+	//Length fields and TLV headers are known now, BeginMessage() wrote them as 0
+	sum += ((length - 4) >> 8) + ((length - 4) & 0xFF) + (body >> 8) + (body & 0xFF);
+	for(uint8_t i = 0; i < message->Count[part]; i++)
+	{
+		const Gen_Type_t * t = message->Fields[part][i]->Type;
+
+		sum += message->Fields[part][i]->Id + t->Size;
+		u16 |= (t->Size == 2);
+		u32 |= (t->Size == 4);
+		u64 |= (t->Size == 8);
+	}
+
+	fprintf(out, "#define %s %u\n\n", length_macro, length);
+	fprintf(out, "static inline int %s(uint8_t* buf, uint16_t inMaxLength, uint16_t dtag_mid", function);
+	Gen_Param_List(out, message, part);
+	fprintf(out, ")\n{\n");
+	fprintf(out, "\tstruct MessageWriter w;\n");
+	fprintf(out, "\tuint32_t sum;\n");
+	if(u16) fprintf(out, "\tuint16_t u16;\n");
+	if(u32) fprintf(out, "\tuint32_t u32;\n");
+	if(u64) fprintf(out, "\tuint64_t u64;\n");
+	fprintf(out, "\n");
+	fprintf(out, "\tif (inMaxLength < %s) {\n\t\treturn -1;\n\t}\n", length_macro);
+	fprintf(out, "\tif (BeginMessage(&w, buf, inMaxLength, %s, %s, dtag_mid) < 0) {\n\t\treturn -1;\n\t}\n", type, message->Macro);
+	fprintf(out, "\tsum = w.sum + 0x%Xu;\n", sum);
+	fprintf(out, "\tnb_store_be16(buf + 2, %u);\n", length - 4);
+	fprintf(out, "\tnb_store_be16(buf + %u, %u);\n", header + 1, body);
+
+	for(uint8_t i = 0; i < message->Count[part]; i++)
+	{
+		const Gen_Sensor_t * sensor = message->Fields[part][i];
+		const Gen_Type_t * t = sensor->Type;
+		uint16_t value = offset + 3;
+		char name[GEN_NAME_SIZE];
+
+		Gen_Lower(name, sensor->Name);
+		fprintf(out, "\n\tbuf[%u] = %s;\n", offset, sensor->Macro);
+		fprintf(out, "\tbuf[%u] = 0;\n", offset + 1);
+		fprintf(out, "\tbuf[%u] = %u;\n", offset + 2, t->Size);
+		switch(t->Size)
+		{
+			case 1:
+				fprintf(out, "\tbuf[%u] = (uint8_t)%s;\n", value, name);
+				fprintf(out, "\tsum += buf[%u];\n", value);
+				break;
+			case 2:
+				fprintf(out, "\tu16 = (uint16_t)%s;\n", name);
+				fprintf(out, "\tnb_store_be16(buf + %u, u16);\n", value);
+				fprintf(out, "\tsum += (u16 & 0xFF) + (u16 >> 8);\n");
+				break;
+			case 4:
+				if(t->Float) fprintf(out, "\tmemcpy(&u32, &%s, sizeof(u32));\n", name);
+				else fprintf(out, "\tu32 = (uint32_t)%s;\n", name);
+				fprintf(out, "\tnb_store_be32(buf + %u, u32);\n", value);
+				fprintf(out, "\tsum += %s_sum32(u32);\n", Gen_Prefix);
+				break;
+			default:
+				if(t->Float) fprintf(out, "\tmemcpy(&u64, &%s, sizeof(u64));\n", name);
+				else fprintf(out, "\tu64 = (uint64_t)%s;\n", name);
+				fprintf(out, "\tnb_store_be64(buf + %u, u64);\n", value);
+				fprintf(out, "\tsum += %s_sum32((uint32_t)u64) + %s_sum32((uint32_t)(u64 >> 32));\n", Gen_Prefix, Gen_Prefix);
+				break;
+		}
+		offset = value + t->Size;
+	}
+
+	fprintf(out, "\n\tbuf[%u] = (uint8_t)sum;\n", offset);
+	fprintf(out, "\tif (%s < inMaxLength) {\n\t\tbuf[%s] = '\\0';\n\t}\n", length_macro, length_macro);
+	fprintf(out, "\treturn %s;\n}\n\n", length_macro);
+}
+
+/**
+  * @brief  Request decoder: the layout the platform sends is checked once and
+  *         read at fixed offsets, anything else goes through Read*().
+  */
+static void Gen_Decoder(FILE * out, const Gen_Message_t * message, const char * lower)
+{
+	uint16_t body = Gen_Body_Length(message, 0);
+	uint16_t offset = 0;
+	bool u32 = false, u64 = false;
+
+	for(uint8_t i = 0; i < message->Count[0]; i++)
+	{
+		u32 |= message->Fields[0][i]->Type->Float && (message->Fields[0][i]->Type->Size == 4);
+		u64 |= message->Fields[0][i]->Type->Float && (message->Fields[0][i]->Type->Size == 8);
+	}
+
+	fprintf(out, "struct %s_request {\n", lower);
+	for(uint8_t i = 0; i < message->Count[0]; i++)
+	{
+		char name[GEN_NAME_SIZE];
+
+		Gen_Lower(name, message->Fields[0][i]->Name);
+		fprintf(out, "\t%s %s;\n", message->Fields[0][i]->Type->CType, name);
+	}
+	if(message->Count[0] == 0) fprintf(out, "\tuint8_t unused;\n");
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "static inline int %s_decode(const struct MessageReader* r, struct %s_request* request)\n{\n", lower, lower);
+	fprintf(out, "\tconst uint8_t* p = r->buf + r->body;\n");
+	if(u32) fprintf(out, "\tuint32_t u32;\n");
+	if(u64) fprintf(out, "\tuint64_t u64;\n");
+	fprintf(out, "\n");
+	fprintf(out, "\tif (r->msgType != CMT_USER_CMD_REQ || r->msgid != %s) {\n\t\treturn -1;\n\t}\n\n", message->Macro);
+
+	fprintf(out, "\tif (r->body == %u && r->end - r->body == %u", GEN_CMD_REQ_BODY, body);
+	for(uint8_t i = 0; i < message->Count[0]; i++)
+	{
+		const Gen_Sensor_t * sensor = message->Fields[0][i];
+
+		fprintf(out, "\n\t\t&& p[%u] == %s && p[%u] == 0 && p[%u] == %u", offset, sensor->Macro, offset + 1, offset + 2,
+		        sensor->Type->Size);
+		offset += 3 + sensor->Type->Size;
+	}
+	fprintf(out, ") {\n");
+
+	offset = 0;
+	for(uint8_t i = 0; i < message->Count[0]; i++)
+	{
+		const Gen_Sensor_t * sensor = message->Fields[0][i];
+		const Gen_Type_t * t = sensor->Type;
+		uint16_t value = offset + 3;
+		char name[GEN_NAME_SIZE];
+
+		Gen_Lower(name, sensor->Name);
+		switch(t->Size)
+		{
+			case 1:
+				fprintf(out, "\t\trequest->%s = (int8_t)p[%u];\n", name, value);
+				break;
+			case 2:
+				fprintf(out, "\t\trequest->%s = (int16_t)nb_load_be16(p + %u);\n", name, value);
+				break;
+			case 4:
+				if(t->Float)
+				{
+					fprintf(out, "\t\tu32 = nb_load_be32(p + %u);\n", value);
+					fprintf(out, "\t\tmemcpy(&request->%s, &u32, sizeof(u32));\n", name);
+				}
+				else fprintf(out, "\t\trequest->%s = (int32_t)nb_load_be32(p + %u);\n", name, value);
+				break;
+			default:
+				if(t->Float)
+				{
+					fprintf(out, "\t\tu64 = nb_load_be64(p + %u);\n", value);
+					fprintf(out, "\t\tmemcpy(&request->%s, &u64, sizeof(u64));\n", name);
+				}
+				else fprintf(out, "\t\trequest->%s = (int64_t)nb_load_be64(p + %u);\n", name, value);
+				break;
+		}
+		offset = value + t->Size;
+	}
+	fprintf(out, "\t\treturn 0;\n\t}\n\n");
+
+	fprintf(out, "\t// Other order or more TLVs\n");
+	for(uint8_t i = 0; i < message->Count[0]; i++)
+	{
+		const Gen_Sensor_t * sensor = message->Fields[0][i];
+		char name[GEN_NAME_SIZE];
+
+		Gen_Lower(name, sensor->Name);
+		fprintf(out, "\tif (%s(r, %s, &request->%s) < 0) {\n\t\treturn -1;\n\t}\n", sensor->Type->Read, sensor->Macro, name);
+	}
+	fprintf(out, "\treturn 0;\n}\n\n");
+}
+
+static bool Gen_Write(FILE * out, const char * source)
+{
+	bool any = false;
+
+	fprintf(out, "/*\n");
+	fprintf(out, " * Generated from %s by Host/Tools/easyiot_gen, do not edit, regenerate\n * when the product definition changes:\n", Gen_Product);
+	fprintf(out, " * %s\n", source);
+	fprintf(out, " */\n\n");
+	fprintf(out, "#ifndef _GUARD_H_%s_codec\n#define _GUARD_H_%s_codec\n\n", Gen_Guard, Gen_Guard);
+	fprintf(out, "#include <stdint.h>\n#include <string.h>\n\n");
+	fprintf(out, "#include \"easyiot.h\"\n#include \"easyiot_endian.h\"\n#include \"%s\"\n\n", Gen_Product);
+
+	fprintf(out, "// Offsets and checksum were computed with these\n");
+	fprintf(out, "#if EASYIOT_UP_HEADER_SIZE != %u || EASYIOT_RSP_HEADER_SIZE != %u\n", GEN_UP_HEADER_SIZE, GEN_RSP_HEADER_SIZE);
+	fprintf(out, "#error \"EasyIoT header size changed, regenerate\"\n#endif\n");
+	for(uint16_t i = 0; i < Gen_Message_Count; i++)
+	{
+		if(Gen_Messages[i].Used == false) continue;
+		fprintf(out, "#if %s != %u\n#error \"%s changed, regenerate\"\n#endif\n", Gen_Messages[i].Macro, Gen_Messages[i].Id, Gen_Messages[i].Macro);
+	}
+	for(uint16_t i = 0; i < Gen_Sensor_Count; i++)
+	{
+		bool used = false;
+
+		for(uint16_t m = 0; m < Gen_Message_Count; m++)
+		{
+			for(uint8_t part = 0; part < 2; part++)
+			{
+				for(uint8_t f = 0; f < Gen_Messages[m].Count[part]; f++) used |= (Gen_Messages[m].Fields[part][f] == &Gen_Sensors[i]);
+			}
+		}
+		if(used == false) continue;
+		fprintf(out, "#if %s != %u\n#error \"%s changed, regenerate\"\n#endif\n", Gen_Sensors[i].Macro, Gen_Sensors[i].Id, Gen_Sensors[i].Macro);
+	}
+	fprintf(out, "\n");
+
+	fprintf(out, "// Sum of the 4 bytes, for the checksum\n");
+	fprintf(out, "static inline uint32_t %s_sum32(uint32_t v)\n{\n", Gen_Prefix);
+	fprintf(out, "\tv = (v & 0x00FF00FFu) + ((v >> 8) & 0x00FF00FFu);\n");
+	fprintf(out, "\treturn (v & 0xFFFFu) + (v >> 16);\n}\n\n");
+
+	for(uint16_t i = 0; i < Gen_Message_Count; i++)
+	{
+		const Gen_Message_t * message = &Gen_Messages[i];
+		char lower[GEN_NAME_SIZE];
+		char function[GEN_NAME_SIZE + 16];
+		char macro[GEN_NAME_SIZE + 16];
+
+		if(message->Used == false) continue;
+		any = true;
+		Gen_Lower(lower, message->Name);
+		if(message->Command == false)
+		{
+			fprintf(out, "// Message %s, uplink\n", message->Name);
+			snprintf(function, sizeof(function), "%s_encode", lower);
+			snprintf(macro, sizeof(macro), "%s_LENGTH", Gen_Upper(message->Name));
+			Gen_Encoder(out, message, 0, function, macro, "CMT_USER_UP", GEN_UP_HEADER_SIZE);
+		}
+		else
+		{
+			fprintf(out, "// Command %s, request\n", message->Name);
+			Gen_Decoder(out, message, lower);
+			fprintf(out, "// Command %s, response\n", message->Name);
+			snprintf(function, sizeof(function), "%s_respond", lower);
+			snprintf(macro, sizeof(macro), "%s_RSP_LENGTH", Gen_Upper(message->Name));
+			Gen_Encoder(out, message, 1, function, macro, "CMT_USER_CMD_RSP", GEN_RSP_HEADER_SIZE);
+		}
+	}
+	fprintf(out, "#endif\n");
+
+	if(any == false) fprintf(stderr, "easyiot_gen: nothing to generate\n");
+	return any;
+}
+
+int main(int argc, char ** argv)
+{
+	const char * output = NULL;
+	const char * product = NULL;
+	char source[1024] = "easyiot_gen";
+	const char * base = NULL;
+	FILE * out = stdout;
+	bool ok = true;
+	int first = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if((strcmp(argv[i], "-o") == 0) && (i + 1 < argc))
+		{
+			output = argv[++i];
+		}
+		else
+		{
+			product = argv[i];
+			first = i + 1;
+			break;
+		}
+	}
+	if((product == NULL) || (first >= argc))
+	{
+		fprintf(stderr, "usage: easyiot_gen [-o out.h] <product.h> <name>=<sensor>,...[:<sensor>,...] ...\n");
+		return 2;
+	}
+
+	base = strrchr(product, '/');
+	base = (base != NULL) ? base + 1 : product;
+	snprintf(Gen_Product, sizeof(Gen_Product), "%s", base);
+	snprintf(source, sizeof(source), "easyiot_gen %s", Gen_Product);
+	snprintf(Gen_Guard, sizeof(Gen_Guard), "%s", Gen_Product);
+	for(char * c = Gen_Guard; *c != '\0'; c++)
+	{
+		if(*c == '.') *c = '\0';
+	}
+	Gen_Lower(Gen_Prefix, Gen_Guard);
+	if(Gen_Load(product) == false) return 1;
+
+	for(int i = first; i < argc; i++)
+	{
+		//Recorded in the header as given, so it can be generated again the same way
+		strncat(source, " ", sizeof(source) - strlen(source) - 1);
+		strncat(source, argv[i], sizeof(source) - strlen(source) - 1);
+		if(Gen_Spec(argv[i]) == false) ok = false;
+	}
+	if(ok == false) return 1;
+
+	if(output != NULL)
+	{
+		out = fopen(output, "w");
+		if(out == NULL)
+		{
+			fprintf(stderr, "easyiot_gen: cannot write %s\n", output);
+			return 1;
+		}
+	}
+	ok = Gen_Write(out, source);
+	if(out != stdout) fclose(out);
+	return ok ? 0 : 1;
+}
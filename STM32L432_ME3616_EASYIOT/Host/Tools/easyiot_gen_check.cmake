@@ -0,0 +1,17 @@
+# Generate from PRODUCT again with the command line recorded in EXPECTED and
+# compare, so the committed codec header follows the product definition.
+file(STRINGS ${EXPECTED} recorded REGEX "^ \\* easyiot_gen ")
+string(REGEX REPLACE "^ \\* easyiot_gen [^ ]+ " "" specs "${recorded}")
+separate_arguments(specs)
+execute_process(COMMAND ${GENERATOR} -o ${OUTPUT} ${PRODUCT} ${specs}
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "easyiot_gen failed: ${result}")
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${OUTPUT} ${EXPECTED}
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  string(REPLACE ";" " " specs "${specs}")
+  message(FATAL_ERROR "${EXPECTED} is stale, generate it again: ${GENERATOR} -o ${EXPECTED} ${PRODUCT} ${specs}")
+endif()
@@ -0,0 +1,1230 @@
+/**
+  ******************************************************************************
+  * @file    me3616_sim.c
+  * @brief   Runs the ME3616 driver against the simulated module, no board needed.
+  *
+  *          me3616_sim [-n count] [-d capture] [script ...]
+  *
+  *          Boots by ME3616_Init(), sends count blocking AT+CESQ, runs a batch,
+  *          registers to the LWM2M platform, takes a downlink Active Report,
+  *          sends an EasyIoT uplink by AT+M2MCLISEND and takes an EasyIoT
+  *          command, decoded in place in RxBuffer. Then runs a UDP socket
+  *          through push, hold and AT+ESOREAD, raw bytes unless built with
+  *          ME3616_SOCKET_HEX, an MQTT client through a lost connection, a
+  *          CoAP client against a server behind the module, and an HTTP client
+  *          streaming content far longer than RxBuffer.
+  *          Latency is reported in virtual time, which is what the target sees,
+  *          and in host CPU time, which is what the driver costs.
+  *          Set ME3616_SIM_VERBOSE to see the debug UART, -d writes it into a
+  *          file, for Tools/dbg_decode when built with ME3616_DBG_BINARY.
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "me3616.h"
+#include "me3616_socket.h"
+#include "me3616_mqtt.h"
+#include "me3616_coap.h"
+#include "me3616_http.h"
+#include "me3616_hex.h"
+#include "easyiot.h"
+#include "sim_me3616.h"
+
+static uint32_t Sim_Recv_Count = 0;
+static bool Sim_Failed = false;
+
+/**
+  * @brief  Driver errors halt on target, fail the run here.
+  */
+void ME3616_ErrorHandler(char *file, int line, char * pch)
+{
+	fprintf(stderr, "%s:%d: %s\n", file, line, pch);
+	exit(2);
+}
+
+static void Sim_SDK_Log(enum LoggingLevel level, const char * fmt, va_list args)
+{
+	UNUSED(level);
+	DBG_Vprintf(DBG_DIR_SDK, fmt, args);
+}
+
+static void Sim_Check(bool condition, const char * what)
+{
+	printf("  %-40s %s\n", what, condition ? "ok" : "FAILED");
+	if(condition == false) Sim_Failed = true;
+}
+
+static uint64_t Host_Now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void Sim_M2MCLIRECV(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	UNUSED(Me3616);
+	UNUSED(len);
+	if(strncmp(pch, "+M2MCLIRECV:", 12) == 0) Sim_Recv_Count++;
+}
+
+static void Sim_Boot_Report(Me3616_DeviceType * Me3616)
+{
+	static const char * const stage_name[] =
+	{
+		"POWER", "RESET", "MATREADY", "CPIN", "CFUN", "IP", "IPV6", "AT"
+	};
+	uint32_t total = 0;
+
+	printf("Boot stages, virtual ms:\n");
+	for(uint8_t i = 0; i < BOOT_STAGE_DONE; i++)
+	{
+		printf("  %-10s %6lu\n", stage_name[i], (unsigned long)Me3616->Boot_StageTime[i]);
+		total += Me3616->Boot_StageTime[i];
+	}
+	printf("  %-10s %6lu\n", "total", (unsigned long)total);
+}
+
+/**
+  * @brief  EasyIoT output, as SendtoModule() of Me3616_app.c. The packet is kept
+  *         to check the command line against.
+  */
+static uint8_t Sim_Uplink_Packet[128];
+static uint16_t Sim_Uplink_Len = 0;
+static bool Sim_Uplink_Sent = false;
+
+static void Sim_Uplink_Out(const uint8_t * buf, uint16_t length)
+{
+	Sim_Uplink_Len = (length < sizeof(Sim_Uplink_Packet)) ? length : sizeof(Sim_Uplink_Packet);
+	memcpy(Sim_Uplink_Packet, buf, Sim_Uplink_Len);
+	Sim_Uplink_Sent = ME3616_Send_AT_Hex(&ME3616_Instance, AT_CMD_LWM_M2MCLISEND, buf, length);
+}
+
+static void Sim_Uplink(Me3616_DeviceType * Me3616)
+{
+	static uint8_t buf[128];
+	char expected[sizeof("AT+M2MCLISEND=") + 2 * sizeof(Sim_Uplink_Packet)] = "AT+M2MCLISEND=";
+	struct MessageWriter msg;
+
+	setNbSerialOutputCb(Sim_Uplink_Out);
+	BeginMessage(&msg, buf, sizeof(buf), CMT_USER_UP, 1, 0x0102);
+	PutInt8(&msg, 1, 60);
+	PutInt32(&msg, 2, 888);
+	PutInt8(&msg, 3, 0);
+	Sim_Check(pushMessageWriter(&msg) > 0, "EasyIoT uplink built");
+	Sim_Check(Sim_Uplink_Sent == true, "AT+M2MCLISEND answered OK");
+
+	Hex2Str(expected + strlen(expected), (const char *)Sim_Uplink_Packet, Sim_Uplink_Len);
+	expected[strlen("AT+M2MCLISEND=") + 2 * Sim_Uplink_Len] = '\0';
+	Sim_Check(strcmp(Sim_Modem_Last_Command(), expected) == 0, "AT+M2MCLISEND hex line");
+
+	ME3616_Delay(Me3616, 500);
+	Sim_Check(Get_Sys_State(Me3616, SYS_STATE_LWM_NOTIFY_SUCCESS) == true, "LWM2M notify success");
+}
+
+/**
+  * @brief  EasyIoT command by +M2MCLIRECV, as M2MCLIRECV_Callback() of Me3616_app.c.
+  *         The reader checks the packet and its TLV views are the line handed to
+  *         the Active Report, in RxBuffer or RxVaildString when it wraps, nothing
+  *         was copied.
+  */
+static const char * Sim_Cmd_Line = NULL;
+static uint32_t Sim_Cmd_Count = 0;
+static uint16_t Sim_Cmd_Mid = 0;
+static int8_t Sim_Cmd_Value = -1;
+static bool Sim_Cmd_In_Place = false;
+static void * Sim_Cmd_Context = NULL;
+static uint8_t Sim_Cmd_Context_Id = 0;
+
+static void Sim_Downlink_Recv(Me3616_DeviceType * Me3616, char * pch, uint16_t len)
+{
+	uint16_t pos = sizeof("+M2MCLIRECV:") - 1;
+
+	UNUSED(Me3616);
+	while((pos < len) && (pch[pos] == ' ')) pos++;
+	Sim_Cmd_Line = pch + pos;
+	CoapHexInputInPlace(pch + pos, len - pos);
+}
+
+static void Sim_Cmd_Reader(const struct MessageReader * req)
+{
+	struct MessageReader it = *req;
+	struct TLVView tlv;
+
+	Sim_Cmd_Count++;
+	Sim_Cmd_Mid = req->dtag_mid;
+	ReadInt8(req, 3, &Sim_Cmd_Value);
+	Sim_Cmd_In_Place = (req->buf == (const uint8_t *)Sim_Cmd_Line);
+	while(NextTLV(&it, &tlv) == 1)
+	{
+		if((tlv.value < req->buf) || (tlv.value + tlv.length > req->buf + req->length)) Sim_Cmd_In_Place = false;
+	}
+}
+
+static void Sim_Cmd_Context_Reader(const struct MessageReader * req, void * context)
+{
+	Sim_Cmd_Count++;
+	Sim_Cmd_Context = context;
+	Sim_Cmd_Context_Id = req->msgid;
+}
+
+static void Sim_Downlink(Me3616_DeviceType * Me3616)
+{
+	//CMT_USER_CMD_REQ, mid 0x1234, cmd 2, TLV 3 = int8 1, checksum last
+	uint8_t packet[] = {0x01, 0xF2, 0x00, 0x0A, 0x34, 0x12, 0x02, 0x00, 0x04, 0x03, 0x00, 0x01, 0x01, 0x00};
+	char line[sizeof("+M2MCLIRECV: ") + 2 * sizeof(packet)] = "+M2MCLIRECV: ";
+	uint8_t sum = 0;
+
+	for(uint16_t i = 0; i < sizeof(packet) - 1; i++) sum += packet[i];
+	packet[sizeof(packet) - 1] = sum;
+
+	setCmdReader(2, Sim_Cmd_Reader);
+	ME3616_Register_URC("+M2MCLIRECV", Sim_Downlink_Recv);
+
+	Hex2Str(line + strlen(line), (const char *)packet, sizeof(packet));
+	line[strlen("+M2MCLIRECV: ") + 2 * sizeof(packet)] = '\0';
+	Sim_Emit(50, line);
+	ME3616_Delay(Me3616, 200);
+	Sim_Check((Sim_Cmd_Count == 1) && (Sim_Cmd_Mid == 0x1234) && (Sim_Cmd_Value == 1), "EasyIoT command read");
+	Sim_Check(Sim_Cmd_In_Place == true, "EasyIoT command decoded in place");
+
+	//A bad checksum never reaches the reader
+	packet[sizeof(packet) - 1] = sum + 1;
+	Hex2Str(line + strlen("+M2MCLIRECV: "), (const char *)packet, sizeof(packet));
+	Sim_Emit(50, line);
+	ME3616_Delay(Me3616, 200);
+	Sim_Check(Sim_Cmd_Count == 1, "EasyIoT command checksum refused");
+
+	//Fill the handler table past the old 8, the last cmdid still dispatches with its context
+	{
+		static uint8_t contexts[EASYIOT_CMD_MAX_HANDLER];
+		bool registered = true;
+		uint8_t cmdid = 0;
+
+		for(uint16_t i = 0; i + 1 < EASYIOT_CMD_MAX_HANDLER; i++)
+		{
+			cmdid = (uint8_t)(0xFF - i);
+			if(setCmdReaderContext(cmdid, Sim_Cmd_Context_Reader, &contexts[i]) != 0) registered = false;
+		}
+		Sim_Check(registered == true, "EasyIoT handler table filled");
+		Sim_Check(setCmdReader(0x10, Sim_Cmd_Reader) != 0, "EasyIoT handler table full refused");
+
+		packet[6] = cmdid;
+		sum = 0;
+		for(uint16_t i = 0; i < sizeof(packet) - 1; i++) sum += packet[i];
+		packet[sizeof(packet) - 1] = sum;
+		Hex2Str(line + strlen("+M2MCLIRECV: "), (const char *)packet, sizeof(packet));
+		Sim_Emit(50, line);
+		ME3616_Delay(Me3616, 200);
+		Sim_Check((Sim_Cmd_Count == 2) && (Sim_Cmd_Context_Id == cmdid) &&
+		          (Sim_Cmd_Context == &contexts[EASYIOT_CMD_MAX_HANDLER - 2]), "EasyIoT command context");
+	}
+}
+
+/**
+  * @brief  UDP socket. An +ESONMI in between AT+ESOSEND and its OK lands in the
+  *         ring. Rings filled up to ME3616_SOCKET_RX_LOW_ROOM turn ME3616 to hold,
+  *         held data is read by AT+ESOREAD, a drained ring turns it back to push.
+  *         With ME3616_SOCKET_RAW data goes both ways as bytes, CR, LF and '\0'
+  *         among them, and an +ESONMI past RxBuffer is streamed into the ring.
+  *         TCP data past the ring breaks the socket.
+  */
+#define SIM_SOCKET_NMI_LEN              80
+#define SIM_SOCKET_LONG_LEN             190
+
+static bool Sim_Socket_Pattern(const uint8_t * data, uint16_t len, uint32_t start)
+{
+	for(uint16_t i = 0; i < len; i++)
+	{
+		if(data[i] != (uint8_t)(start + i)) return false;
+	}
+	return true;
+}
+
+/**
+  * @brief  Socket data of a report line, as ME3616 has it by AT+ESOSETRPT.
+  * @param  line: where the data goes.
+  * @param  data: bytes.
+  * @param  len: bytes of data.
+  * @param  rule: for a sim rule, raw bytes "\xNN" escaped where they would break it.
+  * @retval chars written.
+  */
+static int Sim_Socket_Data(char * line, const uint8_t * data, uint16_t len, bool rule)
+{
+	int n = 0;
+
+#ifdef ME3616_SOCKET_RAW
+	for(uint16_t i = 0; i < len; i++)
+	{
+		if((rule == true) && ((data[i] < 0x20) || (data[i] > 0x7E) || (data[i] == '|') || (data[i] == '\\')))
+		{
+			n += sprintf(line + n, "\\x%02X", data[i]);
+		}
+		else
+		{
+			line[n++] = (char)data[i];
+		}
+	}
+#else
+	UNUSED(rule);
+	Hex2Str(line, (const char *)data, len);
+	n = 2 * len;
+#endif
+	line[n] = '\0';
+	return n;
+}
+
+/**
+  * @brief  +ESONMI=1,<len>,<data> in delay_ms.
+  */
+static void Sim_Socket_NMI(uint32_t delay_ms, const uint8_t * data, uint16_t len)
+{
+	char line[SIM_LINE_SIZE];
+	int n = sprintf(line, "+ESONMI=1,%u,", len);
+
+	n += Sim_Socket_Data(line + n, data, len, false);
+	Sim_Emit_Bytes(delay_ms, (const uint8_t *)line, (uint16_t)n);
+}
+
+/**
+  * @brief  Wait until the module has sent everything scheduled, at any baud rate.
+  */
+static void Sim_Settle(Me3616_DeviceType * Me3616)
+{
+	while(Sim_Modem_Backlog() != 0) ME3616_Delay(Me3616, 10);
+	ME3616_Delay(Me3616, 10);
+}
+
+static void Sim_Socket(Me3616_DeviceType * Me3616)
+{
+	static const uint8_t hello[] = {'h', 'e', 'l', 'l', 'o'};
+	static const uint8_t echo[] = {0xDE, 0x0D, 0x0A, 0x00};
+	static const uint8_t broken[] = {0x01, 0x02};
+	char line[SIM_LINE_SIZE * 2];
+	uint8_t data[ME3616_SOCKET_RX_SIZE];
+	uint8_t buf[ME3616_SOCKET_RX_SIZE];
+	uint16_t filled = 0;
+	int prefix = 0;
+	int len = 0;
+	int fd = 0;
+
+#ifdef ME3616_SOCKET_RAW
+	prefix = sprintf(line, "rule AT+ESOSENDRAW= => +ESONMI=1,%u,", (unsigned)sizeof(echo));
+#else
+	prefix = sprintf(line, "rule AT+ESOSEND= => +ESONMI=1,%u,", (unsigned)sizeof(echo));
+#endif
+	prefix += Sim_Socket_Data(line + prefix, echo, sizeof(echo), true);
+	strcpy(line + prefix, " | OK");
+	Sim_Command(line);
+
+	fd = me_socket(Me3616, ME_SOCK_DGRAM);
+	Sim_Check((fd >= 0) && (strcmp(Sim_Modem_Last_Command(), "AT+ESOC=1,2,1") == 0), "socket created by AT+ESOC");
+	Sim_Check((me_connect(fd, "10.0.0.1", 5683) == 0) &&
+	          (strcmp(Sim_Modem_Last_Command(), "AT+ESOCON=1,5683,\"10.0.0.1\"") == 0), "socket connected by AT+ESOCON");
+#ifdef ME3616_SOCKET_RAW
+	{
+		uint16_t raw_len = 0;
+		const uint8_t * raw = NULL;
+
+		Sim_Check((me_send(fd, hello, sizeof(hello)) == sizeof(hello)) &&
+		          (strcmp(Sim_Modem_Last_Command(), "AT+ESOSENDRAW=1,5") == 0), "socket sent by AT+ESOSENDRAW");
+		raw = Sim_Modem_Last_Raw(&raw_len);
+		Sim_Check((raw_len == sizeof(hello)) && (memcmp(raw, hello, sizeof(hello)) == 0), "AT+ESOSENDRAW payload as is");
+	}
+#else
+	Sim_Check((me_send(fd, hello, sizeof(hello)) == sizeof(hello)) &&
+	          (strcmp(Sim_Modem_Last_Command(), "AT+ESOSEND=1,5,68656C6C6F") == 0), "socket sent by AT+ESOSEND");
+#endif
+	len = me_recv(fd, buf, sizeof(buf));
+	Sim_Check((len == sizeof(echo)) && (memcmp(buf, echo, sizeof(echo)) == 0), "+ESONMI before OK received");
+
+#ifdef ME3616_SOCKET_RAW
+	//Streamed line longer than RxBuffer lands whole, the next one is framed
+	for(uint16_t i = 0; i < SIM_SOCKET_LONG_LEN; i++) data[i] = (uint8_t)(i * 7);
+	Sim_Socket_NMI(20, data, SIM_SOCKET_LONG_LEN);
+	Sim_Socket_NMI(20, broken, sizeof(broken));
+	Sim_Settle(Me3616);
+	len = me_recv(fd, buf, sizeof(buf));
+	Sim_Check((len == SIM_SOCKET_LONG_LEN + sizeof(broken)) && (memcmp(buf, data, SIM_SOCKET_LONG_LEN) == 0) &&
+	          (memcmp(buf + SIM_SOCKET_LONG_LEN, broken, sizeof(broken)) == 0), "+ESONMI past RxBuffer streamed");
+#endif
+
+	//Push until the ring is short of room, the one after does not fit
+	while(filled + SIM_SOCKET_NMI_LEN <= ME3616_SOCKET_RX_SIZE)
+	{
+		for(uint16_t i = 0; i < SIM_SOCKET_NMI_LEN; i++) data[i] = (uint8_t)(filled + i);
+		Sim_Socket_NMI(20, data, SIM_SOCKET_NMI_LEN);
+		Sim_Settle(Me3616);
+		filled += SIM_SOCKET_NMI_LEN;
+	}
+	Sim_Socket_NMI(20, data, SIM_SOCKET_NMI_LEN);
+	Sim_Settle(Me3616);
+	Sim_Check((me_available(fd) == filled) && (ME_Socket_Get(fd)->RxDropped == SIM_SOCKET_NMI_LEN), "+ESONMI past the ring dropped");
+
+	len = me_recv(fd, buf, sizeof(buf));
+	Sim_Check(strcmp(Sim_Modem_Last_Command(), "AT+ESOREADEN=1") == 0, "full ring turns ME3616 to hold");
+	Sim_Check((len == filled) && (Sim_Socket_Pattern(buf, filled, 0) == true), "ring read in order");
+
+	//Held data, two AT+ESOREAD of ME3616_SOCKET_READ_CHUNK
+	for(uint16_t i = 0; i < ME3616_SOCKET_READ_CHUNK; i++) data[i] = (uint8_t)(0x40 + i);
+	prefix = sprintf(line, "rule AT+ESOREAD= => +ESOREAD=1,%u,", ME3616_SOCKET_READ_CHUNK);
+	prefix += Sim_Socket_Data(line + prefix, data, ME3616_SOCKET_READ_CHUNK, true);
+	strcpy(line + prefix, " | OK");
+	Sim_Command(line);
+	sprintf(line, "+ESODATA=1,%u", 2 * ME3616_SOCKET_READ_CHUNK);
+	Sim_Emit(20, line);
+	Sim_Settle(Me3616);
+	Sim_Check(ME_Socket_Get(fd)->Pending == 2 * ME3616_SOCKET_READ_CHUNK, "+ESODATA held bytes counted");
+
+	len = me_recv(fd, buf, sizeof(buf));
+	Sim_Check((len == 2 * ME3616_SOCKET_READ_CHUNK) && (Sim_Socket_Pattern(buf, ME3616_SOCKET_READ_CHUNK, 0x40) == true) &&
+	          (Sim_Socket_Pattern(buf + ME3616_SOCKET_READ_CHUNK, ME3616_SOCKET_READ_CHUNK, 0x40) == true), "held bytes read by AT+ESOREAD");
+	Sim_Check(strcmp(Sim_Modem_Last_Command(), "AT+ESOREADEN=0") == 0, "drained ring turns ME3616 to push");
+
+	Sim_Check((me_close(fd) == 0) && (ME_Socket_Get(fd) == NULL), "socket closed by AT+ESOCL");
+
+	//A broken socket reads -1 once its ring is empty
+	fd = me_socket(Me3616, ME_SOCK_STREAM);
+	Sim_Socket_NMI(20, broken, sizeof(broken));
+	Sim_Emit(20, "+ESOERR=1,3");
+	Sim_Settle(Me3616);
+	Sim_Check((me_recv(fd, buf, sizeof(buf)) == 2) && (me_recv(fd, buf, sizeof(buf)) == -1) &&
+	          (ME_Socket_Get(fd)->Error == 3), "+ESOERR breaks the socket");
+	me_close(fd);
+
+	//TCP data past the ring leaves a gap, the socket breaks after the ring
+	fd = me_socket(Me3616, ME_SOCK_STREAM);
+	for(filled = 0; filled + SIM_SOCKET_NMI_LEN <= ME3616_SOCKET_RX_SIZE; filled += SIM_SOCKET_NMI_LEN)
+	{
+		for(uint16_t i = 0; i < SIM_SOCKET_NMI_LEN; i++) data[i] = (uint8_t)(filled + i);
+		Sim_Socket_NMI(20, data, SIM_SOCKET_NMI_LEN);
+		Sim_Settle(Me3616);
+	}
+	Sim_Socket_NMI(20, data, SIM_SOCKET_NMI_LEN);
+	Sim_Settle(Me3616);
+	Sim_Check((ME_Socket_Get(fd)->State == ME_SOCKET_ERROR) &&
+	          (ME_Socket_Get(fd)->Error == ME_SOCKET_ERR_RX_OVERFLOW), "TCP past the ring breaks the socket");
+	len = me_recv(fd, buf, sizeof(buf));
+	Sim_Check((len == filled) && (Sim_Socket_Pattern(buf, filled, 0) == true) &&
+	          (me_recv(fd, buf, sizeof(buf)) == -1), "broken TCP ring read, then -1");
+	me_close(fd);
+}
+
+/**
+  * @brief  MQTT client. +EMQPUB goes to every matching filter, one in between
+  *         AT+EMQPUB and its OK too. +EMQDISCON makes publishes queue, one per
+  *         topic, a failed reconnect doubles the wait, the next one subscribes
+  *         again and sends the queue in order.
+  */
+typedef struct {
+    uint32_t                Count;
+    char                    Topic[ME3616_MQTT_TOPIC_SIZE];
+    uint8_t                 Payload[8];
+    uint16_t                Len;
+}Sim_MQTT_Sink_t;
+
+static void Sim_MQTT_Handler(void * context, const char * topic, uint16_t topic_len, const uint8_t * payload, uint16_t len)
+{
+	Sim_MQTT_Sink_t * sink = (Sim_MQTT_Sink_t *)context;
+
+	sink->Count++;
+	snprintf(sink->Topic, sizeof(sink->Topic), "%.*s", topic_len, topic);
+	sink->Len = (len < sizeof(sink->Payload)) ? len : sizeof(sink->Payload);
+	memcpy(sink->Payload, payload, sink->Len);
+}
+
+static void Sim_MQTT_Run(Me3616_DeviceType * Me3616, uint32_t ms)
+{
+	uint32_t start = HAL_GetTick();
+
+	while(HAL_GetTick() - start < ms)
+	{
+		ME_MQTT_Poll(Me3616);
+		ME3616_Delay(Me3616, 10);
+	}
+}
+
+static void Sim_MQTT(Me3616_DeviceType * Me3616)
+{
+	static const uint8_t command[] = {0xDE, 0xAD, 0xBE, 0xEF};
+	static const ME_MQTT_Config_t config = {"10.0.0.2", 1883, "me3616", NULL, NULL, 120, true};
+	Sim_MQTT_Sink_t one = {0};
+	Sim_MQTT_Sink_t all = {0};
+	const ME_MQTT_t * mqtt = ME_MQTT_Get();
+	uint32_t published = 0;
+	uint8_t value = 0;
+
+	Sim_Check((ME_MQTT_Topic_Match("a/#", 3, "a", 1) == true) && (ME_MQTT_Topic_Match("a/+/c", 5, "a//c", 4) == true) &&
+	          (ME_MQTT_Topic_Match("a/+", 3, "a/b/c", 5) == false) && (ME_MQTT_Topic_Match("+/b", 3, "$SYS/b", 6) == false) &&
+	          (ME_MQTT_Topic_Match("a/b", 3, "a/bc", 4) == false), "MQTT topic filters");
+
+	//Subscribed on connect
+	Sim_Check((me_mqtt_subscribe("dev/+/cmd", 1, Sim_MQTT_Handler, &one) == true) &&
+	          (me_mqtt_subscribe("dev/#", 0, Sim_MQTT_Handler, &all) == true) &&
+	          (me_mqtt_subscribe("dev/#/x", 0, Sim_MQTT_Handler, &all) == false), "MQTT filters taken before open");
+	Sim_Check((me_mqtt_open(Me3616, &config) == true) && (mqtt->State == ME_MQTT_CONNECTED) &&
+	          (strcmp(Sim_Modem_Last_Command(), "AT+EMQSUB=0,\"dev/#\",0") == 0), "MQTT connected and subscribed");
+
+	Sim_Emit(20, "+EMQPUB: 0,\"dev/7/cmd\",1,0,0,8,\"DEADBEEF\"");
+	Sim_Emit(20, "+EMQPUB: 0,\"other/7\",0,0,0,2,\"01\"");
+	Sim_Settle(Me3616);
+	Sim_Check((one.Count == 1) && (all.Count == 1) && (strcmp(one.Topic, "dev/7/cmd") == 0) &&
+	          (one.Len == sizeof(command)) && (memcmp(one.Payload, command, sizeof(command)) == 0), "+EMQPUB to matching filters");
+	Sim_Check((mqtt->Received == 2) && (mqtt->Unmatched == 1), "+EMQPUB of no filter counted");
+
+	Sim_Command("rule AT+EMQPUB= => +EMQPUB: 0,\"dev/9/cmd\",0,0,0,2,\"2A\" | OK");
+	Sim_Check((me_mqtt_publish("dev/1/up", "hello", 5, 0, false) == true) &&
+	          (strcmp(Sim_Modem_Last_Command(), "AT+EMQPUB=0,\"dev/1/up\",0,0,0,10,68656C6C6F") == 0), "MQTT published by AT+EMQPUB");
+	Sim_Check((one.Count == 2) && (strcmp(one.Topic, "dev/9/cmd") == 0) && (one.Payload[0] == 0x2A), "+EMQPUB before OK received");
+	Sim_Command("rule AT+EMQPUB= => OK");
+
+	//Queued commands share TxBuffer, a publish waits for them
+	ME3616_Queue_AT_Command(Me3616, AT_CMD_NETWORK_CSQ, AT_BASE, NULL, 0, NULL, NULL);
+	Sim_Check((me_mqtt_publish("dev/1/up", "hi", 2, 0, false) == true) && (ME3616_AT_Queue_Idle(Me3616) == true) &&
+	          (strncmp(Sim_Modem_Last_Command(), "AT+EMQPUB=", 10) == 0), "MQTT publish after queued commands");
+
+	//Lost: publishes queue, one per topic
+	Sim_Emit(20, "+EMQDISCON: 0,1");
+	Sim_Settle(Me3616);
+	Sim_Check((mqtt->State == ME_MQTT_LOST) && (mqtt->Error == 1), "+EMQDISCON loses the connection");
+
+	published = mqtt->Published;
+	me_mqtt_publish("dev/1/st", "on", 2, 1, true);
+	for(value = 1; value <= 3; value++) me_mqtt_publish("dev/1/up", &value, 1, 0, false);
+	Sim_Check((mqtt->QueueCount == 2) && (mqtt->Coalesced == 2) && (mqtt->Published == published), "MQTT publishes coalesced while lost");
+
+	Sim_Command("rule AT+EMQCON= => ERROR");
+	Sim_MQTT_Run(Me3616, ME3616_MQTT_BACKOFF_MIN + 100);
+	Sim_Check((mqtt->State == ME_MQTT_LOST) && (mqtt->Wait == 2 * ME3616_MQTT_BACKOFF_MIN), "failed reconnect doubles the wait");
+
+	Sim_Command("rule AT+EMQCON= => OK");
+	Sim_MQTT_Run(Me3616, 2 * ME3616_MQTT_BACKOFF_MIN + 100);
+	Sim_Check((mqtt->State == ME_MQTT_CONNECTED) && (mqtt->Connects == 2) && (mqtt->Sub[1].Subscribed == true),
+	          "MQTT reconnected and subscribed again");
+	Sim_Check((mqtt->QueueCount == 0) && (mqtt->Published == published + 2) &&
+	          (strcmp(Sim_Modem_Last_Command(), "AT+EMQPUB=0,\"dev/1/up\",0,0,0,2,03") == 0), "queue sent in order, latest payload");
+
+	Sim_Check((me_mqtt_unsubscribe("dev/+/cmd") == true) &&
+	          (strcmp(Sim_Modem_Last_Command(), "AT+EMQUNSUB=0,\"dev/+/cmd\"") == 0), "MQTT unsubscribed by AT+EMQUNSUB");
+	Sim_Check((me_mqtt_close() == true) && (strcmp(Sim_Modem_Last_Command(), "AT+EMQDISCON=0") == 0) &&
+	          (mqtt->State == ME_MQTT_CLOSED), "MQTT closed by AT+EMQDISCON");
+	me_mqtt_unsubscribe("dev/#");
+}
+
+/**
+  * @brief  CoAP client against a server behind the module, the command hook
+  *         answers AT+ECOAPSEND. Piggybacked and separate responses, a lost
+  *         request sent again, Block1 upload in the smaller blocks the server
+  *         asks, Block2 download block by block, no answer and reset.
+  */
+#define SIM_COAP_PIGGYBACK              0
+#define SIM_COAP_SEPARATE               1
+#define SIM_COAP_SILENT                 2
+#define SIM_COAP_RESET                  3
+
+typedef struct {
+    uint8_t                 Mode;               //SIM_COAP_xxx
+    uint8_t                 Drop;               //requests not answered before the next is
+    uint8_t                 Szx1;               //largest Block1 taken
+    uint32_t                Requests;           //CON requests, retransmissions too
+    uint16_t                LastId;             //Message ID of the last one
+    uint32_t                Acks;               //empty ACKs of the client
+    uint32_t                Resets;             //RSTs of the client
+    uint16_t                ControlId;          //Message ID of the last empty ACK / RST
+    uint16_t                NextId;             //Message ID of a CON of the server
+    uint8_t                 Upload[320];
+    uint16_t                UploadLen;
+    char                    Line[SIM_LINE_SIZE];//last +ECOAPNMI
+}Sim_CoAP_Server_t;
+
+typedef struct {
+    uint32_t                Count;              //handler calls
+    uint32_t                Failed;             //of no response
+    uint8_t                 Code;
+    uint32_t                Offsets;            //bit of each 64 byte block offset
+    uint8_t                 Data[256];
+    uint16_t                Len;
+}Sim_CoAP_Sink_t;
+
+static Sim_CoAP_Server_t Sim_CoAP_Server;
+static uint8_t Sim_CoAP_Log[200];
+
+static void Sim_CoAP_Reply(uint32_t delay_ms, const uint8_t * pdu, uint16_t len)
+{
+	int n = snprintf(Sim_CoAP_Server.Line, sizeof(Sim_CoAP_Server.Line), "+ECOAPNMI: 0,%u,", len);
+
+	Sim_CoAP_Server.Line[n + Hex_Encode(Sim_CoAP_Server.Line + n, 2 * len, pdu, len)] = '\0';
+	Sim_Emit(delay_ms, Sim_CoAP_Server.Line);
+}
+
+static void Sim_CoAP_Hook(const char * line)
+{
+	static const char command[] = "AT+ECOAPSEND=";
+	Sim_CoAP_Server_t * server = &Sim_CoAP_Server;
+	const char * hex = strrchr(line, ',');
+	uint8_t pdu[ME3616_COAP_PDU_SIZE];
+	uint8_t reply[ME3616_COAP_PDU_SIZE];
+	ME_COAP_Message_t request;
+	ME_COAP_PDU_t response;
+	const uint8_t * path = NULL;
+	const uint8_t * payload = NULL;
+	uint16_t path_len = 0;
+	uint16_t payload_len = 0;
+	uint16_t option = 0;
+	uint32_t block = 0;
+	uint32_t offset = 0;
+	uint8_t code = ME_COAP_CODE(4, 4);
+	uint8_t szx = 0;
+	bool more = false;
+
+	if((strncmp(line, command, sizeof(command) - 1) != 0) || (hex == NULL)) return;
+	if(ME_COAP_Parse(&request, pdu, Hex_Decode(pdu, sizeof(pdu), hex + 1, strlen(hex + 1))) == false) return;
+
+	if((request.Type == ME_COAP_ACK) || (request.Type == ME_COAP_RST))
+	{
+		if(request.Type == ME_COAP_ACK) server->Acks++;
+		else server->Resets++;
+		server->ControlId = request.MessageId;
+		return;
+	}
+
+	server->Requests++;
+	server->LastId = request.MessageId;
+	if(server->Drop != 0)
+	{
+		server->Drop--;
+		return;
+	}
+	if(server->Mode == SIM_COAP_SILENT) return;
+	if(server->Mode == SIM_COAP_RESET)
+	{
+		ME_COAP_PDU_Begin(&response, reply, sizeof(reply), ME_COAP_RST, ME_COAP_EMPTY, request.MessageId, NULL, 0);
+		Sim_CoAP_Reply(40, reply, response.Len);
+		return;
+	}
+
+	ME_COAP_Get_Option(&request, ME_COAP_OPTION_URI_PATH, &path, &path_len);
+	if((path_len == 4) && (memcmp(path, "temp", 4) == 0))
+	{
+		code = ME_COAP_CONTENT;
+		payload = (const uint8_t *)"21.5";
+		payload_len = 4;
+	}
+	else if((path_len == 2) && (memcmp(path, "up", 2) == 0))
+	{
+		//Block1 into Upload, the next one asked in Szx1 at most
+		code = ME_COAP_CHANGED;
+		if(ME_COAP_Get_Option_Uint(&request, ME_COAP_OPTION_BLOCK1, &block) == true)
+		{
+			szx = block & 0x07;
+			offset = (block >> 4) << (szx + 4);
+			more = ((block & 0x08) != 0);
+			if(more == true) code = ME_COAP_CONTINUE;
+			option = ME_COAP_OPTION_BLOCK1;
+			block = (block & ~0x07u) | ((szx < server->Szx1) ? szx : server->Szx1);
+		}
+		if(offset + request.PayloadLen <= sizeof(server->Upload))
+		{
+			memcpy(server->Upload + offset, request.Payload, request.PayloadLen);
+			server->UploadLen = offset + request.PayloadLen;
+		}
+	}
+	else if((path_len == 3) && (memcmp(path, "log", 3) == 0))
+	{
+		//Block2 of Sim_CoAP_Log, the block asked
+		szx = ME3616_COAP_BLOCK2_SZX;
+		if(ME_COAP_Get_Option_Uint(&request, ME_COAP_OPTION_BLOCK2, &block) == true) szx = block & 0x07;
+		offset = (block >> 4) << (szx + 4);
+		payload = Sim_CoAP_Log + offset;
+		payload_len = sizeof(Sim_CoAP_Log) - offset;
+		if(payload_len > (16u << szx)) payload_len = 16u << szx;
+		more = (offset + payload_len < sizeof(Sim_CoAP_Log));
+		code = ME_COAP_CONTENT;
+		option = ME_COAP_OPTION_BLOCK2;
+		block = ((block >> 4) << 4) | (more ? 0x08 : 0x00) | szx;
+	}
+
+	if(server->Mode == SIM_COAP_SEPARATE)
+	{
+		ME_COAP_PDU_Begin(&response, reply, sizeof(reply), ME_COAP_ACK, ME_COAP_EMPTY, request.MessageId, NULL, 0);
+		Sim_CoAP_Reply(40, reply, response.Len);
+		ME_COAP_PDU_Begin(&response, reply, sizeof(reply), ME_COAP_CON, code, ++server->NextId, request.Token, request.TokenLen);
+	}
+	else
+	{
+		ME_COAP_PDU_Begin(&response, reply, sizeof(reply), ME_COAP_ACK, code, request.MessageId, request.Token, request.TokenLen);
+	}
+	if(option != 0) ME_COAP_PDU_Option_Uint(&response, option, block);
+	ME_COAP_PDU_Payload(&response, payload, payload_len);
+	Sim_CoAP_Reply((server->Mode == SIM_COAP_SEPARATE) ? 500 : 40, reply, response.Len);
+}
+
+static void Sim_CoAP_Handler(void * context, const ME_COAP_Message_t * response, uint32_t offset, bool more)
+{
+	Sim_CoAP_Sink_t * sink = (Sim_CoAP_Sink_t *)context;
+
+	UNUSED(more);
+	sink->Count++;
+	if(response == NULL)
+	{
+		sink->Failed++;
+		return;
+	}
+	sink->Code = response->Code;
+	sink->Offsets |= 1u << (offset / 64);
+	if(offset + response->PayloadLen <= sizeof(sink->Data))
+	{
+		memcpy(sink->Data + offset, response->Payload, response->PayloadLen);
+		if(offset + response->PayloadLen > sink->Len) sink->Len = offset + response->PayloadLen;
+	}
+}
+
+/**
+  * @brief  Poll until every request is over, and what the module sent is in.
+  */
+static void Sim_CoAP_Run(Me3616_DeviceType * Me3616)
+{
+	uint32_t start = HAL_GetTick();
+
+	while((ME_COAP_Poll(Me3616) == true) && (HAL_GetTick() - start < 200000)) ME3616_Delay(Me3616, 10);
+	Sim_Settle(Me3616);
+	ME_COAP_Poll(Me3616);
+}
+
+static bool Sim_CoAP_Request(uint8_t method, const char * path, const uint8_t * payload, uint16_t len, Sim_CoAP_Sink_t * sink)
+{
+	ME_COAP_Request_t request = {method, path, NULL, -1, payload, len, Sim_CoAP_Handler, sink};
+
+	memset(sink, 0, sizeof(Sim_CoAP_Sink_t));
+	return (me_coap_request(&request) >= 0);
+}
+
+static void Sim_CoAP(Me3616_DeviceType * Me3616)
+{
+	//RFC 7252 figure 16, GET /temperature
+	static const uint8_t get[] = {0x40, 0x01, 0x7D, 0x34, 0xBB, 't', 'e', 'm', 'p', 'e', 'r', 'a', 't', 'u', 'r', 'e'};
+	static const uint8_t marker_only[] = {0x60, 0x45, 0x7D, 0x34, 0xFF};
+	const ME_COAP_t * coap = ME_COAP_Get();
+	Sim_CoAP_Server_t * server = &Sim_CoAP_Server;
+	uint8_t upload[300];
+	uint8_t buf[32];
+	ME_COAP_PDU_t pdu;
+	ME_COAP_Message_t message;
+	Sim_CoAP_Sink_t sink;
+	uint32_t value = 0;
+	uint32_t count = 0;
+
+	ME_COAP_PDU_Begin(&pdu, buf, sizeof(buf), ME_COAP_CON, ME_COAP_GET, 0x7D34, NULL, 0);
+	ME_COAP_PDU_Option(&pdu, ME_COAP_OPTION_URI_PATH, "temperature", 11);
+	Sim_Check((pdu.Len == sizeof(get)) && (memcmp(buf, get, sizeof(get)) == 0), "CoAP PDU built as RFC 7252");
+	Sim_Check((ME_COAP_PDU_Option_Uint(&pdu, ME_COAP_OPTION_SIZE1, 300) == true) &&
+	          (ME_COAP_PDU_Option(&pdu, ME_COAP_OPTION_URI_QUERY, "a", 1) == false), "CoAP options in order only");
+	ME_COAP_PDU_Begin(&pdu, buf, sizeof(buf), ME_COAP_CON, ME_COAP_GET, 0x7D34, NULL, 0);
+	ME_COAP_PDU_Option(&pdu, ME_COAP_OPTION_URI_PATH, "temperature", 11);
+	ME_COAP_PDU_Option_Uint(&pdu, ME_COAP_OPTION_SIZE1, 300);
+	Sim_Check((ME_COAP_Parse(&message, buf, pdu.Len) == true) &&
+	          (ME_COAP_Get_Option_Uint(&message, ME_COAP_OPTION_SIZE1, &value) == true) && (value == 300) &&
+	          (ME_COAP_Parse(&message, marker_only, sizeof(marker_only)) == false), "CoAP PDU parsed");
+
+	for(uint16_t i = 0; i < sizeof(upload); i++) upload[i] = (uint8_t)(i * 7);
+	for(uint16_t i = 0; i < sizeof(Sim_CoAP_Log); i++) Sim_CoAP_Log[i] = (uint8_t)(i ^ 0x5A);
+	memset(server, 0, sizeof(Sim_CoAP_Server_t));
+	server->Szx1 = 1;
+	Sim_Set_Command_Hook(Sim_CoAP_Hook);
+
+	Sim_Check((me_coap_open(Me3616, "10.0.0.3", 5683) == true) && (coap->Id == 0) &&
+	          (strcmp(Sim_Modem_Last_Command(), "AT+ECOAPNEW=\"10.0.0.3\",5683,1") == 0), "CoAP client by AT+ECOAPNEW");
+
+	Sim_Check(Sim_CoAP_Request(ME_COAP_GET, "/temp", NULL, 0, &sink) == true, "CoAP GET by AT+ECOAPSEND");
+	Sim_CoAP_Run(Me3616);
+	Sim_Check((sink.Count == 1) && (sink.Failed == 0) && (sink.Code == ME_COAP_CONTENT) && (sink.Len == 4) &&
+	          (memcmp(sink.Data, "21.5", 4) == 0), "CoAP piggybacked response");
+
+	//First one lost
+	server->Drop = 1;
+	count = server->Requests;
+	Sim_CoAP_Request(ME_COAP_GET, "temp", NULL, 0, &sink);
+	Sim_CoAP_Run(Me3616);
+	Sim_Check((sink.Count == 1) && (sink.Code == ME_COAP_CONTENT) && (coap->Retransmits == 1) &&
+	          (server->Requests == count + 2), "CoAP lost request sent again");
+
+	//Empty ACK, then CON response
+	server->Mode = SIM_COAP_SEPARATE;
+	Sim_CoAP_Request(ME_COAP_GET, "temp", NULL, 0, &sink);
+	Sim_CoAP_Run(Me3616);
+	Sim_Check((sink.Count == 1) && (sink.Code == ME_COAP_CONTENT) && (server->Acks == 1) &&
+	          (server->ControlId == server->NextId), "CoAP separate response acknowledged");
+	count = coap->Duplicates;
+	Sim_Emit(20, server->Line);
+	Sim_CoAP_Run(Me3616);
+	Sim_Check((sink.Count == 1) && (server->Acks == 2) && (coap->Duplicates == count + 1), "CoAP separate response again, ACK only");
+
+	ME_COAP_PDU_Begin(&pdu, buf, sizeof(buf), ME_COAP_CON, ME_COAP_CONTENT, 0x4242, (const uint8_t *)"\x03\xFF\xFF", 3);
+	Sim_CoAP_Reply(20, buf, pdu.Len);
+	Sim_CoAP_Run(Me3616);
+	Sim_Check((server->Resets == 1) && (server->ControlId == 0x4242) && (coap->Unmatched == 1), "CoAP response of no request reset");
+
+	//64 byte blocks, 32 once the server asks
+	server->Mode = SIM_COAP_PIGGYBACK;
+	count = coap->Blocks;
+	Sim_Check(Sim_CoAP_Request(ME_COAP_POST, "up", upload, sizeof(upload), &sink) == true, "CoAP POST longer than a PDU");
+	Sim_CoAP_Run(Me3616);
+	Sim_Check((sink.Count == 1) && (sink.Code == ME_COAP_CHANGED) && (server->UploadLen == sizeof(upload)) &&
+	          (memcmp(server->Upload, upload, sizeof(upload)) == 0), "CoAP Block1 upload");
+	Sim_Check(coap->Blocks == count + 8, "CoAP Block1 in the size server asked");
+
+	Sim_CoAP_Request(ME_COAP_GET, "log", NULL, 0, &sink);
+	Sim_CoAP_Run(Me3616);
+	Sim_Check((sink.Count == 4) && (sink.Offsets == 0x0F) && (sink.Len == sizeof(Sim_CoAP_Log)) &&
+	          (memcmp(sink.Data, Sim_CoAP_Log, sizeof(Sim_CoAP_Log)) == 0), "CoAP Block2 download, block by block");
+
+	server->Mode = SIM_COAP_SILENT;
+	count = coap->Retransmits;
+	Sim_CoAP_Request(ME_COAP_GET, "temp", NULL, 0, &sink);
+	Sim_CoAP_Run(Me3616);
+	Sim_Check((sink.Count == 1) && (sink.Failed == 1) && (coap->Timeouts == 1) &&
+	          (coap->Retransmits == count + ME3616_COAP_MAX_RETRANSMIT), "CoAP request of no answer fails");
+
+	server->Mode = SIM_COAP_RESET;
+	Sim_CoAP_Request(ME_COAP_DELETE, "temp", NULL, 0, &sink);
+	Sim_CoAP_Run(Me3616);
+	Sim_Check((sink.Failed == 1) && (coap->Resets == 1), "CoAP request reset by the server");
+
+	Sim_Check((me_coap_close() == true) && (strcmp(Sim_Modem_Last_Command(), "AT+ECOAPDEL=0") == 0) &&
+	          (coap->Id < 0), "CoAP client closed by AT+ECOAPDEL");
+	Sim_Set_Command_Hook(NULL);
+}
+
+/**
+  * @brief  HTTP client against a server behind the module, the command hook puts
+  *         the AT+EHTTPSEND pieces together and answers the last one. Content
+  *         far past RxBuffer, each +EHTTPNMIC line longer than it, goes to the
+  *         sink in fragments. A body from a source in pieces, an empty response,
+  *         +EHTTPERR and no answer.
+  */
+#define SIM_HTTP_CONFIG_LEN             700
+#define SIM_HTTP_UP_LEN                 400
+#define SIM_HTTP_BAD_AT                 200
+
+typedef struct {
+    uint32_t                Pieces;             //AT+EHTTPSEND commands
+    bool                    Broken;             //a piece did not add up
+    char                    Create[SIM_LINE_SIZE];//last AT+EHTTPCREATE
+    char                    Data[640];          //data string put together
+    uint16_t                Len;
+    char                    Header[32];         //header lines of the last request
+    char                    Type[32];           //content type of the last request
+    uint32_t                Body;               //body bytes of the last request
+    bool                    BodyOk;             //body was the pattern
+}Sim_HTTP_Server_t;
+
+typedef struct {
+    uint32_t                Header;             //header bytes, in order
+    uint32_t                Content;            //content bytes, in order
+    uint32_t                Fragments;
+    uint16_t                Largest;            //bytes of the largest fragment
+    bool                    Mismatch;           //a byte out of order or not the pattern
+    uint32_t                Done;
+    uint32_t                Failed;
+    uint32_t                Asked;              //source calls
+    char                    Bad;                //put at SIM_HTTP_BAD_AT of the body, '\0' for none
+    char                    Text[32];           //start of the content
+}Sim_HTTP_Sink_t;
+
+static Sim_HTTP_Server_t Sim_HTTP_Server;
+static const char Sim_HTTP_Header[] = "Content-Type: text/plain\r\nContent-Length: 700\r\n";
+
+static uint8_t Sim_HTTP_Pattern(uint32_t offset)
+{
+	return (uint8_t)('A' + offset % 26);
+}
+
+/**
+  * @brief  "<head><data>" as ME3616 frames a line, in parts if longer than SIM_LINE_SIZE.
+  */
+static void Sim_HTTP_Line(uint32_t delay_ms, const char * head, const uint8_t * data, uint16_t len)
+{
+	static uint8_t line[512];
+	uint16_t n = 0;
+
+	line[n++] = '\r';
+	line[n++] = '\n';
+	memcpy(line + n, head, strlen(head));
+	n += strlen(head);
+	memcpy(line + n, data, len);
+	n += len;
+	line[n++] = '\r';
+	line[n++] = '\n';
+
+	//Events due at the same time keep their order
+	for(uint16_t i = 0; i < n; i += SIM_LINE_SIZE)
+	{
+		Sim_Emit_Raw(delay_ms, line + i, (n - i < SIM_LINE_SIZE) ? (n - i) : SIM_LINE_SIZE);
+	}
+}
+
+/**
+  * @brief  "<len>,<text>," field of the data string, text copied into out.
+  * @retval past the field.
+  */
+static const char * Sim_HTTP_Field(const char * p, char * out, size_t size)
+{
+	char * end = NULL;
+	unsigned long len = strtoul(p, &end, 10);
+
+	snprintf(out, size, "%.*s", (int)len, end + 1);
+	return end + 1 + len + 1;
+}
+
+static void Sim_HTTP_Respond(Sim_HTTP_Server_t * server)
+{
+	static uint8_t content[SIM_HTTP_CONFIG_LEN];
+	const char * p = server->Data;
+	char path[32];
+	char head[48];
+	char * end = NULL;
+	int n = 0;
+
+	sscanf(p, "%*d,%*d,%n", &n);
+	if(n == 0) return;
+	p = Sim_HTTP_Field(p + n, path, sizeof(path));
+	p = Sim_HTTP_Field(p, server->Header, sizeof(server->Header));
+	p = Sim_HTTP_Field(p, server->Type, sizeof(server->Type));
+	server->Body = strtoul(p, &end, 10);
+	p = end + 1;
+	server->BodyOk = (p + server->Body == server->Data + server->Len);
+	for(uint32_t i = 0; (server->BodyOk == true) && (i < server->Body); i++)
+	{
+		server->BodyOk = ((uint8_t)p[i] == Sim_HTTP_Pattern(i));
+	}
+
+	if(strcmp(path, "/config") == 0)
+	{
+		for(uint16_t i = 0; i < sizeof(content); i++) content[i] = Sim_HTTP_Pattern(i);
+		sprintf(head, "+EHTTPNMIH: 0,200,%u,", (unsigned)(sizeof(Sim_HTTP_Header) - 1));
+		Sim_HTTP_Line(40, head, (const uint8_t *)Sim_HTTP_Header, sizeof(Sim_HTTP_Header) - 1);
+		sprintf(head, "+EHTTPNMIC: 0,1,%u,%u,", SIM_HTTP_CONFIG_LEN, SIM_HTTP_CONFIG_LEN / 2);
+		Sim_HTTP_Line(60, head, content, SIM_HTTP_CONFIG_LEN / 2);
+		sprintf(head, "+EHTTPNMIC: 0,0,%u,%u,", SIM_HTTP_CONFIG_LEN, SIM_HTTP_CONFIG_LEN / 2);
+		Sim_HTTP_Line(80, head, content + SIM_HTTP_CONFIG_LEN / 2, SIM_HTTP_CONFIG_LEN / 2);
+	}
+	else if(strcmp(path, "/up") == 0)
+	{
+		n = sprintf((char *)content, "stored %lu", (unsigned long)server->Body);
+		Sim_HTTP_Line(40, "+EHTTPNMIH: 0,201,0,", NULL, 0);
+		sprintf(head, "+EHTTPNMIC: 0,0,%d,%d,", n, n);
+		Sim_HTTP_Line(60, head, content, (uint16_t)n);
+	}
+	else if(strcmp(path, "/empty") == 0)
+	{
+		Sim_HTTP_Line(40, "+EHTTPNMIH: 0,204,0,", NULL, 0);
+		Sim_HTTP_Line(60, "+EHTTPNMIC: 0,0,0,0,", NULL, 0);
+	}
+	else if(strcmp(path, "/fail") == 0)
+	{
+		Sim_Emit(40, "+EHTTPERR: 0,3");
+	}
+}
+
+static void Sim_HTTP_Hook(const char * line)
+{
+	static const char create[] = "AT+EHTTPCREATE=";
+	static const char send[] = "AT+EHTTPSEND=";
+	Sim_HTTP_Server_t * server = &Sim_HTTP_Server;
+	unsigned more = 0;
+	unsigned total = 0;
+	unsigned len = 0;
+	int n = 0;
+
+	if(strncmp(line, create, sizeof(create) - 1) == 0) snprintf(server->Create, sizeof(server->Create), "%s", line);
+	if(strncmp(line, send, sizeof(send) - 1) != 0) return;
+
+	server->Pieces++;
+	if((sscanf(line + sizeof(send) - 1, "%u,%u,%u,\"%n", &more, &total, &len, &n) != 3) || (n == 0) ||
+	   (strlen(line + sizeof(send) - 1 + n) != len + 1) || (server->Len + len > sizeof(server->Data) - 1))
+	{
+		server->Broken = true;
+		return;
+	}
+	memcpy(server->Data + server->Len, line + sizeof(send) - 1 + n, len);
+	server->Len += len;
+	if(more != 0) return;
+
+	server->Data[server->Len] = '\0';
+	if(server->Len != total) server->Broken = true;
+	else Sim_HTTP_Respond(server);
+	server->Len = 0;
+}
+
+static void Sim_HTTP_Sink(void * context, ME_HTTP_Event_t event, const uint8_t * data, uint16_t len, uint32_t offset)
+{
+	Sim_HTTP_Sink_t * sink = (Sim_HTTP_Sink_t *)context;
+
+	if(event == ME_HTTP_DONE)
+	{
+		sink->Done++;
+		if(offset != sink->Content) sink->Mismatch = true;
+		return;
+	}
+	if(event == ME_HTTP_FAILED)
+	{
+		sink->Failed++;
+		return;
+	}
+
+	sink->Fragments++;
+	if(len > sink->Largest) sink->Largest = len;
+	if(event == ME_HTTP_HEADER)
+	{
+		if(offset != sink->Header) sink->Mismatch = true;
+		sink->Header += len;
+		return;
+	}
+
+	if(offset != sink->Content) sink->Mismatch = true;
+	for(uint16_t i = 0; (i < len) && (offset + i < sizeof(sink->Text) - 1); i++) sink->Text[offset + i] = (char)data[i];
+	sink->Content += len;
+}
+
+static uint16_t Sim_HTTP_Source(void * context, uint32_t offset, uint8_t * buf, uint16_t size)
+{
+	Sim_HTTP_Sink_t * sink = (Sim_HTTP_Sink_t *)context;
+	uint16_t n = 0;
+
+	sink->Asked++;
+	while((n < size) && (offset + n < SIM_HTTP_UP_LEN))
+	{
+		buf[n] = ((sink->Bad != '\0') && (offset + n == SIM_HTTP_BAD_AT)) ? (uint8_t)sink->Bad : Sim_HTTP_Pattern(offset + n);
+		n++;
+	}
+	return n;
+}
+
+/**
+  * @brief  Poll until the request is over, and what the module sent is in.
+  */
+static void Sim_HTTP_Run(Me3616_DeviceType * Me3616)
+{
+	uint32_t start = HAL_GetTick();
+
+	while((ME_HTTP_Poll(Me3616) == true) && (HAL_GetTick() - start < 100000)) ME3616_Delay(Me3616, 10);
+	Sim_Settle(Me3616);
+	ME_HTTP_Poll(Me3616);
+}
+
+static bool Sim_HTTP_Request(ME_HTTP_Method_t method, const char * path, uint32_t body_len, Sim_HTTP_Sink_t * sink)
+{
+	ME_HTTP_Request_t request = {method, path, NULL, NULL, NULL, body_len, Sim_HTTP_Source, Sim_HTTP_Sink, sink};
+
+	if(body_len != 0)
+	{
+		request.Header = "X-Id: 7";
+		request.ContentType = "text/plain";
+	}
+	memset(sink, 0, sizeof(Sim_HTTP_Sink_t));
+	return me_http_request(&request);
+}
+
+/**
+  * @brief  '"' or LF in the quoted AT+EHTTPSEND string, refused up front, or the
+  *         request failed at the piece it is in.
+  */
+static void Sim_HTTP_Refused(Me3616_DeviceType * Me3616, Sim_HTTP_Sink_t * sink)
+{
+	const ME_HTTP_t * http = ME_HTTP_Get();
+	Sim_HTTP_Server_t * server = &Sim_HTTP_Server;
+	ME_HTTP_Request_t request = {ME_HTTP_POST, "/up", "X-Id: \"7\"", "text/plain", NULL, SIM_HTTP_UP_LEN,
+	                             Sim_HTTP_Source, Sim_HTTP_Sink, sink};
+	uint32_t pieces = server->Pieces;
+	uint32_t failures = http->Failures;
+	static const char bad[] = {'"', '\n'};
+
+	memset(sink, 0, sizeof(Sim_HTTP_Sink_t));
+	Sim_Check(me_http_request(&request) == false, "HTTP header of '\"' refused");
+	request.Header = "X-Id: 7\nX-Up: 1";
+	Sim_Check(me_http_request(&request) == false, "HTTP header of LF refused");
+	request.Header = "X-Id: 7";
+	request.ContentType = "text/\"plain\"";
+	Sim_Check((me_http_request(&request) == false) && (server->Pieces == pieces) && (sink->Asked == 0) &&
+	          (http->State == ME_HTTP_IDLE), "HTTP content type of '\"' refused");
+	request.ContentType = "text/plain";
+
+	for(uint8_t i = 0; i < sizeof(bad); i++)
+	{
+		memset(sink, 0, sizeof(Sim_HTTP_Sink_t));
+		sink->Bad = bad[i];
+		pieces = server->Pieces;
+		Sim_Check(me_http_request(&request) == true, "HTTP request of a bad body taken");
+		Sim_HTTP_Run(Me3616);
+		Sim_Check((sink->Failed == 1) && (sink->Done == 0) && (http->Failures == failures + i + 1u) &&
+		          (server->Pieces != pieces) &&
+		          (server->Pieces - pieces < (http->Total + ME3616_HTTP_PIECE_SIZE - 1u) / ME3616_HTTP_PIECE_SIZE) &&
+		          (memchr(server->Data, bad[i], server->Len) == NULL), (i == 0) ? "HTTP body of '\"' fails" : "HTTP body of LF fails");
+		server->Len = 0;
+	}
+}
+
+static void Sim_HTTP(Me3616_DeviceType * Me3616)
+{
+	const ME_HTTP_t * http = ME_HTTP_Get();
+	Sim_HTTP_Server_t * server = &Sim_HTTP_Server;
+	Sim_HTTP_Sink_t sink;
+	uint32_t pieces = 0;
+
+	memset(server, 0, sizeof(Sim_HTTP_Server_t));
+	Sim_Set_Command_Hook(Sim_HTTP_Hook);
+
+	Sim_Check((me_http_open(Me3616, "http://10.0.0.4:8080/") == true) && (http->Id == 0) &&
+	          (strcmp(server->Create, "AT+EHTTPCREATE=0,32,32,\"http://10.0.0.4:8080/,,,0,,0,,0,\"") == 0) &&
+	          (strcmp(Sim_Modem_Last_Command(), "AT+EHTTPCON=0") == 0), "HTTP client by AT+EHTTPCREATE");
+
+	Sim_Check(Sim_HTTP_Request(ME_HTTP_GET, "/config", 0, &sink) == true, "HTTP GET by AT+EHTTPSEND");
+	Sim_HTTP_Run(Me3616);
+	Sim_Check((sink.Done == 1) && (sink.Failed == 0) && (http->Status == 200) && (sink.Header == sizeof(Sim_HTTP_Header) - 1) &&
+	          (sink.Content == SIM_HTTP_CONFIG_LEN) && (sink.Mismatch == false) &&
+	          (memcmp(sink.Text, "ABCDEFGHIJ", 10) == 0), "HTTP content past RxBuffer streamed");
+	Sim_Check((sink.Largest < ME3616_RX_BUFFER_SIZE) && (sink.Fragments > SIM_HTTP_CONFIG_LEN / ME3616_RX_BUFFER_SIZE),
+	          "HTTP content in fragments");
+
+	pieces = server->Pieces;
+	Sim_HTTP_Request(ME_HTTP_POST, "/up", SIM_HTTP_UP_LEN, &sink);
+	Sim_HTTP_Run(Me3616);
+	Sim_Check((sink.Done == 1) && (http->Status == 201) && (strcmp(sink.Text, "stored 400") == 0) &&
+	          (server->Broken == false) && (server->BodyOk == true) && (server->Body == SIM_HTTP_UP_LEN) &&
+	          (strcmp(server->Header, "X-Id: 7") == 0) && (strcmp(server->Type, "text/plain") == 0),
+	          "HTTP POST body from a source");
+	Sim_Check((server->Pieces - pieces == (http->Total + ME3616_HTTP_PIECE_SIZE - 1u) / ME3616_HTTP_PIECE_SIZE) &&
+	          (sink.Asked >= 3), "HTTP body in AT+EHTTPSEND pieces");
+
+	Sim_HTTP_Request(ME_HTTP_GET, "/empty", 0, &sink);
+	Sim_HTTP_Run(Me3616);
+	Sim_Check((sink.Done == 1) && (sink.Content == 0) && (http->Status == 204), "HTTP response of no content");
+
+	Sim_HTTP_Request(ME_HTTP_GET, "/fail", 0, &sink);
+	Sim_HTTP_Run(Me3616);
+	Sim_Check((sink.Failed == 1) && (sink.Done == 0) && (http->Error == 3), "HTTP request failed by +EHTTPERR");
+
+	Sim_HTTP_Request(ME_HTTP_DELETE, "/silent", 0, &sink);
+	Sim_HTTP_Run(Me3616);
+	Sim_Check((sink.Failed == 1) && (http->Failures == 2), "HTTP request of no answer times out");
+
+	Sim_HTTP_Refused(Me3616, &sink);
+
+	Sim_Check((me_http_close() == true) && (strcmp(Sim_Modem_Last_Command(), "AT+EHTTPDESTROY=0") == 0) &&
+	          (http->Id < 0), "HTTP client closed by AT+EHTTPDESTROY");
+	Sim_Set_Command_Hook(NULL);
+}
+
+static void Sim_CESQ_Latency(Me3616_DeviceType * Me3616, uint32_t count)
+{
+	uint64_t virtual_us = 0;
+	uint64_t host_ns = 0;
+	uint32_t ok = 0;
+	int32_t rsrp = 0;
+
+	for(uint32_t i = 0; i < count; i++)
+	{
+		uint64_t start_us = Sim_Now_us();
+		uint64_t start_ns = Host_Now_ns();
+
+		if(ME3616_Send_AT_Command(Me3616, AT_CMD_NETWORK_CESQ, AT_BASE, false, NULL) == true) ok++;
+
+		host_ns += Host_Now_ns() - start_ns;
+		virtual_us += Sim_Now_us() - start_us;
+	}
+
+	printf("AT+CESQ x %lu: %.2f ms virtual, %.1f us host CPU per command\n", (unsigned long)count,
+	       (double)virtual_us / count / 1000.0, (double)host_ns / count / 1000.0);
+	Sim_Check(ok == count, "AT+CESQ answered OK");
+	Sim_Check(AT_Response_Get_Int(ME3616_Get_Response(Me3616), 5, &rsrp) == true, "AT+CESQ rsrp parsed");
+}
+
+int main(int argc, char ** argv)
+{
+	static const AT_Step_t steps[] =
+	{
+		{AT_CMD_MODULE_CIMI,    AT_BASE,    NULL,   false},
+		{AT_CMD_NETWORK_CEREG,  AT_READ,    NULL,   true},
+		{AT_CMD_HARDWARE_ZADC,  AT_READ,    NULL,   true},
+		{AT_CMD_NETWORK_CSQ,    AT_BASE,    NULL,   false},
+	};
+	Me3616_DeviceType * Me3616 = &ME3616_Instance;
+	const Sim_Stats_t * stats = NULL;
+	char long_param[ME3616_TX_BUFFER_SIZE];
+	uint32_t count = 20;
+
+	Sim_Board_Init();
+
+	for(int i = 1; i < argc; i++)
+	{
+		if((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+		{
+			count = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if((strcmp(argv[i], "-d") == 0) && (i + 1 < argc))
+		{
+			if(Sim_Set_Dbg_Capture(argv[++i]) == false) return 2;
+		}
+		else if(Sim_Load_Script(argv[i]) == false)
+		{
+			return 2;
+		}
+	}
+	if(count == 0) count = 1;
+
+	printf("ME3616 host simulation, %lu us a char\n", (unsigned long)Sim_Modem_Char_us());
+
+	Sim_Check(ME3616_Init(Me3616, &ME3616_UART, &hdma_usart1_tx, &hdma_usart1_rx) == true, "boot");
+	Sim_Boot_Report(Me3616);
+	if(Sim_Failed == true) return 1;
+
+	Sim_CESQ_Latency(Me3616, count);
+
+	Sim_Check(ME3616_Run_Batch(Me3616, steps, sizeof(steps) / sizeof(steps[0])) == true, "batch CIMI;CEREG;ZADC, CSQ");
+
+	Sim_Check(ME3616_Send_AT_Command(Me3616, AT_CMD_LWM_M2MCLINEW, AT_SET, false,
+	                                 "180.101.147.115,5683,\"123456789012396\",300") == true, "AT+M2MCLINEW");
+	ME3616_Delay(Me3616, 1000);
+	Sim_Check(Get_Sys_State(Me3616, SYS_STATE_LWM_OBSERVE_SUCCESS) == true, "LWM2M registered and observed");
+
+	ME3616_Register_URC("+M2MCLIRECV", Sim_M2MCLIRECV);
+	Sim_Emit(50, "+M2MCLIRECV: 0A0B0C");
+	Sim_Emit(60, "+M2MCLIRECV: 0D0E0F");
+	ME3616_Delay(Me3616, 200);
+	Sim_Check(Sim_Recv_Count == 2, "+M2MCLIRECV dispatched");
+
+	//A line past TxBuffer is not sent cut, it reads as ERROR
+	memset(long_param, 'A', sizeof(long_param) - 1);
+	long_param[sizeof(long_param) - 1] = '\0';
+	Sim_Check((ME3616_Send_AT_Command(Me3616, AT_CMD_LWM_M2MCLISEND, AT_SET, false, long_param) == false) &&
+	          (Get_AT_State(Me3616) == AT_STATE_ATERR) &&
+	          (strncmp(Sim_Modem_Last_Command(), "AT+M2MCLISEND", 13) != 0), "line past TxBuffer refused");
+	Set_AT_Info(Me3616, AT_CMD_IGNORE, AT_ACTION_IGNORE, AT_STATE_NONE);
+
+	//EasyIoT SDK logs by the debug log too
+	setLogFormatOutputCb(Sim_SDK_Log);
+	EasyIotInit("861234567890123", "460113009509999");
+	Sim_Uplink(Me3616);
+	Sim_Downlink(Me3616);
+	Sim_Socket(Me3616);
+	Sim_MQTT(Me3616);
+	Sim_CoAP(Me3616);
+	Sim_HTTP(Me3616);
+
+	//Debug log goes out by UART2 DMA in the background, give it a second to catch up
+	for(uint32_t i = 0; (i < 1000) && (DBG_Log_Drain() == true); i++) Sim_Advance(1000);
+	Sim_Check(DBG_Log_Drain() == false, "debug log drained");
+
+	stats = Sim_Get_Stats();
+	printf("UART1: %lu bytes in, %lu bytes out, IDLE %lu, HT %lu, TC %lu, CM %lu\n",
+	       (unsigned long)stats->BytesToMcu, (unsigned long)stats->BytesFromMcu, (unsigned long)stats->IdleEvents,
+	       (unsigned long)stats->HalfEvents, (unsigned long)stats->FullEvents, (unsigned long)stats->MatchEvents);
+	printf("UART2: %lu bytes of debug log\n", (unsigned long)stats->BytesToDbg);
+
+	return (Sim_Failed == true) ? 1 : 0;
+}